@@ -0,0 +1,635 @@
+#include "AssetCooker.h"
+#include "MeshCooker.h"
+#include "PakWriter.h"
+#include "TextureCooker.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
+
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace
+{
+	const char* CacheFileName = "cook.cache";
+	const char* ManifestFileName = "assets.manifest";
+
+	FILE* OpenFile(const char* path, const char* mode)
+	{
+		FILE* file = 0;
+#ifdef _MSC_VER
+		if (fopen_s(&file, path, mode) != 0)
+			file = 0;
+#else
+		file = fopen(path, mode);
+#endif
+		return file;
+	}
+
+	bool ReadTextFile(const std::string& path, std::string& text)
+	{
+		FILE* file = OpenFile(path.c_str(), "rb");
+		if (!file)
+			return false;
+
+		text.clear();
+		char chunk[4096];
+		size_t read;
+		while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+			text.append(chunk, read);
+		fclose(file);
+		return true;
+	}
+
+	// Calls visit(name, isFolder) for each entry in a folder
+	template<typename F>
+	void ListFolder(const std::string& folder, F visit)
+	{
+#ifdef _WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((folder + "/*").c_str(), &data);
+		if (find == INVALID_HANDLE_VALUE)
+			return;
+		do
+		{
+			if (strcmp(data.cFileName, ".") != 0 && strcmp(data.cFileName, "..") != 0)
+				visit(std::string(data.cFileName), (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0);
+		} while (FindNextFileA(find, &data));
+		FindClose(find);
+#else
+		DIR* dir = opendir(folder.c_str());
+		if (!dir)
+			return;
+		while (dirent* entry = readdir(dir))
+		{
+			if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+				continue;
+			std::string name = entry->d_name;
+			struct stat info;
+			bool isFolder = stat((folder + "/" + name).c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+			visit(name, isFolder);
+		}
+		closedir(dir);
+#endif
+	}
+
+	void MakeFolder(const std::string& path)
+	{
+#ifdef _WIN32
+		_mkdir(path.c_str());
+#else
+		mkdir(path.c_str(), 0755);
+#endif
+	}
+
+	// Creates every missing folder leading up to a file.
+	// Folders that already exist (or that another thread just
+	// made) are fine.
+	void MakeFoldersFor(const std::string& filePath)
+	{
+		for (size_t slash = filePath.find('/', 1); slash != std::string::npos; slash = filePath.find('/', slash + 1))
+			MakeFolder(filePath.substr(0, slash));
+	}
+
+	bool ReplaceFile(const std::string& from, const std::string& to)
+	{
+#ifdef _WIN32
+		return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+		return rename(from.c_str(), to.c_str()) == 0;
+#endif
+	}
+
+	// Full path with / separators and no trailing slash
+	std::string CleanPath(std::string path)
+	{
+		std::replace(path.begin(), path.end(), '\\', '/');
+		while (path.size() > 1 && path[path.size() - 1] == '/')
+			path.erase(path.size() - 1);
+		return path;
+	}
+
+	std::string GetExtension(const std::string& path)
+	{
+		size_t dot = path.rfind('.');
+		size_t slash = path.rfind('/');
+		if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+			return std::string();
+
+		std::string extension = path.substr(dot + 1);
+		for (size_t i = 0; i < extension.size(); i++)
+			extension[i] = (char)tolower((unsigned char)extension[i]);
+		return extension;
+	}
+
+	// Reads "name = value" lines into a sorted list, so the
+	// same options always hash the same
+	void ParseOptions(const std::string& text, std::vector<std::pair<std::string, std::string> >& options)
+	{
+		size_t start = 0;
+		while (start < text.size())
+		{
+			size_t end = text.find('\n', start);
+			if (end == std::string::npos)
+				end = text.size();
+			std::string line = text.substr(start, end - start);
+			start = end + 1;
+
+			size_t comment = line.find('#');
+			if (comment != std::string::npos)
+				line.erase(comment);
+			size_t equals = line.find('=');
+			if (equals == std::string::npos)
+				continue;
+
+			std::string name = line.substr(0, equals);
+			std::string value = line.substr(equals + 1);
+			const char* space = " \t\r";
+			name.erase(0, name.find_first_not_of(space));
+			name.erase(name.find_last_not_of(space) + 1);
+			value.erase(0, value.find_first_not_of(space));
+			value.erase(value.find_last_not_of(space) + 1);
+			if (!name.empty())
+				options.push_back(std::make_pair(name, value));
+		}
+		std::sort(options.begin(), options.end());
+	}
+
+	std::string GetValue(const std::vector<std::pair<std::string, std::string> >& options, const char* name, const char* defaultValue)
+	{
+		for (size_t i = 0; i < options.size(); i++)
+		{
+			if (options[i].first == name)
+				return options[i].second;
+		}
+		return defaultValue;
+	}
+
+	bool GetFlag(const std::vector<std::pair<std::string, std::string> >& options, const char* name, bool defaultValue)
+	{
+		return atoi(GetValue(options, name, defaultValue ? "1" : "0").c_str()) != 0;
+	}
+
+	bool ContainsNoCase(const std::string& text, const char* word)
+	{
+		std::string lower = text;
+		for (size_t i = 0; i < lower.size(); i++)
+			lower[i] = (char)tolower((unsigned char)lower[i]);
+		return lower.find(word) != std::string::npos;
+	}
+
+	const char* GetResultName(CookResult result)
+	{
+		switch (result)
+		{
+		case CookResult_UpToDate:	return "up to date";
+		case CookResult_Cooked:		return "cooked";
+		case CookResult_Skipped:	return "skipped";
+		case CookResult_Failed:		return "FAILED";
+		default:					return "";
+		}
+	}
+}
+
+AssetCooker::AssetCooker(const CookSettings& _settings)
+	: settings(_settings),
+	threadCount(0),
+	wallMs(0.0)
+{
+	settings.sourceFolder = CleanPath(settings.sourceFolder);
+	settings.outputFolder = CleanPath(settings.outputFolder);
+}
+
+bool AssetCooker::Run()
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	assets.clear();
+	looseFiles.clear();
+	FindAssets(std::string());
+	std::sort(assets.begin(), assets.end(),
+		[](const Asset& a, const Asset& b) { return a.source < b.source; });
+
+	MakeFolder(settings.outputFolder);
+	if (!settings.force)
+		LoadCache();
+
+	// One asset per job - they vary too much in size to batch.
+	// With one thread the job system isn't started and the
+	// loop below runs them in order.
+	if (settings.threads != 1)
+		jobSystem.Init(settings.threads > 1 ? settings.threads - 1 : 0);
+	threadCount = jobSystem.GetWorkerCount() + 1;
+	jobSystem.ParallelFor((unsigned int)assets.size(), 1, [this](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+			CookAsset(assets[i]);
+	});
+
+	RemoveStaleOutputs();
+
+	AssetManifest manifest;
+	bool failed = false;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		const Asset& asset = assets[i];
+		failed |= asset.result == CookResult_Failed;
+		if (asset.result != CookResult_UpToDate && asset.result != CookResult_Cooked)
+			continue;
+
+		AssetManifestEntry entry;
+		entry.type = asset.type;
+		entry.source = asset.source;
+		entry.cooked = asset.cooked;
+		entry.hash = asset.cookedHash;
+		manifest.Add(entry);
+	}
+
+	if (!manifest.Save(OutputPath(ManifestFileName).c_str()))
+	{
+		printf("Can't write %s\n", OutputPath(ManifestFileName).c_str());
+		failed = true;
+	}
+	if (!SaveCache())
+	{
+		printf("Can't write %s\n", OutputPath(CacheFileName).c_str());
+		failed = true;
+	}
+	if (!settings.pakPath.empty() && !failed)
+		failed = !WritePak();
+	jobSystem.Shutdown();
+
+	wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return !failed;
+}
+
+void AssetCooker::PrintReport() const
+{
+	unsigned int counts[CookResult_Failed + 1] = {};
+	double cookMs = 0.0;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		const Asset& asset = assets[i];
+		counts[asset.result]++;
+		cookMs += asset.ms;
+		if (asset.result == CookResult_UpToDate && !settings.verbose)
+			continue;
+
+		printf("  %-10s %-40s %8.1f ms  %s\n", GetResultName(asset.result), asset.source.c_str(),
+			asset.ms, asset.message.c_str());
+	}
+
+	printf("%u cooked, %u up to date, %u skipped, %u failed - %.1f ms wall, %.1f ms of work on %u threads\n",
+		counts[CookResult_Cooked], counts[CookResult_UpToDate], counts[CookResult_Skipped], counts[CookResult_Failed],
+		wallMs, cookMs, threadCount);
+	if (!pakReport.empty())
+		printf("%s\n", pakReport.c_str());
+}
+
+// --------------------------------------------------------
+// Walks the source folder, leaving out the output folder in
+// case it is inside it
+// --------------------------------------------------------
+void AssetCooker::FindAssets(const std::string& folder)
+{
+	std::string fullFolder = folder.empty() ? settings.sourceFolder : SourcePath(folder);
+	if (fullFolder == settings.outputFolder)
+		return;
+
+	ListFolder(fullFolder, [this, &folder](const std::string& name, bool isFolder)
+	{
+		std::string relative = folder.empty() ? name : folder + "/" + name;
+		if (isFolder)
+			FindAssets(relative);
+		else
+			AddAsset(relative);
+	});
+}
+
+// --------------------------------------------------------
+// Decides what kind of asset a file is.  Formats we know but
+// can't cook yet are listed as skipped, so they show up in
+// the report; anything else is ignored.
+// --------------------------------------------------------
+void AssetCooker::AddAsset(const std::string& source)
+{
+	Asset asset;
+	asset.source = source;
+	asset.extension = GetExtension(source);
+	asset.sourceHash = 0;
+	asset.recipeHash = 0;
+	asset.cookedHash = 0;
+	asset.result = CookResult_Skipped;
+	asset.ms = 0.0;
+
+	const std::string& extension = asset.extension;
+	if (extension == "obj")
+	{
+		asset.type = CookedAssetType_Mesh;
+		asset.cooked = source + ".mesh";
+	}
+	else if (TextureCooker::CanDecode(extension))
+	{
+		asset.type = CookedAssetType_Texture;
+		asset.cooked = source + ".dds";
+	}
+	else if (extension == "dds" || extension == "cso")
+	{
+		looseFiles.push_back(source);
+		return;
+	}
+	else if (extension == "dae" || extension == "fbx")
+	{
+		asset.type = CookedAssetType_Mesh;
+		asset.message = "." + extension + " meshes aren't supported";
+	}
+	else
+	{
+		return;
+	}
+
+	assets.push_back(asset);
+}
+
+// --------------------------------------------------------
+// Runs on any job thread.  Only touches its own asset; the
+// cache is read-only while jobs run.  Big textures also
+// spread their blocks over the job system.
+// --------------------------------------------------------
+void AssetCooker::CookAsset(Asset& asset)
+{
+	if (asset.cooked.empty())
+		return;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// The options file, which may not exist
+	Dependency options;
+	options.path = asset.source + ".cook";
+	options.hash = 0;
+	std::string optionsText;
+	if (ReadTextFile(SourcePath(options.path), optionsText))
+		options.hash = HashBytes(optionsText.data(), optionsText.size(), 1);
+	asset.dependencies.push_back(options);
+
+	std::vector<std::pair<std::string, std::string> > values;
+	ParseOptions(optionsText, values);
+	if (GetFlag(values, "skip", false))
+	{
+		asset.message = "skip = 1 in " + options.path;
+		return;
+	}
+
+	if (!HashFile(SourcePath(asset.source).c_str(), asset.sourceHash))
+	{
+		asset.result = CookResult_Failed;
+		asset.message = "can't read source";
+		return;
+	}
+
+	std::string recipe = "version " + std::to_string(CookerVersion) + "\ntype " +
+		AssetManifest::GetTypeName(asset.type) + "\n";
+	for (size_t i = 0; i < values.size(); i++)
+		recipe += values[i].first + " = " + values[i].second + "\n";
+	asset.recipeHash = HashBytes(recipe.data(), recipe.size());
+
+	if (IsUpToDate(asset))
+	{
+		asset.cookedHash = cache.find(asset.source)->second.cookedHash;
+		asset.result = CookResult_UpToDate;
+		asset.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return;
+	}
+
+	// Cook to a temporary file, so a failed or interrupted cook
+	// never leaves a half-written file under the real name
+	std::string outputPath = OutputPath(asset.cooked);
+	std::string temporaryPath = outputPath + ".tmp";
+	MakeFoldersFor(outputPath);
+
+	bool cooked = false;
+	std::string sourcePath = SourcePath(asset.source);
+	if (asset.type == CookedAssetType_Mesh)
+	{
+		cooked = MeshCooker::Cook(sourcePath.c_str(), temporaryPath.c_str(), asset.message);
+	}
+	else
+	{
+		TextureCookOptions textureOptions;
+		textureOptions.mips = GetFlag(values, "mips", textureOptions.mips);
+		textureOptions.normalMap = GetFlag(values, "normalmap", ContainsNoCase(asset.source, "normal"));
+		textureOptions.linear = GetFlag(values, "linear", textureOptions.linear);
+		textureOptions.mipFilter = GetValue(values, "mipfilter", "kaiser") == "box" ? MipFilter_Box : MipFilter_Kaiser;
+		std::string format = GetValue(values, "format", "auto");
+		if (format != "auto")
+			textureOptions.format = TextureCooker::ParseFormat(format);
+
+		if (format != "auto" && textureOptions.format == DdsFormat_Unknown)
+			asset.message = "unknown format \"" + format + "\" in " + options.path;
+		else
+			cooked = TextureCooker::Cook(sourcePath.c_str(), temporaryPath.c_str(), textureOptions, &jobSystem, asset.message);
+	}
+
+	if (cooked && !ReplaceFile(temporaryPath, outputPath))
+	{
+		cooked = false;
+		asset.message = "can't replace " + asset.cooked;
+	}
+	if (cooked && !HashFile(outputPath.c_str(), asset.cookedHash))
+	{
+		cooked = false;
+		asset.message = "can't read back " + asset.cooked;
+	}
+	if (!cooked)
+		remove(temporaryPath.c_str());
+
+	asset.result = cooked ? CookResult_Cooked : CookResult_Failed;
+	asset.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// --------------------------------------------------------
+// Same source, options and dependencies as last time, and
+// the cooked file is still what we wrote
+// --------------------------------------------------------
+bool AssetCooker::IsUpToDate(const Asset& asset) const
+{
+	std::unordered_map<std::string, CacheEntry>::const_iterator it = cache.find(asset.source);
+	if (it == cache.end())
+		return false;
+
+	const CacheEntry& entry = it->second;
+	if (entry.sourceHash != asset.sourceHash || entry.recipeHash != asset.recipeHash ||
+		entry.cooked != asset.cooked || entry.dependencies.size() != asset.dependencies.size())
+		return false;
+
+	for (size_t i = 0; i < entry.dependencies.size(); i++)
+	{
+		if (entry.dependencies[i].path != asset.dependencies[i].path ||
+			entry.dependencies[i].hash != asset.dependencies[i].hash)
+			return false;
+	}
+
+	ContentHash cookedHash;
+	return HashFile(OutputPath(entry.cooked).c_str(), cookedHash) && cookedHash == entry.cookedHash;
+}
+
+// --------------------------------------------------------
+// Packs the results.  Cooked files go in under their paths
+// in the output folder, loose files under their source
+// paths, so the manifest inside works unchanged.
+// --------------------------------------------------------
+bool AssetCooker::WritePak()
+{
+	PakWriter writer;
+	writer.AddFile(ManifestFileName, OutputPath(ManifestFileName));
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (assets[i].result == CookResult_UpToDate || assets[i].result == CookResult_Cooked)
+			writer.AddFile(assets[i].cooked, OutputPath(assets[i].cooked));
+	}
+	for (size_t i = 0; i < looseFiles.size(); i++)
+		writer.AddFile(looseFiles[i], SourcePath(looseFiles[i]));
+
+	std::string error;
+	if (!writer.Load(&jobSystem, error))
+	{
+		pakReport = "Pak: " + error;
+		return false;
+	}
+
+	PakFile existing;
+	if (!settings.force && existing.Open(settings.pakPath.c_str()) &&
+		existing.GetHeader()->contentsHash == writer.GetContentsHash())
+	{
+		pakReport = "Pak: " + settings.pakPath + " is up to date";
+		return true;
+	}
+	existing.Close();
+
+	PakWriteStats stats;
+	if (!writer.Write(settings.pakPath.c_str(), &jobSystem, &stats))
+	{
+		pakReport = "Pak: can't write " + settings.pakPath;
+		return false;
+	}
+
+	char line[256];
+	snprintf(line, sizeof(line), "Pak: %u files (%u after removing duplicates, %u compressed), %.2f MB in, %.2f MB shared, %.2f MB written",
+		stats.entries, stats.uniqueEntries, stats.compressedEntries, stats.inputBytes / 1048576.0,
+		stats.duplicateBytes / 1048576.0, stats.fileBytes / 1048576.0);
+	pakReport = line;
+	return true;
+}
+
+// --------------------------------------------------------
+// One tab separated line per asset:
+//   source  sourceHash  recipeHash  cooked  cookedHash  [dependency  hash]...
+// --------------------------------------------------------
+bool AssetCooker::LoadCache()
+{
+	cache.clear();
+
+	std::string text;
+	if (!ReadTextFile(OutputPath(CacheFileName), text))
+		return false;
+
+	std::string header = "cook cache " + std::to_string(CookerVersion) + "\n";
+	if (text.compare(0, header.size(), header) != 0)
+		return false;
+
+	size_t start = header.size();
+	std::vector<std::string> fields;
+	while (start < text.size())
+	{
+		size_t end = text.find('\n', start);
+		if (end == std::string::npos)
+			end = text.size();
+
+		fields.clear();
+		size_t field = start;
+		for (;;)
+		{
+			size_t tab = text.find('\t', field);
+			if (tab == std::string::npos || tab > end)
+			{
+				fields.push_back(text.substr(field, end - field));
+				break;
+			}
+			fields.push_back(text.substr(field, tab - field));
+			field = tab + 1;
+		}
+		start = end + 1;
+
+		if (fields.size() < 5 || (fields.size() - 5) % 2 != 0)
+			continue;
+
+		CacheEntry entry;
+		bool valid = ParseHash(fields[1].c_str(), entry.sourceHash) &&
+			ParseHash(fields[2].c_str(), entry.recipeHash) &&
+			ParseHash(fields[4].c_str(), entry.cookedHash);
+		entry.cooked = fields[3];
+		for (size_t i = 5; valid && i < fields.size(); i += 2)
+		{
+			Dependency dependency;
+			dependency.path = fields[i];
+			valid = ParseHash(fields[i + 1].c_str(), dependency.hash);
+			entry.dependencies.push_back(dependency);
+		}
+		if (valid)
+			cache[fields[0]] = entry;
+	}
+	return true;
+}
+
+bool AssetCooker::SaveCache() const
+{
+	FILE* file = OpenFile(OutputPath(CacheFileName).c_str(), "wb");
+	if (!file)
+		return false;
+
+	fprintf(file, "cook cache %u\n", CookerVersion);
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		const Asset& asset = assets[i];
+		if (asset.result != CookResult_UpToDate && asset.result != CookResult_Cooked)
+			continue;
+
+		fprintf(file, "%s\t%s\t%s\t%s\t%s", asset.source.c_str(), FormatHash(asset.sourceHash).c_str(),
+			FormatHash(asset.recipeHash).c_str(), asset.cooked.c_str(), FormatHash(asset.cookedHash).c_str());
+		for (size_t d = 0; d < asset.dependencies.size(); d++)
+			fprintf(file, "\t%s\t%s", asset.dependencies[d].path.c_str(), FormatHash(asset.dependencies[d].hash).c_str());
+		fprintf(file, "\n");
+	}
+
+	bool failed = ferror(file) != 0;
+	return fclose(file) == 0 && !failed;
+}
+
+// --------------------------------------------------------
+// Deletes what was cooked for sources that have since gone
+// away or stopped being cooked
+// --------------------------------------------------------
+void AssetCooker::RemoveStaleOutputs() const
+{
+	std::unordered_set<std::string> live;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (assets[i].result == CookResult_UpToDate || assets[i].result == CookResult_Cooked)
+			live.insert(assets[i].cooked);
+	}
+
+	for (std::unordered_map<std::string, CacheEntry>::const_iterator it = cache.begin(); it != cache.end(); ++it)
+	{
+		if (live.find(it->second.cooked) == live.end())
+			remove(OutputPath(it->second.cooked).c_str());
+	}
+}
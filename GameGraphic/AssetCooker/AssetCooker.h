@@ -0,0 +1,136 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AssetManifest.h"
+#include "ContentHash.h"
+#include "JobSystem.h"
+
+struct CookSettings
+{
+	std::string		sourceFolder;
+	std::string		outputFolder;
+	std::string		pakPath;		// Also pack everything into this, if set
+	unsigned int	threads;		// 0 = one per core
+	bool			force;			// Ignore the cache and cook everything
+	bool			verbose;		// List up to date assets too
+
+	CookSettings() : threads(0), force(false), verbose(false) { }
+};
+
+enum CookResult
+{
+	CookResult_UpToDate,
+	CookResult_Cooked,
+	CookResult_Skipped,
+	CookResult_Failed
+};
+
+// --------------------------------------------------------
+// Converts everything under a source folder that the game
+// can use in a faster form, and writes a manifest the game
+// loads to find the results.
+//
+//  - OBJ meshes become cooked meshes (see CookedMesh)
+//  - Images ImageDecoder can read become block compressed
+//    DDS textures with their mips built
+//
+// Cooked files keep their source's relative path with an
+// extra extension (ironman.obj -> ironman.obj.mesh).
+//
+// A cache in the output folder remembers, for each asset,
+// the hashes of its source, its dependencies, the options it
+// was cooked with and the cooked file.  An asset is only
+// cooked again when one of those has changed.
+//
+// Options for one file go in a text file next to it with
+// ".cook" added (box.jpg.cook), one "name = value" per line:
+//   skip = 1		leave this file out
+//   mips = 0		textures: top level only
+//   mipfilter = box	textures: box or kaiser (the default)
+//   linear = 1		textures: data, not sRGB color, so mips
+//					average the stored values
+//   format = bc7	textures: rgba8, bc1, bc3, bc5 or bc7, with
+//					_srgb for color formats (default: picked
+//					from the image, see TextureCooker)
+//   normalmap = 1	textures: tangent space normals; defaults
+//					on for files with "normal" in their name
+// The options file is a dependency, so editing it re-cooks.
+//
+// Given a pak path, the manifest, every cooked file and the
+// files the game loads as they are (shaders and DDS) are also
+// packed into one pak file.  It is only rewritten when its contents change.
+//
+// Assets are cooked in parallel on the job system.
+// --------------------------------------------------------
+class AssetCooker
+{
+public:
+	// Bump when cooked output changes, to re-cook everything
+	static const unsigned int CookerVersion = 5;
+
+	explicit AssetCooker(const CookSettings& settings);
+
+	// Cooks what's out of date and writes the manifest.
+	// Returns false if anything failed.
+	bool Run();
+
+	void PrintReport() const;
+
+private:
+	struct Dependency
+	{
+		std::string		path;
+		ContentHash		hash;		// 0 if the file doesn't exist
+	};
+
+	struct Asset
+	{
+		std::string				source;			// Relative, with / separators
+		std::string				extension;		// Lower case, no dot
+		CookedAssetType			type;
+		std::string				cooked;			// Relative to the output folder
+
+		ContentHash				sourceHash;
+		ContentHash				recipeHash;		// Cooker version, type and options
+		ContentHash				cookedHash;
+		std::vector<Dependency>	dependencies;
+
+		CookResult				result;
+		std::string				message;
+		double					ms;
+	};
+
+	struct CacheEntry
+	{
+		ContentHash				sourceHash;
+		ContentHash				recipeHash;
+		std::string				cooked;
+		ContentHash				cookedHash;
+		std::vector<Dependency>	dependencies;
+	};
+
+	void FindAssets(const std::string& folder);
+	void AddAsset(const std::string& source);
+	void CookAsset(Asset& asset);
+	bool IsUpToDate(const Asset& asset) const;
+
+	bool WritePak();
+
+	bool LoadCache();
+	bool SaveCache() const;
+	void RemoveStaleOutputs() const;
+
+	std::string SourcePath(const std::string& relative) const { return settings.sourceFolder + "/" + relative; }
+	std::string OutputPath(const std::string& relative) const { return settings.outputFolder + "/" + relative; }
+
+	CookSettings									settings;
+	std::vector<Asset>								assets;
+	std::vector<std::string>						looseFiles;		// Used as they are
+	std::string										pakReport;
+	std::unordered_map<std::string, CacheEntry>		cache;
+	JobSystem										jobSystem;
+	unsigned int									threadCount;
+	double											wallMs;
+};
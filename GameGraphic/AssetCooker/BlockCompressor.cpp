@@ -0,0 +1,771 @@
+#include "BlockCompressor.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define BLOCK_COMPRESSOR_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	// One 4x4 block of texels, a plane per channel, so four
+	// texels of a channel load as one SSE register
+	struct Block
+	{
+		float	planes[4][16];
+	};
+
+	// BC7 interpolation weights for 4 bit indices, out of 64
+	const int Bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Power iterations used to find a block's principal axis
+	const int AxisIterations = 8;
+
+	int Clamp(int value, int low, int high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	int Round(float value)
+	{
+		return (int)floorf(value + 0.5f);
+	}
+
+	size_t GetBlockBytes(DdsFormat format)
+	{
+		return format == DdsFormat_BC1 || format == DdsFormat_BC1_SRGB ? 8 : 16;
+	}
+
+	void LoadBlock(const unsigned char* pixels, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block)
+	{
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			uint32_t sourceY = std::min(blockY * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				uint32_t sourceX = std::min(blockX * 4 + x, width - 1);
+				const unsigned char* texel = pixels + ((size_t)sourceY * width + sourceX) * 4;
+				for (int c = 0; c < 4; c++)
+					block.planes[c][y * 4 + x] = texel[c];
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Picks the nearest palette entry for each texel, comparing
+	// planeCount planes from firstPlane on.  palette[i] holds
+	// entry i's value for each of those planes.  Returns the
+	// total squared error.
+	// --------------------------------------------------------
+	float FitIndices(const Block& block, int firstPlane, int planeCount,
+		const float (*palette)[4], int paletteCount, uint8_t indices[16])
+	{
+		float total = 0.0f;
+#ifdef BLOCK_COMPRESSOR_SSE
+		for (int group = 0; group < 16; group += 4)
+		{
+			__m128 texels[4];
+			for (int p = 0; p < planeCount; p++)
+				texels[p] = _mm_loadu_ps(&block.planes[firstPlane + p][group]);
+
+			__m128 bestError = _mm_set1_ps(FLT_MAX);
+			__m128 bestIndex = _mm_setzero_ps();
+			for (int i = 0; i < paletteCount; i++)
+			{
+				__m128 error = _mm_setzero_ps();
+				for (int p = 0; p < planeCount; p++)
+				{
+					__m128 difference = _mm_sub_ps(texels[p], _mm_set1_ps(palette[i][p]));
+					error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+				}
+				__m128 better = _mm_cmplt_ps(error, bestError);
+				bestError = _mm_min_ps(error, bestError);
+				bestIndex = _mm_or_ps(_mm_and_ps(better, _mm_set1_ps((float)i)), _mm_andnot_ps(better, bestIndex));
+			}
+
+			float errors[4];
+			float best[4];
+			_mm_storeu_ps(errors, bestError);
+			_mm_storeu_ps(best, bestIndex);
+			for (int k = 0; k < 4; k++)
+			{
+				indices[group + k] = (uint8_t)best[k];
+				total += errors[k];
+			}
+		}
+#else
+		for (int t = 0; t < 16; t++)
+		{
+			float bestError = FLT_MAX;
+			for (int i = 0; i < paletteCount; i++)
+			{
+				float error = 0.0f;
+				for (int p = 0; p < planeCount; p++)
+				{
+					float difference = block.planes[firstPlane + p][t] - palette[i][p];
+					error += difference * difference;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					indices[t] = (uint8_t)i;
+				}
+			}
+			total += bestError;
+		}
+#endif
+		return total;
+	}
+
+	// --------------------------------------------------------
+	// The direction the block's texels spread along most, over
+	// planeCount planes.  Also returns their mean.
+	// --------------------------------------------------------
+	void FindAxis(const Block& block, int planeCount, float mean[4], float axis[4])
+	{
+		for (int p = 0; p < planeCount; p++)
+		{
+			mean[p] = 0.0f;
+			for (int t = 0; t < 16; t++)
+				mean[p] += block.planes[p][t];
+			mean[p] /= 16.0f;
+		}
+
+		float covariance[4][4] = {};
+		for (int t = 0; t < 16; t++)
+		{
+			for (int a = 0; a < planeCount; a++)
+			{
+				float da = block.planes[a][t] - mean[a];
+				for (int b = a; b < planeCount; b++)
+					covariance[a][b] += da * (block.planes[b][t] - mean[b]);
+			}
+		}
+		for (int a = 0; a < planeCount; a++)
+		{
+			for (int b = 0; b < a; b++)
+				covariance[a][b] = covariance[b][a];
+		}
+
+		// Power iteration, starting from the widest channel
+		int widest = 0;
+		for (int p = 1; p < planeCount; p++)
+		{
+			if (covariance[p][p] > covariance[widest][widest])
+				widest = p;
+		}
+		for (int p = 0; p < planeCount; p++)
+			axis[p] = covariance[widest][p];
+
+		for (int iteration = 0; iteration < AxisIterations; iteration++)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < planeCount; a++)
+			{
+				for (int b = 0; b < planeCount; b++)
+					next[a] += covariance[a][b] * axis[b];
+				length = std::max(length, fabsf(next[a]));
+			}
+			if (length < 1e-6f)
+				break;
+			for (int p = 0; p < planeCount; p++)
+				axis[p] = next[p] / length;
+		}
+
+		float length = 0.0f;
+		for (int p = 0; p < planeCount; p++)
+			length += axis[p] * axis[p];
+		length = sqrtf(length);
+		for (int p = 0; p < planeCount; p++)
+			axis[p] = length > 1e-6f ? axis[p] / length : 1.0f / sqrtf((float)planeCount);
+	}
+
+	// Where the texels reach along an axis through the mean
+	void FindExtents(const Block& block, int planeCount, const float mean[4], const float axis[4],
+		float low[4], float high[4])
+	{
+		float lowest = FLT_MAX;
+		float highest = -FLT_MAX;
+		for (int t = 0; t < 16; t++)
+		{
+			float projection = 0.0f;
+			for (int p = 0; p < planeCount; p++)
+				projection += (block.planes[p][t] - mean[p]) * axis[p];
+			lowest = std::min(lowest, projection);
+			highest = std::max(highest, projection);
+		}
+		for (int p = 0; p < planeCount; p++)
+		{
+			low[p] = std::min(std::max(mean[p] + axis[p] * lowest, 0.0f), 255.0f);
+			high[p] = std::min(std::max(mean[p] + axis[p] * highest, 0.0f), 255.0f);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Least squares endpoints for a set of indices: each texel
+	// is weights[index] of the way from end0 to end1.  Returns
+	// false if every texel uses the same weight.
+	// --------------------------------------------------------
+	bool SolveEndpoints(const Block& block, int firstPlane, int planeCount, const uint8_t indices[16],
+		const float* weights, float end0[4], float end1[4])
+	{
+		float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+		float ax[4] = {};
+		float bx[4] = {};
+		for (int t = 0; t < 16; t++)
+		{
+			float b = weights[indices[t]];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int p = 0; p < planeCount; p++)
+			{
+				ax[p] += a * block.planes[firstPlane + p][t];
+				bx[p] += b * block.planes[firstPlane + p][t];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (fabsf(determinant) < 1e-6f)
+			return false;
+
+		for (int p = 0; p < planeCount; p++)
+		{
+			end0[p] = std::min(std::max((ax[p] * bb - bx[p] * ab) / determinant, 0.0f), 255.0f);
+			end1[p] = std::min(std::max((bx[p] * aa - ax[p] * ab) / determinant, 0.0f), 255.0f);
+		}
+		return true;
+	}
+
+	// ----------------------------------------------------
+	// BC1 color
+	// ----------------------------------------------------
+
+	void Expand565(uint16_t color, float rgb[4])
+	{
+		int r = color >> 11;
+		int g = (color >> 5) & 63;
+		int b = color & 31;
+		rgb[0] = (float)((r << 3) | (r >> 2));
+		rgb[1] = (float)((g << 2) | (g >> 4));
+		rgb[2] = (float)((b << 3) | (b >> 2));
+		rgb[3] = 255.0f;
+	}
+
+	uint16_t Quantize565(const float rgb[4])
+	{
+		int r = Clamp(Round(rgb[0] * 31.0f / 255.0f), 0, 31);
+		int g = Clamp(Round(rgb[1] * 63.0f / 255.0f), 0, 63);
+		int b = Clamp(Round(rgb[2] * 31.0f / 255.0f), 0, 31);
+		return (uint16_t)((r << 11) | (g << 5) | b);
+	}
+
+	// The 4 color palette, as the decoder builds it
+	int BuildColorPalette(uint16_t color0, uint16_t color1, float palette[4][4])
+	{
+		Expand565(color0, palette[0]);
+		Expand565(color1, palette[1]);
+		if (color0 == color1)
+			return 1;
+		for (int c = 0; c < 4; c++)
+		{
+			int a = (int)palette[0][c];
+			int b = (int)palette[1][c];
+			palette[2][c] = (float)((2 * a + b + 1) / 3);
+			palette[3][c] = (float)((a + 2 * b + 1) / 3);
+		}
+		return 4;
+	}
+
+	// For flat blocks: the endpoint pair per 8 bit value whose
+	// 2/3 point lands closest, for 5 and 6 bit channels
+	struct SolidColorTable
+	{
+		uint8_t		pairs[2][256][2];
+
+		SolidColorTable()
+		{
+			for (int table = 0; table < 2; table++)
+			{
+				int bits = table == 0 ? 5 : 6;
+				int levels = 1 << bits;
+				for (int value = 0; value < 256; value++)
+				{
+					int bestError = 256;
+					for (int high = 0; high < levels; high++)
+					{
+						for (int low = 0; low < levels; low++)
+						{
+							int a = (high << (8 - bits)) | (high >> (2 * bits - 8));
+							int b = (low << (8 - bits)) | (low >> (2 * bits - 8));
+							int error = abs((2 * a + b + 1) / 3 - value);
+							if (error < bestError)
+							{
+								bestError = error;
+								pairs[table][value][0] = (uint8_t)high;
+								pairs[table][value][1] = (uint8_t)low;
+							}
+						}
+					}
+				}
+			}
+		}
+	};
+
+	const SolidColorTable& GetSolidColorTable()
+	{
+		static const SolidColorTable table;
+		return table;
+	}
+
+	// Fits indices for a pair of endpoints and writes the block,
+	// always in 4 color mode so it also suits BC3
+	float PackColor(const Block& block, uint16_t color0, uint16_t color1, uint8_t indices[16], unsigned char* out)
+	{
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		float palette[4][4];
+		int count = BuildColorPalette(color0, color1, palette);
+		float error = FitIndices(block, 0, 3, palette, count, indices);
+
+		uint32_t bits = 0;
+		for (int t = 0; t < 16; t++)
+			bits |= (uint32_t)indices[t] << (t * 2);
+		out[0] = (unsigned char)color0;
+		out[1] = (unsigned char)(color0 >> 8);
+		out[2] = (unsigned char)color1;
+		out[3] = (unsigned char)(color1 >> 8);
+		memcpy(out + 4, &bits, 4);
+		return error;
+	}
+
+	void EncodeColor(const Block& block, unsigned char* out)
+	{
+		uint8_t indices[16];
+		bool solid = true;
+		for (int t = 1; t < 16 && solid; t++)
+		{
+			for (int c = 0; c < 3; c++)
+				solid &= block.planes[c][t] == block.planes[c][0];
+		}
+		if (solid)
+		{
+			const SolidColorTable& table = GetSolidColorTable();
+			int r = (int)block.planes[0][0];
+			int g = (int)block.planes[1][0];
+			int b = (int)block.planes[2][0];
+			uint16_t color0 = (uint16_t)((table.pairs[0][r][0] << 11) | (table.pairs[1][g][0] << 5) | table.pairs[0][b][0]);
+			uint16_t color1 = (uint16_t)((table.pairs[0][r][1] << 11) | (table.pairs[1][g][1] << 5) | table.pairs[0][b][1]);
+			PackColor(block, color0, color1, indices, out);
+			return;
+		}
+
+		float mean[4], axis[4], low[4], high[4];
+		FindAxis(block, 3, mean, axis);
+		FindExtents(block, 3, mean, axis, low, high);
+		float bestError = PackColor(block, Quantize565(high), Quantize565(low), indices, out);
+
+		// Weight of color1 for each index
+		static const float weights[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+		for (int pass = 0; pass < 2 && bestError > 0.0f; pass++)
+		{
+			float end0[4], end1[4];
+			if (!SolveEndpoints(block, 0, 3, indices, weights, end0, end1))
+				break;
+
+			unsigned char candidate[8];
+			uint8_t candidateIndices[16];
+			float error = PackColor(block, Quantize565(end0), Quantize565(end1), candidateIndices, candidate);
+			if (error >= bestError)
+				break;
+			bestError = error;
+			memcpy(out, candidate, sizeof(candidate));
+			memcpy(indices, candidateIndices, sizeof(candidateIndices));
+		}
+	}
+
+	// ----------------------------------------------------
+	// BC4 single channel (BC3 alpha, BC5 red and green)
+	// ----------------------------------------------------
+
+	int BuildChannelPalette(int value0, int value1, float palette[8][4])
+	{
+		palette[0][0] = (float)value0;
+		palette[1][0] = (float)value1;
+		if (value0 == value1)
+			return 1;
+		for (int i = 2; i < 8; i++)
+			palette[i][0] = (float)(((8 - i) * value0 + (i - 1) * value1 + 3) / 7);
+		return 8;
+	}
+
+	// value0 must not be less than value1, which picks the 8
+	// level mode
+	float PackChannel(const Block& block, int plane, int value0, int value1, uint8_t indices[16], unsigned char* out)
+	{
+		float palette[8][4];
+		int count = BuildChannelPalette(value0, value1, palette);
+		float error = FitIndices(block, plane, 1, palette, count, indices);
+
+		uint64_t bits = 0;
+		for (int t = 0; t < 16; t++)
+			bits |= (uint64_t)indices[t] << (t * 3);
+		out[0] = (unsigned char)value0;
+		out[1] = (unsigned char)value1;
+		for (int i = 0; i < 6; i++)
+			out[2 + i] = (unsigned char)(bits >> (i * 8));
+		return error;
+	}
+
+	void EncodeChannel(const Block& block, int plane, unsigned char* out)
+	{
+		float lowest = 255.0f;
+		float highest = 0.0f;
+		for (int t = 0; t < 16; t++)
+		{
+			lowest = std::min(lowest, block.planes[plane][t]);
+			highest = std::max(highest, block.planes[plane][t]);
+		}
+
+		uint8_t indices[16];
+		float bestError = PackChannel(block, plane, (int)highest, (int)lowest, indices, out);
+
+		// Weight of value1 for each index
+		static const float weights[8] = { 0.0f, 1.0f, 1 / 7.0f, 2 / 7.0f, 3 / 7.0f, 4 / 7.0f, 5 / 7.0f, 6 / 7.0f };
+		float end0[4], end1[4];
+		if (bestError > 0.0f && SolveEndpoints(block, plane, 1, indices, weights, end0, end1))
+		{
+			int value0 = Round(end0[0]);
+			int value1 = Round(end1[0]);
+			if (value0 < value1)
+				std::swap(value0, value1);
+
+			unsigned char candidate[8];
+			uint8_t candidateIndices[16];
+			if (value0 != value1 && PackChannel(block, plane, value0, value1, candidateIndices, candidate) < bestError)
+				memcpy(out, candidate, sizeof(candidate));
+		}
+	}
+
+	// ----------------------------------------------------
+	// BC7 mode 6: RGBA, one subset, 7 bit endpoints plus a
+	// shared low bit each, 4 bit indices
+	// ----------------------------------------------------
+
+	struct Bc7Endpoint
+	{
+		int		values[4];		// 7 bits
+		int		pbit;
+	};
+
+	Bc7Endpoint QuantizeBc7(const float color[4])
+	{
+		Bc7Endpoint best = {};
+		float bestError = FLT_MAX;
+		for (int pbit = 0; pbit < 2; pbit++)
+		{
+			Bc7Endpoint endpoint;
+			endpoint.pbit = pbit;
+			float error = 0.0f;
+			for (int c = 0; c < 4; c++)
+			{
+				endpoint.values[c] = Clamp(Round((color[c] - pbit) / 2.0f), 0, 127);
+				float difference = (float)((endpoint.values[c] << 1) | pbit) - color[c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				best = endpoint;
+			}
+		}
+		return best;
+	}
+
+	void BuildBc7Palette(const Bc7Endpoint& end0, const Bc7Endpoint& end1, float palette[16][4])
+	{
+		for (int c = 0; c < 4; c++)
+		{
+			int a = (end0.values[c] << 1) | end0.pbit;
+			int b = (end1.values[c] << 1) | end1.pbit;
+			for (int i = 0; i < 16; i++)
+				palette[i][c] = (float)(((64 - Bc7Weights[i]) * a + Bc7Weights[i] * b + 32) >> 6);
+		}
+	}
+
+	// Least significant bit first, as BC7 is laid out
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(unsigned char* _out) : out(_out), position(0) { memset(out, 0, 16); }
+
+		void Write(uint32_t value, int count)
+		{
+			for (int i = 0; i < count; i++, position++)
+				out[position >> 3] |= (unsigned char)(((value >> i) & 1) << (position & 7));
+		}
+
+	private:
+		unsigned char*	out;
+		int				position;
+	};
+
+	uint32_t ReadBits(const unsigned char* data, int& position, int count)
+	{
+		uint32_t value = 0;
+		for (int i = 0; i < count; i++, position++)
+			value |= (uint32_t)((data[position >> 3] >> (position & 7)) & 1) << i;
+		return value;
+	}
+
+	float PackBc7(const Block& block, Bc7Endpoint end0, Bc7Endpoint end1, uint8_t indices[16], unsigned char* out)
+	{
+		float palette[16][4];
+		BuildBc7Palette(end0, end1, palette);
+		float error = FitIndices(block, 0, 4, palette, 16, indices);
+
+		// The first texel's index has its top bit left out, so
+		// it must be under 8.  The weights are symmetric, so
+		// swapping the ends and flipping the indices fixes it.
+		if (indices[0] >= 8)
+		{
+			std::swap(end0, end1);
+			for (int t = 0; t < 16; t++)
+				indices[t] = (uint8_t)(15 - indices[t]);
+		}
+
+		BitWriter writer(out);
+		writer.Write(1 << 6, 7);
+		for (int c = 0; c < 4; c++)
+		{
+			writer.Write(end0.values[c], 7);
+			writer.Write(end1.values[c], 7);
+		}
+		writer.Write(end0.pbit, 1);
+		writer.Write(end1.pbit, 1);
+		writer.Write(indices[0], 3);
+		for (int t = 1; t < 16; t++)
+			writer.Write(indices[t], 4);
+		return error;
+	}
+
+	void EncodeBc7(const Block& block, unsigned char* out)
+	{
+		float mean[4], axis[4], low[4], high[4];
+		FindAxis(block, 4, mean, axis);
+		FindExtents(block, 4, mean, axis, low, high);
+
+		uint8_t indices[16];
+		float bestError = PackBc7(block, QuantizeBc7(low), QuantizeBc7(high), indices, out);
+
+		float weights[16];
+		for (int i = 0; i < 16; i++)
+			weights[i] = Bc7Weights[i] / 64.0f;
+		for (int pass = 0; pass < 2 && bestError > 0.0f; pass++)
+		{
+			float end0[4], end1[4];
+			if (!SolveEndpoints(block, 0, 4, indices, weights, end0, end1))
+				break;
+
+			unsigned char candidate[16];
+			uint8_t candidateIndices[16];
+			float error = PackBc7(block, QuantizeBc7(end0), QuantizeBc7(end1), candidateIndices, candidate);
+			if (error >= bestError)
+				break;
+			bestError = error;
+			memcpy(out, candidate, sizeof(candidate));
+			memcpy(indices, candidateIndices, sizeof(candidateIndices));
+		}
+	}
+
+	// ----------------------------------------------------
+	// Decoding, into 16 RGBA texels
+	// ----------------------------------------------------
+
+	void DecodeColor(const unsigned char* in, unsigned char texels[16][4])
+	{
+		uint16_t color0 = (uint16_t)(in[0] | (in[1] << 8));
+		uint16_t color1 = (uint16_t)(in[2] | (in[3] << 8));
+		uint32_t bits;
+		memcpy(&bits, in + 4, 4);
+
+		float palette[4][4];
+		BuildColorPalette(color0, color1, palette);
+		for (int t = 0; t < 16; t++)
+		{
+			int index = (bits >> (t * 2)) & 3;
+			if (color0 == color1)
+				index = 0;
+			for (int c = 0; c < 3; c++)
+				texels[t][c] = (unsigned char)palette[index][c];
+		}
+	}
+
+	void DecodeChannel(const unsigned char* in, int channel, unsigned char texels[16][4])
+	{
+		int value0 = in[0];
+		int value1 = in[1];
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; i++)
+			bits |= (uint64_t)in[2 + i] << (i * 8);
+
+		// The 6 level mode, with 0 and 255 as the last two
+		int palette[8];
+		palette[0] = value0;
+		palette[1] = value1;
+		for (int i = 2; i < 8; i++)
+		{
+			if (value0 > value1)
+				palette[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+			else if (i < 6)
+				palette[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+			else
+				palette[i] = i == 6 ? 0 : 255;
+		}
+		for (int t = 0; t < 16; t++)
+			texels[t][channel] = (unsigned char)palette[(bits >> (t * 3)) & 7];
+	}
+
+	bool DecodeBc7(const unsigned char* in, unsigned char texels[16][4])
+	{
+		if ((in[0] & 0x7F) != 0x40)
+			return false;
+
+		int position = 7;
+		Bc7Endpoint end0, end1;
+		for (int c = 0; c < 4; c++)
+		{
+			end0.values[c] = (int)ReadBits(in, position, 7);
+			end1.values[c] = (int)ReadBits(in, position, 7);
+		}
+		end0.pbit = (int)ReadBits(in, position, 1);
+		end1.pbit = (int)ReadBits(in, position, 1);
+
+		float palette[16][4];
+		BuildBc7Palette(end0, end1, palette);
+		for (int t = 0; t < 16; t++)
+		{
+			int index = (int)ReadBits(in, position, t == 0 ? 3 : 4);
+			for (int c = 0; c < 4; c++)
+				texels[t][c] = (unsigned char)palette[index][c];
+		}
+		return true;
+	}
+}
+
+bool BlockCompressor::CanCompress(DdsFormat format)
+{
+	switch (format)
+	{
+	case DdsFormat_BC1:
+	case DdsFormat_BC1_SRGB:
+	case DdsFormat_BC3:
+	case DdsFormat_BC3_SRGB:
+	case DdsFormat_BC5:
+	case DdsFormat_BC7:
+	case DdsFormat_BC7_SRGB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+void BlockCompressor::Compress(const unsigned char* pixels, uint32_t width, uint32_t height,
+	DdsFormat format, unsigned char* dest, JobSystem* jobSystem)
+{
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+	size_t blockBytes = GetBlockBytes(format);
+
+	auto compressRows = [=](unsigned int begin, unsigned int end)
+	{
+		Block block;
+		for (uint32_t blockY = begin; blockY < end; blockY++)
+		{
+			unsigned char* out = dest + (size_t)blockY * blocksWide * blockBytes;
+			for (uint32_t blockX = 0; blockX < blocksWide; blockX++, out += blockBytes)
+			{
+				LoadBlock(pixels, width, height, blockX, blockY, block);
+				switch (format)
+				{
+				case DdsFormat_BC1:
+				case DdsFormat_BC1_SRGB:
+					EncodeColor(block, out);
+					break;
+				case DdsFormat_BC3:
+				case DdsFormat_BC3_SRGB:
+					EncodeChannel(block, 3, out);
+					EncodeColor(block, out + 8);
+					break;
+				case DdsFormat_BC5:
+					EncodeChannel(block, 0, out);
+					EncodeChannel(block, 1, out + 8);
+					break;
+				default:
+					EncodeBc7(block, out);
+					break;
+				}
+			}
+		}
+	};
+
+	if (jobSystem)
+		jobSystem->ParallelFor(blocksHigh, 1, compressRows);
+	else
+		compressRows(0, blocksHigh);
+}
+
+bool BlockCompressor::Decompress(const unsigned char* blocks, uint32_t width, uint32_t height,
+	DdsFormat format, unsigned char* pixels)
+{
+	if (!CanCompress(format))
+		return false;
+
+	uint32_t blocksWide = (width + 3) / 4;
+	uint32_t blocksHigh = (height + 3) / 4;
+	size_t blockBytes = GetBlockBytes(format);
+	for (uint32_t blockY = 0; blockY < blocksHigh; blockY++)
+	{
+		for (uint32_t blockX = 0; blockX < blocksWide; blockX++, blocks += blockBytes)
+		{
+			unsigned char texels[16][4];
+			memset(texels, 255, sizeof(texels));
+			switch (format)
+			{
+			case DdsFormat_BC1:
+			case DdsFormat_BC1_SRGB:
+				DecodeColor(blocks, texels);
+				break;
+			case DdsFormat_BC3:
+			case DdsFormat_BC3_SRGB:
+				DecodeChannel(blocks, 3, texels);
+				DecodeColor(blocks + 8, texels);
+				break;
+			case DdsFormat_BC5:
+				DecodeChannel(blocks, 0, texels);
+				DecodeChannel(blocks + 8, 1, texels);
+				for (int t = 0; t < 16; t++)
+					texels[t][2] = 0;
+				break;
+			default:
+				if (!DecodeBc7(blocks, texels))
+					return false;
+				break;
+			}
+
+			for (uint32_t y = 0; y < 4 && blockY * 4 + y < height; y++)
+			{
+				for (uint32_t x = 0; x < 4 && blockX * 4 + x < width; x++)
+					memcpy(pixels + ((size_t)(blockY * 4 + y) * width + blockX * 4 + x) * 4, texels[y * 4 + x], 4);
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include "DdsFile.h"
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Encodes RGBA8 images into the block compressed formats the
+// GPU samples directly, at a quarter (BC3, BC5, BC7) or an
+// eighth (BC1) of the memory.
+//
+//  - BC1: opaque color
+//  - BC3: color plus a smooth alpha channel
+//  - BC5: two channels, for normal maps (x and y; the shader
+//    rebuilds z)
+//  - BC7: color and alpha at better quality than BC3.  Only
+//    mode 6 (one subset, 7 bit endpoints) is written.
+//
+// Endpoints come from the principal axis of each block's
+// colors and are then refined by least squares.  Picking the
+// nearest palette entry for every texel is the inner loop,
+// and uses SSE where the compiler has it.
+//
+// Decompress() reads back what Compress() writes, so the
+// quality can be measured.
+// --------------------------------------------------------
+class BlockCompressor
+{
+public:
+	// True for formats Compress() can write (sRGB or not)
+	static bool CanCompress(DdsFormat format);
+
+	// Compresses a surface of tightly packed RGBA8 pixels into
+	// DdsFile::GetSurfaceSize(format, width, height) bytes.
+	// Edge blocks repeat the last row and column.  Rows of
+	// blocks are spread over the job system if one is given.
+	static void Compress(const unsigned char* pixels, uint32_t width, uint32_t height,
+		DdsFormat format, unsigned char* dest, JobSystem* jobSystem = 0);
+
+	// Back to RGBA8.  Channels the format doesn't hold come
+	// back as 0 (BC5 blue) or 255 (alpha).
+	static bool Decompress(const unsigned char* blocks, uint32_t width, uint32_t height,
+		DdsFormat format, unsigned char* pixels);
+
+private:
+	BlockCompressor();
+};
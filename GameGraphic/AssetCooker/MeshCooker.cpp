@@ -0,0 +1,321 @@
+#include "MeshCooker.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+
+namespace
+{
+	struct Float3 { float x, y, z; };
+	struct Float2 { float x, y; };
+
+	// One face corner: position, UV and normal indices, 0-based,
+	// -1 where the face doesn't give one
+	struct Corner
+	{
+		int position;
+		int uv;
+		int normal;
+	};
+
+	struct CornerHash
+	{
+		size_t operator()(const Corner& c) const
+		{
+			return ((size_t)c.position * 73856093u) ^ ((size_t)(c.uv + 1) * 19349663u) ^ ((size_t)(c.normal + 1) * 83492791u);
+		}
+	};
+
+	struct CornerEqual
+	{
+		bool operator()(const Corner& a, const Corner& b) const
+		{
+			return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+		}
+	};
+
+	// OBJ indices are 1-based; negative ones count back from the end
+	int ResolveIndex(long index, size_t count)
+	{
+		if (index > 0)
+			return index <= (long)count ? (int)(index - 1) : -2;
+		if (index < 0)
+			return -index <= (long)count ? (int)(count + index) : -2;
+		return -1;
+	}
+
+	// Reads "v", "v/t", "v//n" or "v/t/n".  Moves text past it.
+	bool ParseCorner(const char*& text, size_t positions, size_t uvs, size_t normals, Corner& corner)
+	{
+		char* end;
+		long index = strtol(text, &end, 10);
+		if (end == text)
+			return false;
+		corner.position = ResolveIndex(index, positions);
+		corner.uv = -1;
+		corner.normal = -1;
+		text = end;
+
+		if (*text == '/')
+		{
+			text++;
+			if (*text != '/')
+			{
+				index = strtol(text, &end, 10);
+				corner.uv = end == text ? -1 : ResolveIndex(index, uvs);
+				text = end;
+			}
+			if (*text == '/')
+			{
+				text++;
+				index = strtol(text, &end, 10);
+				corner.normal = end == text ? -1 : ResolveIndex(index, normals);
+				text = end;
+			}
+		}
+		return corner.position >= 0 && corner.uv != -2 && corner.normal != -2;
+	}
+
+	// Reads up to count numbers; missing ones are left alone
+	void ParseFloats(const char* text, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			char* end;
+			float value = strtof(text, &end);
+			if (end == text)
+				break;
+			values[i] = value;
+			text = end;
+		}
+	}
+
+	Float3 Subtract(const Float3& a, const Float3& b)
+	{
+		Float3 result = { a.x - b.x, a.y - b.y, a.z - b.z };
+		return result;
+	}
+
+	Float3 Normalize(const Float3& v)
+	{
+		float length = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+		Float3 result = { 0.0f, 0.0f, 0.0f };
+		if (length > 0.0f)
+		{
+			result.x = v.x / length;
+			result.y = v.y / length;
+			result.z = v.z / length;
+		}
+		return result;
+	}
+}
+
+bool MeshCooker::ParseObj(const char* path, std::vector<CookedVertex>& vertices,
+	std::vector<uint32_t>& indices, std::string& error)
+{
+	vertices.clear();
+	indices.clear();
+
+	std::ifstream obj(path);
+	if (!obj.is_open())
+	{
+		error = "can't open file";
+		return false;
+	}
+
+	std::vector<Float3> positions;
+	std::vector<Float2> uvs;
+	std::vector<Float3> normals;
+	std::unordered_map<Corner, uint32_t, CornerHash, CornerEqual> welded;
+	std::vector<Corner> face;
+	std::string line;
+	unsigned int lineNumber = 0;
+
+	while (std::getline(obj, line))
+	{
+		lineNumber++;
+		const char* text = line.c_str();
+		while (*text == ' ' || *text == '\t')
+			text++;
+
+		if (text[0] == 'v' && text[1] == 'n')
+		{
+			Float3 normal = { 0.0f, 0.0f, 0.0f };
+			ParseFloats(text + 2, &normal.x, 3);
+			normals.push_back(normal);
+		}
+		else if (text[0] == 'v' && text[1] == 't')
+		{
+			Float2 uv = { 0.0f, 0.0f };
+			ParseFloats(text + 2, &uv.x, 2);
+			uvs.push_back(uv);
+		}
+		else if (text[0] == 'v' && (text[1] == ' ' || text[1] == '\t'))
+		{
+			Float3 position = { 0.0f, 0.0f, 0.0f };
+			ParseFloats(text + 1, &position.x, 3);
+			positions.push_back(position);
+		}
+		else if (text[0] == 'f' && (text[1] == ' ' || text[1] == '\t'))
+		{
+			face.clear();
+			text++;
+			for (;;)
+			{
+				while (*text == ' ' || *text == '\t' || *text == '\r')
+					text++;
+				if (*text == 0)
+					break;
+
+				Corner corner;
+				if (!ParseCorner(text, positions.size(), uvs.size(), normals.size(), corner))
+				{
+					error = "bad face on line " + std::to_string(lineNumber);
+					return false;
+				}
+				face.push_back(corner);
+			}
+
+			// Faces without normals get a flat one
+			Float3 flat = { 0.0f, 0.0f, 0.0f };
+			if (face.size() >= 3)
+			{
+				Float3 a = Subtract(positions[face[1].position], positions[face[0].position]);
+				Float3 b = Subtract(positions[face[2].position], positions[face[0].position]);
+				Float3 cross = { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+				flat = Normalize(cross);
+			}
+
+			// Fan out polygons into triangles
+			for (size_t i = 2; i < face.size(); i++)
+			{
+				const Corner* triangle[3] = { &face[0], &face[i - 1], &face[i] };
+				for (int c = 0; c < 3; c++)
+				{
+					const Corner& corner = *triangle[c];
+					std::unordered_map<Corner, uint32_t, CornerHash, CornerEqual>::iterator it = welded.find(corner);
+					if (it != welded.end() && corner.normal >= 0)
+					{
+						indices.push_back(it->second);
+						continue;
+					}
+
+					CookedVertex vertex;
+					memset(&vertex, 0, sizeof(vertex));
+					const Float3& position = positions[corner.position];
+					vertex.position[0] = position.x;
+					vertex.position[1] = position.y;
+					vertex.position[2] = position.z;
+
+					Float3 normal = corner.normal >= 0 ? normals[corner.normal] : flat;
+					vertex.normal[0] = normal.x;
+					vertex.normal[1] = normal.y;
+					vertex.normal[2] = normal.z;
+
+					// Flip the UV's since they're probably "upside down"
+					if (corner.uv >= 0)
+					{
+						vertex.uv[0] = uvs[corner.uv].x;
+						vertex.uv[1] = 1.0f - uvs[corner.uv].y;
+					}
+
+					uint32_t index = (uint32_t)vertices.size();
+					vertices.push_back(vertex);
+					indices.push_back(index);
+
+					// Flat normals differ per face, so only share real ones
+					if (corner.normal >= 0)
+						welded[corner] = index;
+				}
+			}
+		}
+	}
+
+	if (indices.empty())
+	{
+		error = "no faces";
+		return false;
+	}
+
+	CalculateTangents(vertices.data(), (uint32_t)vertices.size(), indices.data(), (uint32_t)indices.size());
+	return true;
+}
+
+// --------------------------------------------------------
+// Same method as Mesh::CalculateTangents(): sum each
+// triangle's tangent into its vertices, then make them
+// orthogonal to the normals
+// --------------------------------------------------------
+void MeshCooker::CalculateTangents(CookedVertex* vertices, uint32_t vertexCount,
+	const uint32_t* indices, uint32_t indexCount)
+{
+	for (uint32_t i = 0; i < vertexCount; i++)
+		vertices[i].tangent[0] = vertices[i].tangent[1] = vertices[i].tangent[2] = 0.0f;
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3)
+	{
+		CookedVertex* v1 = &vertices[indices[i]];
+		CookedVertex* v2 = &vertices[indices[i + 1]];
+		CookedVertex* v3 = &vertices[indices[i + 2]];
+
+		float x1 = v2->position[0] - v1->position[0];
+		float y1 = v2->position[1] - v1->position[1];
+		float z1 = v2->position[2] - v1->position[2];
+		float x2 = v3->position[0] - v1->position[0];
+		float y2 = v3->position[1] - v1->position[1];
+		float z2 = v3->position[2] - v1->position[2];
+
+		float s1 = v2->uv[0] - v1->uv[0];
+		float t1 = v2->uv[1] - v1->uv[1];
+		float s2 = v3->uv[0] - v1->uv[0];
+		float t2 = v3->uv[1] - v1->uv[1];
+
+		// Triangles with no UV area have no tangent to add
+		float determinant = s1 * t2 - s2 * t1;
+		if (fabsf(determinant) < 1e-12f)
+			continue;
+		float r = 1.0f / determinant;
+
+		float tangent[3] =
+		{
+			(t2 * x1 - t1 * x2) * r,
+			(t2 * y1 - t1 * y2) * r,
+			(t2 * z1 - t1 * z2) * r
+		};
+		for (int axis = 0; axis < 3; axis++)
+		{
+			v1->tangent[axis] += tangent[axis];
+			v2->tangent[axis] += tangent[axis];
+			v3->tangent[axis] += tangent[axis];
+		}
+	}
+
+	// Gram-Schmidt orthogonalize
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		const float* n = vertices[i].normal;
+		float* t = vertices[i].tangent;
+		float dot = n[0] * t[0] + n[1] * t[1] + n[2] * t[2];
+		Float3 orthogonal = { t[0] - n[0] * dot, t[1] - n[1] * dot, t[2] - n[2] * dot };
+		orthogonal = Normalize(orthogonal);
+		t[0] = orthogonal.x;
+		t[1] = orthogonal.y;
+		t[2] = orthogonal.z;
+	}
+}
+
+bool MeshCooker::Cook(const char* sourcePath, const char* outputPath, std::string& error)
+{
+	std::vector<CookedVertex> vertices;
+	std::vector<uint32_t> indices;
+	if (!ParseObj(sourcePath, vertices, indices, error))
+		return false;
+
+	if (!CookedMesh::Save(outputPath, vertices.data(), (uint32_t)vertices.size(), indices.data(), (uint32_t)indices.size()))
+	{
+		error = "can't write output";
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CookedMesh.h"
+
+// --------------------------------------------------------
+// Turns OBJ files into cooked meshes.
+//
+// Reads the same files Mesh::ParseObjFile() does, with the
+// same conventions (V flipped, winding kept), but also takes
+// polygons, faces without UVs or normals and negative
+// indices.  Corners that share a position, UV and normal are
+// welded into one vertex, and tangents are calculated here so
+// the game doesn't have to.
+// --------------------------------------------------------
+class MeshCooker
+{
+public:
+	static bool ParseObj(const char* path, std::vector<CookedVertex>& vertices,
+		std::vector<uint32_t>& indices, std::string& error);
+
+	static void CalculateTangents(CookedVertex* vertices, uint32_t vertexCount,
+		const uint32_t* indices, uint32_t indexCount);
+
+	static bool Cook(const char* sourcePath, const char* outputPath, std::string& error);
+
+private:
+	MeshCooker();
+};
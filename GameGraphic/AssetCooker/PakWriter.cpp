@@ -0,0 +1,290 @@
+#include "PakWriter.h"
+#include "ImageDecoder.h"
+#include "JobSystem.h"
+#include "Lz4.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+namespace
+{
+	// Compressed entries are only worth decompressing if they
+	// save at least this much
+	const double MinimumSaving = 0.1;
+
+	// Compressed data only needs aligning for the chunk table
+	const uint64_t CompressedAlignment = 16;
+
+	uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool WritePadding(FILE* file, uint64_t& position, uint64_t target)
+	{
+		static const unsigned char zeros[PakFile::PageAlignment] = {};
+		while (position < target)
+		{
+			size_t count = (size_t)std::min<uint64_t>(target - position, sizeof(zeros));
+			if (fwrite(zeros, 1, count, file) != count)
+				return false;
+			position += count;
+		}
+		return true;
+	}
+
+	bool WriteBytes(FILE* file, uint64_t& position, const void* data, size_t size)
+	{
+		if (size > 0 && fwrite(data, 1, size, file) != size)
+			return false;
+		position += size;
+		return true;
+	}
+}
+
+PakWriter::PakWriter()
+{
+	compression = true;
+	chunkSize = PakFile::DefaultChunkSize;
+}
+
+void PakWriter::AddFile(const std::string& name, const std::string& path)
+{
+	std::string normalized = PakFile::NormalizeName(name);
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		if (inputs[i].name == normalized)
+		{
+			inputs[i].path = path;
+			return;
+		}
+	}
+
+	Input input;
+	input.name = normalized;
+	input.path = path;
+	input.hash = 0;
+	input.sharedWith = -1;
+	inputs.push_back(input);
+}
+
+bool PakWriter::Load(JobSystem* jobSystem, std::string& error)
+{
+	std::atomic<int> failed(-1);
+	auto load = [this, &failed](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			Input& input = inputs[i];
+			if (!ImageDecoder::ReadFile(input.path.c_str(), input.data))
+				failed.store((int)i);
+			input.hash = HashBytes(input.data.data(), input.data.size());
+		}
+	};
+	if (jobSystem)
+		jobSystem->ParallelFor((unsigned int)inputs.size(), 1, load);
+	else
+		load(0, (unsigned int)inputs.size());
+
+	if (failed.load() >= 0)
+	{
+		error = "can't read " + inputs[failed.load()].path;
+		return false;
+	}
+
+	// Duplicates share the first copy's data.  The bytes are
+	// compared too, so a hash collision can't merge two files.
+	std::unordered_multimap<ContentHash, int> seen;
+	for (int i = 0; i < (int)inputs.size(); i++)
+	{
+		Input& input = inputs[i];
+		input.sharedWith = -1;
+
+		auto range = seen.equal_range(input.hash);
+		for (auto it = range.first; it != range.second && input.sharedWith < 0; ++it)
+		{
+			if (inputs[it->second].data == input.data)
+				input.sharedWith = it->second;
+		}
+		if (input.sharedWith < 0)
+			seen.insert(std::make_pair(input.hash, i));
+	}
+	return true;
+}
+
+ContentHash PakWriter::GetContentsHash() const
+{
+	std::vector<const Input*> sorted;
+	for (size_t i = 0; i < inputs.size(); i++)
+		sorted.push_back(&inputs[i]);
+	std::sort(sorted.begin(), sorted.end(),
+		[](const Input* a, const Input* b) { return a->name < b->name; });
+
+	// Settings that change the file count too
+	uint32_t settings[3] = { PakFile::Version, chunkSize, compression ? 1u : 0u };
+	ContentHasher hasher;
+	hasher.Update(settings, sizeof(settings));
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		hasher.Update(sorted[i]->name.c_str(), sorted[i]->name.size() + 1);
+		hasher.Update(&sorted[i]->hash, sizeof(sorted[i]->hash));
+	}
+	return hasher.Finish();
+}
+
+bool PakWriter::Write(const char* path, JobSystem* jobSystem, PakWriteStats* stats)
+{
+	// Compress every unique input
+	std::vector<Blob> blobs(inputs.size());
+	auto compress = [this, &blobs](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			if (inputs[i].sharedWith < 0)
+				Compress(inputs[i], blobs[i]);
+		}
+	};
+	if (jobSystem)
+		jobSystem->ParallelFor((unsigned int)inputs.size(), 1, compress);
+	else
+		compress(0, (unsigned int)inputs.size());
+
+	// Lay out the data: header, blobs, names, then the table
+	uint64_t position = sizeof(PakHeader);
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		if (inputs[i].sharedWith >= 0)
+			continue;
+		Blob& blob = blobs[i];
+		position = AlignUp(position, blob.compression == PakCompression_None ? PakFile::PageAlignment : CompressedAlignment);
+		blob.offset = position;
+		position += blob.stored.size();
+	}
+
+	std::string names;
+	std::vector<PakEntry> entries(inputs.size());
+	for (size_t i = 0; i < inputs.size(); i++)
+	{
+		const Input& input = inputs[i];
+		const Blob& blob = blobs[input.sharedWith >= 0 ? input.sharedWith : i];
+
+		PakEntry& entry = entries[i];
+		memset(&entry, 0, sizeof(entry));
+		entry.nameHash = PakFile::HashName(input.name);
+		entry.contentHash = input.hash;
+		entry.offset = blob.offset;
+		entry.size = input.data.size();
+		entry.storedSize = blob.stored.size();
+		entry.nameOffset = (uint32_t)names.size();
+		entry.nameLength = (uint16_t)input.name.size();
+		entry.compression = (uint8_t)blob.compression;
+		names += input.name;
+	}
+	std::sort(entries.begin(), entries.end(),
+		[](const PakEntry& a, const PakEntry& b) { return a.nameHash < b.nameHash; });
+
+	PakHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = PakFile::Magic;
+	header.version = PakFile::Version;
+	header.entryCount = (uint32_t)entries.size();
+	header.chunkSize = chunkSize;
+	header.namesOffset = position;
+	header.namesSize = names.size();
+	header.tocOffset = AlignUp(position + names.size(), 8);
+	header.contentsHash = GetContentsHash();
+	header.alignment = PakFile::PageAlignment;
+
+	FILE* file = 0;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path, "wb") != 0)
+		file = 0;
+#else
+	file = fopen(path, "wb");
+#endif
+	if (!file)
+		return false;
+
+	position = 0;
+	bool written = WriteBytes(file, position, &header, sizeof(header));
+	for (size_t i = 0; i < inputs.size() && written; i++)
+	{
+		if (inputs[i].sharedWith >= 0)
+			continue;
+		written = WritePadding(file, position, blobs[i].offset) &&
+			WriteBytes(file, position, blobs[i].stored.data(), blobs[i].stored.size());
+	}
+	written = written &&
+		WriteBytes(file, position, names.data(), names.size()) &&
+		WritePadding(file, position, header.tocOffset) &&
+		WriteBytes(file, position, entries.data(), entries.size() * sizeof(PakEntry));
+	written = fclose(file) == 0 && written;
+
+	if (stats)
+	{
+		memset(stats, 0, sizeof(*stats));
+		stats->entries = (unsigned int)inputs.size();
+		stats->fileBytes = position;
+		for (size_t i = 0; i < inputs.size(); i++)
+		{
+			stats->inputBytes += inputs[i].data.size();
+			if (inputs[i].sharedWith >= 0)
+			{
+				stats->duplicateBytes += inputs[i].data.size();
+				continue;
+			}
+			stats->uniqueEntries++;
+			if (blobs[i].compression == PakCompression_Lz4)
+				stats->compressedEntries++;
+		}
+	}
+	return written;
+}
+
+// --------------------------------------------------------
+// Chunk by chunk, so the game can decompress big entries on
+// several threads.  Chunks that don't shrink are kept as is.
+// --------------------------------------------------------
+void PakWriter::Compress(const Input& input, Blob& blob) const
+{
+	const std::vector<unsigned char>& data = input.data;
+	blob.compression = PakCompression_None;
+	blob.offset = 0;
+
+	if (compression && !data.empty())
+	{
+		uint32_t chunkCount = (uint32_t)((data.size() + chunkSize - 1) / chunkSize);
+		std::vector<uint32_t> chunkSizes(chunkCount);
+		std::vector<unsigned char> stored(chunkCount * sizeof(uint32_t));
+		std::vector<unsigned char> scratch(Lz4::GetMaxCompressedSize(chunkSize));
+
+		for (uint32_t i = 0; i < chunkCount; i++)
+		{
+			size_t start = (size_t)i * chunkSize;
+			size_t size = std::min<size_t>(chunkSize, data.size() - start);
+			size_t compressed = Lz4::Compress(&data[start], size, scratch.data(), scratch.size());
+
+			const unsigned char* chunk = scratch.data();
+			chunkSizes[i] = (uint32_t)compressed;
+			if (compressed == 0 || compressed >= size)
+			{
+				chunk = &data[start];
+				compressed = size;
+				chunkSizes[i] = (uint32_t)size | 0x80000000u;
+			}
+			stored.insert(stored.end(), chunk, chunk + compressed);
+		}
+		memcpy(stored.data(), chunkSizes.data(), chunkCount * sizeof(uint32_t));
+
+		if (stored.size() <= data.size() * (1.0 - MinimumSaving))
+		{
+			blob.stored.swap(stored);
+			blob.compression = PakCompression_Lz4;
+			return;
+		}
+	}
+
+	blob.stored = data;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "PakFile.h"
+
+class JobSystem;
+
+struct PakWriteStats
+{
+	unsigned int	entries;
+	unsigned int	uniqueEntries;		// After dropping duplicates
+	unsigned int	compressedEntries;
+	uint64_t		inputBytes;
+	uint64_t		duplicateBytes;		// Not written, thanks to sharing
+	uint64_t		fileBytes;
+};
+
+// --------------------------------------------------------
+// Builds a pak file (see PakFile) from files on disk.
+//
+//   PakWriter writer;
+//   writer.AddFile("ironman.obj.mesh", "Cooked/ironman.obj.mesh");
+//   writer.Load(&jobSystem, error);
+//   writer.Write("assets.pak", &jobSystem);
+//
+// Files with identical contents are stored once and share
+// their data.  Each unique file is compressed, a chunk at a
+// time, and kept compressed if that saves enough to be worth
+// decompressing; otherwise it's stored as is, page aligned
+// so the game can use it straight from the mapped pak.
+// --------------------------------------------------------
+class PakWriter
+{
+public:
+	PakWriter();
+
+	// name is what the game asks for; path is where to read it
+	void AddFile(const std::string& name, const std::string& path);
+
+	// Reads and hashes every file, in parallel if a job system
+	// is given.  Fails if any can't be read.
+	bool Load(JobSystem* jobSystem, std::string& error);
+
+	// Identifies the loaded contents: the same names and data
+	// always give the same hash, so an existing pak with this
+	// hash doesn't need writing again
+	ContentHash GetContentsHash() const;
+
+	// Compresses and writes the pak.  Call after Load().
+	bool Write(const char* path, JobSystem* jobSystem, PakWriteStats* stats = 0);
+
+	void SetCompression(bool enabled) { compression = enabled; }
+
+private:
+	struct Input
+	{
+		std::string					name;		// Normalized
+		std::string					path;
+		std::vector<unsigned char>	data;
+		ContentHash					hash;
+		int							sharedWith;	// Earlier input with the same data, or -1
+	};
+
+	struct Blob
+	{
+		std::vector<unsigned char>	stored;
+		PakCompression				compression;
+		uint64_t					offset;
+	};
+
+	void Compress(const Input& input, Blob& blob) const;
+
+	std::vector<Input>	inputs;
+	bool				compression;
+	uint32_t			chunkSize;
+};
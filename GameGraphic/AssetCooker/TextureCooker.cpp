@@ -0,0 +1,384 @@
+#include "TextureCooker.h"
+#include "BlockCompressor.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	struct FormatName
+	{
+		const char*		name;
+		DdsFormat		format;
+	};
+
+	const FormatName FormatNames[] =
+	{
+		{ "rgba8",		DdsFormat_RGBA8 },
+		{ "rgba8_srgb",	DdsFormat_RGBA8_SRGB },
+		{ "bc1",		DdsFormat_BC1 },
+		{ "bc1_srgb",	DdsFormat_BC1_SRGB },
+		{ "bc3",		DdsFormat_BC3 },
+		{ "bc3_srgb",	DdsFormat_BC3_SRGB },
+		{ "bc5",		DdsFormat_BC5 },
+		{ "bc7",		DdsFormat_BC7 },
+		{ "bc7_srgb",	DdsFormat_BC7_SRGB },
+	};
+
+	const char* GetFormatName(DdsFormat format)
+	{
+		for (size_t i = 0; i < sizeof(FormatNames) / sizeof(FormatNames[0]); i++)
+		{
+			if (FormatNames[i].format == format)
+				return FormatNames[i].name;
+		}
+		return "unknown";
+	}
+
+	// Channels each format keeps, for measuring its error
+	int GetChannelCount(DdsFormat format)
+	{
+		switch (format)
+		{
+		case DdsFormat_BC1:	return 3;
+		case DdsFormat_BC5:	return 2;
+		default:			return 4;
+		}
+	}
+
+	// --------------------------------------------------------
+	// The nearest size that is a multiple of 4 << k, for the
+	// largest k (up to 6) that moves it by no more than 1/32nd,
+	// so the first k + 1 mips are whole blocks too
+	// --------------------------------------------------------
+	uint32_t GetBlockAlignedSize(uint32_t size)
+	{
+		uint32_t multiple = 4;
+		while (multiple * 2 * 16 <= size && multiple < 256)
+			multiple *= 2;
+		return std::max((size + multiple / 2) / multiple, 1u) * multiple;
+	}
+
+	template<typename F>
+	double TimeBest(unsigned int runs, F f)
+	{
+		double best = 0.0;
+		for (unsigned int i = 0; i < runs; i++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			f();
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			best = i == 0 || ms < best ? ms : best;
+		}
+		return best;
+	}
+}
+
+bool TextureCooker::CanDecode(const std::string& extension)
+{
+	return extension == "bmp" || extension == "tga" || extension == "jpg" || extension == "jpeg" || extension == "png";
+}
+
+bool TextureCooker::Cook(const char* sourcePath, const char* outputPath,
+	const TextureCookOptions& options, JobSystem* jobSystem, std::string& message)
+{
+	Image image;
+	if (!ImageDecoder::Load(sourcePath, image, jobSystem))
+	{
+		message = "can't decode image";
+		return false;
+	}
+	return Save(image, outputPath, options, jobSystem, message);
+}
+
+bool TextureCooker::Save(Image& image, const char* outputPath,
+	const TextureCookOptions& options, JobSystem* jobSystem, std::string& message)
+{
+	MipSettings mipSettings;
+	mipSettings.filter = options.mipFilter;
+	mipSettings.content = options.normalMap ? MipContent_NormalMap : (options.linear ? MipContent_Linear : MipContent_Color);
+
+	// Stretched rather than padded, so texture coordinates still
+	// span exactly the image and tiling has no seam
+	DdsImageDesc desc;
+	desc.format = options.format != DdsFormat_Unknown ? options.format : ChooseFormat(image, options.normalMap);
+	if (DdsFile::IsBlockCompressed(desc.format) && (image.width % 4 != 0 || image.height % 4 != 0))
+	{
+		Image resized;
+		resized.width = GetBlockAlignedSize(image.width);
+		resized.height = GetBlockAlignedSize(image.height);
+		resized.pixels.resize((size_t)resized.width * resized.height * 4);
+		MipGenerator::Resize(image.pixels.data(), image.width, image.height,
+			resized.pixels.data(), resized.width, resized.height, mipSettings, jobSystem);
+		message = "resampled from " + std::to_string(image.width) + " x " + std::to_string(image.height) +
+			" to " + std::to_string(resized.width) + " x " + std::to_string(resized.height) + " for " + GetFormatName(desc.format);
+		std::swap(image, resized);
+	}
+	desc.width = image.width;
+	desc.height = image.height;
+	desc.mipCount = 1;
+	if (options.mips)
+	{
+		image.pixels.resize(MipGenerator::GetChainSize(image.width, image.height));
+		desc.mipCount = MipGenerator::Generate(image.pixels.data(), image.width, image.height, mipSettings, jobSystem);
+		if (options.maxMips > 0 && desc.mipCount > options.maxMips)
+			desc.mipCount = options.maxMips;
+	}
+
+	// Each level is compressed from the RGBA8 one of the same size
+	std::vector<unsigned char> blocks;
+	if (DdsFile::IsBlockCompressed(desc.format))
+	{
+		blocks.resize(DdsFile::GetImageSize(desc));
+		size_t sourceOffset = 0;
+		size_t destOffset = 0;
+		uint32_t width = desc.width;
+		uint32_t height = desc.height;
+		for (uint32_t level = 0; level < desc.mipCount; level++)
+		{
+			BlockCompressor::Compress(&image.pixels[sourceOffset], width, height, desc.format, &blocks[destOffset], jobSystem);
+			sourceOffset += (size_t)width * height * 4;
+			destOffset += DdsFile::GetSurfaceSize(desc.format, width, height);
+			width = width > 1 ? width / 2 : 1;
+			height = height > 1 ? height / 2 : 1;
+		}
+	}
+
+	const void* data = blocks.empty() ? image.pixels.data() : blocks.data();
+	if (!DdsFile::Save(outputPath, desc, data))
+	{
+		message = "can't write output";
+		return false;
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// The images are decoded as one batch, then packed, and
+// each page is cooked like any other texture
+// --------------------------------------------------------
+bool TextureCooker::CookAtlas(const char* atlasPath, const char* const* imagePaths, unsigned int count,
+	const AtlasSettings& settings, JobSystem* jobSystem, std::string& error)
+{
+	std::vector<std::vector<unsigned char> > files(count);
+	std::vector<Image> images(count);
+	std::vector<ImageDecodeJob> jobs(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ImageInfo info;
+		if (!ImageDecoder::ReadFile(imagePaths[i], files[i]) || !ImageDecoder::GetInfo(files[i].data(), files[i].size(), info))
+		{
+			error = std::string(imagePaths[i]) + ": can't decode image";
+			return false;
+		}
+		images[i].width = info.width;
+		images[i].height = info.height;
+		images[i].pixels.resize((size_t)info.width * info.height * 4);
+
+		ImageDecodeJob& job = jobs[i];
+		job.file = files[i].data();
+		job.size = files[i].size();
+		job.pixels = images[i].pixels.data();
+		job.rowPitch = 0;
+		job.succeeded = false;
+	}
+	if (!ImageDecoder::DecodeBatch(jobs.data(), count, jobSystem))
+	{
+		error = "can't decode images";
+		return false;
+	}
+
+	TextureAtlas atlas;
+	atlas.SetSettings(settings);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		std::string name = imagePaths[i];
+		size_t slash = name.find_last_of("/\\");
+		if (slash != std::string::npos)
+			name.erase(0, slash + 1);
+		atlas.Add(name, images[i]);
+	}
+	std::vector<Image>().swap(images);
+	if (!atlas.Build())
+	{
+		error = "an image is larger than a page";
+		return false;
+	}
+
+	// Pages go next to the layout, which names them relative to itself
+	std::string base = atlasPath;
+	size_t dot = base.find_last_of('.');
+	size_t folder = base.find_last_of("/\\");
+	if (dot != std::string::npos && (folder == std::string::npos || dot > folder))
+		base.erase(dot);
+	std::string baseName = folder == std::string::npos ? base : base.substr(folder + 1);
+
+	// Box filtered mips stay inside the gutters longest
+	TextureCookOptions options;
+	options.mipFilter = MipFilter_Box;
+	options.maxMips = atlas.GetSafeMipCount(options.mipFilter);
+	for (uint32_t i = 0; i < atlas.GetPages().size(); i++)
+	{
+		const AtlasPage& page = atlas.GetPages()[i];
+		std::string suffix = "_" + std::to_string(i) + ".dds";
+		atlas.SetPageFile(i, baseName + suffix);
+
+		Image pageImage;
+		pageImage.width = page.width;
+		pageImage.height = page.height;
+		pageImage.pixels = page.pixels;
+		if (!Save(pageImage, (base + suffix).c_str(), options, jobSystem, error))
+			return false;
+	}
+
+	if (!atlas.Save(atlasPath))
+	{
+		error = "can't write atlas";
+		return false;
+	}
+	printf("%s: %u images on %u pages\n", atlasPath, count, (unsigned int)atlas.GetPages().size());
+	return true;
+}
+
+DdsFormat TextureCooker::ChooseFormat(const Image& image, bool normalMap)
+{
+	if (normalMap)
+		return DdsFormat_BC5;
+
+	size_t texels = (size_t)image.width * image.height;
+	for (size_t i = 0; i < texels; i++)
+	{
+		if (image.pixels[i * 4 + 3] != 255)
+			return DdsFormat_BC3;
+	}
+	return DdsFormat_BC1;
+}
+
+DdsFormat TextureCooker::ParseFormat(const std::string& name)
+{
+	for (size_t i = 0; i < sizeof(FormatNames) / sizeof(FormatNames[0]); i++)
+	{
+		if (name == FormatNames[i].name)
+			return FormatNames[i].format;
+	}
+	return DdsFormat_Unknown;
+}
+
+// --------------------------------------------------------
+// PSNR is over the channels the format keeps.  Times are the
+// best of a few runs, top level only.
+// --------------------------------------------------------
+bool TextureCooker::Benchmark(const char* path, JobSystem* jobSystem)
+{
+	Image image;
+	if (!ImageDecoder::Load(path, image))
+	{
+		printf("%s: can't decode image\n", path);
+		return false;
+	}
+	printf("%s: %u x %u\n", path, image.width, image.height);
+
+	const DdsFormat formats[] = { DdsFormat_BC1, DdsFormat_BC3, DdsFormat_BC5, DdsFormat_BC7 };
+	const unsigned int runs = 3;
+	double megapixels = (double)image.width * image.height / 1e6;
+	unsigned int threads = jobSystem ? jobSystem->GetWorkerCount() + 1 : 1;
+	std::vector<unsigned char> decoded(image.pixels.size());
+	std::vector<unsigned char> blocks;
+	for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+	{
+		DdsFormat format = formats[f];
+		blocks.resize(DdsFile::GetSurfaceSize(format, image.width, image.height));
+		double singleMs = TimeBest(runs, [&]()
+		{
+			BlockCompressor::Compress(image.pixels.data(), image.width, image.height, format, blocks.data());
+		});
+		double parallelMs = TimeBest(runs, [&]()
+		{
+			BlockCompressor::Compress(image.pixels.data(), image.width, image.height, format, blocks.data(), jobSystem);
+		});
+		BlockCompressor::Decompress(blocks.data(), image.width, image.height, format, decoded.data());
+
+		int channels = GetChannelCount(format);
+		double squaredError = 0.0;
+		for (size_t i = 0; i < image.pixels.size(); i += 4)
+		{
+			for (int c = 0; c < channels; c++)
+			{
+				double difference = (double)image.pixels[i + c] - decoded[i + c];
+				squaredError += difference * difference;
+			}
+		}
+		double meanError = squaredError / ((double)image.width * image.height * channels);
+		double psnr = meanError > 0.0 ? 10.0 * log10(255.0 * 255.0 / meanError) : 99.0;
+
+		printf("  %-4s %6.2f dB  %8.1f MPix/s on 1 thread  %8.1f MPix/s on %u\n", GetFormatName(format), psnr,
+			megapixels / (singleMs / 1000.0), megapixels / (parallelMs / 1000.0), threads);
+	}
+	return true;
+}
+
+// --------------------------------------------------------
+// Files are read up front and pixels go into buffers sized
+// once, so only decoding is timed.  Times are the best of a
+// few runs.
+// --------------------------------------------------------
+bool TextureCooker::BenchmarkDecode(const char* const* paths, unsigned int count, JobSystem* jobSystem)
+{
+	std::vector<std::vector<unsigned char> > files(count);
+	std::vector<std::vector<unsigned char> > pixels(count);
+	std::vector<ImageDecodeJob> jobs(count);
+	double megapixels = 0.0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		ImageInfo info;
+		if (!ImageDecoder::ReadFile(paths[i], files[i]) || !ImageDecoder::GetInfo(files[i].data(), files[i].size(), info))
+		{
+			printf("%s: can't decode image\n", paths[i]);
+			return false;
+		}
+		pixels[i].resize((size_t)info.width * info.height * 4);
+		megapixels += (double)info.width * info.height / 1e6;
+
+		ImageDecodeJob& job = jobs[i];
+		job.file = files[i].data();
+		job.size = files[i].size();
+		job.pixels = pixels[i].data();
+		job.rowPitch = 0;
+		job.succeeded = false;
+	}
+
+	const unsigned int runs = 3;
+	unsigned int threads = jobSystem ? jobSystem->GetWorkerCount() + 1 : 1;
+	bool succeeded = true;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const ImageDecodeJob& job = jobs[i];
+		double singleMs = TimeBest(runs, [&]()
+		{
+			succeeded &= ImageDecoder::Decode(job.file, job.size, job.pixels);
+		});
+		double parallelMs = TimeBest(runs, [&]()
+		{
+			succeeded &= ImageDecoder::Decode(job.file, job.size, job.pixels, 0, jobSystem);
+		});
+		printf("%s: %7.1f ms on 1 thread  %7.1f ms on %u\n", paths[i], singleMs, parallelMs, threads);
+	}
+
+	double sequentialMs = TimeBest(runs, [&]()
+	{
+		for (unsigned int i = 0; i < count; i++)
+			succeeded &= ImageDecoder::Decode(jobs[i].file, jobs[i].size, jobs[i].pixels, 0, jobSystem);
+	});
+	double batchMs = TimeBest(runs, [&]()
+	{
+		succeeded &= ImageDecoder::DecodeBatch(jobs.data(), count, jobSystem);
+	});
+	printf("All %u: %.1f MPix/s one at a time  %.1f MPix/s as a batch, on %u threads\n", count,
+		megapixels / (sequentialMs / 1000.0), megapixels / (batchMs / 1000.0), threads);
+
+	if (!succeeded)
+		printf("Some images failed to decode\n");
+	return succeeded;
+}
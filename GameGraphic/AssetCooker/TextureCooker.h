@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string>
+#include "DdsFile.h"
+#include "ImageDecoder.h"
+#include "MipGenerator.h"
+#include "TextureAtlas.h"
+
+class JobSystem;
+
+// --------------------------------------------------------
+// How one texture is cooked.  Set per file by a .cook file
+// next to the source (see AssetCooker).
+// --------------------------------------------------------
+struct TextureCookOptions
+{
+	bool		mips;			// Build the full mip chain
+	uint32_t	maxMips;		// Levels kept of it, 0 for all
+	MipFilter	mipFilter;
+	bool		normalMap;		// Tangent space normals in red and green
+	bool		linear;			// Data rather than sRGB color, for mips
+	DdsFormat	format;			// Unknown picks one (see ChooseFormat)
+
+	TextureCookOptions() : mips(true), maxMips(0), mipFilter(MipFilter_Kaiser), normalMap(false), linear(false), format(DdsFormat_Unknown) { }
+};
+
+// --------------------------------------------------------
+// Turns images into DDS files the runtime can upload as they
+// are - decoded, with mips built and block compressed (see
+// BlockCompressor) - instead of decoding and generating mips
+// on the render thread at load time.
+//
+// Block compressed textures must be a multiple of 4 texels
+// across at the top level, so other sizes are resampled to
+// one - to a multiple of 4 << k where that is close, so the
+// first few mips are whole blocks as well and the streamer
+// can pin a small one.
+// --------------------------------------------------------
+class TextureCooker
+{
+public:
+	// True if ImageDecoder can read this kind of file
+	static bool CanDecode(const std::string& extension);
+
+	// message gets why it failed, or on success anything worth
+	// reporting (like the image being padded)
+	static bool Cook(const char* sourcePath, const char* outputPath,
+		const TextureCookOptions& options, JobSystem* jobSystem, std::string& message);
+
+	// Cooks an image already decoded.  Its pixels are reused
+	// for the mip chain.
+	static bool Save(Image& image, const char* outputPath,
+		const TextureCookOptions& options, JobSystem* jobSystem, std::string& message);
+
+	// Packs images into a texture atlas (see TextureAtlas).
+	// Writes the layout to atlasPath and each page next to it
+	// as a DDS named after it ("ui.atlas" -> "ui_0.dds"), with
+	// only the mips the gutters keep clean.  Images are named
+	// by their file names, without folders.
+	static bool CookAtlas(const char* atlasPath, const char* const* imagePaths, unsigned int count,
+		const AtlasSettings& settings, JobSystem* jobSystem, std::string& error);
+
+	// BC5 for normal maps, BC3 if any texel is see-through,
+	// otherwise BC1
+	static DdsFormat ChooseFormat(const Image& image, bool normalMap);
+
+	// "bc1", "rgba8" and so on; Unknown for anything else
+	static DdsFormat ParseFormat(const std::string& name);
+
+	// Compresses an image to each block format and prints the
+	// quality (PSNR) and speed, on one thread and on all of them
+	static bool Benchmark(const char* path, JobSystem* jobSystem);
+
+	// Decodes images and prints the speed of each on one thread
+	// and on all of them, then of the whole set decoded one at a
+	// time and as one batch
+	static bool BenchmarkDecode(const char* const* paths, unsigned int count, JobSystem* jobSystem);
+
+private:
+	TextureCooker();
+};
@@ -0,0 +1,124 @@
+#include "AssetCooker.h"
+#include "JobSystem.h"
+#include "TextureCooker.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	void PrintUsage()
+	{
+		printf(
+			"Usage: AssetCooker [options] <source folder> <output folder>\n"
+			"       AssetCooker -b <image>...\n"
+			"       AssetCooker -d <image>...\n"
+			"       AssetCooker -a <atlas> <image>...\n"
+			"\n"
+			"Cooks meshes and textures into the formats the game loads fastest,\n"
+			"and writes <output folder>/assets.manifest for the game to find them.\n"
+			"Only assets whose source, options or output changed are cooked again.\n"
+			"\n"
+			"Options:\n"
+			"  -j <count>   Threads to cook on (default: one per core)\n"
+			"  -p <file>    Also pack the results into one pak file\n"
+			"  -f           Cook everything, ignoring what was cooked before\n"
+			"  -v           List up to date assets as well\n"
+			"  -b           Benchmark the texture block compressors on images\n"
+			"  -d           Benchmark decoding images\n"
+			"  -a           Pack images into <atlas> and its page textures, for sprites\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	CookSettings settings;
+	const char* folders[2] = { 0, 0 };
+	int folderCount = 0;
+	bool benchmark = false;
+	bool benchmarkDecode = false;
+	const char* atlasPath = 0;
+	int firstImage = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+		{
+			int threads = atoi(argv[++i]);
+			settings.threads = threads > 0 ? threads : 0;
+		}
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+			settings.pakPath = argv[++i];
+		else if (strcmp(argv[i], "-f") == 0)
+			settings.force = true;
+		else if (strcmp(argv[i], "-v") == 0)
+			settings.verbose = true;
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc)
+		{
+			benchmark = true;
+			firstImage = i + 1;
+			break;
+		}
+		else if (strcmp(argv[i], "-d") == 0 && i + 1 < argc)
+		{
+			benchmarkDecode = true;
+			firstImage = i + 1;
+			break;
+		}
+		else if (strcmp(argv[i], "-a") == 0 && i + 2 < argc)
+		{
+			atlasPath = argv[i + 1];
+			firstImage = i + 2;
+			break;
+		}
+		else if (argv[i][0] != '-' && folderCount < 2)
+			folders[folderCount++] = argv[i];
+		else
+		{
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	if (benchmark || benchmarkDecode)
+	{
+		JobSystem jobSystem;
+		if (settings.threads != 1)
+			jobSystem.Init(settings.threads > 1 ? settings.threads - 1 : 0);
+		bool succeeded = true;
+		if (benchmarkDecode)
+			succeeded = TextureCooker::BenchmarkDecode(argv + firstImage, (unsigned int)(argc - firstImage), &jobSystem);
+		for (int i = firstImage; benchmark && i < argc; i++)
+			succeeded &= TextureCooker::Benchmark(argv[i], &jobSystem);
+		jobSystem.Shutdown();
+		return succeeded ? 0 : 1;
+	}
+
+	if (atlasPath)
+	{
+		JobSystem jobSystem;
+		if (settings.threads != 1)
+			jobSystem.Init(settings.threads > 1 ? settings.threads - 1 : 0);
+		std::string error;
+		bool succeeded = TextureCooker::CookAtlas(atlasPath, argv + firstImage, (unsigned int)(argc - firstImage),
+			AtlasSettings(), &jobSystem, error);
+		if (!succeeded)
+			printf("%s: %s\n", atlasPath, error.c_str());
+		jobSystem.Shutdown();
+		return succeeded ? 0 : 1;
+	}
+
+	if (folderCount != 2)
+	{
+		PrintUsage();
+		return 2;
+	}
+
+	settings.sourceFolder = folders[0];
+	settings.outputFolder = folders[1];
+
+	AssetCooker cooker(settings);
+	bool succeeded = cooker.Run();
+	cooker.PrintReport();
+	return succeeded ? 0 : 1;
+}
@@ -0,0 +1,593 @@
+#include "AssetLoader.h"
+#include "DirectXGameCore.h"
+#include "CookedMesh.h"
+#include "DDSTextureLoader.h"
+#include "WICTextureLoader.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "MipGenerator.h"
+#include "ImageDecoder.h"
+#include "Profiler.h"
+#include "SimpleShader.h"
+#include <fstream>
+
+using namespace DirectX;
+
+static_assert(sizeof(Vertex) == sizeof(CookedVertex), "Cooked meshes are copied straight into Vertex arrays");
+
+namespace
+{
+	std::string ToNarrow(const std::wstring& text)
+	{
+		std::string result;
+		for (unsigned int i = 0; i < text.size(); i++)
+			result += text[i] < 128 ? (char)text[i] : '?';
+		return result;
+	}
+
+	bool HasExtension(const std::wstring& path, const wchar_t* extension)
+	{
+		size_t length = wcslen(extension);
+		if (path.size() < length)
+			return false;
+		std::wstring end = path.substr(path.size() - length);
+		for (unsigned int i = 0; i < end.size(); i++)
+			end[i] = towlower(end[i]);
+		return end == extension;
+	}
+
+	// WIC needs COM on the calling thread, which may be the
+	// render thread.  It stays initialized for the thread's life.
+	void InitializeComForThread()
+	{
+		static thread_local bool initialized = false;
+		if (!initialized)
+		{
+			CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+			initialized = true;
+		}
+	}
+
+	bool ReadWholeFile(const std::wstring& path, std::vector<unsigned char>& data)
+	{
+		std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return false;
+
+		std::streamoff size = file.tellg();
+		if (size <= 0)
+			return false;
+
+		data.resize((size_t)size);
+		file.seekg(0);
+		file.read((char*)data.data(), size);
+		return file.good();
+	}
+}
+
+AssetLoader::AssetLoader()
+{
+	device = 0;
+	context = 0;
+	jobSystem = 0;
+	pendingCount = 0;
+	for (unsigned int i = 0; i < AssetPlaceholder_Count; i++)
+		placeholders[i] = 0;
+}
+
+AssetLoader::~AssetLoader()
+{
+	Release();
+}
+
+bool AssetLoader::Init(ID3D11Device* _device, ID3D11DeviceContext* _context, JobSystem* _jobSystem)
+{
+	device = _device;
+	context = _context;
+	jobSystem = _jobSystem;
+	return CreatePlaceholders();
+}
+
+// --------------------------------------------------------
+// Lets running jobs finish, then drops anything not yet
+// uploaded
+// --------------------------------------------------------
+void AssetLoader::Release()
+{
+	if (jobSystem)
+		jobSystem->Wait(&loadingJobs);
+
+	for (unsigned int i = 0; i < ready.size(); i++)
+	{
+		ReleaseMacro(ready[i]->shaderBlob);
+		delete ready[i];
+	}
+	ready.clear();
+	pendingCount = 0;
+
+	for (unsigned int i = 0; i < AssetPlaceholder_Count; i++)
+		ReleaseMacro(placeholders[i]);
+	manifest.Clear();
+	pak.Close();
+
+	for (unsigned int i = 0; i < textureMemory.size(); i++)
+		MemoryTracker::Unregister(textureMemory[i]);
+	textureMemory.clear();
+}
+
+bool AssetLoader::LoadManifest(const std::string& path)
+{
+	PROFILE_SCOPE("AssetLoader::LoadManifest");
+	return manifest.Load(path.c_str());
+}
+
+bool AssetLoader::OpenPak(const std::string& path)
+{
+	PROFILE_SCOPE("AssetLoader::OpenPak");
+
+	if (!pak.Open(path.c_str()))
+		return false;
+
+	// Cooked paths in the pak's manifest are pak names already
+	std::vector<unsigned char> text;
+	if (pak.Read("assets.manifest", text, jobSystem))
+		manifest.Parse(std::string(text.begin(), text.end()));
+	return true;
+}
+
+AssetHandle AssetLoader::LoadTexture(const std::wstring& path, ID3D11ShaderResourceView** target,
+	AssetPlaceholder placeholder, AssetCallback onDone)
+{
+	*target = placeholders[placeholder];
+	if (*target)
+		(*target)->AddRef();
+
+	Request* request = new Request();
+	request->type = AssetType_Texture;
+	request->name = ToNarrow(path);
+	request->path = ResolvePath(request->name);
+	request->placeholder = placeholder;
+	request->texture = target;
+	request->onDone = onDone;
+	return Queue(request);
+}
+
+AssetHandle AssetLoader::LoadShader(const std::wstring& path, ISimpleShader* shader, AssetCallback onDone)
+{
+	Request* request = new Request();
+	request->type = AssetType_Shader;
+	request->path = path;
+	request->shader = shader;
+	request->onDone = onDone;
+	return Queue(request);
+}
+
+AssetHandle AssetLoader::LoadMesh(const std::string& path, Mesh* mesh, AssetCallback onDone)
+{
+	Request* request = new Request();
+	request->type = AssetType_Mesh;
+	request->path = ResolvePath(path);
+	request->name = path;
+	request->mesh = mesh;
+	request->onDone = onDone;
+	return Queue(request);
+}
+
+unsigned int AssetLoader::ProcessUploads(size_t budgetBytes)
+{
+	PROFILE_SCOPE("AssetLoader::ProcessUploads");
+
+	unsigned int uploaded = 0;
+	size_t bytes = 0;
+	while (uploaded == 0 || bytes < budgetBytes)
+	{
+		Request* request = 0;
+		{
+			std::lock_guard<std::mutex> lock(readyLock);
+			if (ready.empty())
+				break;
+
+			// Stop before the one that would go over, unless it's the first
+			size_t size = GetUploadBytes(ready.front());
+			if (uploaded > 0 && bytes + size > budgetBytes)
+				break;
+
+			request = ready.front();
+			ready.pop_front();
+			bytes += size;
+		}
+
+		bool succeeded = Upload(request);
+		AssetState state = succeeded ? AssetState_Ready : AssetState_Failed;
+		if (!succeeded)
+			OutputDebugStringA(("Asset failed to load: " + request->name + "\n").c_str());
+
+		request->status->store(state, std::memory_order_release);
+		if (request->onDone)
+			request->onDone(state);
+
+		ReleaseMacro(request->shaderBlob);
+		delete request;
+		pendingCount--;
+		uploaded++;
+	}
+	return uploaded;
+}
+
+void AssetLoader::Flush()
+{
+	PROFILE_SCOPE("AssetLoader::Flush");
+
+	if (jobSystem)
+		jobSystem->Wait(&loadingJobs);
+	ProcessUploads((size_t)-1);
+}
+
+// --------------------------------------------------------
+// The cooked file for a source, if the manifest has one
+// --------------------------------------------------------
+std::wstring AssetLoader::ResolvePath(const std::string& source) const
+{
+	const AssetManifestEntry* entry = manifest.Find(source);
+	std::string path = entry ? manifest.GetDirectory() + entry->cooked : source;
+	return std::wstring(path.begin(), path.end());
+}
+
+AssetHandle AssetLoader::Queue(Request* request)
+{
+	if (request->name.empty())
+		request->name = ToNarrow(request->path);
+	request->status = std::make_shared<std::atomic<int> >(AssetState_Loading);
+
+	AssetHandle handle;
+	handle.status = request->status;
+	pendingCount++;
+
+	jobSystem->Run([this, request]()
+	{
+		Read(request);
+
+		std::lock_guard<std::mutex> lock(readyLock);
+		ready.push_back(request);
+	}, &loadingJobs);
+
+	return handle;
+}
+
+// --------------------------------------------------------
+// Worker thread half of a load: file I/O and parsing only,
+// nothing that touches the GPU
+// --------------------------------------------------------
+void AssetLoader::Read(Request* request)
+{
+	PROFILE_SCOPE("AssetLoader::Read");
+
+	switch (request->type)
+	{
+	case AssetType_Texture:
+		if (HasExtension(request->path, L".dds"))
+			request->loaded = MapFileData(request) || ReadFileData(request->path, request->fileData);
+		else
+		{
+			request->loaded = ReadFileData(request->path, request->fileData);
+			if (request->loaded)
+				DecodeTexture(request);
+		}
+		break;
+
+	case AssetType_Shader:
+		request->loaded = ReadShaderBlob(request->path, &request->shaderBlob);
+		break;
+
+	case AssetType_Mesh:
+		if (HasExtension(request->path, L".mesh"))
+		{
+			CookedMeshHeader header;
+			const CookedVertex* vertices;
+			const uint32_t* indices;
+			request->loaded = ReadFileData(request->path, request->fileData) &&
+				CookedMesh::Parse(request->fileData.data(), request->fileData.size(), header, vertices, indices);
+			if (request->loaded)
+			{
+				const Vertex* first = reinterpret_cast<const Vertex*>(vertices);
+				request->vertices.assign(first, first + header.vertexCount);
+				request->indices.assign(indices, indices + header.indexCount);
+			}
+			std::vector<unsigned char>().swap(request->fileData);
+		}
+		else
+		{
+			request->loaded = Mesh::ParseObjFile(request->name.c_str(), request->vertices, request->indices);
+		}
+		break;
+	}
+}
+
+// --------------------------------------------------------
+// From the pak if it has the file, otherwise from disk
+// --------------------------------------------------------
+bool AssetLoader::ReadFileData(const std::wstring& path, std::vector<unsigned char>& data) const
+{
+	const PakEntry* entry = pak.Find(ToNarrow(path));
+	if (!entry)
+		return ReadWholeFile(path, data);
+
+	data.resize((size_t)entry->size);
+	return pak.Read(*entry, data.data(), jobSystem);
+}
+
+// --------------------------------------------------------
+// Points the request at the file's bytes without copying
+// them: a stored pak entry, or else the loose file mapped.
+// Compressed pak entries can't be used in place, so they
+// return false and are read as usual.
+// --------------------------------------------------------
+bool AssetLoader::MapFileData(Request* request) const
+{
+	if (!MapPath(request->path, request->mappedFile, request->mappedData, request->mappedSize))
+		return false;
+
+	// Fault every page in now, so the upload doesn't wait on the disk
+	MappedFile::Prefetch(request->mappedData, request->mappedSize);
+	return true;
+}
+
+bool AssetLoader::MapFile(const std::wstring& source, MappedFile& file, const unsigned char*& data, size_t& size) const
+{
+	return MapPath(ResolvePath(ToNarrow(source)), file, data, size);
+}
+
+bool AssetLoader::GetContentHash(const std::wstring& source, ContentHash& hash) const
+{
+	std::string name = ToNarrow(source);
+	const AssetManifestEntry* cooked = manifest.Find(name);
+	if (cooked)
+	{
+		hash = cooked->hash;
+		return true;
+	}
+
+	std::string path = ToNarrow(ResolvePath(name));
+	const PakEntry* entry = pak.Find(path);
+	if (entry)
+	{
+		hash = entry->contentHash;
+		return true;
+	}
+	return HashFile(path.c_str(), hash);
+}
+
+bool AssetLoader::MapPath(const std::wstring& path, MappedFile& file, const unsigned char*& data, size_t& size) const
+{
+	std::string name = ToNarrow(path);
+	const PakEntry* entry = pak.Find(name);
+	if (entry)
+	{
+		data = (const unsigned char*)pak.GetStoredData(*entry);
+		size = (size_t)entry->size;
+	}
+	else if (file.Open(name.c_str()))
+	{
+		data = file.GetData();
+		size = file.GetSize();
+	}
+	else
+	{
+		data = 0;
+	}
+	return data != 0;
+}
+
+bool AssetLoader::ReadShaderBlob(const std::wstring& path, ID3DBlob** blob) const
+{
+	const PakEntry* entry = pak.Find(ToNarrow(path));
+	if (!entry)
+		return SUCCEEDED(D3DReadFileToBlob(path.c_str(), blob));
+
+	ID3DBlob* created = 0;
+	if (FAILED(D3DCreateBlob((SIZE_T)entry->size, &created)))
+		return false;
+	if (!pak.Read(*entry, created->GetBufferPointer(), jobSystem))
+	{
+		created->Release();
+		return false;
+	}
+	*blob = created;
+	return true;
+}
+
+// --------------------------------------------------------
+// Decodes the image and builds its mips, if ImageDecoder
+// knows the format.  Normal maps are told apart by their
+// placeholder.
+// --------------------------------------------------------
+void AssetLoader::DecodeTexture(Request* request) const
+{
+	PROFILE_SCOPE("AssetLoader::DecodeTexture");
+
+	ImageInfo info;
+	const unsigned char* file = request->fileData.data();
+	size_t size = request->fileData.size();
+	if (!ImageDecoder::GetInfo(file, size, info))
+		return;
+
+	std::vector<unsigned char> chain(MipGenerator::GetChainSize(info.width, info.height));
+	if (!ImageDecoder::Decode(file, size, chain.data(), 0, jobSystem))
+	{
+		request->loaded = false;
+		return;
+	}
+
+	MipSettings settings;
+	settings.content = request->placeholder == AssetPlaceholder_FlatNormal ? MipContent_NormalMap : MipContent_Color;
+	request->mipCount = MipGenerator::Generate(chain.data(), info.width, info.height, settings, jobSystem);
+	request->width = info.width;
+	request->height = info.height;
+	request->fileData.swap(chain);
+}
+
+// --------------------------------------------------------
+// Upload thread half: creates the GPU resources and hands
+// them to their targets.  WIC images are decoded here, since
+// the loader decodes and creates the texture in one call
+// and needs the immediate context to build the mip chain.
+// --------------------------------------------------------
+bool AssetLoader::Upload(Request* request)
+{
+	PROFILE_SCOPE("AssetLoader::Upload");
+
+	if (!request->loaded)
+		return false;
+
+	switch (request->type)
+	{
+	case AssetType_Texture:
+	{
+		ID3D11ShaderResourceView* srv = 0;
+		const uint8_t* data = request->mappedData ? request->mappedData : request->fileData.data();
+		size_t size = request->mappedData ? request->mappedSize : request->fileData.size();
+		if (request->mipCount > 0)
+		{
+			srv = CreateDecodedTexture(request);
+		}
+		else
+		{
+			InitializeComForThread();
+			HRESULT hr = HasExtension(request->path, L".dds") ?
+				CreateDDSTextureFromMemory(device, context, data, size, 0, &srv) :
+				CreateWICTextureFromMemory(device, context, data, size, 0, &srv);
+			if (FAILED(hr))
+				ReleaseMacro(srv);
+		}
+		if (!srv)
+			return false;
+
+		// The new reference replaces the placeholder's
+		ID3D11ShaderResourceView*& target = *request->texture;
+		ReleaseMacro(target);
+		target = srv;
+		textureMemory.push_back(MemoryTracker::Register(MemoryTag_Texture, request->name, 0, Material::EstimateTextureMemory(srv)));
+		return true;
+	}
+
+	case AssetType_Shader:
+		return request->shader->LoadShaderBlob(request->shaderBlob, request->name);
+
+	case AssetType_Mesh:
+		request->mesh->SetName(request->name);
+		request->mesh->SetVertices(std::move(request->vertices));
+		request->mesh->SetIndices(std::move(request->indices));
+		request->mesh->CreateBuffer();
+		return request->mesh->IsLoaded();
+	}
+	return false;
+}
+
+ID3D11ShaderResourceView* AssetLoader::CreateDecodedTexture(const Request* request) const
+{
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = request->width;
+	desc.Height = request->height;
+	desc.MipLevels = request->mipCount;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_IMMUTABLE;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> levels(request->mipCount);
+	const unsigned char* pixels = request->fileData.data();
+	uint32_t width = request->width;
+	uint32_t height = request->height;
+	for (uint32_t i = 0; i < request->mipCount; i++)
+	{
+		levels[i].pSysMem = pixels;
+		levels[i].SysMemPitch = width * 4;
+		levels[i].SysMemSlicePitch = 0;
+		pixels += (size_t)width * height * 4;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	ID3D11Texture2D* texture = 0;
+	if (FAILED(device->CreateTexture2D(&desc, levels.data(), &texture)))
+		return 0;
+
+	ID3D11ShaderResourceView* srv = 0;
+	HRESULT hr = device->CreateShaderResourceView(texture, 0, &srv);
+	texture->Release();
+	return SUCCEEDED(hr) ? srv : 0;
+}
+
+size_t AssetLoader::GetUploadBytes(const Request* request) const
+{
+	switch (request->type)
+	{
+	case AssetType_Texture:	return request->mappedData ? request->mappedSize : request->fileData.size();
+	case AssetType_Shader:	return request->shaderBlob ? request->shaderBlob->GetBufferSize() : 0;
+	case AssetType_Mesh:	return request->vertices.size() * sizeof(Vertex) + request->indices.size() * sizeof(UINT);
+	}
+	return 0;
+}
+
+// --------------------------------------------------------
+// 1x1 textures in a neutral color for each use.  The sky is
+// the same color the back buffer is cleared to.
+// --------------------------------------------------------
+bool AssetLoader::CreatePlaceholders()
+{
+	const unsigned int colors[AssetPlaceholder_Count] =
+	{
+		0xFFFFFFFF,		// White
+		0xFF000000,		// Black
+		0xFFFF8080,		// Flat normal (0.5, 0.5, 1)
+		0xFFBF9966,		// Sky (0.4, 0.6, 0.75)
+	};
+
+	for (unsigned int i = 0; i < AssetPlaceholder_Count; i++)
+	{
+		bool cube = i == AssetPlaceholder_Sky;
+
+		D3D11_TEXTURE2D_DESC desc = {};
+		desc.Width = 1;
+		desc.Height = 1;
+		desc.MipLevels = 1;
+		desc.ArraySize = cube ? 6 : 1;
+		desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.SampleDesc.Count = 1;
+		desc.Usage = D3D11_USAGE_IMMUTABLE;
+		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		desc.MiscFlags = cube ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+
+		D3D11_SUBRESOURCE_DATA faces[6];
+		for (unsigned int f = 0; f < 6; f++)
+		{
+			faces[f].pSysMem = &colors[i];
+			faces[f].SysMemPitch = sizeof(unsigned int);
+			faces[f].SysMemSlicePitch = 0;
+		}
+
+		ID3D11Texture2D* texture = 0;
+		if (FAILED(device->CreateTexture2D(&desc, faces, &texture)))
+			return false;
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = desc.Format;
+		if (cube)
+		{
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+			srvDesc.TextureCube.MipLevels = 1;
+		}
+		else
+		{
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Texture2D.MipLevels = 1;
+		}
+
+		HRESULT hr = device->CreateShaderResourceView(texture, &srvDesc, &placeholders[i]);
+		texture->Release();
+		if (FAILED(hr))
+			return false;
+	}
+	return true;
+}
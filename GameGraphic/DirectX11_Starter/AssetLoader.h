@@ -0,0 +1,229 @@
+#pragma once
+
+#include <d3d11.h>
+#include <d3dcompiler.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "AssetManifest.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MemoryTracker.h"
+#include "PakFile.h"
+#include "Vertex.h"
+
+class ISimpleShader;
+class Mesh;
+
+enum AssetState
+{
+	AssetState_Loading,
+	AssetState_Ready,
+	AssetState_Failed
+};
+
+// Stand-ins used by textures until they have loaded
+enum AssetPlaceholder
+{
+	AssetPlaceholder_White,
+	AssetPlaceholder_Black,
+	AssetPlaceholder_FlatNormal,
+	AssetPlaceholder_Sky,			// A cube map
+
+	AssetPlaceholder_Count
+};
+
+// Runs on the upload thread once the asset is in place
+typedef std::function<void(AssetState)> AssetCallback;
+
+// --------------------------------------------------------
+// Where a load request is up to.  Copies share the same
+// request; any thread may check it.
+// --------------------------------------------------------
+class AssetHandle
+{
+public:
+	AssetState GetState() const
+	{
+		return status ? (AssetState)status->load(std::memory_order_acquire) : AssetState_Failed;
+	}
+
+	bool IsReady() const { return GetState() == AssetState_Ready; }
+	bool IsDone() const { return GetState() != AssetState_Loading; }
+
+private:
+	friend class AssetLoader;
+	std::shared_ptr<std::atomic<int> > status;
+};
+
+// --------------------------------------------------------
+// Loads assets in the background.
+//
+// Each request is done in two stages.  A job reads the file
+// (and parses it, for meshes) on a worker thread.  The
+// result then waits for ProcessUploads(), which creates the
+// GPU resources for as many finished loads as fit in its
+// byte budget, so a burst of loads is spread over several
+// frames instead of stalling one.
+//
+// DDS files are not copied at all: the upload reads them in
+// place, from the pak's mapping when the pak stores them
+// uncompressed, otherwise from the loose file mapped on the
+// worker.  The worker touches every page first, so the disk
+// reads still happen off the upload thread.
+//
+// Images ImageDecoder can read are decoded on the worker,
+// which also builds their mip chain (see MipGenerator) so the
+// upload is a single texture creation.  Other images are left
+// to WIC at upload time.
+//
+// Textures are given a placeholder straight away.  Shaders
+// and meshes stay empty until they are uploaded, and draws
+// that use them are skipped until then.
+//
+// If a manifest from the asset cooker has been loaded, assets
+// it lists are loaded from their cooked files instead, which
+// skips the parsing, decoding and mip generation.  Callers
+// still ask for them by their source names.
+//
+// With a pak open, files are read from it first, falling
+// back to loose files for anything it doesn't have.  The
+// pak's manifest is used in place of a loose one, and
+// compressed entries are decompressed across the workers.
+//
+// ProcessUploads() uses the immediate context, so call it
+// on the thread that owns it - the render thread in
+// pipelined mode.  The targets passed in are only written
+// there too.
+// --------------------------------------------------------
+class AssetLoader
+{
+public:
+	static const size_t DefaultUploadBudget = 8 * 1024 * 1024;
+
+	AssetLoader();
+	~AssetLoader();
+
+	bool Init(ID3D11Device* device, ID3D11DeviceContext* context, JobSystem* jobSystem);
+	void Release();
+
+	// Loads the asset cooker's manifest.  Without one (or if it
+	// fails to load) every asset is loaded from its source.
+	// Call before queueing any loads.
+	bool LoadManifest(const std::string& path);
+
+	// Opens the asset cooker's pak file and loads the manifest
+	// inside it.  Call before queueing any loads.
+	bool OpenPak(const std::string& path);
+
+	// Points *target at the placeholder now and at the texture
+	// once it loads.  *target owns a reference either way, as
+	// if it had been created directly.
+	AssetHandle LoadTexture(const std::wstring& path, ID3D11ShaderResourceView** target,
+		AssetPlaceholder placeholder, AssetCallback onDone = AssetCallback());
+
+	// Fills in an already constructed shader
+	AssetHandle LoadShader(const std::wstring& path, ISimpleShader* shader, AssetCallback onDone = AssetCallback());
+
+	// Fills in a mesh whose device, context and geometry pool
+	// are already set
+	AssetHandle LoadMesh(const std::string& path, Mesh* mesh, AssetCallback onDone = AssetCallback());
+
+	// Creates finished loads until roughly budgetBytes have been
+	// uploaded (at least one, so big assets still get through).
+	// Returns how many were uploaded.
+	unsigned int ProcessUploads(size_t budgetBytes = DefaultUploadBudget);
+
+	// Waits for every queued load and uploads all of them
+	void Flush();
+
+	// Requests not yet uploaded
+	unsigned int GetPendingCount() const { return pendingCount.load(std::memory_order_relaxed); }
+
+	ID3D11ShaderResourceView* GetPlaceholder(AssetPlaceholder placeholder) { return placeholders[placeholder]; }
+
+	// Points data at a source's file (its cooked copy, if the
+	// manifest has one) without reading it: a stored pak entry,
+	// or else the loose file, opened in file.  False for
+	// compressed pak entries and missing files.  Any thread.
+	bool MapFile(const std::wstring& source, MappedFile& file, const unsigned char*& data, size_t& size) const;
+
+	// Hash of the contents a source loads from: the manifest's
+	// or pak's when they record it, otherwise the file is read
+	// and hashed.  False if the file is missing.  Any thread.
+	bool GetContentHash(const std::wstring& source, ContentHash& hash) const;
+
+private:
+	AssetLoader(const AssetLoader&);
+	AssetLoader& operator=(const AssetLoader&);
+
+	enum AssetType
+	{
+		AssetType_Texture,
+		AssetType_Shader,
+		AssetType_Mesh
+	};
+
+	struct Request
+	{
+		AssetType					type;
+		std::wstring				path;
+		std::string					name;		// For messages and memory accounting
+		AssetPlaceholder			placeholder;
+		AssetCallback				onDone;
+		std::shared_ptr<std::atomic<int> > status;
+
+		// Targets
+		ID3D11ShaderResourceView**	texture;
+		ISimpleShader*				shader;
+		Mesh*						mesh;
+
+		// Filled in by the loading job
+		bool						loaded;
+		std::vector<unsigned char>	fileData;		// Or the decoded mip chain
+		MappedFile					mappedFile;		// Loose DDS files, used in place
+		const unsigned char*		mappedData;		// Into mappedFile or the pak, or null
+		size_t						mappedSize;
+		uint32_t					width;			// Of a decoded texture
+		uint32_t					height;
+		uint32_t					mipCount;		// 0 if not decoded
+		ID3DBlob*					shaderBlob;
+		std::vector<Vertex>			vertices;
+		std::vector<UINT>			indices;
+	};
+
+	std::wstring ResolvePath(const std::string& source) const;
+	bool ReadFileData(const std::wstring& path, std::vector<unsigned char>& data) const;
+	bool ReadShaderBlob(const std::wstring& path, ID3DBlob** blob) const;
+	bool MapFileData(Request* request) const;
+	bool MapPath(const std::wstring& path, MappedFile& file, const unsigned char*& data, size_t& size) const;
+	void DecodeTexture(Request* request) const;
+	ID3D11ShaderResourceView* CreateDecodedTexture(const Request* request) const;
+	AssetHandle Queue(Request* request);
+	void Read(Request* request);
+	bool Upload(Request* request);
+	size_t GetUploadBytes(const Request* request) const;
+	bool CreatePlaceholders();
+
+	ID3D11Device*				device;
+	ID3D11DeviceContext*		context;
+	JobSystem*					jobSystem;
+	ID3D11ShaderResourceView*	placeholders[AssetPlaceholder_Count];
+	AssetManifest				manifest;
+	PakFile						pak;
+
+	// Loading jobs still running
+	JobCounter					loadingJobs;
+	std::atomic<unsigned int>	pendingCount;
+
+	// Read and waiting for ProcessUploads(), oldest first
+	std::mutex					readyLock;
+	std::deque<Request*>		ready;
+
+	// Textures loaded so far, for the memory tracker
+	std::vector<MemoryHandle>	textureMemory;
+};
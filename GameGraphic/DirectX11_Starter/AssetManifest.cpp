@@ -0,0 +1,176 @@
+#include "AssetManifest.h"
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	FILE* OpenFile(const char* path, const char* mode)
+	{
+		FILE* file = 0;
+#ifdef _MSC_VER
+		if (fopen_s(&file, path, mode) != 0)
+			file = 0;
+#else
+		file = fopen(path, mode);
+#endif
+		return file;
+	}
+
+	// Splits a line at tabs
+	void SplitFields(const std::string& line, std::vector<std::string>& fields)
+	{
+		fields.clear();
+		size_t start = 0;
+		for (;;)
+		{
+			size_t tab = line.find('\t', start);
+			fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+			if (tab == std::string::npos)
+				break;
+			start = tab + 1;
+		}
+	}
+}
+
+bool AssetManifest::Load(const char* path)
+{
+	Clear();
+
+	FILE* file = OpenFile(path, "rb");
+	if (!file)
+		return false;
+
+	std::string text;
+	char chunk[4096];
+	size_t read;
+	while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		text.append(chunk, read);
+	fclose(file);
+
+	if (!Parse(text))
+		return false;
+
+	const char* slash = strrchr(path, '/');
+	const char* backslash = strrchr(path, '\\');
+	if (backslash > slash)
+		slash = backslash;
+	if (slash)
+		directory.assign(path, slash + 1);
+	return true;
+}
+
+bool AssetManifest::Parse(const std::string& text)
+{
+	Clear();
+
+	// The first line says which version wrote it
+	std::vector<std::string> fields;
+	bool versionOk = false;
+	size_t start = 0;
+	while (start < text.size())
+	{
+		size_t end = text.find('\n', start);
+		if (end == std::string::npos)
+			end = text.size();
+		std::string line = text.substr(start, end - start);
+		start = end + 1;
+
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		SplitFields(line, fields);
+		if (!versionOk)
+		{
+			versionOk = fields.size() == 2 && fields[0] == "version" && (unsigned int)atoi(fields[1].c_str()) == Version;
+			if (!versionOk)
+				break;
+			continue;
+		}
+
+		AssetManifestEntry entry;
+		if (fields.size() != 4 || !ParseHash(fields[3].c_str(), entry.hash))
+			continue;
+		if (fields[0] == GetTypeName(CookedAssetType_Mesh))
+			entry.type = CookedAssetType_Mesh;
+		else if (fields[0] == GetTypeName(CookedAssetType_Texture))
+			entry.type = CookedAssetType_Texture;
+		else
+			continue;
+
+		entry.source = fields[1];
+		entry.cooked = fields[2];
+		Add(entry);
+	}
+
+	if (!versionOk)
+		Clear();
+	return versionOk;
+}
+
+bool AssetManifest::Save(const char* path) const
+{
+	FILE* file = OpenFile(path, "wb");
+	if (!file)
+		return false;
+
+	fprintf(file, "# Cooked assets - written by the asset cooker\n");
+	fprintf(file, "version\t%u\n", Version);
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const AssetManifestEntry& entry = entries[i];
+		fprintf(file, "%s\t%s\t%s\t%s\n", GetTypeName(entry.type), entry.source.c_str(),
+			entry.cooked.c_str(), FormatHash(entry.hash).c_str());
+	}
+
+	bool failed = ferror(file) != 0;
+	return fclose(file) == 0 && !failed;
+}
+
+void AssetManifest::Clear()
+{
+	entries.clear();
+	lookup.clear();
+	directory.clear();
+}
+
+void AssetManifest::Add(const AssetManifestEntry& entry)
+{
+	std::string key = MakeKey(entry.source);
+	std::unordered_map<std::string, size_t>::iterator it = lookup.find(key);
+	if (it != lookup.end())
+	{
+		entries[it->second] = entry;
+		return;
+	}
+
+	lookup[key] = entries.size();
+	entries.push_back(entry);
+}
+
+const AssetManifestEntry* AssetManifest::Find(const std::string& source) const
+{
+	std::unordered_map<std::string, size_t>::const_iterator it = lookup.find(MakeKey(source));
+	return it != lookup.end() ? &entries[it->second] : 0;
+}
+
+const char* AssetManifest::GetTypeName(CookedAssetType type)
+{
+	switch (type)
+	{
+	case CookedAssetType_Mesh:		return "mesh";
+	case CookedAssetType_Texture:	return "texture";
+	default:						return "unknown";
+	}
+}
+
+std::string AssetManifest::MakeKey(const std::string& source)
+{
+	std::string key = source;
+	for (size_t i = 0; i < key.size(); i++)
+		key[i] = key[i] == '\\' ? '/' : (char)tolower((unsigned char)key[i]);
+	return key;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ContentHash.h"
+
+enum CookedAssetType
+{
+	CookedAssetType_Mesh,
+	CookedAssetType_Texture
+};
+
+// --------------------------------------------------------
+// One cooked asset: the source file it came from and the
+// file to load instead, both relative to their roots
+// --------------------------------------------------------
+struct AssetManifestEntry
+{
+	CookedAssetType		type;
+	std::string			source;
+	std::string			cooked;
+	ContentHash			hash;		// Of the cooked file
+};
+
+// --------------------------------------------------------
+// The list of cooked assets written by the asset cooker.
+//
+// The game asks for assets by their source names; if the
+// manifest has one, the cooked file is loaded instead.
+// Lookups ignore case and treat \ and / alike, like the
+// Windows file system does.
+//
+// Stored as text, one tab separated line per asset:
+//   type  source  cooked  hash
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+class AssetManifest
+{
+public:
+	static const unsigned int Version = 1;
+
+	bool Load(const char* path);
+
+	// Reads a manifest already in memory.  Cooked paths are
+	// then relative to wherever it came from.
+	bool Parse(const std::string& text);
+
+	bool Save(const char* path) const;
+	void Clear();
+
+	// Replaces any entry with the same source
+	void Add(const AssetManifestEntry& entry);
+	const AssetManifestEntry* Find(const std::string& source) const;
+
+	const std::vector<AssetManifestEntry>& GetEntries() const { return entries; }
+
+	// Folder the manifest was loaded from, with a trailing
+	// slash - cooked paths are relative to it
+	const std::string& GetDirectory() const { return directory; }
+
+	static const char* GetTypeName(CookedAssetType type);
+
+private:
+	static std::string MakeKey(const std::string& source);
+
+	std::vector<AssetManifestEntry>				entries;
+	std::unordered_map<std::string, size_t>		lookup;
+	std::string									directory;
+};
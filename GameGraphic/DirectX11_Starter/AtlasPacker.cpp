@@ -0,0 +1,268 @@
+#include "AtlasPacker.h"
+#include <algorithm>
+
+namespace
+{
+	bool Intersects(const AtlasRect& a, const AtlasRect& b)
+	{
+		return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+	}
+
+	bool Contains(const AtlasRect& outer, const AtlasRect& inner)
+	{
+		return inner.x >= outer.x && inner.y >= outer.y &&
+			inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+	}
+}
+
+AtlasPacker::AtlasPacker()
+{
+	method = AtlasPack_MaxRects;
+	width = 0;
+	height = 0;
+	usedArea = 0;
+}
+
+void AtlasPacker::Init(uint32_t _width, uint32_t _height, AtlasPackMethod _method)
+{
+	method = _method;
+	width = _width;
+	height = _height;
+	usedArea = 0;
+
+	freeRects.clear();
+	skyline.clear();
+	if (method == AtlasPack_MaxRects)
+	{
+		AtlasRect all = { 0, 0, width, height };
+		freeRects.push_back(all);
+	}
+	else
+	{
+		SkylineNode floor = { 0, 0, width };
+		skyline.push_back(floor);
+	}
+}
+
+bool AtlasPacker::Insert(uint32_t rectWidth, uint32_t rectHeight, AtlasRect& placed)
+{
+	if (rectWidth == 0 || rectHeight == 0 || rectWidth > width || rectHeight > height)
+		return false;
+
+	bool inserted = method == AtlasPack_MaxRects ?
+		InsertMaxRects(rectWidth, rectHeight, placed) : InsertSkyline(rectWidth, rectHeight, placed);
+	if (inserted)
+		usedArea += (uint64_t)rectWidth * rectHeight;
+	return inserted;
+}
+
+float AtlasPacker::GetOccupancy() const
+{
+	uint64_t area = (uint64_t)width * height;
+	return area > 0 ? (float)((double)usedArea / (double)area) : 0.0f;
+}
+
+// --------------------------------------------------------
+// Best short side fit, then best long side fit
+// --------------------------------------------------------
+bool AtlasPacker::InsertMaxRects(uint32_t rectWidth, uint32_t rectHeight, AtlasRect& placed)
+{
+	size_t best = freeRects.size();
+	uint32_t bestShort = 0;
+	uint32_t bestLong = 0;
+	for (size_t i = 0; i < freeRects.size(); i++)
+	{
+		const AtlasRect& free = freeRects[i];
+		if (free.width < rectWidth || free.height < rectHeight)
+			continue;
+
+		uint32_t overX = free.width - rectWidth;
+		uint32_t overY = free.height - rectHeight;
+		uint32_t shortSide = std::min(overX, overY);
+		uint32_t longSide = std::max(overX, overY);
+		if (best == freeRects.size() || shortSide < bestShort || (shortSide == bestShort && longSide < bestLong))
+		{
+			best = i;
+			bestShort = shortSide;
+			bestLong = longSide;
+		}
+	}
+	if (best == freeRects.size())
+		return false;
+
+	placed.x = freeRects[best].x;
+	placed.y = freeRects[best].y;
+	placed.width = rectWidth;
+	placed.height = rectHeight;
+	SplitFreeRects(placed);
+	return true;
+}
+
+// --------------------------------------------------------
+// Replaces every free rectangle the new one overlaps with
+// the (up to four) largest ones left around it
+// --------------------------------------------------------
+void AtlasPacker::SplitFreeRects(const AtlasRect& used)
+{
+	splitRects.clear();
+	for (size_t i = 0; i < freeRects.size(); i++)
+	{
+		const AtlasRect& free = freeRects[i];
+		if (!Intersects(free, used))
+		{
+			splitRects.push_back(free);
+			continue;
+		}
+
+		uint32_t usedRight = used.x + used.width;
+		uint32_t usedBottom = used.y + used.height;
+		uint32_t freeRight = free.x + free.width;
+		uint32_t freeBottom = free.y + free.height;
+		if (used.x > free.x)
+		{
+			AtlasRect left = { free.x, free.y, used.x - free.x, free.height };
+			splitRects.push_back(left);
+		}
+		if (usedRight < freeRight)
+		{
+			AtlasRect right = { usedRight, free.y, freeRight - usedRight, free.height };
+			splitRects.push_back(right);
+		}
+		if (used.y > free.y)
+		{
+			AtlasRect above = { free.x, free.y, free.width, used.y - free.y };
+			splitRects.push_back(above);
+		}
+		if (usedBottom < freeBottom)
+		{
+			AtlasRect below = { free.x, usedBottom, free.width, freeBottom - usedBottom };
+			splitRects.push_back(below);
+		}
+	}
+	freeRects.swap(splitRects);
+	PruneFreeRects();
+}
+
+// --------------------------------------------------------
+// Drops free rectangles that lie inside another, which
+// splitting leaves plenty of
+// --------------------------------------------------------
+void AtlasPacker::PruneFreeRects()
+{
+	for (size_t i = 0; i < freeRects.size();)
+	{
+		bool inside = false;
+		for (size_t j = i + 1; j < freeRects.size();)
+		{
+			if (Contains(freeRects[j], freeRects[i]))
+			{
+				inside = true;
+				break;
+			}
+			if (Contains(freeRects[i], freeRects[j]))
+				freeRects.erase(freeRects.begin() + j);
+			else
+				j++;
+		}
+
+		if (inside)
+			freeRects.erase(freeRects.begin() + i);
+		else
+			i++;
+	}
+}
+
+// --------------------------------------------------------
+// Bottom left: the spot whose top ends lowest, then the
+// narrowest ledge
+// --------------------------------------------------------
+bool AtlasPacker::InsertSkyline(uint32_t rectWidth, uint32_t rectHeight, AtlasRect& placed)
+{
+	size_t best = skyline.size();
+	uint32_t bestTop = 0;
+	uint32_t bestWidth = 0;
+	for (size_t i = 0; i < skyline.size(); i++)
+	{
+		uint32_t y;
+		if (!FitSkyline(i, rectWidth, rectHeight, y))
+			continue;
+
+		uint32_t top = y + rectHeight;
+		if (best == skyline.size() || top < bestTop || (top == bestTop && skyline[i].width < bestWidth))
+		{
+			best = i;
+			bestTop = top;
+			bestWidth = skyline[i].width;
+		}
+	}
+	if (best == skyline.size())
+		return false;
+
+	placed.x = skyline[best].x;
+	placed.y = bestTop - rectHeight;
+	placed.width = rectWidth;
+	placed.height = rectHeight;
+	AddSkylineLevel(best, placed);
+	return true;
+}
+
+// --------------------------------------------------------
+// Where a rectangle starting at a node's left edge would
+// rest: on the highest node under it
+// --------------------------------------------------------
+bool AtlasPacker::FitSkyline(size_t node, uint32_t rectWidth, uint32_t rectHeight, uint32_t& y) const
+{
+	uint32_t x = skyline[node].x;
+	if (x + rectWidth > width)
+		return false;
+
+	y = 0;
+	uint32_t covered = 0;
+	for (size_t i = node; covered < rectWidth; i++)
+	{
+		y = std::max(y, skyline[i].y);
+		if (y + rectHeight > height)
+			return false;
+		covered += skyline[i].width;
+	}
+	return true;
+}
+
+void AtlasPacker::AddSkylineLevel(size_t node, const AtlasRect& placed)
+{
+	SkylineNode level = { placed.x, placed.y + placed.height, placed.width };
+	skyline.insert(skyline.begin() + node, level);
+
+	// Cut back the nodes the new one covers
+	uint32_t right = placed.x + placed.width;
+	for (size_t i = node + 1; i < skyline.size();)
+	{
+		SkylineNode& next = skyline[i];
+		if (next.x >= right)
+			break;
+
+		uint32_t nextRight = next.x + next.width;
+		if (nextRight <= right)
+		{
+			skyline.erase(skyline.begin() + i);
+			continue;
+		}
+		next.width = nextRight - right;
+		next.x = right;
+		break;
+	}
+
+	// Merge neighbours at the same height
+	for (size_t i = 0; i + 1 < skyline.size();)
+	{
+		if (skyline[i].y == skyline[i + 1].y)
+		{
+			skyline[i].width += skyline[i + 1].width;
+			skyline.erase(skyline.begin() + i + 1);
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
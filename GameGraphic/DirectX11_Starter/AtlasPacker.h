@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum AtlasPackMethod
+{
+	AtlasPack_MaxRects,		// Tightest, best for packing a whole set at once
+	AtlasPack_Skyline		// Faster, for adding one at a time at run time
+};
+
+struct AtlasRect
+{
+	uint32_t	x;
+	uint32_t	y;
+	uint32_t	width;
+	uint32_t	height;
+};
+
+// --------------------------------------------------------
+// Places rectangles in a fixed size area without overlaps,
+// for building texture atlases (see TextureAtlas).
+//
+// MaxRects keeps every maximal free rectangle and puts each
+// new one where it leaves the shortest side over (best short
+// side fit).  Skyline only keeps the top edge of what has
+// been placed and puts each new one as low as it goes, which
+// is quicker but wastes the gaps under overhangs.  Both pack
+// best when given the largest rectangles first.
+//
+// Rectangles are never rotated, so sprites drawn from an
+// atlas don't need their texture coordinates turned.
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+class AtlasPacker
+{
+public:
+	AtlasPacker();
+
+	// Empties the area
+	void Init(uint32_t width, uint32_t height, AtlasPackMethod method);
+
+	// False if there's no room left for it
+	bool Insert(uint32_t width, uint32_t height, AtlasRect& placed);
+
+	uint32_t GetWidth() const { return width; }
+	uint32_t GetHeight() const { return height; }
+
+	// Share of the area used so far, 0 to 1
+	float GetOccupancy() const;
+
+private:
+	struct SkylineNode
+	{
+		uint32_t	x;
+		uint32_t	y;			// Top of what's placed below it
+		uint32_t	width;
+	};
+
+	bool InsertMaxRects(uint32_t width, uint32_t height, AtlasRect& placed);
+	void SplitFreeRects(const AtlasRect& used);
+	void PruneFreeRects();
+
+	bool InsertSkyline(uint32_t width, uint32_t height, AtlasRect& placed);
+	bool FitSkyline(size_t node, uint32_t width, uint32_t height, uint32_t& y) const;
+	void AddSkylineLevel(size_t node, const AtlasRect& placed);
+
+	AtlasPackMethod				method;
+	uint32_t					width;
+	uint32_t					height;
+	uint64_t					usedArea;
+
+	std::vector<AtlasRect>		freeRects;		// MaxRects
+	std::vector<AtlasRect>		splitRects;		// Reused by SplitFreeRects()
+	std::vector<SkylineNode>	skyline;		// Left to right
+};
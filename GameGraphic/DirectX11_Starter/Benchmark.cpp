@@ -0,0 +1,392 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+	FILE* OpenFile(const char* path, const char* mode)
+	{
+		FILE* file = 0;
+#ifdef _MSC_VER
+		if (fopen_s(&file, path, mode) != 0)
+			file = 0;
+#else
+		file = fopen(path, mode);
+#endif
+		return file;
+	}
+
+	// Escapes free text for a JSON string
+	std::string JsonEscape(const std::string& text)
+	{
+		std::string result;
+		for (unsigned int i = 0; i < text.size(); i++)
+		{
+			char c = text[i];
+			if (c == '"' || c == '\\') { result += '\\'; result += c; }
+			else if ((unsigned char)c >= 0x20) result += c;
+		}
+		return result;
+	}
+
+	// Splits a command line on whitespace, keeping "quoted
+	// strings" (e.g. paths with spaces) together
+	std::vector<std::string> SplitArguments(const char* commandLine)
+	{
+		std::vector<std::string> args;
+		const char* c = commandLine;
+		while (c && *c)
+		{
+			while (*c == ' ' || *c == '\t')
+				c++;
+			if (!*c)
+				break;
+
+			std::string arg;
+			if (*c == '"')
+			{
+				for (c++; *c && *c != '"'; c++)
+					arg += *c;
+				if (*c == '"')
+					c++;
+			}
+			else
+			{
+				for (; *c && *c != ' ' && *c != '\t'; c++)
+					arg += *c;
+			}
+			args.push_back(arg);
+		}
+		return args;
+	}
+
+	bool ParseCount(const std::string& text, unsigned int& value)
+	{
+		char* end = 0;
+		unsigned long parsed = strtoul(text.c_str(), &end, 10);
+		if (text.empty() || *end != '\0')
+			return false;
+		value = (unsigned int)parsed;
+		return true;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ CAMERA PATH ---------------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Reads keys from a text file, replacing any current ones
+// --------------------------------------------------------
+bool CameraPath::Load(const char* path)
+{
+	FILE* file = OpenFile(path, "r");
+	if (!file)
+		return false;
+
+	keys.clear();
+	char line[256];
+	while (fgets(line, sizeof(line), file))
+	{
+		if (line[0] == '#')
+			continue;
+
+		// Seven numbers, or the line is skipped
+		float values[7];
+		const char* c = line;
+		unsigned int read = 0;
+		for (; read < 7; read++)
+		{
+			char* end = 0;
+			values[read] = strtof(c, &end);
+			if (end == c)
+				break;
+			c = end;
+		}
+		if (read < 7)
+			continue;
+
+		CameraKey key;
+		key.time = values[0];
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			key.position[i] = values[1 + i];
+			key.direction[i] = values[4 + i];
+		}
+		AddKey(key);
+	}
+
+	fclose(file);
+	return !keys.empty();
+}
+
+void CameraPath::CreateOrbit(const float center[3], float radius, float height, float seconds, unsigned int keyCount)
+{
+	keys.clear();
+	if (keyCount < 2)
+		keyCount = 2;
+
+	// The last key repeats the first so the loop is seamless
+	for (unsigned int i = 0; i <= keyCount; i++)
+	{
+		float angle = 6.2831853f * i / keyCount;
+
+		CameraKey key;
+		key.time = seconds * i / keyCount;
+		key.position[0] = center[0] + sinf(angle) * radius;
+		key.position[1] = center[1] + height;
+		key.position[2] = center[2] - cosf(angle) * radius;
+		for (unsigned int a = 0; a < 3; a++)
+			key.direction[a] = center[a] - key.position[a];
+		keys.push_back(key);
+	}
+}
+
+// --------------------------------------------------------
+// Keys usually arrive in order, so this is an append
+// --------------------------------------------------------
+void CameraPath::AddKey(const CameraKey& key)
+{
+	std::vector<CameraKey>::iterator at = std::upper_bound(keys.begin(), keys.end(), key,
+		[](const CameraKey& a, const CameraKey& b) { return a.time < b.time; });
+	keys.insert(at, key);
+}
+
+void CameraPath::Evaluate(float time, float position[3], float direction[3]) const
+{
+	if (keys.empty())
+		return;
+
+	// Loop the path
+	float duration = GetDuration();
+	if (duration > 0.0f)
+	{
+		time = fmodf(time, duration);
+		if (time < 0.0f)
+			time += duration;
+	}
+
+	// First key after the time, and the one before it
+	unsigned int next = 0;
+	while (next < keys.size() && keys[next].time <= time)
+		next++;
+
+	const CameraKey& a = keys[next > 0 ? next - 1 : 0];
+	const CameraKey& b = keys[next < keys.size() ? next : keys.size() - 1];
+	float span = b.time - a.time;
+	float t = span > 0.0f ? (time - a.time) / span : 0.0f;
+
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		position[i] = a.position[i] + (b.position[i] - a.position[i]) * t;
+		direction[i] = a.direction[i] + (b.direction[i] - a.direction[i]) * t;
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ BENCHMARK SETTINGS --------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+BenchmarkSettings::BenchmarkSettings()
+	: enabled(false),
+	frameCount(600),
+	warmupFrames(30),
+	headless(false),
+	driver(Driver_Hardware),
+	reportFile("benchmark.json"),
+	stressDraws(0)
+{
+}
+
+bool BenchmarkSettings::Parse(const char* commandLine)
+{
+	std::vector<std::string> args = SplitArguments(commandLine);
+
+	bool benchmark = false;
+	bool driverGiven = false;
+	bool stressGiven = false;
+	for (unsigned int i = 0; i < args.size(); i++)
+	{
+		const std::string& arg = args[i];
+		bool hasValue = i + 1 < args.size();
+
+		if (arg == "-benchmark")
+		{
+			benchmark = true;
+			if (hasValue && ParseCount(args[i + 1], frameCount))
+				i++;
+		}
+		else if (arg == "-warmup")
+		{
+			if (!hasValue || !ParseCount(args[++i], warmupFrames))
+				return false;
+		}
+		else if (arg == "-headless")
+		{
+			headless = true;
+		}
+		else if (arg == "-driver")
+		{
+			if (!hasValue)
+				return false;
+			const std::string& name = args[++i];
+			if (name == "hardware")	driver = Driver_Hardware;
+			else if (name == "warp")	driver = Driver_Warp;
+			else if (name == "null")	driver = Driver_Null;
+			else return false;
+			driverGiven = true;
+		}
+		else if (arg == "-path")
+		{
+			if (!hasValue)
+				return false;
+			cameraPathFile = args[++i];
+		}
+		else if (arg == "-report")
+		{
+			if (!hasValue)
+				return false;
+			reportFile = args[++i];
+		}
+		else if (arg == "-stress")
+		{
+			if (!hasValue || !ParseCount(args[++i], stressDraws))
+				return false;
+			stressGiven = true;
+		}
+	}
+
+	// Without a window there is nothing to present to, so only
+	// the CPU side is measured unless WARP was asked for
+	if (headless && !driverGiven)
+		driver = Driver_Null;
+
+	// Benchmarks measure submission with enough draws for it
+	// to be worth splitting across threads
+	if (benchmark && !stressGiven)
+		stressDraws = DefaultStressDraws;
+
+	enabled = benchmark && frameCount > 0;
+	return true;
+}
+
+const char* BenchmarkSettings::GetDriverName(Driver driver)
+{
+	switch (driver)
+	{
+	case Driver_Warp:	return "warp";
+	case Driver_Null:	return "null";
+	default:			return "hardware";
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ BENCHMARK REPORT ----------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+BenchmarkReport::BenchmarkReport()
+{
+	Reset();
+}
+
+void BenchmarkReport::Reset()
+{
+	phases.clear();
+	phaseFrames = 0;
+	for (unsigned int i = 0; i < RenderCounter_Count; i++)
+		counterTotals[i] = 0;
+	counterFrames = 0;
+}
+
+// --------------------------------------------------------
+// Merges one batch of profiler scopes covering the given
+// number of frames
+// --------------------------------------------------------
+void BenchmarkReport::AddPhases(const std::vector<ProfileSummaryEntry>& batch, unsigned int frames)
+{
+	for (unsigned int i = 0; i < batch.size(); i++)
+	{
+		Phase* phase = 0;
+		for (unsigned int p = 0; p < phases.size() && !phase; p++)
+			if (phases[p].name == batch[i].name)
+				phase = &phases[p];
+
+		if (!phase)
+		{
+			Phase blank = { batch[i].name, 0, 0.0, 0.0 };
+			phases.push_back(blank);
+			phase = &phases.back();
+		}
+
+		phase->calls += batch[i].calls;
+		phase->totalMs += batch[i].totalMs;
+		phase->maxMs = std::max(phase->maxMs, batch[i].maxMs);
+	}
+	phaseFrames += frames;
+}
+
+void BenchmarkReport::AddRenderCounters(const RenderCounters& counters)
+{
+	for (unsigned int i = 0; i < RenderCounter_Count; i++)
+		counterTotals[i] += counters.values[i];
+	counterFrames++;
+}
+
+bool BenchmarkReport::Write(const char* path, const BenchmarkSettings& settings, float stepSeconds,
+	double wallSeconds, const FrameTimeSummary& frameTimes, unsigned int hitchCount)
+{
+	FILE* file = OpenFile(path, "w");
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n");
+	fprintf(file, "  \"settings\": { \"frames\": %u, \"warmup_frames\": %u, \"step_seconds\": %.6f, "
+		"\"headless\": %s, \"driver\": \"%s\", \"camera_path\": \"%s\", \"stress_draws\": %u },\n",
+		settings.frameCount, settings.warmupFrames, stepSeconds,
+		settings.headless ? "true" : "false",
+		BenchmarkSettings::GetDriverName(settings.driver),
+		JsonEscape(settings.cameraPathFile.empty() ? "orbit" : settings.cameraPathFile).c_str(),
+		settings.stressDraws);
+
+	fprintf(file, "  \"wall_seconds\": %.4f,\n", wallSeconds);
+	fprintf(file, "  \"frame_ms\": { \"frames\": %u, \"average\": %.4f, \"p50\": %.4f, "
+		"\"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"hitches\": %u },\n",
+		frameTimes.frameCount, frameTimes.averageMs, frameTimes.p50Ms,
+		frameTimes.p95Ms, frameTimes.p99Ms, frameTimes.maxMs, hitchCount);
+
+	// Most expensive phases first
+	std::vector<Phase> sorted = phases;
+	std::sort(sorted.begin(), sorted.end(), [](const Phase& a, const Phase& b)
+	{
+		return a.totalMs > b.totalMs;
+	});
+
+	fprintf(file, "  \"phases\": [");
+	for (unsigned int i = 0; i < sorted.size(); i++)
+	{
+		fprintf(file, "%s\n    { \"name\": \"%s\", \"calls\": %u, \"total_ms\": %.4f, "
+			"\"ms_per_frame\": %.4f, \"max_ms\": %.4f }",
+			i > 0 ? "," : "",
+			JsonEscape(sorted[i].name).c_str(),
+			sorted[i].calls,
+			sorted[i].totalMs,
+			phaseFrames > 0 ? sorted[i].totalMs / phaseFrames : 0.0,
+			sorted[i].maxMs);
+	}
+	fprintf(file, "%s],\n", sorted.empty() ? "" : "\n  ");
+
+	fprintf(file, "  \"render_counters_per_frame\": {");
+	for (unsigned int i = 0; i < RenderCounter_Count; i++)
+	{
+		fprintf(file, "%s \"%s\": %.2f",
+			i > 0 ? "," : "",
+			RenderStats::GetName((RenderCounter)i),
+			counterFrames > 0 ? (double)counterTotals[i] / counterFrames : 0.0);
+	}
+	fprintf(file, " }\n}\n");
+
+	fclose(file);
+	return true;
+}
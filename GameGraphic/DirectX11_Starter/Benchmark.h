@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "FrameStats.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+
+// --------------------------------------------------------
+// One point on a camera path
+// --------------------------------------------------------
+struct CameraKey
+{
+	float time;				// Seconds from the start of the path
+	float position[3];
+	float direction[3];		// Look direction, need not be normalized
+};
+
+// --------------------------------------------------------
+// A scripted camera flight for benchmark runs, so every run
+// sees the same views.  Positions and directions are linearly
+// interpolated between keys, and the path loops.
+//
+// Files are plain text, one key per line:
+//   time  px py pz  dx dy dz
+// Blank lines and lines starting with # are skipped.
+// --------------------------------------------------------
+class CameraPath
+{
+public:
+	bool Load(const char* path);
+
+	// A circle around center at the given radius and height,
+	// looking at the center, taking the given time per lap
+	void CreateOrbit(const float center[3], float radius, float height, float seconds, unsigned int keyCount = 32);
+
+	void AddKey(const CameraKey& key);
+
+	// Where the camera is at a time.  Does nothing on an empty path.
+	void Evaluate(float time, float position[3], float direction[3]) const;
+
+	bool IsEmpty() const { return keys.empty(); }
+	float GetDuration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+private:
+	std::vector<CameraKey> keys;	// Sorted by time
+};
+
+// --------------------------------------------------------
+// How a benchmark run is set up, usually from the command line:
+//
+//   -benchmark [frames]   Run a benchmark of that many frames (600)
+//   -warmup <frames>      Frames to run first and leave out (30)
+//   -headless             No window; implies -driver null
+//   -driver <name>        hardware, warp or null
+//   -path <file>          Camera path (default: an orbit)
+//   -report <file>        JSON report (default: benchmark.json)
+//   -stress <draws>       Extra cube draws per frame (1024 when
+//                         benchmarking, else 0), so there are
+//                         enough for parallel submission to split
+// --------------------------------------------------------
+struct BenchmarkSettings
+{
+	enum Driver
+	{
+		Driver_Hardware,
+		Driver_Warp,		// Software rasterizer - no GPU needed
+		Driver_Null			// Creates resources but never draws
+	};
+
+	BenchmarkSettings();
+
+	// Returns false (and leaves enabled unset) on a bad argument
+	bool Parse(const char* commandLine);
+
+	bool			enabled;
+	unsigned int	frameCount;
+	unsigned int	warmupFrames;
+	bool			headless;
+	Driver			driver;
+	std::string		cameraPathFile;
+	std::string		reportFile;
+	unsigned int	stressDraws;
+
+	// Stress draws in a benchmark that doesn't say otherwise
+	static const unsigned int DefaultStressDraws = 1024;
+
+	static const char* GetDriverName(Driver driver);
+};
+
+// --------------------------------------------------------
+// Collects what a benchmark run measured and writes it out
+// as JSON: frame time percentiles, time per profiler scope
+// (the frame's phases) and average render counters.
+//
+// Phases are added in batches from Profiler::GetSummary(),
+// since the profiler only remembers a few hundred frames.
+// --------------------------------------------------------
+class BenchmarkReport
+{
+public:
+	BenchmarkReport();
+
+	void Reset();
+
+	void AddPhases(const std::vector<ProfileSummaryEntry>& phases, unsigned int frames);
+	void AddRenderCounters(const RenderCounters& counters);
+
+	bool Write(const char* path, const BenchmarkSettings& settings, float stepSeconds,
+		double wallSeconds, const FrameTimeSummary& frameTimes, unsigned int hitchCount);
+
+private:
+	struct Phase
+	{
+		std::string		name;
+		unsigned int	calls;
+		double			totalMs;
+		double			maxMs;
+	};
+
+	std::vector<Phase>	phases;
+	unsigned int		phaseFrames;
+
+	unsigned long long	counterTotals[RenderCounter_Count];
+	unsigned int		counterFrames;
+};
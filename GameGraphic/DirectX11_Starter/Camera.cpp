@@ -9,6 +9,8 @@ Camera::Camera()
 	cameraPos			= XMFLOAT3(0.0f, 0.0f, -10.0f);
 	cameraLookToDir		= XMFLOAT3(0, 0, 1);
 	cameraUp			= XMFLOAT3(0, 1, 0);
+	prevCameraPos		= cameraPos;
+	viewPos				= cameraPos;
 	//Projection matrix
 	viewAngleField		= 0.25f * 3.1415926535f;
 	nearClipDistance	= 0.1f;
@@ -39,10 +41,18 @@ void Camera::SetFarClipDis(float fardis)
 	farClipDistance = fardis;
 }
 
-void Camera::UpdateVPMatrixes()
+void Camera::SaveState()
 {
-	//view matrix
-	XMVECTOR pos = XMLoadFloat3(&cameraPos);
+	prevCameraPos = cameraPos;
+}
+
+void Camera::UpdateVPMatrixes(float interpolation)
+{
+	//view matrix, from between the last two simulation steps.
+	//The look direction follows the mouse directly, so only
+	//the position needs interpolating.
+	XMVECTOR pos = XMVectorLerp(XMLoadFloat3(&prevCameraPos), XMLoadFloat3(&cameraPos), interpolation);
+	XMStoreFloat3(&viewPos, pos);
 	XMVECTOR dir = XMLoadFloat3(&cameraLookToDir);
 	XMVECTOR up = /*XMLoadFloat3(&XMFLOAT3(0.0, 1.0, 0.0));*/XMLoadFloat3(&cameraUp);
 	XMMATRIX V = XMMatrixLookToLH(
@@ -84,6 +94,22 @@ void Camera::UpdateCameraDir(float XPitchMouseY, float YYawMouseX)
 	XMStoreFloat3(&cameraUp, newUpVector);
 }
 
+void Camera::SetCameraPosition(XMFLOAT3 position)
+{
+	cameraPos = position;
+}
+
+void Camera::SetCameraDirection(XMFLOAT3 direction)
+{
+	//keep the direction normalized and the up vector perpendicular to it
+	XMVECTOR newCameraDir = XMVector3Normalize(XMLoadFloat3(&direction));
+	XMStoreFloat3(&cameraLookToDir, newCameraDir);
+
+	XMFLOAT3 temp(0, 1, 0);
+	XMVECTOR newUpVector = XMVector3Cross(XMVector3Cross(newCameraDir, XMLoadFloat3(&temp)), newCameraDir);
+	XMStoreFloat3(&cameraUp, newUpVector);
+}
+
 void Camera::MoveForward(float fSpeed)
 {
 	XMVECTOR newCameraPos = XMLoadFloat3(&cameraPos);
@@ -148,4 +174,9 @@ XMFLOAT4X4 Camera::GetProjectionMatrix()
 XMFLOAT3 Camera::GetCameraPosition()
 {
 	return cameraPos;
-}
\ No newline at end of file
+}
+
+XMFLOAT3 Camera::GetViewPosition()
+{
+	return viewPos;
+}
@@ -16,8 +16,17 @@ public:
 	void SetFarClipDis(float fardis);
 	
 	void UpdateCameraDir(float XPitchMouseY, float YYawMouseX);
+
+	// Places the camera directly (e.g. from a scripted path)
+	void SetCameraPosition(XMFLOAT3 position);
+	void SetCameraDirection(XMFLOAT3 direction);
 	
-	void UpdateVPMatrixes();
+	// Builds the view matrix from a point between the saved and
+	// current positions (0 = saved, 1 = current)
+	void UpdateVPMatrixes(float interpolation = 1.0f);
+
+	// Remembers the current position for interpolation
+	void SaveState();
 	
 	XMFLOAT4X4 GetViewMatrix();
 	XMFLOAT4X4 GetProjectionMatrix();
@@ -31,6 +40,9 @@ public:
 	
 	XMFLOAT3 GetCameraPosition();
 
+	// Position the last view matrix was built from
+	XMFLOAT3 GetViewPosition();
+
 
 
 private:
@@ -40,6 +52,10 @@ private:
 	XMFLOAT3	cameraUp;
 	XMFLOAT4X4	viewMatrix;
 
+	//interpolation
+	XMFLOAT3	prevCameraPos;
+	XMFLOAT3	viewPos;
+
 	//Projection matrix
 	float		viewAngleField;
 	float		aspectRatio;
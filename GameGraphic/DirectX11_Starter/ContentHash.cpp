@@ -0,0 +1,230 @@
+#include "ContentHash.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+	const uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+	const uint64_t Prime3 = 0x165667B19E3779F9ULL;
+	const uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+	const uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+	inline uint64_t RotateLeft(uint64_t value, int bits)
+	{
+		return (value << bits) | (value >> (64 - bits));
+	}
+
+	// Unaligned little-endian reads
+	inline uint64_t Read64(const unsigned char* p)
+	{
+		uint64_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Read32(const unsigned char* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint64_t Round(uint64_t lane, uint64_t input)
+	{
+		lane += input * Prime2;
+		lane = RotateLeft(lane, 31);
+		return lane * Prime1;
+	}
+
+	inline uint64_t MergeRound(uint64_t hash, uint64_t lane)
+	{
+		hash ^= Round(0, lane);
+		return hash * Prime1 + Prime4;
+	}
+
+	// Mixes in the last (less than 32) bytes and scrambles the result
+	uint64_t Finalize(uint64_t hash, const unsigned char* p, size_t size)
+	{
+		while (size >= 8)
+		{
+			hash ^= Round(0, Read64(p));
+			hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+			p += 8;
+			size -= 8;
+		}
+		if (size >= 4)
+		{
+			hash ^= (uint64_t)Read32(p) * Prime1;
+			hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+			p += 4;
+			size -= 4;
+		}
+		while (size > 0)
+		{
+			hash ^= (*p) * Prime5;
+			hash = RotateLeft(hash, 11) * Prime1;
+			p++;
+			size--;
+		}
+
+		hash ^= hash >> 33;
+		hash *= Prime2;
+		hash ^= hash >> 29;
+		hash *= Prime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	uint64_t MergeLanes(const uint64_t lanes[4])
+	{
+		uint64_t hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) +
+			RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+		for (int i = 0; i < 4; i++)
+			hash = MergeRound(hash, lanes[i]);
+		return hash;
+	}
+}
+
+ContentHash HashBytes(const void* data, size_t size, uint64_t seed)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + size;
+	uint64_t hash;
+
+	if (size >= 32)
+	{
+		uint64_t lanes[4] = { seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1 };
+		for (; p + 32 <= end; p += 32)
+		{
+			lanes[0] = Round(lanes[0], Read64(p));
+			lanes[1] = Round(lanes[1], Read64(p + 8));
+			lanes[2] = Round(lanes[2], Read64(p + 16));
+			lanes[3] = Round(lanes[3], Read64(p + 24));
+		}
+		hash = MergeLanes(lanes);
+	}
+	else
+	{
+		hash = seed + Prime5;
+	}
+
+	hash += (uint64_t)size;
+	return Finalize(hash, p, end - p);
+}
+
+bool HashFile(const char* path, ContentHash& hash)
+{
+	FILE* file = 0;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path, "rb") != 0)
+		file = 0;
+#else
+	file = fopen(path, "rb");
+#endif
+	if (!file)
+		return false;
+
+	ContentHasher hasher;
+	unsigned char chunk[64 * 1024];
+	size_t read;
+	while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		hasher.Update(chunk, read);
+
+	bool failed = ferror(file) != 0;
+	fclose(file);
+	if (failed)
+		return false;
+
+	hash = hasher.Finish();
+	return true;
+}
+
+std::string FormatHash(ContentHash hash)
+{
+	static const char digits[] = "0123456789abcdef";
+	std::string text(16, '0');
+	for (int i = 15; i >= 0; i--)
+	{
+		text[i] = digits[hash & 0xF];
+		hash >>= 4;
+	}
+	return text;
+}
+
+bool ParseHash(const char* text, ContentHash& hash)
+{
+	ContentHash value = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		char c = text[i];
+		unsigned int digit;
+		if (c >= '0' && c <= '9')		digit = c - '0';
+		else if (c >= 'a' && c <= 'f')	digit = c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')	digit = c - 'A' + 10;
+		else return false;
+		value = (value << 4) | digit;
+	}
+	hash = value;
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ STREAMING -----------------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+ContentHasher::ContentHasher(uint64_t _seed)
+{
+	seed = _seed;
+	lanes[0] = seed + Prime1 + Prime2;
+	lanes[1] = seed + Prime2;
+	lanes[2] = seed;
+	lanes[3] = seed - Prime1;
+	buffered = 0;
+	totalSize = 0;
+}
+
+void ContentHasher::Update(const void* data, size_t size)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + size;
+	totalSize += size;
+
+	// Top up a partial stripe first
+	if (buffered > 0)
+	{
+		size_t take = 32 - buffered;
+		if (take > size)
+			take = size;
+		memcpy(buffer + buffered, p, take);
+		buffered += (unsigned int)take;
+		p += take;
+		if (buffered < 32)
+			return;
+
+		for (int i = 0; i < 4; i++)
+			lanes[i] = Round(lanes[i], Read64(buffer + i * 8));
+		buffered = 0;
+	}
+
+	for (; p + 32 <= end; p += 32)
+	{
+		lanes[0] = Round(lanes[0], Read64(p));
+		lanes[1] = Round(lanes[1], Read64(p + 8));
+		lanes[2] = Round(lanes[2], Read64(p + 16));
+		lanes[3] = Round(lanes[3], Read64(p + 24));
+	}
+
+	if (p < end)
+	{
+		memcpy(buffer, p, end - p);
+		buffered = (unsigned int)(end - p);
+	}
+}
+
+ContentHash ContentHasher::Finish() const
+{
+	uint64_t hash = totalSize >= 32 ? MergeLanes(lanes) : seed + Prime5;
+	hash += totalSize;
+	return Finalize(hash, buffer, buffered);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// --------------------------------------------------------
+// 64-bit content hashes (the XXH64 algorithm), for telling
+// whether two files or blocks of data are the same without
+// comparing them byte by byte.
+//
+// Not cryptographic - fine for caches and deduplication,
+// not for anything that has to resist tampering.
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+typedef uint64_t ContentHash;
+
+// Hashes a block of memory
+ContentHash HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// Hashes a whole file.  Returns false if it can't be read.
+bool HashFile(const char* path, ContentHash& hash);
+
+// 16 lowercase hex digits, and back
+std::string FormatHash(ContentHash hash);
+bool ParseHash(const char* text, ContentHash& hash);
+
+// --------------------------------------------------------
+// Hashes data that arrives in pieces.  Gives the same result
+// as HashBytes() over the pieces joined together.
+// --------------------------------------------------------
+class ContentHasher
+{
+public:
+	explicit ContentHasher(uint64_t seed = 0);
+
+	void Update(const void* data, size_t size);
+	ContentHash Finish() const;
+
+private:
+	uint64_t		lanes[4];
+	unsigned char	buffer[32];		// Partial stripe waiting for more data
+	unsigned int	buffered;
+	uint64_t		totalSize;
+	uint64_t		seed;
+};
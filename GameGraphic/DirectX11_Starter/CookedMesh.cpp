@@ -0,0 +1,70 @@
+#include "CookedMesh.h"
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+
+static_assert(sizeof(CookedVertex) == 44, "Cooked vertices must match Vertex");
+static_assert(sizeof(CookedMeshHeader) % 4 == 0, "Vertices follow the header");
+
+bool CookedMesh::Save(const char* path, const CookedVertex* vertices, uint32_t vertexCount,
+	const uint32_t* indices, uint32_t indexCount)
+{
+	CookedMeshHeader header;
+	memset(&header, 0, sizeof(header));
+	header.magic = Magic;
+	header.version = Version;
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.vertexStride = sizeof(CookedVertex);
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		header.boundsMin[axis] = vertexCount > 0 ? FLT_MAX : 0.0f;
+		header.boundsMax[axis] = vertexCount > 0 ? -FLT_MAX : 0.0f;
+	}
+	for (uint32_t i = 0; i < vertexCount; i++)
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float value = vertices[i].position[axis];
+			if (value < header.boundsMin[axis]) header.boundsMin[axis] = value;
+			if (value > header.boundsMax[axis]) header.boundsMax[axis] = value;
+		}
+	}
+
+	FILE* file = 0;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path, "wb") != 0)
+		file = 0;
+#else
+	file = fopen(path, "wb");
+#endif
+	if (!file)
+		return false;
+
+	bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+		fwrite(vertices, sizeof(CookedVertex), vertexCount, file) == vertexCount &&
+		fwrite(indices, sizeof(uint32_t), indexCount, file) == indexCount;
+	return fclose(file) == 0 && written;
+}
+
+bool CookedMesh::Parse(const void* file, size_t size, CookedMeshHeader& header,
+	const CookedVertex*& vertices, const uint32_t*& indices)
+{
+	if (size < sizeof(CookedMeshHeader))
+		return false;
+
+	memcpy(&header, file, sizeof(header));
+	if (header.magic != Magic || header.version != Version || header.vertexStride != sizeof(CookedVertex))
+		return false;
+
+	size_t vertexBytes = (size_t)header.vertexCount * sizeof(CookedVertex);
+	size_t indexBytes = (size_t)header.indexCount * sizeof(uint32_t);
+	if (size - sizeof(header) < vertexBytes + indexBytes)
+		return false;
+
+	const unsigned char* data = (const unsigned char*)file + sizeof(header);
+	vertices = (const CookedVertex*)data;
+	indices = (const uint32_t*)(data + vertexBytes);
+	return true;
+}
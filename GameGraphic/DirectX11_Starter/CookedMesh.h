@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// --------------------------------------------------------
+// A vertex as stored in a cooked mesh.  Laid out exactly like
+// the game's Vertex, so the data can be copied straight into
+// a vertex buffer.
+// --------------------------------------------------------
+struct CookedVertex
+{
+	float position[3];
+	float normal[3];
+	float tangent[3];
+	float uv[2];
+};
+
+// --------------------------------------------------------
+// Start of a cooked mesh file.  The vertices follow it, then
+// 32-bit indices.
+// --------------------------------------------------------
+struct CookedMeshHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	vertexCount;
+	uint32_t	indexCount;
+	uint32_t	vertexStride;		// sizeof(CookedVertex) when written
+	uint32_t	reserved;
+	float		boundsMin[3];
+	float		boundsMax[3];
+};
+
+// --------------------------------------------------------
+// Reads and writes meshes the asset cooker has already
+// parsed and had tangents calculated for, so loading one is
+// a single read with no text parsing.
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+class CookedMesh
+{
+public:
+	static const uint32_t Magic = 0x48534D43;		// "CMSH"
+	static const uint32_t Version = 1;
+
+	static bool Save(const char* path, const CookedVertex* vertices, uint32_t vertexCount,
+		const uint32_t* indices, uint32_t indexCount);
+
+	// Checks a file in memory and points into it.  Fails for
+	// other versions or truncated files.
+	static bool Parse(const void* file, size_t size, CookedMeshHeader& header,
+		const CookedVertex*& vertices, const uint32_t*& indices);
+
+private:
+	CookedMesh();
+};
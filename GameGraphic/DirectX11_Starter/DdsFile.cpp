@@ -0,0 +1,334 @@
+#include "DdsFile.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const uint32_t Magic = 0x20534444;			// "DDS "
+	const uint32_t FourCCDX10 = 0x30315844;		// "DX10"
+	const uint32_t FourCCDXT1 = 0x31545844;
+	const uint32_t FourCCDXT2 = 0x32545844;
+	const uint32_t FourCCDXT3 = 0x33545844;
+	const uint32_t FourCCDXT4 = 0x34545844;
+	const uint32_t FourCCDXT5 = 0x35545844;
+	const uint32_t FourCCATI2 = 0x32495441;
+	const uint32_t FourCCBC5U = 0x55354342;
+
+	// Header flags
+	const uint32_t FlagCaps = 0x1;
+	const uint32_t FlagHeight = 0x2;
+	const uint32_t FlagWidth = 0x4;
+	const uint32_t FlagPitch = 0x8;
+	const uint32_t FlagPixelFormat = 0x1000;
+	const uint32_t FlagMipCount = 0x20000;
+	const uint32_t FlagLinearSize = 0x80000;
+	const uint32_t FlagDepth = 0x800000;
+
+	const uint32_t PixelFormatFourCC = 0x4;
+	const uint32_t PixelFormatRGB = 0x40;
+
+	const uint32_t CapsComplex = 0x8;
+	const uint32_t CapsTexture = 0x1000;
+	const uint32_t CapsMipMap = 0x400000;
+
+	const uint32_t Caps2CubeMap = 0x200;
+	const uint32_t Caps2AllFaces = 0xFC00;
+
+	const uint32_t DimensionTexture2D = 3;
+	const uint32_t MiscTextureCube = 0x4;
+
+	// Direct3D 11 limits, which also keep sizes from overflowing
+	const uint32_t MaxDimension = 16384;
+	const uint32_t MaxArraySize = 2048;
+
+	// Both headers as 32-bit words, in file order
+	struct Header
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipCount;
+		uint32_t reserved1[11];
+
+		// Pixel format
+		uint32_t formatSize;
+		uint32_t formatFlags;
+		uint32_t fourCC;
+		uint32_t bitCount;
+		uint32_t masks[4];
+
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+
+		// DX10 extension
+		uint32_t dxgiFormat;
+		uint32_t dimension;
+		uint32_t miscFlags;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+	static_assert(sizeof(Header) == 124 + 20, "DDS header layout");
+
+	bool IsKnownFormat(uint32_t format)
+	{
+		switch (format)
+		{
+		case DdsFormat_RGBA8:	case DdsFormat_RGBA8_SRGB:
+		case DdsFormat_BGRA8:	case DdsFormat_BGRX8:
+		case DdsFormat_BC1:		case DdsFormat_BC1_SRGB:
+		case DdsFormat_BC2:		case DdsFormat_BC2_SRGB:
+		case DdsFormat_BC3:		case DdsFormat_BC3_SRGB:
+		case DdsFormat_BC5:
+		case DdsFormat_BC7:		case DdsFormat_BC7_SRGB:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// The format of a header without the DX10 extension, from
+	// its FourCC code or its 32-bit channel masks
+	DdsFormat GetLegacyFormat(const Header& header)
+	{
+		if (header.formatFlags & PixelFormatFourCC)
+		{
+			switch (header.fourCC)
+			{
+			case FourCCDXT1:	return DdsFormat_BC1;
+			case FourCCDXT2:
+			case FourCCDXT3:	return DdsFormat_BC2;
+			case FourCCDXT4:
+			case FourCCDXT5:	return DdsFormat_BC3;
+			case FourCCATI2:
+			case FourCCBC5U:	return DdsFormat_BC5;
+			default:			return DdsFormat_Unknown;
+			}
+		}
+
+		if (!(header.formatFlags & PixelFormatRGB) || header.bitCount != 32)
+			return DdsFormat_Unknown;
+
+		const uint32_t* masks = header.masks;
+		if (masks[0] == 0x000000ff && masks[1] == 0x0000ff00 && masks[2] == 0x00ff0000 && masks[3] == 0xff000000)
+			return DdsFormat_RGBA8;
+		if (masks[0] == 0x00ff0000 && masks[1] == 0x0000ff00 && masks[2] == 0x000000ff)
+			return masks[3] == 0xff000000 ? DdsFormat_BGRA8 : masks[3] == 0 ? DdsFormat_BGRX8 : DdsFormat_Unknown;
+		return DdsFormat_Unknown;
+	}
+}
+
+bool DdsFile::IsBlockCompressed(DdsFormat format)
+{
+	switch (format)
+	{
+	case DdsFormat_BC1:		case DdsFormat_BC1_SRGB:
+	case DdsFormat_BC2:		case DdsFormat_BC2_SRGB:
+	case DdsFormat_BC3:		case DdsFormat_BC3_SRGB:
+	case DdsFormat_BC5:
+	case DdsFormat_BC7:		case DdsFormat_BC7_SRGB:
+		return true;
+	default:
+		return false;
+	}
+}
+
+size_t DdsFile::GetRowPitch(DdsFormat format, uint32_t width)
+{
+	switch (format)
+	{
+	case DdsFormat_RGBA8:
+	case DdsFormat_RGBA8_SRGB:
+	case DdsFormat_BGRA8:
+	case DdsFormat_BGRX8:
+		return (size_t)width * 4;
+
+	// 8 bytes per 4x4 block
+	case DdsFormat_BC1:
+	case DdsFormat_BC1_SRGB:
+		return (size_t)((width + 3) / 4) * 8;
+
+	// 16 bytes per 4x4 block
+	case DdsFormat_BC2:
+	case DdsFormat_BC2_SRGB:
+	case DdsFormat_BC3:
+	case DdsFormat_BC3_SRGB:
+	case DdsFormat_BC5:
+	case DdsFormat_BC7:
+	case DdsFormat_BC7_SRGB:
+		return (size_t)((width + 3) / 4) * 16;
+
+	default:
+		return 0;
+	}
+}
+
+size_t DdsFile::GetSurfaceSize(DdsFormat format, uint32_t width, uint32_t height)
+{
+	size_t rows = IsBlockCompressed(format) ? (height + 3) / 4 : height;
+	return GetRowPitch(format, width) * rows;
+}
+
+size_t DdsFile::GetImageSize(const DdsImageDesc& desc)
+{
+	size_t size = 0;
+	uint32_t width = desc.width;
+	uint32_t height = desc.height;
+	for (uint32_t mip = 0; mip < desc.mipCount; mip++)
+	{
+		size += GetSurfaceSize(desc.format, width, height);
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return size;
+}
+
+uint32_t DdsFile::GetFullMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		count++;
+	}
+	return count;
+}
+
+void DdsFile::WriteHeader(const DdsImageDesc& desc, std::vector<unsigned char>& out)
+{
+	Header header;
+	memset(&header, 0, sizeof(header));
+	header.size = 124;
+	header.flags = FlagCaps | FlagHeight | FlagWidth | FlagPixelFormat | FlagMipCount;
+	header.height = desc.height;
+	header.width = desc.width;
+	header.mipCount = desc.mipCount;
+	if (IsBlockCompressed(desc.format))
+	{
+		header.flags |= FlagLinearSize;
+		header.pitchOrLinearSize = (uint32_t)GetSurfaceSize(desc.format, desc.width, desc.height);
+	}
+	else
+	{
+		header.flags |= FlagPitch;
+		header.pitchOrLinearSize = (uint32_t)GetRowPitch(desc.format, desc.width);
+	}
+
+	header.formatSize = 32;
+	header.formatFlags = PixelFormatFourCC;
+	header.fourCC = FourCCDX10;
+
+	header.caps = CapsTexture;
+	if (desc.mipCount > 1)
+		header.caps |= CapsComplex | CapsMipMap;
+
+	header.dxgiFormat = desc.format;
+	header.dimension = DimensionTexture2D;
+	header.arraySize = 1;
+
+	size_t start = out.size();
+	out.resize(start + HeaderSize);
+	memcpy(&out[start], &Magic, sizeof(Magic));
+	memcpy(&out[start + sizeof(Magic)], &header, sizeof(header));
+}
+
+bool DdsFile::Save(const char* path, const DdsImageDesc& desc, const void* data)
+{
+	std::vector<unsigned char> header;
+	WriteHeader(desc, header);
+
+	FILE* file = 0;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path, "wb") != 0)
+		file = 0;
+#else
+	file = fopen(path, "wb");
+#endif
+	if (!file)
+		return false;
+
+	size_t size = GetImageSize(desc);
+	bool written = fwrite(header.data(), 1, header.size(), file) == header.size() &&
+		fwrite(data, 1, size, file) == size;
+	return fclose(file) == 0 && written;
+}
+
+bool DdsFile::ParseTextureInfo(const void* file, size_t size, DdsTextureInfo& info)
+{
+	if (size < LegacyHeaderSize)
+		return false;
+
+	// Only the DX10 fields can be missing from a short file
+	uint32_t magic;
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(&magic, file, sizeof(magic));
+	memcpy(&header, (const unsigned char*)file + sizeof(magic), size < HeaderSize ? size - sizeof(magic) : sizeof(header));
+	if (magic != Magic || header.size != 124 || (header.flags & FlagDepth))
+		return false;
+
+	DdsImageDesc& image = info.image;
+	image.width = header.width;
+	image.height = header.height;
+	image.mipCount = header.mipCount > 0 ? header.mipCount : 1;
+	info.arraySize = 1;
+	info.isCubeMap = false;
+
+	if ((header.formatFlags & PixelFormatFourCC) && header.fourCC == FourCCDX10)
+	{
+		if (size < HeaderSize || header.dimension != DimensionTexture2D || !IsKnownFormat(header.dxgiFormat))
+			return false;
+		image.format = (DdsFormat)header.dxgiFormat;
+		info.arraySize = header.arraySize;
+		info.isCubeMap = (header.miscFlags & MiscTextureCube) != 0;
+		info.dataOffset = HeaderSize;
+	}
+	else
+	{
+		image.format = GetLegacyFormat(header);
+		if (header.caps2 & Caps2CubeMap)
+		{
+			// Files may leave faces out, but textures can't
+			if ((header.caps2 & Caps2AllFaces) != Caps2AllFaces)
+				return false;
+			info.isCubeMap = true;
+		}
+		info.dataOffset = LegacyHeaderSize;
+	}
+
+	if (image.format == DdsFormat_Unknown || image.width == 0 || image.height == 0 ||
+		image.width > MaxDimension || image.height > MaxDimension ||
+		image.mipCount > GetFullMipCount(image.width, image.height) ||
+		info.arraySize == 0 || info.arraySize > MaxArraySize)
+		return false;
+
+	if (info.isCubeMap)
+		info.arraySize *= 6;
+
+	info.dataSize = GetImageSize(image) * info.arraySize;
+	return size - info.dataOffset >= info.dataSize;
+}
+
+DdsSurface DdsFile::GetSurface(const DdsTextureInfo& info, uint32_t slice, uint32_t mip)
+{
+	const DdsImageDesc& image = info.image;
+	DdsSurface surface;
+	surface.offset = info.dataOffset + GetImageSize(image) * slice;
+	surface.width = image.width;
+	surface.height = image.height;
+	for (uint32_t i = 0; i < mip; i++)
+	{
+		surface.offset += GetSurfaceSize(image.format, surface.width, surface.height);
+		surface.width = surface.width > 1 ? surface.width / 2 : 1;
+		surface.height = surface.height > 1 ? surface.height / 2 : 1;
+	}
+	surface.rowPitch = GetRowPitch(image.format, surface.width);
+	surface.size = GetSurfaceSize(image.format, surface.width, surface.height);
+	return surface;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// Pixel formats a DDS file can hold.  The values are the
+// matching DXGI_FORMAT ones, so they can be cast straight
+// across where d3d11.h is available.
+// --------------------------------------------------------
+enum DdsFormat
+{
+	DdsFormat_Unknown		= 0,
+	DdsFormat_RGBA8			= 28,	// DXGI_FORMAT_R8G8B8A8_UNORM
+	DdsFormat_RGBA8_SRGB	= 29,
+	DdsFormat_BC1			= 71,
+	DdsFormat_BC1_SRGB		= 72,
+	DdsFormat_BC2			= 74,
+	DdsFormat_BC2_SRGB		= 75,
+	DdsFormat_BC3			= 77,
+	DdsFormat_BC3_SRGB		= 78,
+	DdsFormat_BC5			= 83,
+	DdsFormat_BGRA8			= 87,
+	DdsFormat_BGRX8			= 88,
+	DdsFormat_BC7			= 98,
+	DdsFormat_BC7_SRGB		= 99
+};
+
+// --------------------------------------------------------
+// A 2D texture with its mip chain.  The surfaces are stored
+// one after another, largest first, with tightly packed rows.
+// --------------------------------------------------------
+struct DdsImageDesc
+{
+	uint32_t	width;
+	uint32_t	height;
+	uint32_t	mipCount;
+	DdsFormat	format;
+};
+
+// --------------------------------------------------------
+// Everything the headers say about a 2D texture or cube map,
+// without its surfaces.  Surfaces follow the headers slice
+// by slice, each slice being a whole mip chain; a cube map
+// has six slices per cube, in +X -X +Y -Y +Z -Z order.
+// --------------------------------------------------------
+struct DdsTextureInfo
+{
+	DdsImageDesc	image;			// Size of the top level, mips and format
+	uint32_t		arraySize;		// Slices, already multiplied by 6 for cube maps
+	bool			isCubeMap;
+	size_t			dataOffset;		// Where the first surface starts
+	size_t			dataSize;		// Bytes of surfaces after the headers
+};
+
+// Where one surface is in the file
+struct DdsSurface
+{
+	uint32_t	width;
+	uint32_t	height;
+	size_t		offset;				// From the start of the file
+	size_t		rowPitch;			// Bytes per row (of blocks, if compressed)
+	size_t		size;
+};
+
+// --------------------------------------------------------
+// Writes DDS headers (with the DX10 extension) so tools can
+// produce textures the runtime's DDSTextureLoader takes as
+// they are, and reads them, older headers included.  The
+// game reads headers here (see TextureStreamer), as the
+// prebuilt DirectXTK library only has entry points that
+// create whole textures.
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+class DdsFile
+{
+public:
+	// Bytes in a header with the DX10 extension, magic included
+	static const size_t HeaderSize = 4 + 124 + 20;
+
+	// And without it, as older tools write them
+	static const size_t LegacyHeaderSize = 4 + 124;
+
+	static bool IsBlockCompressed(DdsFormat format);
+
+	// Bytes in one row (of 4x4 blocks, for compressed formats)
+	static size_t GetRowPitch(DdsFormat format, uint32_t width);
+
+	// Bytes in one surface, and in a whole mip chain
+	static size_t GetSurfaceSize(DdsFormat format, uint32_t width, uint32_t height);
+	static size_t GetImageSize(const DdsImageDesc& desc);
+
+	// Number of levels in a full chain down to 1x1
+	static uint32_t GetFullMipCount(uint32_t width, uint32_t height);
+
+	// Appends the magic number and headers to out
+	static void WriteHeader(const DdsImageDesc& desc, std::vector<unsigned char>& out);
+
+	// Writes a header followed by GetImageSize(desc) bytes of data
+	static bool Save(const char* path, const DdsImageDesc& desc, const void* data);
+
+	// Reads the headers of a file in memory, with or without
+	// the DX10 extension, and checks that the surfaces they
+	// describe are all there.  Reads 2D textures, arrays and
+	// cube maps in the formats above; not volumes or 1D ones.
+	static bool ParseTextureInfo(const void* file, size_t size, DdsTextureInfo& info);
+
+	// The layout of one level of one slice of a parsed file
+	static DdsSurface GetSurface(const DdsTextureInfo& info, uint32_t slice, uint32_t mip);
+
+private:
+	DdsFile();
+};
@@ -10,8 +10,43 @@
 // -------------------------------------------------------------
 
 #include "DirectXGameCore.h"
+#include "FrameAllocator.h"
+#include "FramePacket.h"
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include "RenderStats.h"
 #include <WindowsX.h>
 #include <sstream>
+#include <cmath>
+
+#if defined(DEBUG) || defined(_DEBUG)
+#include <crtdbg.h>
+#include <atomic>
+
+namespace
+{
+	// Debug builds count every CRT heap allocation (from any
+	// thread), so the title bar shows whether frames allocate
+	std::atomic<unsigned int> heapAllocations(0);
+
+	int __cdecl CountHeapAllocation(int allocType, void* userData, size_t size, int blockType,
+		long requestNumber, const unsigned char* fileName, int lineNumber)
+	{
+		if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC)
+			heapAllocations.fetch_add(1, std::memory_order_relaxed);
+		return TRUE;
+	}
+}
+#endif
+
+namespace
+{
+	// Memory budget warnings go to the debugger's output window
+	void DebugOutputWarning(const char* message)
+	{
+		OutputDebugStringA(message);
+	}
+}
 
 #pragma region Global Window Callback
 
@@ -62,8 +97,26 @@ DirectXGameCore::DirectXGameCore(HINSTANCE hInstance)
 	currentTime(0),
 	previousTime(0),
 	totalTime(0.0f),
-	deltaTime(0.0f)
+	deltaTime(0.0f),
+	frameTime(0.0f),
+	pipelinedRendering(false),
+	fixedTimestep(false),
+	fixedStepSeconds(1.0f / 60.0f),
+	maxStepsPerFrame(5),
+	simulationTime(0.0),
+	accumulator(0.0),
+	interpolationAlpha(1.0f),
+	frames(0),
+	frameIndex(0),
+	benchmarkFrames(0),
+	benchmarkPhaseStart(0),
+	benchmarkStartTime(0)
 {
+	// Only used in pipelined mode, but cheap to create
+	frames = new FramePacketBuffer();
+
+	MemoryTracker::SetWarningHandler(DebugOutputWarning);
+
 	// Zero out the viewport struct
 	ZeroMemory(&viewport, sizeof(D3D11_VIEWPORT));
 
@@ -82,6 +135,10 @@ DirectXGameCore::DirectXGameCore(HINSTANCE hInstance)
 // --------------------------------------------------------
 DirectXGameCore::~DirectXGameCore(void)
 {
+	// Normally already done by the derived class
+	ShutdownJobs();
+	delete frames;
+
 	// Release the core DirectX "stuff" we set up
 	ReleaseMacro(renderTargetView);
 	ReleaseMacro(depthStencilView);
@@ -96,6 +153,11 @@ DirectXGameCore::~DirectXGameCore(void)
 	ReleaseMacro(deviceContext);
 	ReleaseMacro(device);
 }
+
+void DirectXGameCore::ShutdownJobs()
+{
+	jobSystem.Shutdown();
+}
 #pragma endregion
 
 #pragma region Initialization
@@ -105,8 +167,13 @@ DirectXGameCore::~DirectXGameCore(void)
 // --------------------------------------------------------
 bool DirectXGameCore::Init()
 {
-	// Create the actual window itself (no DirectX yet)
-	if(!InitMainWindow())
+	// Start the worker threads first so the rest of
+	// initialization can already use them
+	jobSystem.Init();
+
+	// Create the actual window itself (no DirectX yet),
+	// unless this is a headless benchmark
+	if(!benchmark.headless && !InitMainWindow())
 		return false;
 
 	// Now that the window is ready, initialize
@@ -196,6 +263,33 @@ bool DirectXGameCore::InitDirect3D()
 	createDeviceFlags |= D3D11_CREATE_DEVICE_DEBUG;
 #endif
 
+	// Headless runs and the null driver have nothing to present
+	// to, so they only get a device and draw into a texture
+	// (see OnResize)
+	if (!hMainWnd || driverType == D3D_DRIVER_TYPE_NULL)
+	{
+		HRESULT hr = D3D11CreateDevice(
+			0,
+			driverType,
+			0,
+			createDeviceFlags,
+			0,
+			0,
+			D3D11_SDK_VERSION,
+			&device,
+			&featureLevel,
+			&deviceContext);
+
+		if( FAILED(hr) )
+		{
+			OutputDebugStringA("D3D11CreateDevice Failed\n");
+			return false;
+		}
+
+		OnResize();
+		return true;
+	}
+
 	// Set up a swap chain description - 
 	// The swap chain is used for double buffering (a.k.a. page flipping)
 	DXGI_SWAP_CHAIN_DESC swapChainDesc;
@@ -260,17 +354,37 @@ void DirectXGameCore::OnResize()
 	ReleaseMacro(depthStencilView);
 	ReleaseMacro(depthStencilBuffer);
 
-	// Resize the swap chain to match the new window dimensions
-	HR(swapChain->ResizeBuffers(
-		1, 
-		windowWidth, 
-		windowHeight, 
-		DXGI_FORMAT_R8G8B8A8_UNORM,
-		0));
-
-	// Recreate the render target view that points to the swap chain's buffer
 	ID3D11Texture2D* backBuffer;
-	HR(swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backBuffer)));
+	if (swapChain)
+	{
+		// Resize the swap chain to match the new window dimensions
+		HR(swapChain->ResizeBuffers(
+			1, 
+			windowWidth, 
+			windowHeight, 
+			DXGI_FORMAT_R8G8B8A8_UNORM,
+			0));
+
+		// Recreate the render target view that points to the swap chain's buffer
+		HR(swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backBuffer)));
+	}
+	else
+	{
+		// No swap chain, so draw into a plain texture of the same size
+		D3D11_TEXTURE2D_DESC backBufferDesc;
+		backBufferDesc.Width				= windowWidth;
+		backBufferDesc.Height				= windowHeight;
+		backBufferDesc.MipLevels			= 1;
+		backBufferDesc.ArraySize			= 1;
+		backBufferDesc.Format				= DXGI_FORMAT_R8G8B8A8_UNORM;
+		backBufferDesc.Usage				= D3D11_USAGE_DEFAULT;
+		backBufferDesc.BindFlags			= D3D11_BIND_RENDER_TARGET;
+		backBufferDesc.CPUAccessFlags		= 0;
+		backBufferDesc.MiscFlags			= 0;
+		backBufferDesc.SampleDesc.Count		= 1;
+		backBufferDesc.SampleDesc.Quality	= 0;
+		HR(device->CreateTexture2D(&backBufferDesc, 0, &backBuffer));
+	}
 	HR(device->CreateRenderTargetView(backBuffer, 0, &renderTargetView));
 	ReleaseMacro(backBuffer);
 
@@ -325,8 +439,30 @@ int DirectXGameCore::Run()
 	currentTime  = now;
 	previousTime = now;
 
+	// Nothing to interpolate from yet
+	simulationTime = 0.0;
+	accumulator = 0.0;
+	SaveSimulationState();
+	frameLimiter.Reset();
+	Profiler::SetThreadName("Main");
+
+	if (benchmark.enabled)
+		BeginBenchmark();
+
+#if defined(DEBUG) || defined(_DEBUG)
+	_CRT_ALLOC_HOOK previousAllocHook = _CrtSetAllocHook(CountHeapAllocation);
+#endif
+
+	// Start drawing on a separate thread if requested
+	if (pipelinedRendering)
+	{
+		frames->Reopen();
+		renderThread = std::thread(&DirectXGameCore::RenderLoop, this);
+	}
+
 	// Create a variable to hold the current message
 	MSG msg = {0};
+	bool firstFrame = true;
 
 	// Loop until we get a quit message from windows
 	while(msg.message != WM_QUIT)
@@ -341,21 +477,154 @@ int DirectXGameCore::Run()
 		else // No message to handle
 		{
 			// Update the timer for this frame
+			Profiler::BeginFrame();
+			FrameAllocator::ResetThread();
 			UpdateTimer();
 
+			// frameTime is how long the previous frame took
+			if (!firstFrame && frameStats.AddFrame(frameTime * 1000.0))
+				ReportHitch();
+			firstFrame = false;
+
+			// Stop here once a benchmark has all its frames
+			if (benchmark.enabled && !UpdateBenchmark())
+				continue;
+
+			// Run any work the job system handed back to this thread
+			jobSystem.PumpMainThreadJobs();
+
 			// Standard game loop type stuff
 			CalculateFrameStats();
-			UpdateScene(deltaTime, totalTime);
-			DrawScene(deltaTime, totalTime);			
+			Simulate();
+
+			if (pipelinedRendering)
+			{
+				// Capture this frame and hand it to the render thread,
+				// which may still be drawing the previous one
+				FramePacket* frame = frames->BeginWrite();
+				frame->Clear();
+				frame->frameIndex = frameIndex++;
+				frame->deltaTime = deltaTime;
+				frame->totalTime = totalTime;
+				{
+					PROFILE_SCOPE("BuildFrame");
+					BuildFrame(*frame);
+				}
+				frames->Publish();
+			}
+			else
+			{
+				PROFILE_SCOPE("DrawScene");
+				DrawScene(deltaTime, totalTime);
+				RenderStats::EndFrame();
+			}
+
+			// Sleep off whatever is left of this frame
+			PROFILE_SCOPE("FrameLimiter::Wait");
+			frameLimiter.WaitForNextFrame();
 		}
 	}
 
+	// Let the render thread finish the last frame and stop
+	if (renderThread.joinable())
+	{
+		frames->WaitForIdle();
+		frames->Close();
+		renderThread.join();
+	}
+
+#if defined(DEBUG) || defined(_DEBUG)
+	_CrtSetAllocHook(previousAllocHook);
+#endif
+
+	// Save the frame time reports
+	if (!frameStatsFile.empty())
+	{
+		frameStats.ExportCsv((frameStatsFile + ".csv").c_str());
+		frameStats.ExportJson((frameStatsFile + ".json").c_str());
+	}
+
 	// If we make it outside the game loop, return the most
 	// recent message's exit code
 	return (int)msg.wParam;
 }
 
 
+// --------------------------------------------------------
+// Advances the simulation.  With a fixed timestep the frame's
+// time is banked in an accumulator and spent in whole steps,
+// and the leftover fraction becomes the interpolation alpha.
+// --------------------------------------------------------
+void DirectXGameCore::Simulate()
+{
+	if (!fixedTimestep || fixedStepSeconds <= 0.0f)
+	{
+		PROFILE_SCOPE("UpdateScene");
+		UpdateScene(deltaTime, totalTime);
+		interpolationAlpha = 1.0f;
+		return;
+	}
+
+	accumulator += deltaTime;
+
+	int steps = 0;
+	while (accumulator >= fixedStepSeconds && steps < maxStepsPerFrame)
+	{
+		PROFILE_SCOPE("UpdateScene");
+		SaveSimulationState();
+		simulationTime += fixedStepSeconds;
+		UpdateScene(fixedStepSeconds, (float)simulationTime);
+		accumulator -= fixedStepSeconds;
+		steps++;
+	}
+
+	// Couldn't keep up - drop the backlog rather than trying
+	// to catch up next frame (the "spiral of death")
+	if (accumulator >= fixedStepSeconds)
+		accumulator = fmod(accumulator, (double)fixedStepSeconds);
+
+	interpolationAlpha = (float)(accumulator / fixedStepSeconds);
+}
+
+// --------------------------------------------------------
+// Render thread body for pipelined mode - draws each frame
+// packet as soon as the update thread publishes it
+// --------------------------------------------------------
+void DirectXGameCore::RenderLoop()
+{
+	Profiler::SetThreadName("Render");
+
+	// Drawing queues jobs every frame, which would otherwise
+	// each be a heap allocation from this thread
+	jobSystem.AttachThread();
+
+	while (const FramePacket* frame = frames->AcquireRead())
+	{
+		FrameAllocator::ResetThread();
+		{
+			PROFILE_SCOPE("DrawFrame");
+			DrawFrame(*frame);
+			RenderStats::EndFrame();
+		}
+		frames->ReleaseRead();
+	}
+
+	jobSystem.DetachThread();
+}
+
+// --------------------------------------------------------
+// The message handler runs on the update thread, so in
+// pipelined mode the render thread has to be idle before
+// the swap chain buffers can be touched
+// --------------------------------------------------------
+void DirectXGameCore::HandleResize()
+{
+	if (renderThread.joinable())
+		frames->WaitForIdle();
+
+	OnResize();
+}
+
 // --------------------------------------------------------
 // Updates the timer stats for this frame
 // --------------------------------------------------------
@@ -373,10 +642,19 @@ void DirectXGameCore::UpdateTimer()
 	deltaTime = (float)((currentTime - previousTime) * perfCounterSeconds);
 	if (deltaTime < 0.0f)
 		deltaTime = 0.0f;
+	frameTime = deltaTime;
 
 	// Calculate total time
 	totalTime = (float)((currentTime - startTime) * perfCounterSeconds);
 
+	// Benchmarks simulate exactly one step per frame, so every
+	// run sees the same frames however fast the machine is
+	if (benchmark.enabled)
+	{
+		deltaTime = fixedStepSeconds;
+		totalTime = (float)(benchmarkFrames * (double)fixedStepSeconds);
+	}
+
 	// Save the previous time
 	previousTime = currentTime;
 }
@@ -407,6 +685,37 @@ void DirectXGameCore::CalculateFrameStats()
 			<< L"FPS: " << fps << L"    " 
 			<< L"Frame Time: " << mspf << L"ms";
 
+		// Averages hide stutter, so show the tail too
+		FrameTimeSummary recent = frameStats.GetRollingSummary();
+		outs << L"    p50: " << recent.p50Ms << L"ms"
+			<< L"    p99: " << recent.p99Ms << L"ms"
+			<< L"    Hitches: " << frameStats.GetHitches().size();
+
+		// What the last frame submitted
+		RenderCounters counters = RenderStats::GetLastFrame();
+		outs << L"    Draws: " << counters.values[RenderCounter_DrawCalls]
+			<< L"    Tris: " << counters.values[RenderCounter_Triangles]
+			<< L"    CB: " << counters.values[RenderCounter_ConstantBufferBytes] / 1024 << L"KB"
+			<< L"    Binds: " << counters.values[RenderCounter_ShaderBinds] + counters.values[RenderCounter_ShaderResourceBinds] + counters.values[RenderCounter_SamplerBinds] + counters.values[RenderCounter_GeometryBinds]
+			<< L"    States: " << counters.values[RenderCounter_StateChanges];
+
+		// Pacing accuracy over the same second, if limited
+		if (frameLimiter.GetTargetFrameTime() > 0.0)
+		{
+			FramePacingStats pacing = frameLimiter.GetStats();
+			outs << L"    Jitter: " << pacing.averageJitter * 1000.0 << L"ms";
+			frameLimiter.ResetStats();
+		}
+
+#if defined(DEBUG) || defined(_DEBUG)
+		// Steady frames shouldn't touch the heap (this string
+		// accounts for a few allocations per second)
+		static unsigned int lastAllocations = 0;
+		unsigned int allocations = heapAllocations.load(std::memory_order_relaxed);
+		outs << L"    Allocs/frame: " << (float)(allocations - lastAllocations) / frameCount;
+		lastAllocations = allocations;
+#endif
+
 		// Include feature level
 		switch(featureLevel)
 		{
@@ -420,7 +729,8 @@ void DirectXGameCore::CalculateFrameStats()
 		default:                     outs << "    DX ???";  break;
 		}
 
-		SetWindowText(hMainWnd, outs.str().c_str());
+		if (hMainWnd)
+			SetWindowText(hMainWnd, outs.str().c_str());
 
 		// Reset frame count, and adjust time elapsed
 		// to wait another second
@@ -429,6 +739,31 @@ void DirectXGameCore::CalculateFrameStats()
 	}
 }
 
+// --------------------------------------------------------
+// Attaches the previous frame's profiler scopes to the hitch
+// just recorded, and echoes it to the debug output
+// --------------------------------------------------------
+void DirectXGameCore::ReportHitch()
+{
+	const FrameHitch& hitch = frameStats.GetHitches().back();
+
+	std::vector<ProfileSummaryEntry> scopes;
+	Profiler::GetSummary(1, scopes);
+
+	std::ostringstream details;
+	details.precision(3);
+	details << std::fixed;
+	for (unsigned int i = 0; i < scopes.size(); i++)
+		details << (i > 0 ? "; " : "") << scopes[i].name << " " << scopes[i].totalMs << "ms";
+	frameStats.SetLastHitchDetails(details.str());
+
+	std::ostringstream outs;
+	outs.precision(3);
+	outs << std::fixed << "Hitch: frame " << hitch.frameIndex << " took " << hitch.frameMs
+		<< "ms (median " << hitch.medianMs << "ms)\n  " << details.str() << "\n";
+	OutputDebugStringA(outs.str().c_str());
+}
+
 // --------------------------------------------------------
 // Sends an OS-level Quit message to our process, which
 // will be handled by our message processing function
@@ -440,6 +775,102 @@ void DirectXGameCore::Quit()
 
 #pragma endregion
 
+#pragma region Benchmark
+
+void DirectXGameCore::SetBenchmark(const BenchmarkSettings& settings)
+{
+	benchmark = settings;
+	if (!benchmark.enabled)
+		return;
+
+	switch (benchmark.driver)
+	{
+	case BenchmarkSettings::Driver_Warp: driverType = D3D_DRIVER_TYPE_WARP; break;
+	case BenchmarkSettings::Driver_Null: driverType = D3D_DRIVER_TYPE_NULL; break;
+	default:                             driverType = D3D_DRIVER_TYPE_HARDWARE; break;
+	}
+}
+
+// --------------------------------------------------------
+// Overrides whatever pacing the derived class asked for, so
+// the run is deterministic and as fast as the machine allows
+// --------------------------------------------------------
+void DirectXGameCore::BeginBenchmark()
+{
+	fixedTimestep = true;
+	if (fixedStepSeconds <= 0.0f)
+		fixedStepSeconds = 1.0f / 60.0f;
+	frameLimiter.SetTargetFrameTime(0.0);
+	Profiler::SetEnabled(true);
+
+	benchmarkFrames = 0;
+	benchmarkPhaseStart = 0;
+	benchmarkReport.Reset();
+}
+
+// --------------------------------------------------------
+// Called at the top of each frame, just after the profiler
+// has started it, so everything before it is complete.
+// Warm-up frames are dropped; after that the profiler's
+// scopes are collected in batches it can still remember.
+// --------------------------------------------------------
+bool DirectXGameCore::UpdateBenchmark()
+{
+	unsigned int finished = benchmarkFrames;
+	unsigned int endFrame = benchmark.warmupFrames + benchmark.frameCount;
+
+	// Already reported, just waiting for the quit message
+	if (finished > endFrame)
+		return false;
+
+	if (finished == benchmark.warmupFrames)
+	{
+		frameStats.Reset();
+		benchmarkReport.Reset();
+		benchmarkPhaseStart = finished;
+		QueryPerformanceCounter((LARGE_INTEGER*)&benchmarkStartTime);
+	}
+	else if (finished > benchmark.warmupFrames)
+	{
+		benchmarkReport.AddRenderCounters(RenderStats::GetLastFrame());
+
+		unsigned int batch = finished - benchmarkPhaseStart;
+		if (batch >= Profiler::FrameHistory / 2 || finished == endFrame)
+		{
+			std::vector<ProfileSummaryEntry> phases;
+			Profiler::GetSummary(batch, phases);
+			benchmarkReport.AddPhases(phases, batch);
+			benchmarkPhaseStart = finished;
+		}
+	}
+
+	if (finished < endFrame)
+	{
+		benchmarkFrames++;
+		return true;
+	}
+
+	// All done - write the report and quit, with a non-zero
+	// exit code if the report couldn't be saved
+	__int64 now;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	double wallSeconds = (now - benchmarkStartTime) * perfCounterSeconds;
+
+	bool written = benchmarkReport.Write(
+		benchmark.reportFile.c_str(),
+		benchmark,
+		fixedStepSeconds,
+		wallSeconds,
+		frameStats.GetSessionSummary(),
+		(unsigned int)frameStats.GetHitches().size());
+
+	benchmarkFrames++;
+	PostQuitMessage(written ? 0 : 1);
+	return false;
+}
+
+#pragma endregion
+
 #pragma region Windows Message Processing
 
 // --------------------------------------------------------
@@ -483,7 +914,7 @@ LRESULT DirectXGameCore::ProcessMessage(HWND hwnd, UINT msg, WPARAM wParam, LPAR
 				hasFocus = true;
 				minimized = false;
 				maximized = true;
-				OnResize();
+				HandleResize();
 			}
 			else if( wParam == SIZE_RESTORED )
 			{
@@ -492,7 +923,7 @@ LRESULT DirectXGameCore::ProcessMessage(HWND hwnd, UINT msg, WPARAM wParam, LPAR
 				{
 					hasFocus = true;
 					minimized = false;
-					OnResize();
+					HandleResize();
 				}
 
 				// Restoring from maximized state?
@@ -500,7 +931,7 @@ LRESULT DirectXGameCore::ProcessMessage(HWND hwnd, UINT msg, WPARAM wParam, LPAR
 				{
 					hasFocus = true;
 					maximized = false;
-					OnResize();
+					HandleResize();
 				}
 				else if( resizing )
 				{
@@ -515,7 +946,7 @@ LRESULT DirectXGameCore::ProcessMessage(HWND hwnd, UINT msg, WPARAM wParam, LPAR
 				}
 				else // API call such as SetWindowPos or mSwapChain->SetFullscreenState.
 				{
-					OnResize();
+					HandleResize();
 				}
 			}
 		}
@@ -530,7 +961,7 @@ LRESULT DirectXGameCore::ProcessMessage(HWND hwnd, UINT msg, WPARAM wParam, LPAR
 	// Here we reset everything based on the new window dimensions.
 	case WM_EXITSIZEMOVE:
 		resizing = false;
-		OnResize();
+		HandleResize();
 		return 0;
 
 	// WM_DESTROY is sent when the window is being destroyed.
@@ -6,7 +6,12 @@
 //  This version doesn't rely on D3DX or the Effect framework,
 //  as these libraries are deprecated.
 //
-//  You should not need to edit this class at all.
+//  Beyond the window and device, it owns the game loop:
+//  the job system, an optional render thread (pipelined
+//  mode), fixed timestep simulation, the frame limiter,
+//  frame time stats and benchmark runs.  Derived classes
+//  turn these on in their constructors; changes here affect
+//  every game built on it.
 // -------------------------------------------------------------
 
 #pragma once
@@ -16,6 +21,16 @@
 #include <d3d11.h>
 
 #include "dxerr.h"
+#include "JobSystem.h"
+#include "FrameLimiter.h"
+#include "FrameStats.h"
+#include "Benchmark.h"
+#include <thread>
+
+// Mesh.h includes this header, so the frame packet types
+// (which hold meshes) can only be forward declared here
+struct FramePacket;
+class FramePacketBuffer;
 
 // --------------------------------------------------------
 // Convenience macro for releasing COM objects.
@@ -61,6 +76,11 @@ public:
 	
 	// The game loop
 	int Run();
+
+	// Turns the run into a benchmark (see BenchmarkSettings).
+	// Call before Init(), since it picks the driver and whether
+	// to create a window.
+	void SetBenchmark(const BenchmarkSettings& settings);
  
 	// Methods called by the game loop - override these in
 	// derived classes to implement custom functionality
@@ -68,6 +88,19 @@ public:
 	virtual void OnResize(); 
 	virtual void UpdateScene(float deltaTime, float totalTime) = 0;
 	virtual void DrawScene(float deltaTime, float totalTime)   = 0;
+
+	// Pipelined mode replaces DrawScene() with these two.
+	// BuildFrame() runs on the update thread right after
+	// UpdateScene() and copies out everything needed to draw.
+	// DrawFrame() then draws that copy on the render thread
+	// while the next frame is being simulated.
+	virtual void BuildFrame(FramePacket& frame) { }
+	virtual void DrawFrame(const FramePacket& frame) { }
+
+	// Fixed timestep mode calls this before every simulation step
+	// so the derived class can keep the previous state around for
+	// interpolation (see GetInterpolationAlpha())
+	virtual void SaveSimulationState() { }
 	virtual LRESULT ProcessMessage(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
 	// Convenience methods for handling mouse input, since we
@@ -105,6 +138,51 @@ protected:
 	D3D_DRIVER_TYPE           driverType;
 	D3D_FEATURE_LEVEL         featureLevel;
 
+	// Shared worker threads for every engine subsystem
+	JobSystem jobSystem;
+
+	// Finishes every outstanding job and stops the workers.
+	// The base destructor only runs after the derived class's
+	// members are gone, so a derived class whose members jobs
+	// can reach should call this first in its destructor.
+	void ShutdownJobs();
+
+	// Derived class can set this in its constructor to simulate
+	// and draw on separate threads (see BuildFrame/DrawFrame).
+	// The immediate context then belongs to the render thread.
+	bool pipelinedRendering;
+
+	// Derived class can set these in its constructor to run
+	// UpdateScene() at a fixed rate instead of once per frame.
+	// At most maxStepsPerFrame steps run per frame; any time
+	// beyond that is dropped so a slow frame can't snowball.
+	bool  fixedTimestep;
+	float fixedStepSeconds;
+	int   maxStepsPerFrame;
+
+	// Holds the loop to a target frame time (off by default).
+	// Derived class can call frameLimiter.SetTargetFrameTime()
+	// to stop the game from using a whole core.
+	FrameLimiter frameLimiter;
+
+	// Frame time percentiles and hitches.  If frameStatsFile is
+	// set (without extension), .csv and .json reports are
+	// written there when the game loop exits.
+	FrameStats frameStats;
+	std::string frameStatsFile;
+
+	// How far the current frame is between the last two
+	// simulation steps, from 0 (previous) to 1 (latest).
+	// Always 1 without a fixed timestep.
+	float GetInterpolationAlpha() { return interpolationAlpha; }
+
+	// In a benchmark run the derived class should take its
+	// input from a script instead of the keyboard and mouse.
+	// Every frame then advances the simulation by exactly one
+	// fixed step, whatever the frame really took.
+	bool IsBenchmarking() { return benchmark.enabled; }
+	const BenchmarkSettings& GetBenchmarkSettings() { return benchmark; }
+
 	// The window's aspect ratio, used mostly for your projection matrix
 	float aspectRatio;
 
@@ -121,12 +199,46 @@ private:
 	__int64 previousTime;
 	float totalTime;
 	float deltaTime;
+	float frameTime;		// Measured, even when deltaTime is simulated
+
+	// Fixed timestep state
+	double simulationTime;
+	double accumulator;
+	float interpolationAlpha;
+
+	// Runs UpdateScene() once, or as many fixed steps as are due
+	void Simulate();
 
 	// Updates the timer for this frame
 	void UpdateTimer();
 
+	// Pipelined mode
+	std::thread renderThread;
+	FramePacketBuffer* frames;
+	unsigned int frameIndex;
+	void RenderLoop();
+
+	// Resizes the buffers, first letting the render thread
+	// finish with them if there is one
+	void HandleResize();
+
 	// Calculates stats about the current frame and
 	// updates the window's title bar
 	void CalculateFrameStats();
+
+	// Logs the profiler scopes of a frame that just hitched
+	void ReportHitch();
+
+	// Benchmark state
+	BenchmarkSettings benchmark;
+	BenchmarkReport benchmarkReport;
+	unsigned int benchmarkFrames;		// Loop iterations finished
+	unsigned int benchmarkPhaseStart;	// First frame not yet in the report
+	__int64 benchmarkStartTime;
+	void BeginBenchmark();
+
+	// Collects the frames finished so far.  Returns false once
+	// the run is complete and the report has been written.
+	bool UpdateBenchmark();
 };
 
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+using namespace DirectX;
+
+// Only pointers are kept, so frame packets (and the tests
+// for them) don't need D3D
+class Mesh;
+class Material;
+class SimpleVertexShader;
+class SimplePixelShader;
+
+// --------------------------------------------------------
+// Everything needed to record one draw, captured at the
+// time the draw is queued.  The shaders are copied out of
+// the material so recording doesn't have to look them up.
+// --------------------------------------------------------
+struct DrawCommand
+{
+	Mesh*				mesh;
+	Material*			material;		// Textures, sampler and render states
+	SimpleVertexShader*	vertexShader;
+	SimplePixelShader*	pixelShader;
+	XMFLOAT4X4			worldMatrix;	// Already transposed for HLSL
+};
@@ -0,0 +1,120 @@
+#include "FrameAllocator.h"
+#include <cstdlib>
+
+LinearAllocator::LinearAllocator(size_t blockSize)
+	: current(0),
+	offset(0),
+	blockSize(blockSize > 0 ? blockSize : DefaultBlockSize),
+	bytesUsed(0),
+	highWater(0)
+{
+}
+
+LinearAllocator::~LinearAllocator()
+{
+	Release();
+}
+
+void LinearAllocator::Release()
+{
+	for (unsigned int i = 0; i < blocks.size(); i++)
+		free(blocks[i].memory);
+	blocks.clear();
+	current = 0;
+	offset = 0;
+}
+
+// --------------------------------------------------------
+// Carves the request out of the current block, moving on to
+// the next one (or a new one) when it doesn't fit
+// --------------------------------------------------------
+void* LinearAllocator::Allocate(size_t size, size_t alignment)
+{
+	if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+		alignment = DefaultAlignment;
+
+	for (;;)
+	{
+		if (current < blocks.size())
+		{
+			Block& block = blocks[current];
+			size_t address = (size_t)(block.memory + offset);
+			size_t aligned = (address + alignment - 1) & ~(alignment - 1);
+			size_t end = aligned - (size_t)block.memory + size;
+			if (end <= block.size)
+			{
+				bytesUsed += end - offset;
+				if (bytesUsed > highWater)
+					highWater = bytesUsed;
+				offset = end;
+				return (void*)aligned;
+			}
+
+			// Doesn't fit - try the next block, if there is one
+			if (current + 1 < blocks.size())
+			{
+				current++;
+				offset = 0;
+				continue;
+			}
+		}
+
+		// Out of blocks.  Big requests get a block to themselves.
+		Block block;
+		block.size = size + alignment > blockSize ? size + alignment : blockSize;
+		block.memory = (char*)malloc(block.size);
+		if (!block.memory)
+			return 0;
+
+		blocks.push_back(block);
+		current = blocks.size() - 1;
+		offset = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Frees the frame's allocations, folding the blocks into
+// one if the frame outgrew the first
+// --------------------------------------------------------
+void LinearAllocator::Reset()
+{
+	if (blocks.size() > 1)
+	{
+		size_t total = GetCapacity();
+		Release();
+
+		Block block;
+		block.size = total;
+		block.memory = (char*)malloc(total);
+		if (block.memory)
+			blocks.push_back(block);
+	}
+
+	current = 0;
+	offset = 0;
+	bytesUsed = 0;
+}
+
+size_t LinearAllocator::GetCapacity() const
+{
+	size_t total = 0;
+	for (unsigned int i = 0; i < blocks.size(); i++)
+		total += blocks[i].size;
+	return total;
+}
+
+LinearAllocator& FrameAllocator::GetThreadAllocator()
+{
+	thread_local LinearAllocator allocator;
+	return allocator;
+}
+
+void* FrameAllocator::Allocate(size_t size, size_t alignment)
+{
+	return GetThreadAllocator().Allocate(size, alignment);
+}
+
+void FrameAllocator::ResetThread()
+{
+	GetThreadAllocator().Reset();
+}
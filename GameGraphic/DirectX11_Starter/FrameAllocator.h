@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+// --------------------------------------------------------
+// Bump allocator for data that lives for one frame.
+//
+// Allocating moves a pointer forward; nothing is freed on
+// its own.  Reset() makes all of the memory available again
+// at once.  If a frame needed more than one block, Reset()
+// replaces them with a single block big enough for all of
+// them, so after a few frames a steady workload never
+// touches the heap.
+//
+// Not thread safe - use one per thread (see FrameAllocator)
+// or per owner.
+// --------------------------------------------------------
+class LinearAllocator
+{
+public:
+	static const size_t DefaultBlockSize = 64 * 1024;
+	static const size_t DefaultAlignment = 16;
+
+	explicit LinearAllocator(size_t blockSize = DefaultBlockSize);
+	~LinearAllocator();
+
+	void* Allocate(size_t size, size_t alignment = DefaultAlignment);
+	void Reset();
+
+	// Bytes handed out since the last Reset(), the most ever
+	// handed out in one frame, and the memory held
+	size_t GetBytesUsed() const { return bytesUsed; }
+	size_t GetHighWater() const { return highWater; }
+	size_t GetCapacity() const;
+
+private:
+	LinearAllocator(const LinearAllocator&);
+	LinearAllocator& operator=(const LinearAllocator&);
+
+	struct Block
+	{
+		char*	memory;
+		size_t	size;
+	};
+
+	void Release();
+
+	std::vector<Block>	blocks;
+	unsigned int		current;		// Block being allocated from
+	size_t				offset;			// Next free byte in that block
+	size_t				blockSize;
+	size_t				bytesUsed;
+	size_t				highWater;
+};
+
+// --------------------------------------------------------
+// One LinearAllocator per thread, for scratch data that is
+// made and used on the same thread within a frame.
+//
+// Each thread resets its own allocator at its own frame
+// boundary: the game loop at the top of every frame, the
+// render thread before drawing each packet, and job workers
+// after each job (so on a worker the memory only lasts
+// while the job runs).  Anything that crosses threads or
+// frames needs an allocator with a longer life, like the
+// one each FramePacket owns.
+// --------------------------------------------------------
+class FrameAllocator
+{
+public:
+	static LinearAllocator& GetThreadAllocator();
+
+	static void* Allocate(size_t size, size_t alignment = LinearAllocator::DefaultAlignment);
+
+	// Frees everything this thread allocated this frame
+	static void ResetThread();
+};
+
+// --------------------------------------------------------
+// Standard library allocator on top of a LinearAllocator,
+// by default the calling thread's frame allocator:
+//
+//   FrameVector<int> visible;	// Gone at the next reset
+//
+// Deallocation does nothing, and a container must not be
+// used after its allocator has been reset.
+// --------------------------------------------------------
+template <typename T>
+class FrameStlAllocator
+{
+public:
+	typedef T value_type;
+
+	FrameStlAllocator() : arena(&FrameAllocator::GetThreadAllocator()) { }
+	explicit FrameStlAllocator(LinearAllocator* arena) : arena(arena) { }
+
+	template <typename U>
+	FrameStlAllocator(const FrameStlAllocator<U>& other) : arena(other.arena) { }
+
+	T* allocate(size_t count)
+	{
+		void* memory = arena->Allocate(count * sizeof(T), alignof(T));
+		if (!memory)
+			throw std::bad_alloc();
+		return static_cast<T*>(memory);
+	}
+
+	void deallocate(T*, size_t) { }
+
+	template <typename U> bool operator==(const FrameStlAllocator<U>& other) const { return arena == other.arena; }
+	template <typename U> bool operator!=(const FrameStlAllocator<U>& other) const { return arena != other.arena; }
+
+	LinearAllocator* arena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameStlAllocator<T> >;
@@ -0,0 +1,240 @@
+#include "FrameLimiter.h"
+#include <cmath>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <mmsystem.h>
+#pragma comment(lib, "winmm.lib")
+
+// Not in older SDK headers
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#else
+#include <chrono>
+#include <thread>
+#endif
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ SYSTEM FRAME CLOCK --------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Constructor - Prefers a high resolution waitable timer
+// (Windows 10 1803+), otherwise raises the scheduler
+// resolution to 1ms so plain sleeps are usable
+// --------------------------------------------------------
+SystemFrameClock::SystemFrameClock()
+	: secondsPerCount(0.0),
+	timer(0),
+	raisedTimerResolution(false)
+{
+#ifdef _WIN32
+	__int64 perfFreq;
+	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
+	secondsPerCount = 1.0 / (double)perfFreq;
+
+	timer = CreateWaitableTimerExW(0, 0, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+	if (!timer)
+	{
+		timer = CreateWaitableTimerExW(0, 0, 0, TIMER_ALL_ACCESS);
+		raisedTimerResolution = timeBeginPeriod(1) == TIMERR_NOERROR;
+	}
+#endif
+}
+
+SystemFrameClock::~SystemFrameClock()
+{
+#ifdef _WIN32
+	if (timer)
+		CloseHandle((HANDLE)timer);
+	if (raisedTimerResolution)
+		timeEndPeriod(1);
+#endif
+}
+
+double SystemFrameClock::Now()
+{
+#ifdef _WIN32
+	__int64 now;
+	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	return now * secondsPerCount;
+#else
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void SystemFrameClock::Sleep(double seconds)
+{
+	if (seconds <= 0.0)
+		return;
+
+#ifdef _WIN32
+	if (timer)
+	{
+		// Negative due time is relative, in 100ns units
+		LARGE_INTEGER dueTime;
+		dueTime.QuadPart = -(LONGLONG)(seconds * 10000000.0);
+		if (SetWaitableTimer((HANDLE)timer, &dueTime, 0, 0, 0, FALSE))
+		{
+			WaitForSingleObject((HANDLE)timer, INFINITE);
+			return;
+		}
+	}
+	::Sleep((DWORD)(seconds * 1000.0));
+#else
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+#endif
+}
+
+void SystemFrameClock::Spin()
+{
+#ifdef _WIN32
+	YieldProcessor();
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ FRAME LIMITER -------------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Constructor - Limiting is off until a target is set
+// --------------------------------------------------------
+FrameLimiter::FrameLimiter(FrameClock* clock)
+	: clock(clock),
+	ownsClock(false),
+	targetFrameTime(0.0),
+	spinThreshold(0.002),
+	frameStart(0.0),
+	deadline(0.0),
+	started(false)
+{
+	if (!this->clock)
+	{
+		this->clock = new SystemFrameClock();
+		ownsClock = true;
+	}
+	ResetStats();
+}
+
+FrameLimiter::~FrameLimiter()
+{
+	if (ownsClock)
+		delete clock;
+}
+
+void FrameLimiter::SetTargetFrameTime(double seconds)
+{
+	targetFrameTime = seconds > 0.0 ? seconds : 0.0;
+	Reset();
+}
+
+void FrameLimiter::SetSpinThreshold(double seconds)
+{
+	spinThreshold = seconds > 0.0 ? seconds : 0.0;
+}
+
+void FrameLimiter::Reset()
+{
+	started = false;
+}
+
+// --------------------------------------------------------
+// Sleeps, then spins, until this frame's deadline.  The next
+// deadline is one target frame later, so small oversleeps
+// are absorbed instead of accumulating.  A frame that ran
+// long restarts the schedule from now rather than rushing
+// the following frames to catch up.
+// --------------------------------------------------------
+void FrameLimiter::WaitForNextFrame()
+{
+	double now = clock->Now();
+	if (!started)
+	{
+		frameStart = now;
+		deadline = now + targetFrameTime;
+		started = true;
+		return;
+	}
+
+	bool missed = false;
+	if (targetFrameTime > 0.0)
+	{
+		if (now < deadline)
+		{
+			double sleepTime = deadline - now - spinThreshold;
+			if (sleepTime > 0.0)
+				clock->Sleep(sleepTime);
+
+			now = clock->Now();
+			while (now < deadline)
+			{
+				clock->Spin();
+				now = clock->Now();
+			}
+		}
+		else
+		{
+			missed = true;
+			missedFrames++;
+		}
+	}
+
+	RecordFrame(now - frameStart);
+	frameStart = now;
+
+	if (missed)
+		deadline = now + targetFrameTime;
+	else
+		deadline += targetFrameTime;
+}
+
+// --------------------------------------------------------
+// Adds one frame to the running sums
+// --------------------------------------------------------
+void FrameLimiter::RecordFrame(double frameTime)
+{
+	double jitter = targetFrameTime > 0.0 ? frameTime - targetFrameTime : 0.0;
+
+	frameCount++;
+	frameTimeSum += frameTime;
+	jitterSum += jitter;
+	jitterSquaredSum += jitter * jitter;
+	absJitterSum += fabs(jitter);
+	if (fabs(jitter) > maxJitter)
+		maxJitter = fabs(jitter);
+}
+
+FramePacingStats FrameLimiter::GetStats()
+{
+	FramePacingStats stats;
+	stats.frameCount = frameCount;
+	stats.missedFrames = missedFrames;
+	stats.averageFrameTime = 0.0;
+	stats.averageJitter = 0.0;
+	stats.jitterStdDev = 0.0;
+	stats.maxJitter = maxJitter;
+
+	if (frameCount > 0)
+	{
+		double mean = jitterSum / frameCount;
+		double variance = jitterSquaredSum / frameCount - mean * mean;
+
+		stats.averageFrameTime = frameTimeSum / frameCount;
+		stats.averageJitter = absJitterSum / frameCount;
+		stats.jitterStdDev = variance > 0.0 ? sqrt(variance) : 0.0;
+	}
+	return stats;
+}
+
+void FrameLimiter::ResetStats()
+{
+	frameCount = 0;
+	missedFrames = 0;
+	frameTimeSum = 0.0;
+	absJitterSum = 0.0;
+	jitterSum = 0.0;
+	jitterSquaredSum = 0.0;
+	maxJitter = 0.0;
+}
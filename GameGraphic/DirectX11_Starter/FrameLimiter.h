@@ -0,0 +1,141 @@
+#pragma once
+
+// --------------------------------------------------------
+// Source of time for the frame limiter.  The real clock
+// sleeps the thread; ManualFrameClock just moves time
+// forward, so pacing can be measured without a window.
+// --------------------------------------------------------
+class FrameClock
+{
+public:
+	virtual ~FrameClock() { }
+
+	// Current time in seconds
+	virtual double Now() = 0;
+
+	// Gives up the CPU for roughly this long.  May oversleep.
+	virtual void Sleep(double seconds) = 0;
+
+	// Called while spinning out the last few microseconds
+	virtual void Spin() { }
+};
+
+// --------------------------------------------------------
+// High resolution system clock.  On Windows it sleeps on a
+// high resolution waitable timer when available.
+// --------------------------------------------------------
+class SystemFrameClock : public FrameClock
+{
+public:
+	SystemFrameClock();
+	~SystemFrameClock();
+
+	double Now();
+	void Sleep(double seconds);
+	void Spin();
+
+private:
+	SystemFrameClock(const SystemFrameClock&);
+	SystemFrameClock& operator=(const SystemFrameClock&);
+
+	double	secondsPerCount;
+	void*	timer;			// Waitable timer handle, or null
+	bool	raisedTimerResolution;
+};
+
+// --------------------------------------------------------
+// Clock that only moves when told to.  Sleep() advances it
+// by the requested time plus a fixed oversleep, and Spin()
+// by a fixed step, so limiter behaviour is deterministic.
+// --------------------------------------------------------
+class ManualFrameClock : public FrameClock
+{
+public:
+	ManualFrameClock(double oversleep = 0.0, double spinStep = 0.00001)
+		: time(0.0), oversleep(oversleep), spinStep(spinStep) { }
+
+	double Now() { return time; }
+	void Sleep(double seconds) { time += seconds + oversleep; }
+	void Spin() { time += spinStep; }
+
+	// Simulates the work done during a frame
+	void Advance(double seconds) { time += seconds; }
+	void SetOversleep(double seconds) { oversleep = seconds; }
+
+private:
+	double time;
+	double oversleep;
+	double spinStep;
+};
+
+// --------------------------------------------------------
+// How evenly frames were paced since the last reset.
+// Jitter is the difference between each frame's actual
+// length and the target.
+// --------------------------------------------------------
+struct FramePacingStats
+{
+	unsigned int	frameCount;
+	unsigned int	missedFrames;		// Frames that ran past their deadline
+	double			averageFrameTime;
+	double			averageJitter;		// Mean of |actual - target|
+	double			jitterStdDev;		// Standard deviation of (actual - target)
+	double			maxJitter;
+};
+
+// --------------------------------------------------------
+// Holds the game loop to a target frame time without
+// burning a core.  It sleeps until shortly before the
+// deadline, then spins for the last stretch, since sleeps
+// are only accurate to a millisecond or so.
+// --------------------------------------------------------
+class FrameLimiter
+{
+public:
+	// clock of 0 uses the system clock.  The limiter does
+	// not take ownership of a clock passed in.
+	FrameLimiter(FrameClock* clock = 0);
+	~FrameLimiter();
+
+	// 0 disables limiting (stats are still kept)
+	void SetTargetFrameTime(double seconds);
+	double GetTargetFrameTime() { return targetFrameTime; }
+
+	// How long before the deadline to stop sleeping and spin
+	void SetSpinThreshold(double seconds);
+
+	// Call once per frame, after presenting.  Waits until the
+	// frame's deadline and records how close it got.
+	void WaitForNextFrame();
+
+	// Forgets the last deadline, e.g. after a long stall,
+	// so the next frame doesn't try to catch up
+	void Reset();
+
+	FramePacingStats GetStats();
+	void ResetStats();
+
+private:
+	FrameLimiter(const FrameLimiter&);
+	FrameLimiter& operator=(const FrameLimiter&);
+
+	void RecordFrame(double frameTime);
+
+	FrameClock*	clock;
+	bool		ownsClock;
+
+	double		targetFrameTime;
+	double		spinThreshold;
+	double		frameStart;
+	double		deadline;
+	bool		started;
+
+	// Running sums for the stats
+	unsigned int	frameCount;
+	unsigned int	missedFrames;
+	double			frameTimeSum;
+	double			absJitterSum;
+	double			jitterSum;
+	double			jitterSquaredSum;
+	double			maxJitter;
+};
@@ -0,0 +1,150 @@
+#include "FramePacket.h"
+#include <thread>
+#include <chrono>
+
+FramePacket::FramePacket()
+	: draws(DrawList::allocator_type(&memory))
+{
+	Clear();
+}
+
+// --------------------------------------------------------
+// The draw list lets go of its memory before the allocator
+// is reset, then reserves as much as last frame needed so
+// it doesn't have to grow
+// --------------------------------------------------------
+void FramePacket::Clear()
+{
+	frameIndex = 0;
+	deltaTime = 0.0f;
+	totalTime = 0.0f;
+
+	size_t drawCount = draws.size();
+	DrawList(draws.get_allocator()).swap(draws);
+	memory.Reset();
+	draws.reserve(drawCount);
+}
+
+// --------------------------------------------------------
+// Constructor - Both packets start out free
+// --------------------------------------------------------
+FramePacketBuffer::FramePacketBuffer()
+	: writeIndex(0)
+{
+	readyIndex.store(-1);
+	readingIndex.store(-1);
+	closed.store(false);
+	readerSleeping.store(false);
+
+	packets[0].Clear();
+	packets[1].Clear();
+}
+
+// --------------------------------------------------------
+// Waits until the renderer is done with the packet we're
+// about to overwrite (it can only be reading the other one
+// or this one from two frames ago)
+// --------------------------------------------------------
+FramePacket* FramePacketBuffer::BeginWrite()
+{
+	while (readingIndex.load(std::memory_order_acquire) == writeIndex &&
+		!closed.load(std::memory_order_acquire))
+		std::this_thread::yield();
+
+	return &packets[writeIndex];
+}
+
+// --------------------------------------------------------
+// Waits for the renderer to pick up the previous frame,
+// then publishes this one and flips to the other packet
+// --------------------------------------------------------
+void FramePacketBuffer::Publish()
+{
+	while (readyIndex.load(std::memory_order_acquire) != -1 &&
+		!closed.load(std::memory_order_acquire))
+		std::this_thread::yield();
+
+	readyIndex.store(writeIndex, std::memory_order_release);
+	writeIndex = 1 - writeIndex;
+	WakeReader();
+}
+
+void FramePacketBuffer::WaitForIdle()
+{
+	while ((readyIndex.load(std::memory_order_acquire) != -1 ||
+		readingIndex.load(std::memory_order_acquire) != -1) &&
+		!closed.load(std::memory_order_acquire))
+		std::this_thread::yield();
+}
+
+// --------------------------------------------------------
+// Takes the published packet.  readingIndex is set before
+// readyIndex is cleared so the update thread never sees the
+// packet as free in between.
+// --------------------------------------------------------
+const FramePacket* FramePacketBuffer::AcquireRead()
+{
+	for (unsigned int spins = 0; ; spins++)
+	{
+		if (closed.load(std::memory_order_acquire))
+			return 0;
+
+		int index = readyIndex.load(std::memory_order_acquire);
+		if (index != -1)
+		{
+			readingIndex.store(index, std::memory_order_release);
+			readyIndex.store(-1, std::memory_order_release);
+			return &packets[index];
+		}
+
+		// Spin briefly, then sleep until the next Publish()
+		if (spins < 64)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepLock);
+		readerSleeping.store(true);
+		wake.wait_for(lock, std::chrono::milliseconds(5), [this]
+		{
+			return readyIndex.load() != -1 || closed.load();
+		});
+		readerSleeping.store(false);
+	}
+}
+
+// --------------------------------------------------------
+// Only takes the lock if the render thread is asleep
+// --------------------------------------------------------
+void FramePacketBuffer::WakeReader()
+{
+	if (!readerSleeping.load())
+		return;
+
+	std::lock_guard<std::mutex> lock(sleepLock);
+	wake.notify_one();
+}
+
+void FramePacketBuffer::ReleaseRead()
+{
+	readingIndex.store(-1, std::memory_order_release);
+}
+
+void FramePacketBuffer::Close()
+{
+	closed.store(true, std::memory_order_release);
+	WakeReader();
+}
+
+// --------------------------------------------------------
+// Makes the buffer usable again after Close().  Only call
+// when the render thread is not running.
+// --------------------------------------------------------
+void FramePacketBuffer::Reopen()
+{
+	readyIndex.store(-1);
+	readingIndex.store(-1);
+	writeIndex = 0;
+	closed.store(false);
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "DrawCommand.h"
+#include "FrameAllocator.h"
+#include "Light.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Everything the renderer needs to draw one frame, captured
+// by the update thread.  Once handed to the render thread it
+// is read-only, so simulation can move on to the next frame
+// while this one is being drawn.
+// --------------------------------------------------------
+struct FramePacket
+{
+	typedef FrameVector<DrawCommand> DrawList;
+
+	FramePacket();
+
+	// Transient memory that lives exactly as long as the packet's
+	// contents, so it can be handed to the render thread.  The
+	// draw list comes from here; BuildFrame() can use it for
+	// anything else the frame needs.
+	LinearAllocator				memory;
+
+	unsigned int				frameIndex;
+	float						deltaTime;
+	float						totalTime;
+
+	// Camera
+	XMFLOAT4X4					viewMatrix;
+	XMFLOAT4X4					projectionMatrix;
+	XMFLOAT3					cameraPosition;
+
+	// Lights
+	DirectionalLight			dirLight;
+	PointLight					pointLight;
+
+	// Draws in the order they should be recorded
+	DrawList					draws;
+
+	// Empties the packet and frees its transient memory
+	void Clear();
+
+private:
+	FramePacket(const FramePacket&);
+	FramePacket& operator=(const FramePacket&);
+};
+
+// --------------------------------------------------------
+// Hands frame packets from the update thread to the render
+// thread without locks.
+//
+// There are two packets: the update thread fills one while
+// the render thread draws the other.  Publish() only waits
+// if the renderer hasn't picked up the previous frame yet,
+// and BeginWrite() only waits if the renderer is still
+// drawing the packet about to be reused - so a frame costs
+// max(update, render) rather than their sum.
+// --------------------------------------------------------
+class FramePacketBuffer
+{
+public:
+	FramePacketBuffer();
+
+	// --- Update thread ---
+
+	// Returns the packet to fill for the next frame
+	FramePacket* BeginWrite();
+
+	// Makes the packet from BeginWrite() visible to the renderer
+	void Publish();
+
+	// Blocks until the renderer has drawn everything published
+	// so far, e.g. before touching D3D from the update thread
+	void WaitForIdle();
+
+	// --- Render thread ---
+
+	// Blocks until a packet is published.  Returns null once
+	// the buffer is closed.
+	const FramePacket* AcquireRead();
+
+	// Hands the packet from AcquireRead() back for reuse
+	void ReleaseRead();
+
+	// --- Either thread ---
+
+	// Wakes the render thread and makes AcquireRead() fail
+	void Close();
+	void Reopen();
+
+private:
+	FramePacketBuffer(const FramePacketBuffer&);
+	FramePacketBuffer& operator=(const FramePacketBuffer&);
+
+	FramePacket			packets[2];
+	int					writeIndex;		// Owned by the update thread
+
+	std::atomic<int>	readyIndex;		// Published but not yet picked up, or -1
+	std::atomic<int>	readingIndex;	// Being drawn, or -1
+	std::atomic<bool>	closed;
+
+	// Lets an idle render thread sleep instead of spinning
+	// when the update thread is being frame limited.  The
+	// handoff itself never takes the lock.
+	std::atomic<bool>		readerSleeping;
+	std::mutex				sleepLock;
+	std::condition_variable	wake;
+
+	void WakeReader();
+};
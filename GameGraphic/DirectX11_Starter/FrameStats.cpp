@@ -0,0 +1,266 @@
+#include "FrameStats.h"
+#include <cstdio>
+
+const double FrameStats::BucketMs = 0.1;
+
+namespace
+{
+	FILE* OpenForWriting(const char* path)
+	{
+		FILE* file = 0;
+#ifdef _MSC_VER
+		if (fopen_s(&file, path, "w") != 0)
+			file = 0;
+#else
+		file = fopen(path, "w");
+#endif
+		return file;
+	}
+
+	// Escapes free text for a JSON string
+	std::string JsonEscape(const std::string& text)
+	{
+		std::string result;
+		for (unsigned int i = 0; i < text.size(); i++)
+		{
+			char c = text[i];
+			if (c == '"' || c == '\\') { result += '\\'; result += c; }
+			else if (c == '\n') result += "\\n";
+			else if ((unsigned char)c >= 0x20) result += c;
+		}
+		return result;
+	}
+}
+
+// --------------------------------------------------------
+// Constructor - Empty stats with the default thresholds
+// --------------------------------------------------------
+FrameStats::FrameStats()
+	: hitchAbsoluteMs(50.0),
+	hitchMedianMultiple(2.5),
+	warmupFrames(30)
+{
+	window.resize(WindowSize);
+	rolling.buckets.resize(BucketCount + 1);
+	session.buckets.resize(BucketCount + 1);
+	Reset();
+}
+
+void FrameStats::SetHitchThresholds(double absoluteMs, double medianMultiple)
+{
+	hitchAbsoluteMs = absoluteMs;
+	hitchMedianMultiple = medianMultiple;
+}
+
+void FrameStats::SetWarmupFrames(unsigned int frames)
+{
+	warmupFrames = frames;
+}
+
+void FrameStats::Reset()
+{
+	windowNext = 0;
+	windowCount = 0;
+	totalFrames = 0;
+
+	Histogram* histograms[2] = { &rolling, &session };
+	for (unsigned int h = 0; h < 2; h++)
+	{
+		for (unsigned int i = 0; i < histograms[h]->buckets.size(); i++)
+			histograms[h]->buckets[i] = 0;
+		histograms[h]->count = 0;
+		histograms[h]->sum = 0.0;
+		histograms[h]->max = 0.0;
+	}
+
+	hitches.clear();
+}
+
+// --------------------------------------------------------
+// Index of the bucket a frame falls in.  The last bucket
+// catches everything too long for the others.
+// --------------------------------------------------------
+unsigned int FrameStats::BucketFor(double frameMs)
+{
+	if (frameMs <= 0.0)
+		return 0;
+
+	unsigned int bucket = (unsigned int)(frameMs / BucketMs);
+	return bucket < BucketCount ? bucket : BucketCount;
+}
+
+// --------------------------------------------------------
+// Records a frame, evicting the oldest from the rolling
+// window, and checks it against the hitch thresholds (which
+// use the median from before this frame)
+// --------------------------------------------------------
+bool FrameStats::AddFrame(double frameMs)
+{
+	double medianMs = Percentile(rolling, 0.5, RollingMax());
+	bool warmedUp = windowCount >= warmupFrames;
+
+	// Slide the window
+	if (windowCount == WindowSize)
+	{
+		double old = window[windowNext];
+		rolling.buckets[BucketFor(old)]--;
+		rolling.count--;
+		rolling.sum -= old;
+	}
+	else
+	{
+		windowCount++;
+	}
+	window[windowNext] = frameMs;
+	windowNext = (windowNext + 1) % WindowSize;
+
+	rolling.buckets[BucketFor(frameMs)]++;
+	rolling.count++;
+	rolling.sum += frameMs;
+
+	session.buckets[BucketFor(frameMs)]++;
+	session.count++;
+	session.sum += frameMs;
+	if (frameMs > session.max)
+		session.max = frameMs;
+
+	unsigned int frameIndex = totalFrames++;
+
+	// Is it a hitch?
+	if (!warmedUp)
+		return false;
+
+	bool hitch =
+		(hitchAbsoluteMs > 0.0 && frameMs > hitchAbsoluteMs) ||
+		(hitchMedianMultiple > 0.0 && medianMs > 0.0 && frameMs > medianMs * hitchMedianMultiple);
+	if (!hitch)
+		return false;
+
+	FrameHitch record;
+	record.frameIndex = frameIndex;
+	record.frameMs = frameMs;
+	record.medianMs = medianMs;
+	if (hitches.size() >= MaxHitches)
+		hitches.erase(hitches.begin());
+	hitches.push_back(record);
+	return true;
+}
+
+void FrameStats::SetLastHitchDetails(const std::string& details)
+{
+	if (!hitches.empty())
+		hitches.back().details = details;
+}
+
+// --------------------------------------------------------
+// The rolling max isn't tracked incrementally (it can leave
+// the window), so it is found by a scan when needed
+// --------------------------------------------------------
+double FrameStats::RollingMax()
+{
+	double max = 0.0;
+	for (unsigned int i = 0; i < windowCount; i++)
+		if (window[i] > max)
+			max = window[i];
+	return max;
+}
+
+// --------------------------------------------------------
+// Walks the buckets until the given fraction of frames is
+// covered and returns that bucket's midpoint.  Frames in the
+// overflow bucket report overflowMax instead.
+// --------------------------------------------------------
+double FrameStats::Percentile(const Histogram& histogram, double fraction, double overflowMax)
+{
+	if (histogram.count == 0)
+		return 0.0;
+
+	unsigned int target = (unsigned int)(fraction * histogram.count + 0.5);
+	if (target < 1) target = 1;
+	if (target > histogram.count) target = histogram.count;
+
+	unsigned int covered = 0;
+	for (unsigned int i = 0; i < BucketCount; i++)
+	{
+		covered += histogram.buckets[i];
+		if (covered >= target)
+			return (i + 0.5) * BucketMs;
+	}
+	return overflowMax;
+}
+
+FrameTimeSummary FrameStats::Summarize(const Histogram& histogram, double overflowMax)
+{
+	FrameTimeSummary summary;
+	summary.frameCount = histogram.count;
+	summary.averageMs = histogram.count > 0 ? histogram.sum / histogram.count : 0.0;
+	summary.p50Ms = Percentile(histogram, 0.50, overflowMax);
+	summary.p95Ms = Percentile(histogram, 0.95, overflowMax);
+	summary.p99Ms = Percentile(histogram, 0.99, overflowMax);
+	summary.maxMs = overflowMax;
+	return summary;
+}
+
+FrameTimeSummary FrameStats::GetRollingSummary()
+{
+	return Summarize(rolling, RollingMax());
+}
+
+FrameTimeSummary FrameStats::GetSessionSummary()
+{
+	return Summarize(session, session.max);
+}
+
+// --------------------------------------------------------
+// One row per frame in the rolling window, oldest first
+// --------------------------------------------------------
+bool FrameStats::ExportCsv(const char* path)
+{
+	FILE* file = OpenForWriting(path);
+	if (!file)
+		return false;
+
+	fprintf(file, "frame,frame_ms\n");
+	unsigned int first = totalFrames - windowCount;
+	unsigned int oldest = windowCount == WindowSize ? windowNext : 0;
+	for (unsigned int i = 0; i < windowCount; i++)
+		fprintf(file, "%u,%.4f\n", first + i, window[(oldest + i) % WindowSize]);
+
+	fclose(file);
+	return true;
+}
+
+bool FrameStats::ExportJson(const char* path)
+{
+	FILE* file = OpenForWriting(path);
+	if (!file)
+		return false;
+
+	FrameTimeSummary summaries[2] = { GetSessionSummary(), GetRollingSummary() };
+	const char* names[2] = { "session", "rolling" };
+
+	fprintf(file, "{\n");
+	for (unsigned int s = 0; s < 2; s++)
+	{
+		const FrameTimeSummary& sum = summaries[s];
+		fprintf(file, "  \"%s\": { \"frames\": %u, \"average_ms\": %.4f, \"p50_ms\": %.4f, "
+			"\"p95_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f },\n",
+			names[s], sum.frameCount, sum.averageMs, sum.p50Ms, sum.p95Ms, sum.p99Ms, sum.maxMs);
+	}
+
+	fprintf(file, "  \"hitch_thresholds\": { \"absolute_ms\": %.4f, \"median_multiple\": %.4f },\n",
+		hitchAbsoluteMs, hitchMedianMultiple);
+
+	fprintf(file, "  \"hitches\": [");
+	for (unsigned int i = 0; i < hitches.size(); i++)
+	{
+		fprintf(file, "%s\n    { \"frame\": %u, \"frame_ms\": %.4f, \"median_ms\": %.4f, \"details\": \"%s\" }",
+			i > 0 ? "," : "",
+			hitches[i].frameIndex, hitches[i].frameMs, hitches[i].medianMs,
+			JsonEscape(hitches[i].details).c_str());
+	}
+	fprintf(file, "%s]\n}\n", hitches.empty() ? "" : "\n  ");
+
+	fclose(file);
+	return true;
+}
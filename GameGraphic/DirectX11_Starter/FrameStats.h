@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Frame time percentiles from FrameStats
+// --------------------------------------------------------
+struct FrameTimeSummary
+{
+	unsigned int	frameCount;
+	double			averageMs;
+	double			p50Ms;
+	double			p95Ms;
+	double			p99Ms;
+	double			maxMs;
+};
+
+// --------------------------------------------------------
+// A frame that took noticeably longer than it should have
+// --------------------------------------------------------
+struct FrameHitch
+{
+	unsigned int	frameIndex;
+	double			frameMs;
+	double			medianMs;		// Rolling median when it happened
+	std::string		details;		// Whatever the caller attached (profiler scopes)
+};
+
+// --------------------------------------------------------
+// Frame time statistics that averages can't hide.
+//
+// Keeps a histogram of the last WindowSize frames (updated
+// as frames enter and leave the window) and another over the
+// whole session, so percentiles cost a walk over the buckets
+// instead of a sort.  Buckets are 0.1ms wide up to 250ms;
+// anything longer lands in an overflow bucket, whose frames
+// report the true maximum.
+//
+// A frame is a hitch if it is longer than an absolute limit
+// or than a multiple of the rolling median.
+//
+// Pure computation - no Windows or D3D dependencies.
+// --------------------------------------------------------
+class FrameStats
+{
+public:
+	static const unsigned int WindowSize = 1000;
+	static const unsigned int BucketCount = 2500;
+	static const double BucketMs;
+
+	// Only the most recent hitches are kept
+	static const unsigned int MaxHitches = 1000;
+
+	FrameStats();
+
+	// Either limit can be 0 to disable it.  Defaults are
+	// 50ms absolute and 2.5x the rolling median.
+	void SetHitchThresholds(double absoluteMs, double medianMultiple);
+
+	// Hitches aren't checked until the window has this many
+	// frames, so loading doesn't count
+	void SetWarmupFrames(unsigned int frames);
+
+	// Adds one frame.  Returns true if it was a hitch, in which
+	// case it has been appended to GetHitches() and the caller
+	// can attach details with SetLastHitchDetails().
+	bool AddFrame(double frameMs);
+	void SetLastHitchDetails(const std::string& details);
+
+	// Over the last WindowSize frames, or the whole session
+	FrameTimeSummary GetRollingSummary();
+	FrameTimeSummary GetSessionSummary();
+
+	const std::vector<FrameHitch>& GetHitches() { return hitches; }
+	unsigned int GetFrameCount() { return totalFrames; }
+
+	void Reset();
+
+	// CSV: one row per frame in the rolling window.
+	// JSON: both summaries and every hitch.
+	bool ExportCsv(const char* path);
+	bool ExportJson(const char* path);
+
+private:
+	struct Histogram
+	{
+		std::vector<unsigned int>	buckets;
+		unsigned int				count;
+		double						sum;
+		double						max;
+	};
+
+	static unsigned int BucketFor(double frameMs);
+	static double Percentile(const Histogram& histogram, double fraction, double overflowMax);
+	static FrameTimeSummary Summarize(const Histogram& histogram, double overflowMax);
+
+	double RollingMax();
+
+	// Ring of the frames in the rolling window
+	std::vector<double>	window;
+	unsigned int		windowNext;
+	unsigned int		windowCount;
+
+	Histogram			rolling;
+	Histogram			session;
+	unsigned int		totalFrames;
+
+	double				hitchAbsoluteMs;
+	double				hitchMedianMultiple;
+	unsigned int		warmupFrames;
+	std::vector<FrameHitch>	hitches;
+};
@@ -1,4 +1,6 @@
 #include "GameEntity.h"
+#include "Profiler.h"
+#include "RenderStats.h"
 
 
 
@@ -8,6 +10,7 @@ GameEntity::GameEntity()
 	Position = XMFLOAT3(0, 0, 0);
 	Rotation = XMFLOAT3(0, 0, 0);
 	Scale	 = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	SaveState();
 
 	XMMATRIX W = XMMatrixIdentity();
 	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(W));
@@ -22,6 +25,7 @@ GameEntity::GameEntity( Mesh* pMesh = NULL, Material* pMaterial = NULL)
 	Position = XMFLOAT3(0, 0, 0);
 	Rotation = XMFLOAT3(0, 0, 0);
 	Scale = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	SaveState();
 	
 	XMMATRIX W = XMMatrixIdentity();
 	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(W));
@@ -87,18 +91,50 @@ void GameEntity::setPixelShader(SimplePixelShader* pPS)
 	pixelShader = pPS;
 }
 #endif
-void GameEntity::DrawEntity(XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projectionMatrix)
+void GameEntity::SaveState()
+{
+	PrevPosition = Position;
+	PrevRotation = Rotation;
+	PrevScale	 = Scale;
+}
+
+XMFLOAT4X4 GameEntity::GetWorldMatrix(float interpolation)
 {
-	XMMATRIX trans = XMMatrixTranslation(Position.x, Position.y, Position.z);
+	//blend from the saved transformations to the current ones
+	XMFLOAT3 position, rotation, scaling;
+	XMStoreFloat3(&position, XMVectorLerp(XMLoadFloat3(&PrevPosition), XMLoadFloat3(&Position), interpolation));
+	XMStoreFloat3(&rotation, XMVectorLerp(XMLoadFloat3(&PrevRotation), XMLoadFloat3(&Rotation), interpolation));
+	XMStoreFloat3(&scaling, XMVectorLerp(XMLoadFloat3(&PrevScale), XMLoadFloat3(&Scale), interpolation));
+
+	XMMATRIX trans = XMMatrixTranslation(position.x, position.y, position.z);
 	//the order of rotation matters but here we assume a order ourselves
-	XMMATRIX rotx  = XMMatrixRotationX(Rotation.x);
-	XMMATRIX roty = XMMatrixRotationY(Rotation.y);
-	XMMATRIX rotz = XMMatrixRotationZ(Rotation.z);
-	XMMATRIX scale = XMMatrixScaling(Scale.x, Scale.y, Scale.z);
+	XMMATRIX rotx  = XMMatrixRotationX(rotation.x);
+	XMMATRIX roty = XMMatrixRotationY(rotation.y);
+	XMMATRIX rotz = XMMatrixRotationZ(rotation.z);
+	XMMATRIX scale = XMMatrixScaling(scaling.x, scaling.y, scaling.z);
 	XMMATRIX W = scale * rotz * roty * rotx * trans;
 	//XMStoreFloat4x4(&worldMatrix, W); // Transpose for HLSL!
 
 	XMStoreFloat4x4(&worldMatrix, XMMatrixTranspose(W)); // Transpose for HLSL!
+	return worldMatrix;
+}
+
+DrawCommand GameEntity::GetDrawCommand(float interpolation)
+{
+	DrawCommand cmd;
+	cmd.mesh			= pEntityMesh;
+	cmd.material		= pEntityMaterial;
+	cmd.vertexShader	= pEntityMaterial->GetVertexShader();
+	cmd.pixelShader		= pEntityMaterial->GetPixelShader();
+	cmd.worldMatrix		= GetWorldMatrix(interpolation);
+	return cmd;
+}
+
+void GameEntity::DrawEntity(XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projectionMatrix)
+{
+	PROFILE_SCOPE("GameEntity::DrawEntity");
+
+	GetWorldMatrix();
 
 	pEntityMaterial->GetVertexShader()->SetMatrix4x4("world", worldMatrix);
 	pEntityMaterial->GetVertexShader()->SetMatrix4x4("view", viewMatrix);
@@ -120,6 +156,7 @@ void GameEntity::DrawEntity(XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projectionMatrix)
 	// Reset my states
 	pEntityMesh->GetD3DDeviceContext()->RSSetState(0);
 	pEntityMesh->GetD3DDeviceContext()->OMSetDepthStencilState(0, 0);
+	RenderStats::Add(RenderCounter_StateChanges, 4);
 }
 
 GameEntity::~GameEntity()
@@ -3,6 +3,7 @@
 #include"Mesh.h"
 #include"SimpleShader.h"
 #include"Material.h"
+#include"DrawCommand.h"
 
 //for the DX Math library
 using namespace DirectX;
@@ -40,6 +41,16 @@ public:
 	//Draw Entity
 	void DrawEntity(XMFLOAT4X4 viewMatrix, XMFLOAT4X4 projectionMatrix);
 
+	//Remember the current transformations for interpolation
+	void SaveState();
+
+	//Rebuild the world matrix from between the saved and current
+	//transformations (0 = saved, 1 = current)
+	XMFLOAT4X4 GetWorldMatrix(float interpolation = 1.0f);
+
+	//Capture this entity as a draw command for deferred recording
+	DrawCommand GetDrawCommand(float interpolation = 1.0f);
+
 private:
 	//Mesh pointer
 	Mesh* pEntityMesh;
@@ -52,6 +63,11 @@ private:
 	XMFLOAT3 Rotation;
 	XMFLOAT3 Scale;
 
+	//Transformations at the last SaveState()
+	XMFLOAT3 PrevPosition;
+	XMFLOAT3 PrevRotation;
+	XMFLOAT3 PrevScale;
+
 	//worldMatrix generated by 3 vectors above
 	XMFLOAT4X4 worldMatrix;
 #if 0	
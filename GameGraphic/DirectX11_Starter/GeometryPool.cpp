@@ -0,0 +1,153 @@
+#include "GeometryPool.h"
+#include "DirectXGameCore.h"
+#include <algorithm>
+
+GeometryPool::GeometryPool()
+{
+	device = 0;
+	context = 0;
+	pageVertices = DefaultPageVertices;
+	pageIndices = DefaultPageIndices;
+}
+
+GeometryPool::~GeometryPool()
+{
+	Release();
+}
+
+bool GeometryPool::Init(ID3D11Device* _device, ID3D11DeviceContext* _context, UINT _pageVertices, UINT _pageIndices)
+{
+	Release();
+	device = _device;
+	context = _context;
+	pageVertices = _pageVertices;
+	pageIndices = _pageIndices;
+	return device && context && pageVertices > 0 && pageIndices > 0;
+}
+
+void GeometryPool::Release()
+{
+	for (unsigned int i = 0; i < pages.size(); i++)
+	{
+		ReleaseMacro(pages[i]->vertexBuffer);
+		ReleaseMacro(pages[i]->indexBuffer);
+		MemoryTracker::Unregister(pages[i]->memoryHandle);
+		delete pages[i];
+	}
+	pages.clear();
+}
+
+bool GeometryPool::Allocate(const Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, GeometryAllocation& allocation)
+{
+	allocation.vertices = RangeAllocation{ 0, 0, 0xFFFFFFFF };
+	allocation.indices = allocation.vertices;
+	if (!device || vertexCount == 0 || indexCount == 0)
+		return false;
+
+	// First page with room for both halves
+	unsigned int page = 0;
+	for (; page < pages.size(); page++)
+	{
+		allocation.vertices = pages[page]->vertices.Allocate(vertexCount);
+		if (!allocation.vertices.IsValid())
+			continue;
+
+		allocation.indices = pages[page]->indices.Allocate(indexCount);
+		if (allocation.indices.IsValid())
+			break;
+
+		pages[page]->vertices.Free(allocation.vertices);
+	}
+
+	if (page == pages.size())
+	{
+		Page* added = CreatePage(std::max(vertexCount, pageVertices), std::max(indexCount, pageIndices));
+		if (!added)
+			return false;
+		pages.push_back(added);
+		allocation.vertices = added->vertices.Allocate(vertexCount);
+		allocation.indices = added->indices.Allocate(indexCount);
+	}
+	allocation.page = page;
+
+	// Default usage buffers take partial updates
+	D3D11_BOX box = { 0, 0, 0, 0, 1, 1 };
+	box.left = allocation.vertices.offset * sizeof(Vertex);
+	box.right = box.left + vertexCount * sizeof(Vertex);
+	context->UpdateSubresource(pages[page]->vertexBuffer, 0, &box, vertices, 0, 0);
+
+	box.left = allocation.indices.offset * sizeof(UINT);
+	box.right = box.left + indexCount * sizeof(UINT);
+	context->UpdateSubresource(pages[page]->indexBuffer, 0, &box, indices, 0, 0);
+	return true;
+}
+
+void GeometryPool::Free(GeometryAllocation& allocation)
+{
+	if (!allocation.IsValid() || allocation.page >= pages.size())
+		return;
+
+	// The stale data stays in the buffers until it is overwritten
+	pages[allocation.page]->vertices.Free(allocation.vertices);
+	pages[allocation.page]->indices.Free(allocation.indices);
+}
+
+UINT GeometryPool::GetUsedVertices() const
+{
+	UINT used = 0;
+	for (unsigned int i = 0; i < pages.size(); i++)
+		used += pages[i]->vertices.GetCapacity() - pages[i]->vertices.GetFreeSpace();
+	return used;
+}
+
+UINT GeometryPool::GetUsedIndices() const
+{
+	UINT used = 0;
+	for (unsigned int i = 0; i < pages.size(); i++)
+		used += pages[i]->indices.GetCapacity() - pages[i]->indices.GetFreeSpace();
+	return used;
+}
+
+float GeometryPool::GetFragmentation() const
+{
+	float worst = 0.0f;
+	for (unsigned int i = 0; i < pages.size(); i++)
+		worst = std::max(worst, pages[i]->vertices.GetFragmentation());
+	return worst;
+}
+
+// --------------------------------------------------------
+// The whole page is reported to the memory tracker up
+// front, since that is what the GPU holds
+// --------------------------------------------------------
+GeometryPool::Page* GeometryPool::CreatePage(UINT vertexCount, UINT indexCount)
+{
+	D3D11_BUFFER_DESC vbd;
+	vbd.Usage = D3D11_USAGE_DEFAULT;
+	vbd.ByteWidth = sizeof(Vertex) * vertexCount;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbd.CPUAccessFlags = 0;
+	vbd.MiscFlags = 0;
+	vbd.StructureByteStride = 0;
+
+	D3D11_BUFFER_DESC ibd = vbd;
+	ibd.ByteWidth = sizeof(UINT) * indexCount;
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+	ID3D11Buffer* vertexBuffer = 0;
+	ID3D11Buffer* indexBuffer = 0;
+	if (FAILED(device->CreateBuffer(&vbd, 0, &vertexBuffer)) ||
+		FAILED(device->CreateBuffer(&ibd, 0, &indexBuffer)))
+	{
+		ReleaseMacro(vertexBuffer);
+		return 0;
+	}
+
+	Page* page = new Page();
+	page->vertexBuffer = vertexBuffer;
+	page->indexBuffer = indexBuffer;
+	page->vertices.Reset(vertexCount);
+	page->indices.Reset(indexCount);
+	page->memoryHandle = MemoryTracker::Register(MemoryTag_Mesh, "Geometry pool", 0, (size_t)vbd.ByteWidth + ibd.ByteWidth);
+	return page;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <d3d11.h>
+#include <vector>
+#include "Vertex.h"
+#include "RangeAllocator.h"
+#include "MemoryTracker.h"
+
+// --------------------------------------------------------
+// Where one mesh's geometry lives in a GeometryPool
+// --------------------------------------------------------
+struct GeometryAllocation
+{
+	unsigned int		page;
+	RangeAllocation		vertices;
+	RangeAllocation		indices;
+
+	bool IsValid() const { return vertices.IsValid(); }
+
+	// For DrawIndexed()
+	UINT GetBaseVertex() const { return vertices.offset; }
+	UINT GetStartIndex() const { return indices.offset; }
+};
+
+// --------------------------------------------------------
+// Shared vertex and index buffers for every mesh.
+//
+// Geometry is sub-allocated from a few large pages, each a
+// vertex buffer and an index buffer with a RangeAllocator
+// for each.  Meshes in the same page draw from the same
+// buffers with a base vertex and start index, so
+// consecutive draws don't have to rebind the input
+// assembler.  A new page is added when none has room; a
+// mesh bigger than a page gets a page of its own.
+//
+// Uploads go through the immediate context, so allocate and
+// free on the thread that owns it, like any other resource
+// creation in the game.  The pool must outlive its meshes.
+// --------------------------------------------------------
+class GeometryPool
+{
+public:
+	static const UINT DefaultPageVertices = 256 * 1024;
+	static const UINT DefaultPageIndices = 1024 * 1024;
+
+	GeometryPool();
+	~GeometryPool();
+
+	bool Init(ID3D11Device* device, ID3D11DeviceContext* context,
+		UINT pageVertices = DefaultPageVertices, UINT pageIndices = DefaultPageIndices);
+	void Release();
+
+	// Copies the geometry into a page.  Indices are relative
+	// to the first vertex, as for a buffer of its own.
+	bool Allocate(const Vertex* vertices, UINT vertexCount, const UINT* indices, UINT indexCount, GeometryAllocation& allocation);
+	void Free(GeometryAllocation& allocation);
+
+	ID3D11Buffer* GetVertexBuffer(unsigned int page) const { return pages[page]->vertexBuffer; }
+	ID3D11Buffer* GetIndexBuffer(unsigned int page) const { return pages[page]->indexBuffer; }
+
+	// --- Stats ---
+	unsigned int GetPageCount() const { return (unsigned int)pages.size(); }
+	UINT GetUsedVertices() const;
+	UINT GetUsedIndices() const;
+
+	// Worst vertex fragmentation of any page (see RangeAllocator)
+	float GetFragmentation() const;
+
+private:
+	GeometryPool(const GeometryPool&);
+	GeometryPool& operator=(const GeometryPool&);
+
+	struct Page
+	{
+		ID3D11Buffer*		vertexBuffer;
+		ID3D11Buffer*		indexBuffer;
+		RangeAllocator		vertices;
+		RangeAllocator		indices;
+		MemoryHandle		memoryHandle;
+	};
+
+	Page* CreatePage(UINT vertexCount, UINT indexCount);
+
+	ID3D11Device*			device;
+	ID3D11DeviceContext*	context;
+	UINT					pageVertices;
+	UINT					pageIndices;
+	std::vector<Page*>		pages;
+};
@@ -0,0 +1,310 @@
+#include "ImageDecoder.h"
+#include "JobSystem.h"
+#include "JpegDecoder.h"
+#include "PngDecoder.h"
+#include "Profiler.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	inline uint16_t Read16(const unsigned char* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+	inline uint32_t Read32(const unsigned char* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24); }
+
+	// Images bigger than this are assumed to be corrupt headers
+	const uint32_t MaxDimension = 32768;
+
+	// TGA image types
+	const unsigned char TgaTrueColor = 2;
+	const unsigned char TgaGrey = 3;
+	const unsigned char TgaTrueColorRle = 10;
+	const unsigned char TgaGreyRle = 11;
+}
+
+bool ImageDecoder::GetInfo(const void* file, size_t size, ImageInfo& info)
+{
+	const unsigned char* bytes = (const unsigned char*)file;
+	info.type = ImageFileType_Unknown;
+
+	// TGAs have no signature, so the formats that do go first
+	if (JpegDecoder::IsJpeg(bytes, size))
+	{
+		info.type = ImageFileType_Jpeg;
+		info.hasAlpha = false;
+		return JpegDecoder::GetInfo(bytes, size, info.width, info.height);
+	}
+	if (PngDecoder::IsPng(bytes, size))
+	{
+		info.type = ImageFileType_Png;
+		return PngDecoder::GetInfo(bytes, size, info.width, info.height, info.hasAlpha);
+	}
+	if (GetBmpInfo(bytes, size, info))
+		return true;
+	if (GetTgaInfo(bytes, size, info))
+		return true;
+	return false;
+}
+
+bool ImageDecoder::Decode(const void* file, size_t size, void* pixels, size_t rowPitch, JobSystem* jobSystem)
+{
+	ImageInfo info;
+	if (!GetInfo(file, size, info))
+		return false;
+	if (rowPitch == 0)
+		rowPitch = (size_t)info.width * 4;
+
+	const unsigned char* bytes = (const unsigned char*)file;
+	switch (info.type)
+	{
+	case ImageFileType_Bmp:		return DecodeBmp(bytes, size, info, (unsigned char*)pixels, rowPitch);
+	case ImageFileType_Tga:		return DecodeTga(bytes, size, info, (unsigned char*)pixels, rowPitch);
+	case ImageFileType_Jpeg:	return JpegDecoder::Decode(bytes, size, pixels, rowPitch, jobSystem);
+	case ImageFileType_Png:		return PngDecoder::Decode(bytes, size, pixels, rowPitch, jobSystem);
+	default:					return false;
+	}
+}
+
+bool ImageDecoder::Decode(const void* file, size_t size, Image& image, JobSystem* jobSystem)
+{
+	ImageInfo info;
+	if (!GetInfo(file, size, info))
+		return false;
+
+	image.width = info.width;
+	image.height = info.height;
+	image.pixels.resize((size_t)info.width * info.height * 4);
+	return Decode(file, size, image.pixels.data(), 0, jobSystem);
+}
+
+// --------------------------------------------------------
+// Each image is a job, and each also spreads its own rows;
+// jobs waiting on rows run other images meanwhile, so a batch
+// of small images and one of a few big ones both keep every
+// worker busy.
+// --------------------------------------------------------
+bool ImageDecoder::DecodeBatch(ImageDecodeJob* jobs, unsigned int count, JobSystem* jobSystem)
+{
+	PROFILE_SCOPE("ImageDecoder::DecodeBatch");
+
+	auto decode = [jobs, jobSystem](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			ImageDecodeJob& job = jobs[i];
+			job.succeeded = Decode(job.file, job.size, job.pixels, job.rowPitch, jobSystem);
+		}
+	};
+	if (jobSystem)
+		jobSystem->ParallelFor(count, 1, decode);
+	else
+		decode(0, count);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (!jobs[i].succeeded)
+			return false;
+	}
+	return true;
+}
+
+bool ImageDecoder::Load(const char* path, Image& image, JobSystem* jobSystem)
+{
+	std::vector<unsigned char> data;
+	return ReadFile(path, data) && Decode(data.data(), data.size(), image, jobSystem);
+}
+
+bool ImageDecoder::ReadFile(const char* path, std::vector<unsigned char>& data)
+{
+	FILE* file = 0;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path, "rb") != 0)
+		file = 0;
+#else
+	file = fopen(path, "rb");
+#endif
+	if (!file)
+		return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	bool read = size >= 0;
+	if (read)
+	{
+		data.resize((size_t)size);
+		read = fread(data.data(), 1, data.size(), file) == data.size();
+	}
+	fclose(file);
+	return read;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ BMP -----------------------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Only uncompressed files; 32-bit ones may use bitfields as
+// long as they're the usual BGRA layout
+// --------------------------------------------------------
+bool ImageDecoder::GetBmpInfo(const unsigned char* file, size_t size, ImageInfo& info)
+{
+	if (size < 54 || file[0] != 'B' || file[1] != 'M')
+		return false;
+
+	uint32_t headerSize = Read32(file + 14);
+	int32_t width = (int32_t)Read32(file + 18);
+	int32_t height = (int32_t)Read32(file + 22);
+	uint16_t bits = Read16(file + 28);
+	uint32_t compression = Read32(file + 30);
+	if (headerSize < 40 || width <= 0 || height == 0)
+		return false;
+
+	bool supported = (bits == 24 || bits == 32) && compression == 0;
+	bool hasAlpha = false;
+	if (bits == 32 && compression == 3 && size >= 14 + 52)
+	{
+		// Red, green, blue (and alpha, in V3+ headers) masks
+		supported = Read32(file + 54) == 0x00FF0000 && Read32(file + 58) == 0x0000FF00 && Read32(file + 62) == 0x000000FF;
+		hasAlpha = headerSize >= 56 && size >= 14 + 56 && Read32(file + 66) == 0xFF000000;
+	}
+	if (!supported)
+		return false;
+
+	uint32_t rows = (uint32_t)(height < 0 ? -height : height);
+	if ((uint32_t)width > MaxDimension || rows > MaxDimension)
+		return false;
+
+	info.type = ImageFileType_Bmp;
+	info.width = (uint32_t)width;
+	info.height = rows;
+	info.hasAlpha = hasAlpha;
+	return true;
+}
+
+bool ImageDecoder::DecodeBmp(const unsigned char* file, size_t size, const ImageInfo& info, unsigned char* pixels, size_t rowPitch)
+{
+	uint32_t offset = Read32(file + 10);
+	bool bottomUp = (int32_t)Read32(file + 22) > 0;
+	unsigned int bytesPerPixel = Read16(file + 28) / 8;
+
+	// Rows are padded to 4 bytes
+	size_t sourcePitch = ((size_t)info.width * bytesPerPixel + 3) & ~(size_t)3;
+	if (offset > size || size - offset < sourcePitch * info.height)
+		return false;
+
+	for (uint32_t y = 0; y < info.height; y++)
+	{
+		const unsigned char* source = file + offset + sourcePitch * (bottomUp ? info.height - 1 - y : y);
+		unsigned char* dest = pixels + rowPitch * y;
+		for (uint32_t x = 0; x < info.width; x++)
+		{
+			dest[0] = source[2];
+			dest[1] = source[1];
+			dest[2] = source[0];
+			dest[3] = info.hasAlpha ? source[3] : 255;
+			source += bytesPerPixel;
+			dest += 4;
+		}
+	}
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ TGA -----------------------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// TGAs have no magic number, so the header is checked
+// field by field.  Color-mapped files aren't supported.
+// --------------------------------------------------------
+bool ImageDecoder::GetTgaInfo(const unsigned char* file, size_t size, ImageInfo& info)
+{
+	if (size < 18)
+		return false;
+
+	unsigned char colorMapType = file[1];
+	unsigned char imageType = file[2];
+	uint16_t width = Read16(file + 12);
+	uint16_t height = Read16(file + 14);
+	unsigned char bits = file[16];
+	if (colorMapType > 1 || width == 0 || height == 0)
+		return false;
+
+	bool grey = imageType == TgaGrey || imageType == TgaGreyRle;
+	bool color = imageType == TgaTrueColor || imageType == TgaTrueColorRle;
+	if (!(grey && bits == 8) && !(color && (bits == 24 || bits == 32)))
+		return false;
+
+	info.type = ImageFileType_Tga;
+	info.width = width;
+	info.height = height;
+	info.hasAlpha = bits == 32;
+	return true;
+}
+
+bool ImageDecoder::DecodeTga(const unsigned char* file, size_t size, const ImageInfo& info, unsigned char* pixels, size_t rowPitch)
+{
+	unsigned char imageType = file[2];
+	unsigned int bytesPerPixel = file[16] / 8;
+	bool topDown = (file[17] & 0x20) != 0;
+	bool rle = imageType == TgaTrueColorRle || imageType == TgaGreyRle;
+
+	// Skip the image id and any (unused) color map
+	size_t offset = 18 + file[0];
+	if (file[1] == 1)
+		offset += (size_t)Read16(file + 5) * ((file[7] + 7) / 8);
+	if (offset > size)
+		return false;
+
+	const unsigned char* source = file + offset;
+	const unsigned char* end = file + size;
+	size_t pixelCount = (size_t)info.width * info.height;
+
+	// RLE packets may run across rows, so walk the pixels in
+	// file order and work out where each one lands
+	unsigned int runLeft = 0;
+	bool repeating = false;
+	for (size_t i = 0; i < pixelCount; i++)
+	{
+		if (rle && runLeft == 0)
+		{
+			if (source >= end)
+				return false;
+			repeating = (*source & 0x80) != 0;
+			runLeft = (*source & 0x7F) + 1;
+			source++;
+		}
+		if (source + bytesPerPixel > end)
+			return false;
+
+		uint32_t x = (uint32_t)(i % info.width);
+		uint32_t y = (uint32_t)(i / info.width);
+		unsigned char* dest = pixels + rowPitch * (topDown ? y : info.height - 1 - y) + x * 4;
+		if (bytesPerPixel == 1)
+		{
+			dest[0] = dest[1] = dest[2] = source[0];
+			dest[3] = 255;
+		}
+		else
+		{
+			dest[0] = source[2];
+			dest[1] = source[1];
+			dest[2] = source[0];
+			dest[3] = bytesPerPixel == 4 ? source[3] : 255;
+		}
+
+		// A repeat packet reuses its one pixel for the whole run
+		if (rle)
+		{
+			runLeft--;
+			if (!repeating || runLeft == 0)
+				source += bytesPerPixel;
+		}
+		else
+		{
+			source += bytesPerPixel;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class JobSystem;
+
+enum ImageFileType
+{
+	ImageFileType_Unknown,
+	ImageFileType_Bmp,
+	ImageFileType_Tga,
+	ImageFileType_Jpeg,
+	ImageFileType_Png
+};
+
+// --------------------------------------------------------
+// Size of an image, read from its header alone
+// --------------------------------------------------------
+struct ImageInfo
+{
+	ImageFileType	type;
+	uint32_t		width;
+	uint32_t		height;
+	bool			hasAlpha;
+};
+
+// --------------------------------------------------------
+// Decoded RGBA8 pixels, top row first
+// --------------------------------------------------------
+struct Image
+{
+	uint32_t					width;
+	uint32_t					height;
+	std::vector<unsigned char>	pixels;
+};
+
+// --------------------------------------------------------
+// One image of a batch: the file, and where its pixels go
+// --------------------------------------------------------
+struct ImageDecodeJob
+{
+	const void*		file;
+	size_t			size;
+	void*			pixels;			// rowPitch * height bytes
+	size_t			rowPitch;		// 0 means width * 4
+	bool			succeeded;		// Set by DecodeBatch
+};
+
+// --------------------------------------------------------
+// Decodes image files in memory to 8-bit RGBA.
+//
+// Handles uncompressed BMPs (24 and 32-bit), TGAs (8-bit
+// grey, 24 and 32-bit, plain or run-length encoded), and
+// hands JPEGs and PNGs to JpegDecoder and PngDecoder.
+//
+// Decoding goes into memory the caller owns, so callers can
+// decode straight into an upload buffer, or reuse one buffer
+// for many images.  Given a job system, JPEG and PNG decoding
+// spread their rows over it, and DecodeBatch decodes several
+// images at once as well.
+//
+// This file only uses the standard library and the job
+// system, so it also builds on Linux for tools.
+// --------------------------------------------------------
+class ImageDecoder
+{
+public:
+	// Reads just the header.  False if the format isn't supported.
+	static bool GetInfo(const void* file, size_t size, ImageInfo& info);
+
+	// Decodes into pixels, which must hold rowPitch * height bytes.
+	// rowPitch of 0 means width * 4.
+	static bool Decode(const void* file, size_t size, void* pixels, size_t rowPitch = 0, JobSystem* jobSystem = 0);
+
+	// Decodes into an image sized to fit
+	static bool Decode(const void* file, size_t size, Image& image, JobSystem* jobSystem = 0);
+
+	// Decodes every job's image, in parallel if there is a job
+	// system.  Returns true if they all succeeded.
+	static bool DecodeBatch(ImageDecodeJob* jobs, unsigned int count, JobSystem* jobSystem = 0);
+
+	// Reads and decodes a file
+	static bool Load(const char* path, Image& image, JobSystem* jobSystem = 0);
+
+	// Reads a whole file into memory
+	static bool ReadFile(const char* path, std::vector<unsigned char>& data);
+
+private:
+	ImageDecoder();
+
+	static bool GetBmpInfo(const unsigned char* file, size_t size, ImageInfo& info);
+	static bool GetTgaInfo(const unsigned char* file, size_t size, ImageInfo& info);
+	static bool DecodeBmp(const unsigned char* file, size_t size, const ImageInfo& info, unsigned char* pixels, size_t rowPitch);
+	static bool DecodeTga(const unsigned char* file, size_t size, const ImageInfo& info, unsigned char* pixels, size_t rowPitch);
+};
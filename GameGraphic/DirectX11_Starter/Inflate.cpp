@@ -0,0 +1,415 @@
+#include "Inflate.h"
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	// Huffman codes up to this long are found with one lookup
+	const int FastBits = 10;
+
+	const int MaxCodeLength = 15;
+
+	// Symbols in each alphabet
+	const int LiteralCount = 288;
+	const int DistanceCount = 32;
+	const int CodeLengthCount = 19;
+
+	// Length symbols 257-285 and distance symbols 0-29: the
+	// smallest value each codes, and the extra bits after it
+	const uint16_t LengthBase[29] =
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	const uint8_t LengthExtra[29] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+	const uint16_t DistanceBase[30] =
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+	const uint8_t DistanceExtra[30] =
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	// The order code length code lengths are sent in
+	const uint8_t CodeLengthOrder[CodeLengthCount] =
+	{
+		16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+	};
+
+	// --------------------------------------------------------
+	// Reads bits least significant first.  Past the end it
+	// feeds zeros, and Overran() says if any were used.
+	// --------------------------------------------------------
+	class BitReader
+	{
+	public:
+		BitReader(const uint8_t* _data, size_t _size) : data(_data), size(_size), position(0), bits(0), available(0) { }
+
+		uint32_t Peek(int count)
+		{
+			if (available < count)
+				Fill();
+			return (uint32_t)(bits & ((1ull << count) - 1));
+		}
+
+		void Skip(int count)
+		{
+			bits >>= count;
+			available -= count;
+		}
+
+		uint32_t Read(int count)
+		{
+			uint32_t value = Peek(count);
+			Skip(count);
+			return value;
+		}
+
+		// Drops the bits up to the next byte boundary, and gives
+		// back whole bytes still buffered
+		void AlignToByte()
+		{
+			Skip(available & 7);
+			position -= available / 8;
+			bits = 0;
+			available = 0;
+		}
+
+		bool Overran() const { return position > size + 8; }
+
+		const uint8_t*	data;
+		size_t			size;
+		size_t			position;
+
+	private:
+		void Fill()
+		{
+			while (available <= 56)
+			{
+				uint64_t byte = position < size ? data[position] : 0;
+				position++;
+				bits |= byte << available;
+				available += 8;
+			}
+		}
+
+		uint64_t		bits;
+		int				available;
+	};
+
+	// --------------------------------------------------------
+	// A canonical Huffman code.  Short codes come from the
+	// fast table; longer ones are walked one bit at a time.
+	// --------------------------------------------------------
+	struct Huffman
+	{
+		uint16_t	fast[1 << FastBits];		// (length << 9) | symbol, or 0 if longer
+		uint16_t	counts[MaxCodeLength + 1];
+		uint16_t	symbols[LiteralCount];
+
+		bool Build(const uint8_t* lengths, int count)
+		{
+			memset(counts, 0, sizeof(counts));
+			for (int i = 0; i < count; i++)
+				counts[lengths[i]]++;
+			counts[0] = 0;
+
+			// Over-subscribed sets of lengths aren't a code
+			int left = 1;
+			for (int length = 1; length <= MaxCodeLength; length++)
+			{
+				left = (left << 1) - counts[length];
+				if (left < 0)
+					return false;
+			}
+
+			uint16_t offsets[MaxCodeLength + 2];
+			offsets[1] = 0;
+			for (int length = 1; length <= MaxCodeLength; length++)
+				offsets[length + 1] = offsets[length] + counts[length];
+			for (int i = 0; i < count; i++)
+			{
+				if (lengths[i])
+					symbols[offsets[lengths[i]]++] = (uint16_t)i;
+			}
+
+			// Codes are sent most significant bit first, but the
+			// stream is read least significant first, so the table
+			// is indexed by each code reversed
+			memset(fast, 0, sizeof(fast));
+			int code = 0;
+			int k = 0;
+			for (int length = 1; length <= FastBits; length++)
+			{
+				for (int i = 0; i < counts[length]; i++, code++, k++)
+				{
+					int reversed = 0;
+					for (int b = 0; b < length; b++)
+						reversed |= ((code >> b) & 1) << (length - 1 - b);
+					for (int j = reversed; j < (1 << FastBits); j += 1 << length)
+						fast[j] = (uint16_t)((length << 9) | symbols[k]);
+				}
+				code <<= 1;
+			}
+			return true;
+		}
+
+		int Decode(BitReader& reader) const
+		{
+			uint32_t peek = reader.Peek(MaxCodeLength);
+			uint16_t entry = fast[peek & ((1 << FastBits) - 1)];
+			if (entry)
+			{
+				reader.Skip(entry >> 9);
+				return entry & 511;
+			}
+
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (int length = 1; length <= MaxCodeLength; length++)
+			{
+				code |= (peek >> (length - 1)) & 1;
+				int count = counts[length];
+				if (code - first < count)
+				{
+					reader.Skip(length);
+					return symbols[index + code - first];
+				}
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			return -1;
+		}
+	};
+
+	bool InflateBlock(BitReader& reader, const Huffman& literals, const Huffman& distances,
+		uint8_t* dest, size_t destSize, size_t& written)
+	{
+		for (;;)
+		{
+			int symbol = literals.Decode(reader);
+			if (symbol < 0 || reader.Overran())
+				return false;
+			if (symbol < 256)
+			{
+				if (written >= destSize)
+					return false;
+				dest[written++] = (uint8_t)symbol;
+				continue;
+			}
+			if (symbol == 256)
+				return true;
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			size_t length = LengthBase[symbol] + reader.Read(LengthExtra[symbol]);
+
+			int distanceSymbol = distances.Decode(reader);
+			if (distanceSymbol < 0 || distanceSymbol >= 30)
+				return false;
+			size_t distance = DistanceBase[distanceSymbol] + reader.Read(DistanceExtra[distanceSymbol]);
+			if (distance > written || length > destSize - written)
+				return false;
+
+			// Copies may overlap themselves, so byte by byte
+			const uint8_t* from = dest + written - distance;
+			uint8_t* to = dest + written;
+			for (size_t i = 0; i < length; i++)
+				to[i] = from[i];
+			written += length;
+		}
+	}
+
+	bool ReadDynamicCodes(BitReader& reader, Huffman& literals, Huffman& distances)
+	{
+		int literalCount = reader.Read(5) + 257;
+		int distanceCount = reader.Read(5) + 1;
+		int codeLengthCount = reader.Read(4) + 4;
+		if (literalCount > 286 || distanceCount > 30)
+			return false;
+
+		uint8_t lengths[LiteralCount + DistanceCount] = {};
+		for (int i = 0; i < codeLengthCount; i++)
+			lengths[CodeLengthOrder[i]] = (uint8_t)reader.Read(3);
+
+		Huffman codeLengths;
+		if (!codeLengths.Build(lengths, CodeLengthCount))
+			return false;
+
+		// Both sets of lengths are sent as one run-length coded list
+		int total = literalCount + distanceCount;
+		memset(lengths, 0, sizeof(lengths));
+		for (int i = 0; i < total;)
+		{
+			int symbol = codeLengths.Decode(reader);
+			if (symbol < 0 || reader.Overran())
+				return false;
+			if (symbol < 16)
+			{
+				lengths[i++] = (uint8_t)symbol;
+				continue;
+			}
+
+			uint8_t value = 0;
+			int repeat;
+			if (symbol == 16)
+			{
+				if (i == 0)
+					return false;
+				value = lengths[i - 1];
+				repeat = 3 + reader.Read(2);
+			}
+			else if (symbol == 17)
+				repeat = 3 + reader.Read(3);
+			else
+				repeat = 11 + reader.Read(7);
+
+			if (i + repeat > total)
+				return false;
+			while (repeat--)
+				lengths[i++] = value;
+		}
+
+		// A block without an end code can't be decoded
+		if (lengths[256] == 0)
+			return false;
+		return literals.Build(lengths, literalCount) && distances.Build(lengths + literalCount, distanceCount);
+	}
+
+	// The codes of fixed Huffman blocks, built once
+	struct FixedCodes
+	{
+		Huffman	literals;
+		Huffman	distances;
+
+		FixedCodes()
+		{
+			uint8_t lengths[LiteralCount];
+			memset(lengths, 8, 144);
+			memset(lengths + 144, 9, 112);
+			memset(lengths + 256, 7, 24);
+			memset(lengths + 280, 8, 8);
+			literals.Build(lengths, LiteralCount);
+			memset(lengths, 5, DistanceCount);
+			distances.Build(lengths, DistanceCount);
+		}
+	};
+
+	const FixedCodes& GetFixedCodes()
+	{
+		static const FixedCodes codes;
+		return codes;
+	}
+
+	uint32_t Adler32(const uint8_t* data, size_t size)
+	{
+		// 5552 bytes is the most that can be summed before the
+		// 32-bit totals could overflow
+		uint32_t a = 1;
+		uint32_t b = 0;
+		while (size > 0)
+		{
+			size_t count = size < 5552 ? size : 5552;
+			size -= count;
+			while (count--)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+}
+
+bool Inflate::Decompress(const void* source, size_t size, void* dest, size_t destSize)
+{
+	BitReader reader((const uint8_t*)source, size);
+	uint8_t* output = (uint8_t*)dest;
+	size_t written = 0;
+
+	Huffman literals;
+	Huffman distances;
+
+	bool last = false;
+	bool ok = true;
+	while (ok && !last)
+	{
+		last = reader.Read(1) != 0;
+		uint32_t type = reader.Read(2);
+		switch (type)
+		{
+		case 0:
+		{
+			// Stored: a byte count and its complement, then bytes
+			reader.AlignToByte();
+			if (reader.position + 4 > size)
+			{
+				ok = false;
+				break;
+			}
+			const uint8_t* p = reader.data + reader.position;
+			size_t length = p[0] | (p[1] << 8);
+			size_t complement = p[2] | (p[3] << 8);
+			reader.position += 4;
+			if ((length ^ 0xFFFF) != complement || length > size - reader.position || length > destSize - written)
+			{
+				ok = false;
+				break;
+			}
+			memcpy(output + written, reader.data + reader.position, length);
+			reader.position += length;
+			written += length;
+			break;
+		}
+
+		case 1:
+		{
+			const FixedCodes& fixed = GetFixedCodes();
+			ok = InflateBlock(reader, fixed.literals, fixed.distances, output, destSize, written);
+			break;
+		}
+
+		case 2:
+			ok = ReadDynamicCodes(reader, literals, distances) &&
+				InflateBlock(reader, literals, distances, output, destSize, written);
+			break;
+
+		default:
+			ok = false;
+			break;
+		}
+	}
+	return ok && !reader.Overran() && written == destSize;
+}
+
+bool Inflate::DecompressZlib(const void* source, size_t size, void* dest, size_t destSize)
+{
+	const uint8_t* bytes = (const uint8_t*)source;
+	if (size < 6)
+		return false;
+
+	// Deflate only, no preset dictionary, and a valid check value
+	int method = bytes[0] & 15;
+	bool dictionary = (bytes[1] & 0x20) != 0;
+	if (method != 8 || dictionary || ((bytes[0] << 8) | bytes[1]) % 31 != 0)
+		return false;
+
+	if (!Decompress(bytes + 2, size - 6, dest, destSize))
+		return false;
+
+	const uint8_t* trailer = bytes + size - 4;
+	uint32_t expected = ((uint32_t)trailer[0] << 24) | (trailer[1] << 16) | (trailer[2] << 8) | trailer[3];
+	return Adler32((const uint8_t*)dest, destSize) == expected;
+}
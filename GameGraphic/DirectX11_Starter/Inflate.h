@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// Decompression of deflate data (RFC 1951), and of the zlib
+// wrapper around it (RFC 1950) that PNG uses.  Stored, fixed
+// and dynamic Huffman blocks are all supported.
+//
+// Like Lz4, the whole output is decompressed in one go into
+// a buffer the caller sized, and every length and distance is
+// checked, so bad data fails instead of reading or writing out
+// of bounds.
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+class Inflate
+{
+public:
+	// Raw deflate data, which must expand to exactly destSize bytes
+	static bool Decompress(const void* source, size_t size, void* dest, size_t destSize);
+
+	// The same, inside a zlib header and Adler-32 trailer
+	static bool DecompressZlib(const void* source, size_t size, void* dest, size_t destSize);
+
+private:
+	Inflate();
+};
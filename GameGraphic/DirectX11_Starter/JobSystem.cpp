@@ -0,0 +1,509 @@
+#include "JobSystem.h"
+#include "FrameAllocator.h"
+#include "Profiler.h"
+#include <chrono>
+
+// Which thread slot (deque, job pool) the current thread owns
+static thread_local int currentThreadIndex = -1;
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ WORK STEALING QUEUE -------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Constructor - Starts out empty
+// --------------------------------------------------------
+WorkStealingQueue::WorkStealingQueue()
+{
+	top.store(0, std::memory_order_relaxed);
+	bottom.store(0, std::memory_order_relaxed);
+	for (long long i = 0; i < Capacity; i++)
+		buffer[i].store(0, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// Pushes a job onto the bottom (owner thread only)
+//
+// Returns false if the queue is full
+// --------------------------------------------------------
+bool WorkStealingQueue::Push(Job* job)
+{
+	long long b = bottom.load(std::memory_order_relaxed);
+	long long t = top.load(std::memory_order_acquire);
+	if (b - t >= Capacity)
+		return false;
+
+	buffer[b & (Capacity - 1)].store(job, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	bottom.store(b + 1, std::memory_order_relaxed);
+	return true;
+}
+
+// --------------------------------------------------------
+// Pops a job from the bottom (owner thread only)
+// --------------------------------------------------------
+Job* WorkStealingQueue::Pop()
+{
+	long long b = bottom.load(std::memory_order_relaxed) - 1;
+	bottom.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long t = top.load(std::memory_order_relaxed);
+
+	// Empty?
+	if (t > b)
+	{
+		bottom.store(b + 1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	Job* job = buffer[b & (Capacity - 1)].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// Last item - race any thieves for it
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = 0;
+		bottom.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+// --------------------------------------------------------
+// Steals a job from the top (any thread)
+// --------------------------------------------------------
+Job* WorkStealingQueue::Steal()
+{
+	long long t = top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	long long b = bottom.load(std::memory_order_acquire);
+	if (t >= b)
+		return 0;
+
+	Job* job = buffer[t & (Capacity - 1)].load(std::memory_order_relaxed);
+	if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return 0;
+	return job;
+}
+
+bool WorkStealingQueue::IsEmpty() const
+{
+	return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ------ JOB SYSTEM ----------------------------------------------------------
+///////////////////////////////////////////////////////////////////////////////
+
+// --------------------------------------------------------
+// Constructor - No threads until Init()
+// --------------------------------------------------------
+JobSystem::JobSystem()
+	: running(false)
+{
+	liveJobs.store(0);
+	queuedJobs.store(0);
+	sleepingWorkers.store(0);
+	shuttingDown.store(false);
+}
+
+JobSystem::~JobSystem()
+{
+	Shutdown();
+}
+
+// --------------------------------------------------------
+// Creates the per-thread data and starts the workers
+// --------------------------------------------------------
+void JobSystem::Init(unsigned int workerCount)
+{
+	Shutdown();
+
+	if (workerCount == 0)
+	{
+		unsigned int cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? cores - 1 : 1;
+	}
+
+	// Slot 0 is the calling (main) thread, and the slots after
+	// the workers' wait for AttachThread()
+	threads.resize(workerCount + 1 + MaxAttachedThreads);
+	for (unsigned int i = 0; i < threads.size(); i++)
+	{
+		ThreadData* data = new ThreadData();
+		data->pool = new Job[PoolSize];
+		data->poolNext = 0;
+		data->randomState = 0x9E3779B9u * (i + 1);
+		data->attached.store(false, std::memory_order_relaxed);
+		for (unsigned int j = 0; j < PoolSize; j++)
+			data->pool[j].inUse.store(false, std::memory_order_relaxed);
+		threads[i] = data;
+	}
+	currentThreadIndex = 0;
+
+	shuttingDown.store(false);
+	running = true;
+	for (unsigned int i = 1; i <= workerCount; i++)
+		workers.push_back(std::thread(&JobSystem::WorkerLoop, this, (int)i));
+}
+
+// --------------------------------------------------------
+// Claims the first free slot after the workers'.  Ownership
+// of the deque and pool passes with the flag, so a slot can
+// be reused by another thread after a detach.
+// --------------------------------------------------------
+bool JobSystem::AttachThread()
+{
+	if (!running || GetThreadIndex() >= 0)
+		return false;
+
+	for (unsigned int i = workers.size() + 1; i < threads.size(); i++)
+	{
+		bool expected = false;
+		if (threads[i]->attached.compare_exchange_strong(expected, true, std::memory_order_acquire))
+		{
+			currentThreadIndex = (int)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+// --------------------------------------------------------
+// Jobs left in the deque could still be stolen, but running
+// them here means the slot is empty for whoever takes it next
+// --------------------------------------------------------
+void JobSystem::DetachThread()
+{
+	int index = GetThreadIndex();
+	if (index <= (int)workers.size() || index >= (int)threads.size())
+		return;
+
+	ThreadData* data = threads[index];
+	while (Job* job = data->queue.Pop())
+	{
+		queuedJobs.fetch_sub(1);
+		Execute(job);
+	}
+
+	currentThreadIndex = -1;
+	data->attached.store(false, std::memory_order_release);
+}
+
+// --------------------------------------------------------
+// Finishes outstanding work and joins every worker
+// --------------------------------------------------------
+void JobSystem::Shutdown()
+{
+	if (!running)
+		return;
+
+	// Finish everything, including jobs that workers queue for
+	// the main thread meanwhile, so no job outlives the objects
+	// it points at and nobody waits forever
+	while (liveJobs.load(std::memory_order_acquire) > 0)
+	{
+		if (PumpMainThreadJobs() > 0)
+			continue;
+
+		if (Job* job = FindJob(0))
+			Execute(job);
+		else
+			std::this_thread::yield();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepLock);
+		shuttingDown.store(true);
+	}
+	wake.notify_all();
+
+	for (unsigned int i = 0; i < workers.size(); i++)
+		workers[i].join();
+	workers.clear();
+
+	for (unsigned int i = 0; i < threads.size(); i++)
+	{
+		delete[] threads[i]->pool;
+		delete threads[i];
+	}
+	threads.clear();
+
+	running = false;
+	currentThreadIndex = -1;
+}
+
+int JobSystem::GetThreadIndex()
+{
+	return currentThreadIndex;
+}
+
+// --------------------------------------------------------
+// Grabs a job slot from this thread's pool.  Slots are reused
+// round-robin; one still owned by a running job is skipped.
+// Threads without a pool fall back to the heap.
+// --------------------------------------------------------
+Job* JobSystem::AllocateJob()
+{
+	int index = GetThreadIndex();
+	if (index < 0 || index >= (int)threads.size())
+	{
+		Job* job = new Job();
+		job->pooled = false;
+		job->inUse.store(true, std::memory_order_relaxed);
+		return job;
+	}
+
+	ThreadData* data = threads[index];
+	for (unsigned int tries = 0; ; tries++)
+	{
+		Job* job = &data->pool[data->poolNext++ & (PoolSize - 1)];
+		if (!job->inUse.load(std::memory_order_acquire))
+		{
+			job->pooled = true;
+			job->inUse.store(true, std::memory_order_relaxed);
+			return job;
+		}
+
+		// The whole pool is in flight - make progress before retrying
+		if (tries >= PoolSize)
+		{
+			if (Job* other = FindJob(index))
+				Execute(other);
+			tries = 0;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// Queues a job, or parks it on its dependency if that
+// counter hasn't reached zero yet
+// --------------------------------------------------------
+void JobSystem::Submit(Job* job, JobCounter* dependency)
+{
+	if (dependency)
+	{
+		std::lock_guard<std::mutex> lock(dependency->parkedLock);
+		if (dependency->value.load(std::memory_order_acquire) != 0)
+		{
+			dependency->parked.push_back(job);
+			return;
+		}
+	}
+
+	Push(job);
+}
+
+// --------------------------------------------------------
+// Puts a runnable job on this thread's deque (or the shared
+// injection list for foreign threads / a full deque)
+// --------------------------------------------------------
+void JobSystem::Push(Job* job)
+{
+	queuedJobs.fetch_add(1);
+
+	int index = GetThreadIndex();
+	if (index < 0 || index >= (int)threads.size() || !threads[index]->queue.Push(job))
+	{
+		std::lock_guard<std::mutex> lock(injectedLock);
+		injected.push_back(job);
+	}
+
+	WakeWorkers(1);
+}
+
+// --------------------------------------------------------
+// Finds something to run: our own deque first, then steal
+// from a random victim, then the injection list
+// --------------------------------------------------------
+Job* JobSystem::FindJob(int threadIndex)
+{
+	Job* job = 0;
+	unsigned int threadCount = threads.size();
+
+	if (threadIndex >= 0 && threadIndex < (int)threadCount)
+		job = threads[threadIndex]->queue.Pop();
+
+	if (!job && queuedJobs.load(std::memory_order_relaxed) > 0)
+	{
+		// Cheap xorshift so thieves spread out over the victims
+		static thread_local unsigned int foreignRandom = 0x2545F491u;
+		unsigned int& random = (threadIndex >= 0 && threadIndex < (int)threadCount) ?
+			threads[threadIndex]->randomState : foreignRandom;
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+
+		unsigned int start = random % threadCount;
+		for (unsigned int i = 0; i < threadCount && !job; i++)
+		{
+			unsigned int victim = (start + i) % threadCount;
+			if ((int)victim != threadIndex)
+				job = threads[victim]->queue.Steal();
+		}
+
+		if (!job)
+		{
+			std::lock_guard<std::mutex> lock(injectedLock);
+			if (!injected.empty())
+			{
+				job = injected.back();
+				injected.pop_back();
+			}
+		}
+	}
+
+	if (job)
+		queuedJobs.fetch_sub(1);
+	return job;
+}
+
+// --------------------------------------------------------
+// Runs a job and signals its counter
+// --------------------------------------------------------
+void JobSystem::Execute(Job* job)
+{
+	job->function(job);
+	FinishJob(job);
+}
+
+// --------------------------------------------------------
+// Destroys the payload, frees the slot, and decrements the
+// counter - releasing any jobs parked on it at zero
+// --------------------------------------------------------
+void JobSystem::FinishJob(Job* job)
+{
+	JobCounter* counter = job->counter;
+
+	job->destroy(job);
+	if (job->pooled)
+		job->inUse.store(false, std::memory_order_release);
+	else
+		delete job;
+
+	if (!counter)
+	{
+		liveJobs.fetch_sub(1, std::memory_order_release);
+		return;
+	}
+
+	// "busy" keeps waiters from destroying the counter until
+	// we're completely done with it
+	counter->busy.fetch_add(1, std::memory_order_acq_rel);
+	if (counter->value.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		static thread_local std::vector<Job*> released;
+		{
+			std::lock_guard<std::mutex> lock(counter->parkedLock);
+			released.swap(counter->parked);
+		}
+
+		for (unsigned int i = 0; i < released.size(); i++)
+			Push(released[i]);
+		released.clear();
+	}
+	counter->busy.fetch_sub(1, std::memory_order_release);
+	liveJobs.fetch_sub(1, std::memory_order_release);
+}
+
+// --------------------------------------------------------
+// Body of every worker thread
+// --------------------------------------------------------
+void JobSystem::WorkerLoop(int threadIndex)
+{
+	currentThreadIndex = threadIndex;
+	Profiler::SetThreadName("Job Worker");
+
+	unsigned int idleSpins = 0;
+	for (;;)
+	{
+		Job* job = FindJob(threadIndex);
+		if (job)
+		{
+			// Nothing outlives a job in the worker's frame allocator
+			Execute(job);
+			FrameAllocator::ResetThread();
+			idleSpins = 0;
+			continue;
+		}
+
+		if (shuttingDown.load())
+			return;
+
+		// Spin briefly before going to sleep - new work often
+		// arrives within a few microseconds
+		if (++idleSpins < 64)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepLock);
+		sleepingWorkers.fetch_add(1);
+		wake.wait_for(lock, std::chrono::milliseconds(10), [this]
+		{
+			return queuedJobs.load() > 0 || shuttingDown.load();
+		});
+		sleepingWorkers.fetch_sub(1);
+		idleSpins = 0;
+	}
+}
+
+// --------------------------------------------------------
+// Wakes sleeping workers after new jobs were queued
+// --------------------------------------------------------
+void JobSystem::WakeWorkers(unsigned int count)
+{
+	if (sleepingWorkers.load() == 0)
+		return;
+
+	std::lock_guard<std::mutex> lock(sleepLock);
+	if (count == 1)
+		wake.notify_one();
+	else
+		wake.notify_all();
+}
+
+// --------------------------------------------------------
+// Helps run jobs until the counter reaches zero.  The main
+// thread also services its own queue so a worker waiting on
+// main-thread work can't deadlock it.
+// --------------------------------------------------------
+void JobSystem::Wait(JobCounter* counter)
+{
+	int index = GetThreadIndex();
+	while (!counter->IsDone())
+	{
+		if (index == 0 && PumpMainThreadJobs(1) > 0)
+			continue;
+
+		Job* job = FindJob(index);
+		if (job)
+			Execute(job);
+		else
+			std::this_thread::yield();
+	}
+}
+
+// --------------------------------------------------------
+// Runs up to maxJobs queued main-thread jobs, oldest first
+//
+// Returns the number of jobs that ran
+// --------------------------------------------------------
+unsigned int JobSystem::PumpMainThreadJobs(unsigned int maxJobs)
+{
+	unsigned int ran = 0;
+	while (ran < maxJobs)
+	{
+		Job* job = 0;
+		{
+			std::lock_guard<std::mutex> lock(mainThreadLock);
+			if (mainThreadJobs.empty())
+				break;
+			job = mainThreadJobs.front();
+			mainThreadJobs.erase(mainThreadJobs.begin());
+		}
+
+		Execute(job);
+		ran++;
+	}
+	return ran;
+}
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// --------------------------------------------------------
+// A work-stealing job scheduler.
+//
+// Every thread that runs jobs (the main thread plus N workers)
+// owns a lock-free deque.  Threads push and pop at the bottom
+// of their own deque and steal from the top of everyone else's
+// when they run dry.  Jobs report completion through a
+// JobCounter, which can also hold back other jobs until it
+// reaches zero (a dependency).
+//
+// D3D calls that need the immediate context can be queued
+// with RunOnMainThread(); the game loop drains that queue
+// once per frame with PumpMainThreadJobs().
+//
+// Other long-lived threads that queue jobs every frame (the
+// render thread) should AttachThread(), so they get a deque
+// and job pool of their own.  Jobs from threads that aren't
+// attached are heap allocated and go through a shared list.
+//
+// This file only uses the standard library, so the scheduler
+// also builds on Linux for tools.
+// --------------------------------------------------------
+
+class JobSystem;
+struct Job;
+
+// --------------------------------------------------------
+// Counts unfinished jobs.  Incremented when a job is queued,
+// decremented when it finishes.  Jobs that depend on a counter
+// are parked on it and released when it hits zero.
+//
+// A counter should not be reused until it has reached zero.
+// --------------------------------------------------------
+class JobCounter
+{
+public:
+	JobCounter() : value(0), busy(0) { }
+
+	// True once every job has finished AND no finishing thread is
+	// still touching the counter, so it is then safe to destroy
+	bool IsDone() const
+	{
+		return value.load(std::memory_order_acquire) == 0 &&
+			busy.load(std::memory_order_acquire) == 0;
+	}
+
+private:
+	friend class JobSystem;
+	JobCounter(const JobCounter&);
+	JobCounter& operator=(const JobCounter&);
+
+	std::atomic<int>	value;
+	std::atomic<int>	busy;
+	std::mutex			parkedLock;
+	std::vector<Job*>	parked;
+};
+
+// --------------------------------------------------------
+// A single unit of work.  Small callables are stored inline
+// in the payload; bigger ones are boxed on the heap.
+// --------------------------------------------------------
+struct Job
+{
+	static const unsigned int PayloadSize = 64;
+
+	void (*function)(Job* job);
+	void (*destroy)(Job* job);
+	JobCounter*			counter;
+	bool				pooled;		// false if heap allocated by a foreign thread
+	bool				mainThreadOnly;
+	std::atomic<bool>	inUse;		// pooled slot still owned by a live job
+
+	union
+	{
+		unsigned char	payload[PayloadSize];
+		double			payloadAlign;
+		void*			payloadPointer;
+	};
+};
+
+// --------------------------------------------------------
+// Chase-Lev work-stealing deque with a fixed capacity.
+// Only the owning thread may Push() and Pop(); any thread
+// may Steal().
+// --------------------------------------------------------
+class WorkStealingQueue
+{
+public:
+	static const long long Capacity = 4096;
+
+	WorkStealingQueue();
+	bool Push(Job* job);
+	Job* Pop();
+	Job* Steal();
+	bool IsEmpty() const;
+
+private:
+	std::atomic<long long>	top;
+	std::atomic<long long>	bottom;
+	std::atomic<Job*>		buffer[Capacity];
+};
+
+// --------------------------------------------------------
+// The scheduler itself
+// --------------------------------------------------------
+class JobSystem
+{
+public:
+	JobSystem();
+	~JobSystem();
+
+	// Starts the worker threads.  The calling thread becomes the
+	// "main" thread.  workerCount of 0 uses one less than the
+	// number of cores.
+	void Init(unsigned int workerCount = 0);
+
+	// Threads that can be attached at once
+	static const unsigned int MaxAttachedThreads = 4;
+
+	// Gives the calling thread a slot (deque and job pool) of
+	// its own until DetachThread().  False if it isn't running,
+	// every slot is taken, or the thread already has one.
+	bool AttachThread();
+
+	// Runs whatever is left in the calling thread's deque and
+	// gives its slot back.  Call before the thread exits, and
+	// before Shutdown().
+	void DetachThread();
+
+	// Runs every job still queued, parked on a dependency or
+	// waiting for the main thread, then joins the workers.
+	// Call from the main thread.
+	void Shutdown();
+
+	bool IsRunning() { return running; }
+	unsigned int GetWorkerCount() { return workers.size(); }
+
+	// 0 for the main thread, 1..N for workers, N+1 and up for
+	// attached threads, -1 for any other thread
+	int GetThreadIndex();
+
+	// Queues a callable.  counter (optional) is incremented now and
+	// decremented when the job finishes.  dependency (optional)
+	// holds the job back until that counter reaches zero.
+	template<typename F>
+	void Run(F&& f, JobCounter* counter = 0, JobCounter* dependency = 0);
+
+	// Queues a callable that must run on the main thread
+	template<typename F>
+	void RunOnMainThread(F&& f, JobCounter* counter = 0);
+
+	// Splits [0, count) into ranges of grainSize and calls
+	// f(begin, end) for each range on any thread.  Blocks until
+	// every range is done; the caller helps out meanwhile.
+	template<typename F>
+	void ParallelFor(unsigned int count, unsigned int grainSize, F&& f);
+
+	// Runs other jobs until the counter reaches zero
+	void Wait(JobCounter* counter);
+
+	// Runs queued main-thread jobs.  Only call from the main thread.
+	unsigned int PumpMainThreadJobs(unsigned int maxJobs = 0xFFFFFFFF);
+
+private:
+	static const unsigned int PoolSize = 4096;
+
+	struct ThreadData
+	{
+		WorkStealingQueue	queue;
+		Job*				pool;
+		unsigned int		poolNext;
+		unsigned int		randomState;
+		std::atomic<bool>	attached;		// Slots past the workers only
+	};
+
+	template<typename F> static void InvokeInline(Job* job);
+	template<typename F> static void DestroyInline(Job* job);
+	template<typename F> static void InvokeBoxed(Job* job);
+	template<typename F> static void DestroyBoxed(Job* job);
+	template<typename F> Job* CreateJob(F&& f, JobCounter* counter);
+
+	Job* AllocateJob();
+	void Submit(Job* job, JobCounter* dependency);
+	void Push(Job* job);
+	Job* FindJob(int threadIndex);
+	void Execute(Job* job);
+	void FinishJob(Job* job);
+	void WorkerLoop(int threadIndex);
+	void WakeWorkers(unsigned int count);
+
+	bool						running;
+	std::vector<std::thread>	workers;
+	std::vector<ThreadData*>	threads;		// Main thread, workers, then attachable slots
+
+	// Jobs queued by threads that don't own a deque
+	std::mutex					injectedLock;
+	std::vector<Job*>			injected;
+
+	// Jobs that may only run on the main thread
+	std::mutex					mainThreadLock;
+	std::vector<Job*>			mainThreadJobs;
+
+	// Jobs created but not yet finished, wherever they are
+	std::atomic<int>			liveJobs;
+
+	// Sleeping for idle workers
+	std::atomic<int>			queuedJobs;
+	std::atomic<int>			sleepingWorkers;
+	std::mutex					sleepLock;
+	std::condition_variable		wake;
+	std::atomic<bool>			shuttingDown;
+};
+
+// --------------------------------------------------------
+// Template implementation
+// --------------------------------------------------------
+
+template<typename F>
+void JobSystem::InvokeInline(Job* job)
+{
+	(*reinterpret_cast<F*>(job->payload))();
+}
+
+template<typename F>
+void JobSystem::DestroyInline(Job* job)
+{
+	reinterpret_cast<F*>(job->payload)->~F();
+}
+
+template<typename F>
+void JobSystem::InvokeBoxed(Job* job)
+{
+	(*static_cast<F*>(job->payloadPointer))();
+}
+
+template<typename F>
+void JobSystem::DestroyBoxed(Job* job)
+{
+	delete static_cast<F*>(job->payloadPointer);
+}
+
+template<typename F>
+Job* JobSystem::CreateJob(F&& f, JobCounter* counter)
+{
+	typedef typename std::decay<F>::type Callable;
+
+	Job* job = AllocateJob();
+	job->counter = counter;
+	job->mainThreadOnly = false;
+
+	// Store small callables in place to avoid a heap allocation
+	if (sizeof(Callable) <= Job::PayloadSize && alignof(Callable) <= alignof(double))
+	{
+		new (job->payload) Callable(std::forward<F>(f));
+		job->function = &InvokeInline<Callable>;
+		job->destroy = &DestroyInline<Callable>;
+	}
+	else
+	{
+		job->payloadPointer = new Callable(std::forward<F>(f));
+		job->function = &InvokeBoxed<Callable>;
+		job->destroy = &DestroyBoxed<Callable>;
+	}
+
+	if (counter)
+		counter->value.fetch_add(1, std::memory_order_relaxed);
+	liveJobs.fetch_add(1, std::memory_order_relaxed);
+	return job;
+}
+
+template<typename F>
+void JobSystem::Run(F&& f, JobCounter* counter, JobCounter* dependency)
+{
+	// Without workers just run it here
+	if (!running)
+	{
+		if (dependency) Wait(dependency);
+		f();
+		return;
+	}
+
+	Submit(CreateJob(std::forward<F>(f), counter), dependency);
+}
+
+template<typename F>
+void JobSystem::RunOnMainThread(F&& f, JobCounter* counter)
+{
+	// Already on the main thread (or single threaded)?
+	if (!running || GetThreadIndex() == 0)
+	{
+		f();
+		return;
+	}
+
+	Job* job = CreateJob(std::forward<F>(f), counter);
+	job->mainThreadOnly = true;
+
+	std::lock_guard<std::mutex> lock(mainThreadLock);
+	mainThreadJobs.push_back(job);
+}
+
+template<typename F>
+void JobSystem::ParallelFor(unsigned int count, unsigned int grainSize, F&& f)
+{
+	if (count == 0)
+		return;
+	if (grainSize == 0)
+		grainSize = 1;
+
+	// A single range, or nobody to share with
+	if (!running || count <= grainSize)
+	{
+		f(0u, count);
+		return;
+	}
+
+	JobCounter counter;
+	for (unsigned int begin = grainSize; begin < count; begin += grainSize)
+	{
+		unsigned int end = begin + grainSize < count ? begin + grainSize : count;
+		typename std::remove_reference<F>::type* body = &f;
+		Run([body, begin, end]() { (*body)(begin, end); }, &counter);
+	}
+
+	// Do the first range ourselves, then help with the rest
+	f(0u, grainSize);
+	Wait(&counter);
+}
@@ -0,0 +1,895 @@
+#include "JpegDecoder.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define JPEG_DECODER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// Images bigger than this are assumed to be corrupt headers
+	const uint32_t MaxDimension = 32768;
+
+	// Huffman codes up to this long are found with one lookup
+	const int FastBits = 9;
+
+	// Output rows handed to each job
+	const unsigned int RowsPerJob = 16;
+
+	// Where each coefficient of the zig-zag order goes in the
+	// 8x8 block, with spares so a bad run can't index past it
+	const uint8_t ZigZag[64 + 16] =
+	{
+		 0,  1,  8, 16,  9,  2,  3, 10,
+		17, 24, 32, 25, 18, 11,  4,  5,
+		12, 19, 26, 33, 40, 48, 41, 34,
+		27, 20, 13,  6,  7, 14, 21, 28,
+		35, 42, 49, 56, 57, 50, 43, 36,
+		29, 22, 15, 23, 30, 37, 44, 51,
+		58, 59, 52, 45, 38, 31, 39, 46,
+		53, 60, 61, 54, 47, 55, 62, 63,
+		63, 63, 63, 63, 63, 63, 63, 63,
+		63, 63, 63, 63, 63, 63, 63, 63
+	};
+
+	inline uint16_t ReadBig16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+	inline uint8_t Clamp8(int value)
+	{
+		return (uint8_t)(value < 0 ? 0 : (value > 255 ? 255 : value));
+	}
+
+	struct HuffmanTable
+	{
+		uint16_t	fast[1 << FastBits];	// (length << 8) | symbol, or 0 if longer
+		uint8_t		symbols[256];
+		int32_t		maxCode[17];			// Largest code of each length, -1 if none
+		int32_t		symbolOffset[17];		// Code of a length + this = index into symbols
+		bool		defined;
+	};
+
+	bool BuildHuffmanTable(const uint8_t counts[16], const uint8_t* symbols, int symbolCount, HuffmanTable& table)
+	{
+		memset(table.fast, 0, sizeof(table.fast));
+		memcpy(table.symbols, symbols, symbolCount);
+
+		int code = 0;
+		int k = 0;
+		for (int length = 1; length <= 16; length++)
+		{
+			table.symbolOffset[length] = k - code;
+			for (int i = 0; i < counts[length - 1]; i++, code++, k++)
+			{
+				if (length <= FastBits)
+				{
+					int first = code << (FastBits - length);
+					int count = 1 << (FastBits - length);
+					for (int j = 0; j < count; j++)
+						table.fast[first + j] = (uint16_t)((length << 8) | symbols[k]);
+				}
+			}
+			if (code > (1 << length))
+				return false;
+			table.maxCode[length] = counts[length - 1] > 0 ? code - 1 : -1;
+			code <<= 1;
+		}
+		table.defined = true;
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Reads entropy coded bits, most significant first, taking
+	// out the zero byte stuffed after each 0xFF.  Stops at a
+	// marker and feeds zeros from then on.
+	// --------------------------------------------------------
+	class BitReader
+	{
+	public:
+		void Reset(const uint8_t* _data, size_t _size, size_t _position)
+		{
+			data = _data;
+			size = _size;
+			position = _position;
+			bits = 0;
+			available = 0;
+			hitMarker = false;
+		}
+
+		uint32_t Peek16()
+		{
+			if (available < 16)
+				Fill();
+			return (uint32_t)(bits >> 48);
+		}
+
+		void Skip(int count)
+		{
+			bits <<= count;
+			available -= count;
+		}
+
+		int Receive(int count)
+		{
+			if (available < count)
+				Fill();
+			int value = (int)(bits >> (64 - count));
+			Skip(count);
+			return value;
+		}
+
+		// Drops buffered bits and moves past the next restart marker
+		bool Restart()
+		{
+			while (position + 1 < size && !(data[position] == 0xFF && data[position + 1] >= 0xD0 && data[position + 1] <= 0xD7))
+				position++;
+			if (position + 1 >= size)
+				return false;
+			Reset(data, size, position + 2);
+			return true;
+		}
+
+		size_t GetPosition() const { return position; }
+
+	private:
+		void Fill()
+		{
+			while (available <= 56)
+			{
+				uint64_t byte = 0;
+				if (!hitMarker && position < size)
+				{
+					byte = data[position];
+					if (byte != 0xFF)
+						position++;
+					else if (position + 1 < size && data[position + 1] == 0x00)
+						position += 2;
+					else
+					{
+						hitMarker = true;
+						byte = 0;
+					}
+				}
+				bits |= byte << (56 - available);
+				available += 8;
+			}
+		}
+
+		const uint8_t*	data;
+		size_t			size;
+		size_t			position;
+		uint64_t		bits;			// Next bit in the top bit
+		int				available;
+		bool			hitMarker;
+	};
+
+	int DecodeSymbol(BitReader& reader, const HuffmanTable& table)
+	{
+		uint32_t peek = reader.Peek16();
+		uint16_t fast = table.fast[peek >> (16 - FastBits)];
+		if (fast)
+		{
+			reader.Skip(fast >> 8);
+			return fast & 0xFF;
+		}
+		for (int length = FastBits + 1; length <= 16; length++)
+		{
+			int32_t code = (int32_t)(peek >> (16 - length));
+			if (code <= table.maxCode[length])
+			{
+				reader.Skip(length);
+				return table.symbols[code + table.symbolOffset[length]];
+			}
+		}
+		return -1;
+	}
+
+	// Turns count raw bits into a signed value
+	inline int Extend(int value, int count)
+	{
+		return value < (1 << (count - 1)) ? value - (1 << count) + 1 : value;
+	}
+
+	struct Component
+	{
+		int						id;
+		int						h;				// Sampling factors
+		int						v;
+		int						quantTable;
+		int						dcTable;
+		int						acTable;
+		int						predictor;		// Last DC value
+
+		int						width;			// Real samples
+		int						height;
+		int						blocksWide;		// Padded to whole MCUs
+		int						blocksHigh;
+		std::vector<int16_t>	coefficients;	// 64 per block, natural order
+		std::vector<uint8_t>	samples;		// blocksWide * 8 across
+	};
+
+	struct Frame
+	{
+		uint32_t		width;
+		uint32_t		height;
+		int				componentCount;
+		Component		components[3];
+		int				hMax;
+		int				vMax;
+		int				mcusWide;
+		int				mcusHigh;
+		uint16_t		quant[4][64];			// Natural order
+		HuffmanTable	dc[4];
+		HuffmanTable	ac[4];
+		int				restartInterval;
+		int				adobeTransform;			// -1 without an Adobe segment
+	};
+
+	bool ParseFrame(const uint8_t* segment, size_t length, Frame& frame)
+	{
+		if (length < 6 || segment[0] != 8)
+			return false;
+
+		frame.height = ReadBig16(segment + 1);
+		frame.width = ReadBig16(segment + 3);
+		frame.componentCount = segment[5];
+		if (frame.width == 0 || frame.height == 0 || frame.width > MaxDimension || frame.height > MaxDimension ||
+			(frame.componentCount != 1 && frame.componentCount != 3) || length < 6 + 3 * (size_t)frame.componentCount)
+			return false;
+
+		frame.hMax = 1;
+		frame.vMax = 1;
+		for (int i = 0; i < frame.componentCount; i++)
+		{
+			Component& component = frame.components[i];
+			const uint8_t* p = segment + 6 + i * 3;
+			component.id = p[0];
+			component.h = p[1] >> 4;
+			component.v = p[1] & 15;
+			component.quantTable = p[2];
+			if (component.h < 1 || component.h > 2 || component.v < 1 || component.v > 2 || component.quantTable > 3)
+				return false;
+			frame.hMax = std::max(frame.hMax, component.h);
+			frame.vMax = std::max(frame.vMax, component.v);
+		}
+
+		frame.mcusWide = (int)(frame.width + 8 * frame.hMax - 1) / (8 * frame.hMax);
+		frame.mcusHigh = (int)(frame.height + 8 * frame.vMax - 1) / (8 * frame.vMax);
+		for (int i = 0; i < frame.componentCount; i++)
+		{
+			Component& component = frame.components[i];
+			component.width = (int)(frame.width * component.h + frame.hMax - 1) / frame.hMax;
+			component.height = (int)(frame.height * component.v + frame.vMax - 1) / frame.vMax;
+			component.blocksWide = frame.mcusWide * component.h;
+			component.blocksHigh = frame.mcusHigh * component.v;
+		}
+		return true;
+	}
+
+	bool ParseQuantTables(const uint8_t* segment, size_t length, Frame& frame)
+	{
+		while (length > 0)
+		{
+			int precision = segment[0] >> 4;
+			int index = segment[0] & 15;
+			size_t tableSize = 1 + 64 * (precision ? 2 : 1);
+			if (index > 3 || precision > 1 || length < tableSize)
+				return false;
+			for (int i = 0; i < 64; i++)
+				frame.quant[index][ZigZag[i]] = precision ? ReadBig16(segment + 1 + i * 2) : segment[1 + i];
+			segment += tableSize;
+			length -= tableSize;
+		}
+		return true;
+	}
+
+	bool ParseHuffmanTables(const uint8_t* segment, size_t length, Frame& frame)
+	{
+		while (length >= 17)
+		{
+			int tableClass = segment[0] >> 4;
+			int index = segment[0] & 15;
+			int symbolCount = 0;
+			for (int i = 0; i < 16; i++)
+				symbolCount += segment[1 + i];
+			if (tableClass > 1 || index > 3 || symbolCount > 256 || length < 17 + (size_t)symbolCount)
+				return false;
+
+			HuffmanTable& table = tableClass == 0 ? frame.dc[index] : frame.ac[index];
+			if (!BuildHuffmanTable(segment + 1, segment + 17, symbolCount, table))
+				return false;
+			segment += 17 + symbolCount;
+			length -= 17 + symbolCount;
+		}
+		return length == 0;
+	}
+
+	// Coefficients are stored dequantized.  Damaged files can
+	// make them any size, so they're clamped to what the inverse
+	// DCT's arithmetic has room for.
+	inline int16_t Dequantize(int value, uint16_t quant)
+	{
+		int64_t product = (int64_t)value * quant;
+		return (int16_t)(product < -32768 ? -32768 : (product > 32767 ? 32767 : product));
+	}
+
+	bool DecodeBlock(BitReader& reader, const HuffmanTable& dc, const HuffmanTable& ac, const uint16_t* quant,
+		int& predictor, int16_t* coefficients)
+	{
+		int size = DecodeSymbol(reader, dc);
+		if (size < 0 || size > 11)
+			return false;
+		predictor += size ? Extend(reader.Receive(size), size) : 0;
+		coefficients[0] = Dequantize(predictor, quant[0]);
+
+		for (int k = 1; k < 64;)
+		{
+			int symbol = DecodeSymbol(reader, ac);
+			if (symbol < 0)
+				return false;
+
+			int run = symbol >> 4;
+			size = symbol & 15;
+			if (size == 0)
+			{
+				if (run != 15)
+					break;			// End of block
+				k += 16;
+				continue;
+			}
+
+			k += run;
+			if (k > 63)
+				return false;
+			coefficients[ZigZag[k]] = Dequantize(Extend(reader.Receive(size), size), quant[ZigZag[k]]);
+			k++;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Decodes one scan's coefficients.  Returns where the data
+	// after it starts, or 0 on failure.
+	// --------------------------------------------------------
+	size_t DecodeScan(const uint8_t* data, size_t size, size_t position, const uint8_t* header, size_t length, Frame& frame)
+	{
+		int scanCount = header[0];
+		if (scanCount < 1 || scanCount > frame.componentCount || length < 4 + 2 * (size_t)scanCount)
+			return 0;
+
+		Component* scan[3];
+		for (int i = 0; i < scanCount; i++)
+		{
+			int id = header[1 + i * 2];
+			int tables = header[2 + i * 2];
+			scan[i] = 0;
+			for (int c = 0; c < frame.componentCount; c++)
+			{
+				if (frame.components[c].id == id)
+					scan[i] = &frame.components[c];
+			}
+			if (!scan[i])
+				return 0;
+			scan[i]->dcTable = tables >> 4;
+			scan[i]->acTable = tables & 15;
+			if (scan[i]->dcTable > 3 || scan[i]->acTable > 3 || !frame.dc[scan[i]->dcTable].defined || !frame.ac[scan[i]->acTable].defined)
+				return 0;
+			scan[i]->predictor = 0;
+		}
+
+		// Baseline scans cover every coefficient
+		const uint8_t* spectral = header + 1 + scanCount * 2;
+		if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0)
+			return 0;
+
+		// One component on its own is coded block by block,
+		// only over its real size; several are coded in MCUs
+		int mcusWide = frame.mcusWide;
+		int mcusHigh = frame.mcusHigh;
+		if (scanCount == 1)
+		{
+			mcusWide = (scan[0]->width + 7) / 8;
+			mcusHigh = (scan[0]->height + 7) / 8;
+		}
+
+		BitReader reader;
+		reader.Reset(data, size, position);
+		int mcuCount = mcusWide * mcusHigh;
+		for (int mcu = 0; mcu < mcuCount; mcu++)
+		{
+			if (frame.restartInterval > 0 && mcu > 0 && mcu % frame.restartInterval == 0)
+			{
+				if (!reader.Restart())
+					return 0;
+				for (int i = 0; i < scanCount; i++)
+					scan[i]->predictor = 0;
+			}
+
+			int mcuX = mcu % mcusWide;
+			int mcuY = mcu / mcusWide;
+			for (int i = 0; i < scanCount; i++)
+			{
+				Component& component = *scan[i];
+				int blocksH = scanCount == 1 ? 1 : component.h;
+				int blocksV = scanCount == 1 ? 1 : component.v;
+				for (int by = 0; by < blocksV; by++)
+				{
+					for (int bx = 0; bx < blocksH; bx++)
+					{
+						size_t block = (size_t)(mcuY * blocksV + by) * component.blocksWide + mcuX * blocksH + bx;
+						if (!DecodeBlock(reader, frame.dc[component.dcTable], frame.ac[component.acTable], frame.quant[component.quantTable],
+							component.predictor, &component.coefficients[block * 64]))
+							return 0;
+					}
+				}
+			}
+		}
+
+		// On to the next marker that isn't a restart
+		position = reader.GetPosition();
+		while (position + 1 < size && !(data[position] == 0xFF && data[position + 1] != 0 &&
+			!(data[position + 1] >= 0xD0 && data[position + 1] <= 0xD7)))
+			position++;
+		return position;
+	}
+
+	// --------------------------------------------------------
+	// The inverse DCT, in integers.  The same factoring as the
+	// IJG "islow" one, with 12 fractional bits.
+	// --------------------------------------------------------
+	inline int Fix(float x) { return (int)(x * 4096.0f + 0.5f); }
+
+	struct Idct1D
+	{
+		int		x0, x1, x2, x3;
+		int		t0, t1, t2, t3;
+
+		Idct1D(int s0, int s1, int s2, int s3, int s4, int s5, int s6, int s7)
+		{
+			int p1 = (s2 + s6) * Fix(0.5411961f);
+			t2 = p1 + s6 * Fix(-1.847759065f);
+			t3 = p1 + s2 * Fix(0.765366865f);
+			t0 = (s0 + s4) * 4096;
+			t1 = (s0 - s4) * 4096;
+			x0 = t0 + t3;
+			x3 = t0 - t3;
+			x1 = t1 + t2;
+			x2 = t1 - t2;
+
+			int o0 = s7, o1 = s5, o2 = s3, o3 = s1;
+			int p3 = o0 + o2;
+			int p4 = o1 + o3;
+			p1 = o0 + o3;
+			int p2 = o1 + o2;
+			int p5 = (p3 + p4) * Fix(1.175875602f);
+			o0 *= Fix(0.298631336f);
+			o1 *= Fix(2.053119869f);
+			o2 *= Fix(3.072711026f);
+			o3 *= Fix(1.501321110f);
+			p1 = p5 + p1 * Fix(-0.899976223f);
+			p2 = p5 + p2 * Fix(-2.562915447f);
+			p3 *= Fix(-1.961570560f);
+			p4 *= Fix(-0.390180644f);
+			t3 = o3 + p1 + p4;
+			t2 = o2 + p2 + p3;
+			t1 = o1 + p2 + p4;
+			t0 = o0 + p1 + p3;
+		}
+	};
+
+	// Keeps the row pass's arithmetic in 32 bits whatever the
+	// coefficients (real images stay well inside this)
+	inline int ClampColumn(int value)
+	{
+		return value < -65535 ? -65535 : (value > 65535 ? 65535 : value);
+	}
+
+	void InverseDct(const int16_t* coefficients, uint8_t* out, size_t pitch)
+	{
+		int values[64];
+		for (int i = 0; i < 8; i++)
+		{
+			const int16_t* c = coefficients + i;
+
+			// Columns with only a DC term are flat
+			if (c[8] == 0 && c[16] == 0 && c[24] == 0 && c[32] == 0 && c[40] == 0 && c[48] == 0 && c[56] == 0)
+			{
+				int dc = ClampColumn(c[0] * 4);
+				for (int j = 0; j < 8; j++)
+					values[i + j * 8] = dc;
+				continue;
+			}
+
+			Idct1D d(c[0], c[8], c[16], c[24], c[32], c[40], c[48], c[56]);
+			d.x0 += 512; d.x1 += 512; d.x2 += 512; d.x3 += 512;
+			values[i] = ClampColumn((d.x0 + d.t3) >> 10);
+			values[i + 56] = ClampColumn((d.x0 - d.t3) >> 10);
+			values[i + 8] = ClampColumn((d.x1 + d.t2) >> 10);
+			values[i + 48] = ClampColumn((d.x1 - d.t2) >> 10);
+			values[i + 16] = ClampColumn((d.x2 + d.t1) >> 10);
+			values[i + 40] = ClampColumn((d.x2 - d.t1) >> 10);
+			values[i + 24] = ClampColumn((d.x3 + d.t0) >> 10);
+			values[i + 32] = ClampColumn((d.x3 - d.t0) >> 10);
+		}
+
+		for (int i = 0; i < 8; i++, out += pitch)
+		{
+			const int* v = values + i * 8;
+			Idct1D d(v[0], v[1], v[2], v[3], v[4], v[5], v[6], v[7]);
+
+			// Rounding, and the +128 level shift
+			const int bias = 65536 + (128 << 17);
+			d.x0 += bias; d.x1 += bias; d.x2 += bias; d.x3 += bias;
+			out[0] = Clamp8((d.x0 + d.t3) >> 17);
+			out[7] = Clamp8((d.x0 - d.t3) >> 17);
+			out[1] = Clamp8((d.x1 + d.t2) >> 17);
+			out[6] = Clamp8((d.x1 - d.t2) >> 17);
+			out[2] = Clamp8((d.x2 + d.t1) >> 17);
+			out[5] = Clamp8((d.x2 - d.t1) >> 17);
+			out[3] = Clamp8((d.x3 + d.t0) >> 17);
+			out[4] = Clamp8((d.x3 - d.t0) >> 17);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Doubles a row's width, each output 3/4 of its nearest
+	// input and 1/4 of the next nearest, as libjpeg's "fancy"
+	// upsampling does:
+	//   out[2i]     = (3 in[i] + in[i-1] + evenBias) >> shift
+	//   out[2i + 1] = (3 in[i] + in[i+1] + oddBias) >> shift
+	// The ends repeat the edge input.
+	// --------------------------------------------------------
+	void UpsampleRow2(const int16_t* in, int count, uint8_t* out, int evenBias, int oddBias, int shift)
+	{
+		if (count == 1)
+		{
+			out[0] = Clamp8((in[0] * 4 + evenBias) >> shift);
+			out[1] = Clamp8((in[0] * 4 + oddBias) >> shift);
+			return;
+		}
+
+		out[0] = Clamp8((in[0] * 4 + evenBias) >> shift);
+		out[1] = Clamp8((in[0] * 3 + in[1] + oddBias) >> shift);
+
+		int i = 1;
+#ifdef JPEG_DECODER_SSE2
+		__m128i even = _mm_set1_epi16((short)evenBias);
+		__m128i odd = _mm_set1_epi16((short)oddBias);
+		__m128i shiftCount = _mm_cvtsi32_si128(shift);
+		for (; i + 8 < count; i += 8)
+		{
+			__m128i current = _mm_loadu_si128((const __m128i*)(in + i));
+			__m128i previous = _mm_loadu_si128((const __m128i*)(in + i - 1));
+			__m128i next = _mm_loadu_si128((const __m128i*)(in + i + 1));
+			__m128i triple = _mm_add_epi16(current, _mm_add_epi16(current, current));
+			__m128i evens = _mm_srl_epi16(_mm_add_epi16(_mm_add_epi16(triple, previous), even), shiftCount);
+			__m128i odds = _mm_srl_epi16(_mm_add_epi16(_mm_add_epi16(triple, next), odd), shiftCount);
+			__m128i low = _mm_unpacklo_epi16(evens, odds);
+			__m128i high = _mm_unpackhi_epi16(evens, odds);
+			_mm_storeu_si128((__m128i*)(out + i * 2), _mm_packus_epi16(low, high));
+		}
+#endif
+		for (; i < count - 1; i++)
+		{
+			int triple = in[i] * 3;
+			out[i * 2] = Clamp8((triple + in[i - 1] + evenBias) >> shift);
+			out[i * 2 + 1] = Clamp8((triple + in[i + 1] + oddBias) >> shift);
+		}
+
+		int last = count - 1;
+		out[last * 2] = Clamp8((in[last] * 3 + in[last - 1] + evenBias) >> shift);
+		out[last * 2 + 1] = Clamp8((in[last] * 4 + oddBias) >> shift);
+	}
+
+	// --------------------------------------------------------
+	// JFIF YCbCr to RGB, with 14 fractional bits:
+	//   R = Y + 1.402 Cr
+	//   G = Y - 0.344136 Cb - 0.714136 Cr
+	//   B = Y + 1.772 Cb
+	// --------------------------------------------------------
+	const int CrToR = 22970;
+	const int CbToG = -5638;
+	const int CrToG = -11700;
+	const int CbToB = 29032;
+
+	void YCbCrToRgba(const uint8_t* y, const uint8_t* cb, const uint8_t* cr, uint8_t* out, int count)
+	{
+		int i = 0;
+#ifdef JPEG_DECODER_SSE2
+		__m128i zero = _mm_setzero_si128();
+		__m128i center = _mm_set1_epi16(128);
+		__m128i round = _mm_set1_epi32(1 << 13);
+		__m128i toR = _mm_set_epi16(CrToR, 0, CrToR, 0, CrToR, 0, CrToR, 0);
+		__m128i toG = _mm_set_epi16(CrToG, CbToG, CrToG, CbToG, CrToG, CbToG, CrToG, CbToG);
+		__m128i toB = _mm_set_epi16(0, CbToB, 0, CbToB, 0, CbToB, 0, CbToB);
+		__m128i alpha = _mm_set1_epi8((char)0xFF);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i luma = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(y + i)), zero);
+			__m128i blue = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(cb + i)), zero), center);
+			__m128i red = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(cr + i)), zero), center);
+
+			// (Cb, Cr) pairs, so one multiply-add does both terms
+			__m128i pairsLow = _mm_unpacklo_epi16(blue, red);
+			__m128i pairsHigh = _mm_unpackhi_epi16(blue, red);
+			__m128i channels[3];
+			const __m128i* factors[3] = { &toR, &toG, &toB };
+			for (int c = 0; c < 3; c++)
+			{
+				__m128i low = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(pairsLow, *factors[c]), round), 14);
+				__m128i high = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(pairsHigh, *factors[c]), round), 14);
+				channels[c] = _mm_add_epi16(luma, _mm_packs_epi32(low, high));
+			}
+
+			__m128i rg = _mm_unpacklo_epi8(_mm_packus_epi16(channels[0], channels[0]), _mm_packus_epi16(channels[1], channels[1]));
+			__m128i ba = _mm_unpacklo_epi8(_mm_packus_epi16(channels[2], channels[2]), alpha);
+			_mm_storeu_si128((__m128i*)(out + i * 4), _mm_unpacklo_epi16(rg, ba));
+			_mm_storeu_si128((__m128i*)(out + i * 4 + 16), _mm_unpackhi_epi16(rg, ba));
+		}
+#endif
+		for (; i < count; i++)
+		{
+			int blue = cb[i] - 128;
+			int red = cr[i] - 128;
+			out[i * 4 + 0] = Clamp8(y[i] + ((red * CrToR + (1 << 13)) >> 14));
+			out[i * 4 + 1] = Clamp8(y[i] + ((blue * CbToG + red * CrToG + (1 << 13)) >> 14));
+			out[i * 4 + 2] = Clamp8(y[i] + ((blue * CbToB + (1 << 13)) >> 14));
+			out[i * 4 + 3] = 255;
+		}
+	}
+
+	template<typename F>
+	void ForEachRow(JobSystem* jobSystem, unsigned int rows, unsigned int rowsPerJob, F f)
+	{
+		if (jobSystem)
+			jobSystem->ParallelFor(rows, rowsPerJob, f);
+		else
+			f(0u, rows);
+	}
+
+	// --------------------------------------------------------
+	// One component's samples for an output row, at full width
+	// --------------------------------------------------------
+	const uint8_t* GetFullRow(const Frame& frame, const Component& component, int y, uint8_t* buffer, int16_t* sums)
+	{
+		size_t pitch = (size_t)component.blocksWide * 8;
+		int hScale = frame.hMax / component.h;
+		int vScale = frame.vMax / component.v;
+		const uint8_t* row = &component.samples[(size_t)(y / vScale) * pitch];
+		if (hScale == 1 && vScale == 1)
+			return row;
+
+		// Vertically, blend in the nearest other row
+		if (vScale == 2)
+		{
+			int other = (y & 1) ? y / 2 + 1 : y / 2 - 1;
+			other = std::min(std::max(other, 0), component.height - 1);
+			const uint8_t* far = &component.samples[(size_t)other * pitch];
+			for (int x = 0; x < component.width; x++)
+				sums[x] = (int16_t)(row[x] * 3 + far[x]);
+
+			if (hScale == 2)
+			{
+				UpsampleRow2(sums, component.width, buffer, 8, 7, 4);
+				return buffer;
+			}
+			int bias = (y & 1) ? 2 : 1;
+			for (int x = 0; x < component.width; x++)
+				buffer[x] = (uint8_t)((sums[x] + bias) >> 2);
+			return buffer;
+		}
+
+		if (hScale == 2)
+		{
+			for (int x = 0; x < component.width; x++)
+				sums[x] = row[x];
+			UpsampleRow2(sums, component.width, buffer, 1, 2, 2);
+			return buffer;
+		}
+		return row;
+	}
+
+	void WriteRows(const Frame& frame, uint8_t* pixels, size_t rowPitch, unsigned int begin, unsigned int end)
+	{
+		// Wide enough for a doubled row of a padded component
+		size_t bufferSize = (size_t)frame.mcusWide * frame.hMax * 8 + 16;
+		std::vector<uint8_t> buffers(bufferSize * 3);
+		std::vector<int16_t> sums(bufferSize);
+		bool rgb = frame.adobeTransform == 0 ||
+			(frame.componentCount == 3 && frame.components[0].id == 'R' && frame.components[1].id == 'G' && frame.components[2].id == 'B');
+
+		for (unsigned int y = begin; y < end; y++)
+		{
+			uint8_t* out = pixels + y * rowPitch;
+			const uint8_t* rows[3];
+			for (int c = 0; c < frame.componentCount; c++)
+				rows[c] = GetFullRow(frame, frame.components[c], (int)y, &buffers[c * bufferSize], sums.data());
+
+			if (frame.componentCount == 1)
+			{
+				for (uint32_t x = 0; x < frame.width; x++, out += 4)
+				{
+					out[0] = out[1] = out[2] = rows[0][x];
+					out[3] = 255;
+				}
+			}
+			else if (rgb)
+			{
+				for (uint32_t x = 0; x < frame.width; x++, out += 4)
+				{
+					out[0] = rows[0][x];
+					out[1] = rows[1][x];
+					out[2] = rows[2][x];
+					out[3] = 255;
+				}
+			}
+			else
+			{
+				YCbCrToRgba(rows[0], rows[1], rows[2], out, (int)frame.width);
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Walks the markers.  With pixels null, stops after the
+	// frame header.
+	// --------------------------------------------------------
+	bool Parse(const uint8_t* data, size_t size, Frame& frame, uint8_t* pixels, size_t rowPitch, JobSystem* jobSystem)
+	{
+		if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+			return false;
+
+		frame.componentCount = 0;
+		frame.restartInterval = 0;
+		frame.adobeTransform = -1;
+		for (int i = 0; i < 4; i++)
+		{
+			frame.dc[i].defined = false;
+			frame.ac[i].defined = false;
+		}
+
+		bool scanned = false;
+		size_t position = 2;
+		while (position + 4 <= size)
+		{
+			if (data[position] != 0xFF)
+				return false;
+			uint8_t marker = data[position + 1];
+			position += 2;
+			if (marker == 0xFF)
+			{
+				position--;			// Fill byte
+				continue;
+			}
+			if (marker == 0xD9)
+				break;
+			if ((marker >= 0xD0 && marker <= 0xD7) || marker == 0x01)
+				continue;
+
+			size_t length = ReadBig16(data + position);
+			if (length < 2 || position + length > size)
+				return false;
+			const uint8_t* segment = data + position + 2;
+			size_t segmentLength = length - 2;
+
+			switch (marker)
+			{
+			case 0xC0:			// Baseline
+			case 0xC1:			// Extended, Huffman coded
+				if (frame.componentCount != 0 || !ParseFrame(segment, segmentLength, frame))
+					return false;
+				if (!pixels)
+					return true;
+				for (int i = 0; i < frame.componentCount; i++)
+				{
+					Component& component = frame.components[i];
+					component.coefficients.assign((size_t)component.blocksWide * component.blocksHigh * 64, 0);
+				}
+				break;
+
+			case 0xC2: case 0xC3: case 0xC5: case 0xC6: case 0xC7:
+			case 0xC9: case 0xCA: case 0xCB: case 0xCD: case 0xCE: case 0xCF:
+				return false;	// Progressive, lossless or arithmetic coded
+
+			case 0xDB:
+				if (!ParseQuantTables(segment, segmentLength, frame))
+					return false;
+				break;
+
+			case 0xC4:
+				if (!ParseHuffmanTables(segment, segmentLength, frame))
+					return false;
+				break;
+
+			case 0xDD:
+				if (segmentLength < 2)
+					return false;
+				frame.restartInterval = ReadBig16(segment);
+				break;
+
+			case 0xEE:
+				if (segmentLength >= 12 && memcmp(segment, "Adobe", 5) == 0)
+					frame.adobeTransform = segment[11];
+				break;
+
+			case 0xDA:
+			{
+				if (frame.componentCount == 0 || segmentLength < 1)
+					return false;
+				PROFILE_SCOPE("JpegDecoder::DecodeScan");
+				position = DecodeScan(data, size, position + length, segment, segmentLength, frame);
+				if (position == 0)
+					return false;
+				scanned = true;
+				continue;
+			}
+
+			default:
+				break;
+			}
+			position += length;
+		}
+
+		if (frame.componentCount == 0 || !scanned)
+			return false;
+
+		{
+			PROFILE_SCOPE("JpegDecoder::InverseDct");
+			for (int i = 0; i < frame.componentCount; i++)
+			{
+				Component& component = frame.components[i];
+				size_t pitch = (size_t)component.blocksWide * 8;
+				component.samples.resize(pitch * component.blocksHigh * 8);
+				ForEachRow(jobSystem, component.blocksHigh, 4, [&component, pitch](unsigned int begin, unsigned int end)
+				{
+					for (unsigned int by = begin; by < end; by++)
+					{
+						for (int bx = 0; bx < component.blocksWide; bx++)
+						{
+							size_t block = (size_t)by * component.blocksWide + bx;
+							InverseDct(&component.coefficients[block * 64], &component.samples[by * 8 * pitch + bx * 8], pitch);
+						}
+					}
+				});
+				std::vector<int16_t>().swap(component.coefficients);
+			}
+		}
+
+		PROFILE_SCOPE("JpegDecoder::WriteRows");
+		ForEachRow(jobSystem, frame.height, RowsPerJob, [&frame, pixels, rowPitch](unsigned int begin, unsigned int end)
+		{
+			WriteRows(frame, pixels, rowPitch, begin, end);
+		});
+		return true;
+	}
+}
+
+bool JpegDecoder::IsJpeg(const void* file, size_t size)
+{
+	const uint8_t* bytes = (const uint8_t*)file;
+	return size >= 3 && bytes[0] == 0xFF && bytes[1] == 0xD8 && bytes[2] == 0xFF;
+}
+
+bool JpegDecoder::GetInfo(const void* file, size_t size, uint32_t& width, uint32_t& height)
+{
+	Frame frame;
+	if (!Parse((const uint8_t*)file, size, frame, 0, 0, 0))
+		return false;
+	width = frame.width;
+	height = frame.height;
+	return true;
+}
+
+bool JpegDecoder::Decode(const void* file, size_t size, void* pixels, size_t rowPitch, JobSystem* jobSystem)
+{
+	PROFILE_SCOPE("JpegDecoder::Decode");
+
+	// Big, so it goes on the heap
+	std::unique_ptr<Frame> frame(new Frame());
+	return Parse((const uint8_t*)file, size, *frame, (uint8_t*)pixels, rowPitch, jobSystem);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Decodes baseline JPEG files - what cameras and Photoshop
+// save by default - to RGBA8:
+//  - 8-bit Huffman coded, in one scan or one per component
+//  - greyscale, YCbCr, or RGB (marked by an Adobe segment)
+//  - chroma subsampled 2x horizontally and/or vertically,
+//    smoothed the way libjpeg does by default
+//  - restart markers
+// Progressive and arithmetic coded files aren't supported.
+//
+// Huffman decoding is sequential.  The inverse DCT and the
+// upsampling and color conversion after it work on rows, so
+// they are spread over the job system when one is given;
+// upsampling and color conversion use SSE2 where the compiler
+// has it.  Pixels are written straight into the caller's
+// memory.
+//
+// This file only uses the standard library and the job
+// system, so it also builds on Linux for tools.
+// --------------------------------------------------------
+class JpegDecoder
+{
+public:
+	// True if the file starts like a JPEG
+	static bool IsJpeg(const void* file, size_t size);
+
+	// Reads the frame header.  False if the file is damaged or
+	// uses a kind of JPEG this can't decode.
+	static bool GetInfo(const void* file, size_t size, uint32_t& width, uint32_t& height);
+
+	// pixels must hold rowPitch * height bytes
+	static bool Decode(const void* file, size_t size, void* pixels, size_t rowPitch, JobSystem* jobSystem = 0);
+
+private:
+	JpegDecoder();
+};
@@ -0,0 +1,225 @@
+#include "Lz4.h"
+#include <cstdint>
+#include <cstring>
+
+namespace
+{
+	// Limits from the block format: the last 5 bytes are always
+	// literals, and the last match starts 12 or more from the end
+	const size_t LastLiterals = 5;
+	const size_t MatchSearchLimit = 12;
+	const size_t MinMatch = 4;
+	const size_t MaxOffset = 65535;
+
+	const unsigned int HashBits = 12;
+
+	inline uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	inline uint32_t Hash(uint32_t sequence)
+	{
+		return (sequence * 2654435761u) >> (32 - HashBits);
+	}
+
+	// Lengths of 15 or more spill into extra bytes of 255s
+	inline uint8_t* WriteLength(uint8_t* out, size_t length)
+	{
+		while (length >= 255)
+		{
+			*out++ = 255;
+			length -= 255;
+		}
+		*out++ = (uint8_t)length;
+		return out;
+	}
+
+	inline bool ReadLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (in >= end)
+				return false;
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	// Appends one sequence: literals, then a match unless
+	// matchLength is 0 (the final sequence)
+	uint8_t* WriteSequence(uint8_t* out, uint8_t* outEnd, const uint8_t* literals, size_t literalLength,
+		size_t offset, size_t matchLength)
+	{
+		size_t worstCase = 1 + literalLength / 255 + 1 + literalLength + 2 + matchLength / 255 + 1;
+		if ((size_t)(outEnd - out) < worstCase)
+			return 0;
+
+		uint8_t* token = out++;
+		*token = (uint8_t)((literalLength >= 15 ? 15 : literalLength) << 4);
+		if (literalLength >= 15)
+			out = WriteLength(out, literalLength - 15);
+		memcpy(out, literals, literalLength);
+		out += literalLength;
+
+		if (matchLength == 0)
+			return out;
+
+		*out++ = (uint8_t)(offset & 0xFF);
+		*out++ = (uint8_t)(offset >> 8);
+		size_t code = matchLength - MinMatch;
+		*token |= (uint8_t)(code >= 15 ? 15 : code);
+		if (code >= 15)
+			out = WriteLength(out, code - 15);
+		return out;
+	}
+}
+
+size_t Lz4::Compress(const void* source, size_t size, void* dest, size_t capacity)
+{
+	// Nothing is a lone empty token.  Empty buffers may be null,
+	// which even a 0 byte memcpy mustn't see.
+	if (size == 0)
+	{
+		if (capacity == 0)
+			return 0;
+		*(uint8_t*)dest = 0;
+		return 1;
+	}
+
+	const uint8_t* in = (const uint8_t*)source;
+	const uint8_t* end = in + size;
+	uint8_t* out = (uint8_t*)dest;
+	uint8_t* outEnd = out + capacity;
+	const uint8_t* anchor = in;
+
+	if (size > MatchSearchLimit)
+	{
+		// Last position each hashed 4 bytes were seen at
+		uint32_t table[1 << HashBits];
+		memset(table, 0, sizeof(table));
+
+		const uint8_t* matchLimit = end - LastLiterals;
+		const uint8_t* searchLimit = end - MatchSearchLimit;
+		const uint8_t* ip = in + 1;
+		while (ip < searchLimit)
+		{
+			uint32_t sequence = Read32(ip);
+			uint32_t hash = Hash(sequence);
+			const uint8_t* candidate = in + table[hash];
+			table[hash] = (uint32_t)(ip - in);
+
+			if (candidate >= ip || (size_t)(ip - candidate) > MaxOffset || Read32(candidate) != sequence)
+			{
+				// Skip ahead faster the longer nothing has matched
+				ip += 1 + ((ip - anchor) >> 6);
+				continue;
+			}
+
+			// Grow the match backwards into the pending literals
+			while (ip > anchor && candidate > in && ip[-1] == candidate[-1])
+			{
+				ip--;
+				candidate--;
+			}
+
+			const uint8_t* matchEnd = ip + MinMatch;
+			const uint8_t* from = candidate + MinMatch;
+			while (matchEnd < matchLimit && *matchEnd == *from)
+			{
+				matchEnd++;
+				from++;
+			}
+
+			out = WriteSequence(out, outEnd, anchor, ip - anchor, ip - candidate, matchEnd - ip);
+			if (!out)
+				return 0;
+
+			anchor = ip = matchEnd;
+			if (ip - 2 > in && ip < searchLimit)
+				table[Hash(Read32(ip - 2))] = (uint32_t)(ip - 2 - in);
+		}
+	}
+
+	out = WriteSequence(out, outEnd, anchor, end - anchor, 0, 0);
+	return out ? out - (uint8_t*)dest : 0;
+}
+
+bool Lz4::Decompress(const void* source, size_t size, void* dest, size_t destSize)
+{
+	if (size == 0)
+		return false;
+	if (destSize == 0)
+		return size == 1 && *(const uint8_t*)source == 0;
+
+	const uint8_t* in = (const uint8_t*)source;
+	const uint8_t* end = in + size;
+	uint8_t* out = (uint8_t*)dest;
+	uint8_t* outStart = out;
+	uint8_t* outEnd = out + destSize;
+
+	for (;;)
+	{
+		if (in >= end)
+			return false;
+		uint8_t token = *in++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(in, end, literalLength))
+			return false;
+		if (literalLength > (size_t)(end - in) || literalLength > (size_t)(outEnd - out))
+			return false;
+
+		// Short runs are copied 16 bytes at a time when there's
+		// room to overshoot; later writes cover the extra
+		if (literalLength <= 16 && end - in >= 16 && outEnd - out >= 16)
+			memcpy(out, in, 16);
+		else
+			memcpy(out, in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		// The last sequence has no match
+		if (in == end)
+			break;
+
+		if (end - in < 2)
+			return false;
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > (size_t)(out - outStart))
+			return false;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(in, end, matchLength))
+			return false;
+		matchLength += MinMatch;
+		if (matchLength > (size_t)(outEnd - out))
+			return false;
+
+		// Matches may overlap what they write (a repeating run),
+		// which memcpy doesn't allow - but 8 byte steps are safe
+		// as long as the source is at least 8 bytes back
+		const uint8_t* from = out - offset;
+		uint8_t* stop = out + matchLength;
+		if (offset >= 16 && matchLength <= 32 && outEnd - out >= 32)
+		{
+			memcpy(out, from, 16);
+			memcpy(out + 16, from + 16, 16);
+			out = stop;
+			continue;
+		}
+		if (offset >= 8)
+		{
+			for (; out + 8 <= stop; out += 8, from += 8)
+				memcpy(out, from, 8);
+		}
+		while (out < stop)
+			*out++ = *from++;
+	}
+	return out == outEnd;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// Compression in the LZ4 block format - byte-oriented LZ77
+// with no entropy coding, so decompressing runs at memory
+// speed.  The compressor is the single-pass greedy kind:
+// fast, with a lower ratio than zlib.
+//
+// Blocks are interchangeable with other LZ4 implementations'
+// (LZ4_compress_default / LZ4_decompress_safe).
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+class Lz4
+{
+public:
+	// Worst case output size for size bytes of input
+	static size_t GetMaxCompressedSize(size_t size) { return size + size / 255 + 16; }
+
+	// Returns the compressed size, or 0 if it didn't fit in
+	// capacity (GetMaxCompressedSize() always fits)
+	static size_t Compress(const void* source, size_t size, void* dest, size_t capacity);
+
+	// Decompresses a whole block, which must expand to exactly
+	// destSize bytes.  Checks every length and offset, so bad
+	// data fails instead of reading or writing out of bounds.
+	static bool Decompress(const void* source, size_t size, void* dest, size_t destSize);
+
+private:
+	Lz4();
+};
@@ -0,0 +1,116 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = 0;
+	size = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = 0;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+void MappedFile::Prefetch(const void* data, size_t size)
+{
+	const size_t PageSize = 4096;
+	const volatile unsigned char* bytes = (const volatile unsigned char*)data;
+	unsigned char sum = 0;
+	for (size_t i = 0; i < size; i += PageSize)
+		sum += bytes[i];
+	if (size > 0)
+		sum += bytes[size - 1];
+	(void)sum;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		Close();
+		return false;
+	}
+
+	mapping = CreateFileMappingA(file, 0, PAGE_READONLY, 0, 0, 0);
+	if (mapping)
+		data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!data)
+	{
+		Close();
+		return false;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+
+	data = 0;
+	size = 0;
+	mapping = 0;
+	file = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const char* path)
+{
+	Close();
+
+	int descriptor = open(path, O_RDONLY);
+	if (descriptor < 0)
+		return false;
+
+	// The mapping keeps the file alive, so the descriptor can go
+	struct stat info;
+	void* mapped = MAP_FAILED;
+	if (fstat(descriptor, &info) == 0 && info.st_size > 0)
+		mapped = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+	close(descriptor);
+	if (mapped == MAP_FAILED)
+		return false;
+
+	data = (const unsigned char*)mapped;
+	size = (size_t)info.st_size;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data)
+		munmap((void*)data, size);
+	data = 0;
+	size = 0;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+
+// --------------------------------------------------------
+// A read-only file mapped into memory.  Pages are read in by
+// the OS the first time they're touched, so opening even a
+// large file costs nothing up front, and data that is used
+// in place never gets copied.
+//
+// Uses file mapping on Windows and mmap elsewhere, so it
+// also builds on Linux for tools.
+// --------------------------------------------------------
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* path);
+	void Close();
+
+	bool IsOpen() const { return data != 0; }
+	const unsigned char* GetData() const { return data; }
+	size_t GetSize() const { return size; }
+
+	// Touches every page of a range, so the OS reads it in
+	// now rather than when it is first used
+	static void Prefetch(const void* data, size_t size);
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char*	data;
+	size_t					size;
+
+#ifdef _WIN32
+	void*					file;		// HANDLEs, to keep windows.h out of this header
+	void*					mapping;
+#endif
+};
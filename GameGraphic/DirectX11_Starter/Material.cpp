@@ -1,4 +1,5 @@
 #include "Material.h"
+#include "MemoryTracker.h"
 
 
 
@@ -14,6 +15,10 @@ Material::Material(	SimpleVertexShader*			VS = NULL,
 	texture				= TEXTURE;
 	normalMap			= NM;
 	samplerState		= SS;
+	specTexture			= NULL;
+	skyTexture			= NULL;
+	rsState				= NULL;
+	dsState				= NULL;
 }
 
 Material::Material()
@@ -23,6 +28,10 @@ Material::Material()
 	texture = NULL;
 	normalMap = NULL;
 	samplerState = NULL;
+	specTexture = NULL;
+	skyTexture = NULL;
+	rsState = NULL;
+	dsState = NULL;
 }
 
 Material::~Material()
@@ -30,6 +39,10 @@ Material::~Material()
 	//assert(texture);
 	//assert(normalMap);
 	//assert(samplerState);
+	for (unsigned int i = 0; i < sharedTextures.size(); i++)
+		sharedTextures[i].second->RemoveSlot(sharedTextures[i].first);
+	sharedTextures.clear();
+
 	if (texture)
 	{
 		texture->Release();
@@ -42,12 +55,36 @@ Material::~Material()
 		normalMap = NULL;
 	}
 
+	if (specTexture)
+	{
+		specTexture->Release();
+		specTexture = NULL;
+	}
+
+	if (skyTexture)
+	{
+		skyTexture->Release();
+		skyTexture = NULL;
+	}
+
 	
 	if (samplerState)
 	{
 		samplerState->Release();
 		samplerState = NULL;
 	}
+
+	if (rsState)
+	{
+		rsState->Release();
+		rsState = NULL;
+	}
+
+	if (dsState)
+	{
+		dsState->Release();
+		dsState = NULL;
+	}
 }
 
 void Material::SetVertexShader(SimpleVertexShader* VS)
@@ -85,4 +122,57 @@ ID3D11ShaderResourceView* Material::GetTexture()
 ID3D11SamplerState* Material::GetSamplerState()
 {
 	return samplerState;
-}
\ No newline at end of file
+}
+
+void Material::ShareTexture(ID3D11ShaderResourceView** slot, const std::shared_ptr<SharedTexture>& shared)
+{
+	shared->AddSlot(slot);
+	sharedTextures.push_back(std::make_pair(slot, shared));
+}
+
+size_t Material::EstimateTextureMemory(ID3D11ShaderResourceView* srv)
+{
+	if (!srv)
+		return 0;
+
+	ID3D11Resource* resource = NULL;
+	srv->GetResource(&resource);
+	ID3D11Texture2D* texture2D = NULL;
+	HRESULT hr = resource->QueryInterface(__uuidof(ID3D11Texture2D), (void**)&texture2D);
+	resource->Release();
+	if (FAILED(hr))
+		return 0;
+
+	D3D11_TEXTURE2D_DESC desc;
+	texture2D->GetDesc(&desc);
+	texture2D->Release();
+
+	//bits per pixel, per 4x4 block averaged for compressed formats
+	unsigned int bitsPerPixel = 32;
+	bool blockCompressed = false;
+	switch (desc.Format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+		bitsPerPixel = 4; blockCompressed = true; break;
+	case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+		bitsPerPixel = 8; blockCompressed = true; break;
+	case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM:
+		bitsPerPixel = 8; break;
+	case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_B5G6R5_UNORM: case DXGI_FORMAT_B5G5R5A1_UNORM:
+		bitsPerPixel = 16; break;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM: case DXGI_FORMAT_R32G32_FLOAT:
+		bitsPerPixel = 64; break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		bitsPerPixel = 128; break;
+	default:
+		break;
+	}
+
+	return MemoryTracker::EstimateTextureBytes(desc.Width, desc.Height, desc.ArraySize, desc.MipLevels, bitsPerPixel, blockCompressed);
+}
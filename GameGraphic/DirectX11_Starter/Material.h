@@ -1,5 +1,9 @@
 #pragma once
+#include <memory>
+#include <utility>
+#include <vector>
 #include "SimpleShader.h"
+#include "SharedTexture.h"
 class Material
 {
 public:
@@ -21,6 +25,14 @@ public:
 	ID3D11ShaderResourceView* GetTexture();
 	ID3D11SamplerState*		  GetSamplerState();
 
+	// Points one of the view slots below at a shared texture,
+	// which keeps it up to date for as long as the material lives
+	void ShareTexture(ID3D11ShaderResourceView** slot, const std::shared_ptr<SharedTexture>& shared);
+
+	// Estimated video memory behind a 2D texture (or cube) view,
+	// for memory accounting
+	static size_t EstimateTextureMemory(ID3D11ShaderResourceView* srv);
+
 	ID3D11ShaderResourceView*	texture;
 	ID3D11ShaderResourceView*	normalMap;
 	ID3D11ShaderResourceView*	specTexture;
@@ -34,5 +46,7 @@ public:
 private:
 	SimpleVertexShader*			vertexShader;
 	SimplePixelShader*			pixelShader;
+
+	std::vector<std::pair<ID3D11ShaderResourceView**, std::shared_ptr<SharedTexture> > >	sharedTextures;
 };
 
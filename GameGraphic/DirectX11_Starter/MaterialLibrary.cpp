@@ -0,0 +1,218 @@
+#include "MaterialLibrary.h"
+#include "Profiler.h"
+
+namespace
+{
+	template<typename T>
+	void HashValue(ContentHasher& hasher, const T& value)
+	{
+		hasher.Update(&value, sizeof(value));
+	}
+
+	void HashStencilOp(ContentHasher& hasher, const D3D11_DEPTH_STENCILOP_DESC& op)
+	{
+		HashValue(hasher, op.StencilFailOp);
+		HashValue(hasher, op.StencilDepthFailOp);
+		HashValue(hasher, op.StencilPassOp);
+		HashValue(hasher, op.StencilFunc);
+	}
+}
+
+MaterialDesc::MaterialDesc()
+{
+	vertexShader = 0;
+	pixelShader = 0;
+
+	sampler = D3D11_SAMPLER_DESC();
+	sampler.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
+	sampler.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
+	sampler.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
+	sampler.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+	sampler.MaxLOD = D3D11_FLOAT32_MAX;
+
+	hasRasterizerState = false;
+	rasterizer = D3D11_RASTERIZER_DESC();
+	hasDepthStencilState = false;
+	depthStencil = D3D11_DEPTH_STENCIL_DESC();
+}
+
+MaterialLibrary::MaterialLibrary()
+{
+	device = 0;
+	assetLoader = 0;
+	streamer = 0;
+}
+
+MaterialLibrary::~MaterialLibrary()
+{
+	Release();
+}
+
+bool MaterialLibrary::Init(ID3D11Device* _device, AssetLoader* _assetLoader, TextureStreamer* _streamer)
+{
+	device = _device;
+	assetLoader = _assetLoader;
+	streamer = _streamer;
+	return device && assetLoader;
+}
+
+// --------------------------------------------------------
+// Forgets everything.  Textures and materials still held
+// elsewhere stay alive, but later requests load new ones.
+// --------------------------------------------------------
+void MaterialLibrary::Release()
+{
+	materials.Clear();
+	textures.Clear();
+
+	std::lock_guard<std::mutex> lock(hashLock);
+	contentHashes.clear();
+}
+
+// --------------------------------------------------------
+// The placeholder decides how a source image is mipped (as
+// colour or as normals), so it's part of the key.  Missing
+// files fall back to hashing the name.
+// --------------------------------------------------------
+ContentHash MaterialLibrary::GetTextureKey(const std::wstring& path, AssetPlaceholder placeholder)
+{
+	ContentHash hash = 0;
+	bool known = false;
+	{
+		std::lock_guard<std::mutex> lock(hashLock);
+		std::unordered_map<std::wstring, ContentHash>::const_iterator found = contentHashes.find(path);
+		if (found != contentHashes.end())
+		{
+			hash = found->second;
+			known = true;
+		}
+	}
+
+	if (!known)
+	{
+		if (!assetLoader->GetContentHash(path, hash))
+			hash = HashBytes(path.data(), path.size() * sizeof(wchar_t));
+
+		std::lock_guard<std::mutex> lock(hashLock);
+		contentHashes[path] = hash;
+	}
+
+	uint32_t kind = (uint32_t)placeholder;
+	return HashBytes(&kind, sizeof(kind), hash);
+}
+
+std::shared_ptr<SharedTexture> MaterialLibrary::LoadTexture(const std::wstring& path, AssetPlaceholder placeholder)
+{
+	PROFILE_SCOPE("MaterialLibrary::LoadTexture");
+
+	return textures.Acquire(GetTextureKey(path, placeholder), [&]()
+	{
+		// The load keeps the texture alive while it can still
+		// write to it: until the upload, or for as long as the
+		// streamer has it
+		std::shared_ptr<SharedTexture> texture = std::make_shared<SharedTexture>();
+		AssetCallback publish = [texture](AssetState) { texture->Publish(); };
+		if (streamer)
+			streamer->LoadTexture(path, texture->GetLoadTarget(), placeholder, publish);
+		else
+			assetLoader->LoadTexture(path, texture->GetLoadTarget(), placeholder, publish);
+
+		// The placeholder, or the streamer's first mips
+		texture->Publish();
+		return texture;
+	});
+}
+
+// --------------------------------------------------------
+// Hashed field by field, as the depth stencil description
+// has padding in it
+// --------------------------------------------------------
+ContentHash MaterialLibrary::GetMaterialKey(const MaterialDesc& desc)
+{
+	ContentHasher hasher;
+	HashValue(hasher, desc.vertexShader);
+	HashValue(hasher, desc.pixelShader);
+
+	const std::wstring* paths[] = { &desc.texture, &desc.normalMap, &desc.specTexture, &desc.skyTexture };
+	const AssetPlaceholder placeholders[] =
+		{ AssetPlaceholder_White, AssetPlaceholder_FlatNormal, AssetPlaceholder_Black, AssetPlaceholder_Sky };
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		ContentHash key = paths[i]->empty() ? 0 : GetTextureKey(*paths[i], placeholders[i]);
+		HashValue(hasher, key);
+	}
+
+	const D3D11_SAMPLER_DESC& s = desc.sampler;
+	HashValue(hasher, s.Filter);
+	HashValue(hasher, s.AddressU);
+	HashValue(hasher, s.AddressV);
+	HashValue(hasher, s.AddressW);
+	HashValue(hasher, s.MipLODBias);
+	HashValue(hasher, s.MaxAnisotropy);
+	HashValue(hasher, s.ComparisonFunc);
+	HashValue(hasher, s.BorderColor);
+	HashValue(hasher, s.MinLOD);
+	HashValue(hasher, s.MaxLOD);
+
+	HashValue(hasher, desc.hasRasterizerState);
+	if (desc.hasRasterizerState)
+	{
+		const D3D11_RASTERIZER_DESC& r = desc.rasterizer;
+		HashValue(hasher, r.FillMode);
+		HashValue(hasher, r.CullMode);
+		HashValue(hasher, r.FrontCounterClockwise);
+		HashValue(hasher, r.DepthBias);
+		HashValue(hasher, r.DepthBiasClamp);
+		HashValue(hasher, r.SlopeScaledDepthBias);
+		HashValue(hasher, r.DepthClipEnable);
+		HashValue(hasher, r.ScissorEnable);
+		HashValue(hasher, r.MultisampleEnable);
+		HashValue(hasher, r.AntialiasedLineEnable);
+	}
+
+	HashValue(hasher, desc.hasDepthStencilState);
+	if (desc.hasDepthStencilState)
+	{
+		const D3D11_DEPTH_STENCIL_DESC& d = desc.depthStencil;
+		HashValue(hasher, d.DepthEnable);
+		HashValue(hasher, d.DepthWriteMask);
+		HashValue(hasher, d.DepthFunc);
+		HashValue(hasher, d.StencilEnable);
+		HashValue(hasher, d.StencilReadMask);
+		HashValue(hasher, d.StencilWriteMask);
+		HashStencilOp(hasher, d.FrontFace);
+		HashStencilOp(hasher, d.BackFace);
+	}
+
+	return hasher.Finish();
+}
+
+void MaterialLibrary::ShareTexture(Material* material, ID3D11ShaderResourceView** slot, const std::wstring& path, AssetPlaceholder placeholder)
+{
+	if (!path.empty())
+		material->ShareTexture(slot, LoadTexture(path, placeholder));
+}
+
+std::shared_ptr<Material> MaterialLibrary::GetMaterial(const MaterialDesc& desc)
+{
+	PROFILE_SCOPE("MaterialLibrary::GetMaterial");
+
+	return materials.Acquire(GetMaterialKey(desc), [&]()
+	{
+		std::shared_ptr<Material> material = std::make_shared<Material>();
+		if (FAILED(device->CreateSamplerState(&desc.sampler, &material->samplerState)))
+			return std::shared_ptr<Material>();
+		if (desc.hasRasterizerState)
+			device->CreateRasterizerState(&desc.rasterizer, &material->rsState);
+		if (desc.hasDepthStencilState)
+			device->CreateDepthStencilState(&desc.depthStencil, &material->dsState);
+
+		material->SetVertexShader(desc.vertexShader);
+		material->SetPixelShader(desc.pixelShader);
+		ShareTexture(material.get(), &material->texture, desc.texture, AssetPlaceholder_White);
+		ShareTexture(material.get(), &material->normalMap, desc.normalMap, AssetPlaceholder_FlatNormal);
+		ShareTexture(material.get(), &material->specTexture, desc.specTexture, AssetPlaceholder_Black);
+		ShareTexture(material.get(), &material->skyTexture, desc.skyTexture, AssetPlaceholder_Sky);
+		return material;
+	});
+}
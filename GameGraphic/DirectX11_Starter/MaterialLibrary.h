@@ -0,0 +1,98 @@
+#pragma once
+
+#include <d3d11.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "AssetLoader.h"
+#include "Material.h"
+#include "ResourceCache.h"
+#include "SharedTexture.h"
+#include "TextureStreamer.h"
+
+// --------------------------------------------------------
+// Everything that makes up a material.  Texture names are
+// source paths, as given to the asset loader; leave them
+// empty for none.
+// --------------------------------------------------------
+struct MaterialDesc
+{
+	MaterialDesc();
+
+	SimpleVertexShader*			vertexShader;
+	SimplePixelShader*			pixelShader;
+
+	std::wstring				texture;
+	std::wstring				normalMap;
+	std::wstring				specTexture;
+	std::wstring				skyTexture;		// A cube map
+
+	// Wrapped trilinear by default
+	D3D11_SAMPLER_DESC			sampler;
+
+	// Only created when set
+	bool						hasRasterizerState;
+	D3D11_RASTERIZER_DESC		rasterizer;
+	bool						hasDepthStencilState;
+	D3D11_DEPTH_STENCIL_DESC	depthStencil;
+};
+
+// --------------------------------------------------------
+// Loads each texture and builds each material once, however
+// many models ask for them.
+//
+// Textures are keyed by the hash of the data they load from
+// (see AssetLoader::GetContentHash()), so copies of one image
+// under different names load once too.  Materials are keyed
+// by their shaders, their textures' keys and their states.
+// Both live as long as something holds them, and are shared
+// through a ResourceCache, so models can be set up from
+// several threads at once.
+//
+// Textures stream through the texture streamer when there
+// is one, and a shared texture stays with it until it's
+// released, since it writes the texture's view.
+// --------------------------------------------------------
+class MaterialLibrary
+{
+public:
+	MaterialLibrary();
+	~MaterialLibrary();
+
+	// streamer may be null to load every texture whole
+	bool Init(ID3D11Device* device, AssetLoader* assetLoader, TextureStreamer* streamer);
+	void Release();
+
+	// The texture loaded from path, shown as the placeholder
+	// until it arrives
+	std::shared_ptr<SharedTexture> LoadTexture(const std::wstring& path, AssetPlaceholder placeholder);
+
+	// A material matching desc.  Null only if its sampler
+	// can't be created.
+	std::shared_ptr<Material> GetMaterial(const MaterialDesc& desc);
+
+	// Live textures and materials
+	size_t GetTextureCount() const { return textures.GetCount(); }
+	size_t GetMaterialCount() const { return materials.GetCount(); }
+
+private:
+	MaterialLibrary(const MaterialLibrary&);
+	MaterialLibrary& operator=(const MaterialLibrary&);
+
+	ContentHash GetTextureKey(const std::wstring& path, AssetPlaceholder placeholder);
+	ContentHash GetMaterialKey(const MaterialDesc& desc);
+	void ShareTexture(Material* material, ID3D11ShaderResourceView** slot, const std::wstring& path, AssetPlaceholder placeholder);
+
+	ID3D11Device*				device;
+	AssetLoader*				assetLoader;
+	TextureStreamer*			streamer;
+
+	ResourceCache<SharedTexture>	textures;
+	ResourceCache<Material>			materials;
+
+	// Content hashes already worked out, so files without a
+	// recorded hash are only read once
+	std::mutex									hashLock;
+	std::unordered_map<std::wstring, ContentHash>	contentHashes;
+};
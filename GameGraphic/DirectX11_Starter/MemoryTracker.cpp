@@ -0,0 +1,310 @@
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace
+{
+	struct TagState
+	{
+		MemoryTotals	totals;
+		bool			overCpuBudget;
+		bool			overGpuBudget;
+	};
+
+	std::mutex									trackerLock;
+	std::unordered_map<MemoryHandle, MemoryAsset>	assets;
+	TagState									tags[MemoryTag_Count];
+	MemoryHandle								nextHandle = 1;
+
+	void PrintWarning(const char* message)
+	{
+		fputs(message, stderr);
+	}
+
+	MemoryTracker::WarningHandler				warningHandler = PrintWarning;
+
+	const char* tagNames[MemoryTag_Count] =
+	{
+		"Meshes",
+		"Textures",
+		"Shaders",
+		"Audio",
+		"Other",
+	};
+
+	double ToMegabytes(size_t bytes)
+	{
+		return bytes / (1024.0 * 1024.0);
+	}
+
+	// Escapes free text for a JSON string
+	std::string JsonEscape(const std::string& text)
+	{
+		std::string result;
+		for (unsigned int i = 0; i < text.size(); i++)
+		{
+			char c = text[i];
+			if (c == '"' || c == '\\') { result += '\\'; result += c; }
+			else if ((unsigned char)c >= 0x20) result += c;
+		}
+		return result;
+	}
+
+	// --------------------------------------------------------
+	// Compares a tag's totals to its budgets.  Returns the
+	// warning to send, if it just went over one.  Call with
+	// the lock held.
+	// --------------------------------------------------------
+	std::string CheckBudgets(MemoryTag tag)
+	{
+		TagState& state = tags[tag];
+		MemoryTotals& totals = state.totals;
+		totals.peakCpuBytes = std::max(totals.peakCpuBytes, totals.cpuBytes);
+		totals.peakGpuBytes = std::max(totals.peakGpuBytes, totals.gpuBytes);
+
+		bool overCpu = totals.cpuBudget > 0 && totals.cpuBytes > totals.cpuBudget;
+		bool overGpu = totals.gpuBudget > 0 && totals.gpuBytes > totals.gpuBudget;
+
+		std::ostringstream warning;
+		warning.precision(2);
+		warning << std::fixed;
+		if (overCpu && !state.overCpuBudget)
+		{
+			warning << "Memory budget: " << tagNames[tag] << " use " << ToMegabytes(totals.cpuBytes)
+				<< "MB of CPU memory (budget " << ToMegabytes(totals.cpuBudget) << "MB)\n";
+		}
+		if (overGpu && !state.overGpuBudget)
+		{
+			warning << "Memory budget: " << tagNames[tag] << " use " << ToMegabytes(totals.gpuBytes)
+				<< "MB of GPU memory (budget " << ToMegabytes(totals.gpuBudget) << "MB)\n";
+		}
+
+		state.overCpuBudget = overCpu;
+		state.overGpuBudget = overGpu;
+		return warning.str();
+	}
+
+	// Handlers are called outside the lock, so they may use the tracker
+	void Warn(const std::string& warning)
+	{
+		if (warning.empty())
+			return;
+
+		MemoryTracker::WarningHandler handler;
+		{
+			std::lock_guard<std::mutex> lock(trackerLock);
+			handler = warningHandler;
+		}
+		if (handler)
+			handler(warning.c_str());
+	}
+}
+
+MemoryHandle MemoryTracker::Register(MemoryTag tag, const std::string& name, size_t cpuBytes, size_t gpuBytes)
+{
+	std::string warning;
+	MemoryHandle handle;
+	{
+		std::lock_guard<std::mutex> lock(trackerLock);
+		handle = nextHandle++;
+
+		MemoryAsset asset = { handle, tag, name, cpuBytes, gpuBytes };
+		assets[handle] = asset;
+
+		MemoryTotals& totals = tags[tag].totals;
+		totals.cpuBytes += cpuBytes;
+		totals.gpuBytes += gpuBytes;
+		totals.assetCount++;
+		warning = CheckBudgets(tag);
+	}
+
+	Warn(warning);
+	return handle;
+}
+
+void MemoryTracker::Update(MemoryHandle handle, size_t cpuBytes, size_t gpuBytes)
+{
+	std::string warning;
+	{
+		std::lock_guard<std::mutex> lock(trackerLock);
+		std::unordered_map<MemoryHandle, MemoryAsset>::iterator it = assets.find(handle);
+		if (it == assets.end())
+			return;
+
+		MemoryAsset& asset = it->second;
+		MemoryTotals& totals = tags[asset.tag].totals;
+		totals.cpuBytes += cpuBytes - asset.cpuBytes;
+		totals.gpuBytes += gpuBytes - asset.gpuBytes;
+		asset.cpuBytes = cpuBytes;
+		asset.gpuBytes = gpuBytes;
+		warning = CheckBudgets(asset.tag);
+	}
+
+	Warn(warning);
+}
+
+void MemoryTracker::Unregister(MemoryHandle handle)
+{
+	std::lock_guard<std::mutex> lock(trackerLock);
+	std::unordered_map<MemoryHandle, MemoryAsset>::iterator it = assets.find(handle);
+	if (it == assets.end())
+		return;
+
+	MemoryTotals& totals = tags[it->second.tag].totals;
+	totals.cpuBytes -= it->second.cpuBytes;
+	totals.gpuBytes -= it->second.gpuBytes;
+	totals.assetCount--;
+	CheckBudgets(it->second.tag);
+	assets.erase(it);
+}
+
+void MemoryTracker::SetBudget(MemoryTag tag, size_t cpuBytes, size_t gpuBytes)
+{
+	std::string warning;
+	{
+		std::lock_guard<std::mutex> lock(trackerLock);
+		tags[tag].totals.cpuBudget = cpuBytes;
+		tags[tag].totals.gpuBudget = gpuBytes;
+		warning = CheckBudgets(tag);
+	}
+
+	Warn(warning);
+}
+
+void MemoryTracker::SetWarningHandler(WarningHandler handler)
+{
+	std::lock_guard<std::mutex> lock(trackerLock);
+	warningHandler = handler;
+}
+
+MemoryTotals MemoryTracker::GetTotals(MemoryTag tag)
+{
+	std::lock_guard<std::mutex> lock(trackerLock);
+	return tags[tag].totals;
+}
+
+// --------------------------------------------------------
+// Largest first, by CPU plus GPU bytes
+// --------------------------------------------------------
+void MemoryTracker::GetAssets(std::vector<MemoryAsset>& result)
+{
+	result.clear();
+	{
+		std::lock_guard<std::mutex> lock(trackerLock);
+		result.reserve(assets.size());
+		for (std::unordered_map<MemoryHandle, MemoryAsset>::iterator it = assets.begin(); it != assets.end(); ++it)
+			result.push_back(it->second);
+	}
+
+	std::sort(result.begin(), result.end(), [](const MemoryAsset& a, const MemoryAsset& b)
+	{
+		return a.cpuBytes + a.gpuBytes > b.cpuBytes + b.gpuBytes;
+	});
+}
+
+std::string MemoryTracker::FormatReport(unsigned int largestAssets)
+{
+	std::ostringstream outs;
+	outs.precision(2);
+	outs << std::fixed << "Memory            CPU MB (budget)      GPU MB (budget)   assets\n";
+	for (unsigned int t = 0; t < MemoryTag_Count; t++)
+	{
+		MemoryTotals totals = GetTotals((MemoryTag)t);
+		outs << "  " << tagNames[t] << "  "
+			<< ToMegabytes(totals.cpuBytes) << " (" << ToMegabytes(totals.cpuBudget) << ")  "
+			<< ToMegabytes(totals.gpuBytes) << " (" << ToMegabytes(totals.gpuBudget) << ")  "
+			<< totals.assetCount << "\n";
+	}
+
+	std::vector<MemoryAsset> list;
+	GetAssets(list);
+	if (!list.empty())
+		outs << "Largest assets       CPU MB  GPU MB\n";
+	for (unsigned int i = 0; i < list.size() && i < largestAssets; i++)
+	{
+		outs << "  " << list[i].name << " [" << tagNames[list[i].tag] << "]  "
+			<< ToMegabytes(list[i].cpuBytes) << "  " << ToMegabytes(list[i].gpuBytes) << "\n";
+	}
+	return outs.str();
+}
+
+bool MemoryTracker::WriteJsonReport(const char* path)
+{
+	FILE* file = 0;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path, "w") != 0)
+		file = 0;
+#else
+	file = fopen(path, "w");
+#endif
+	if (!file)
+		return false;
+
+	fprintf(file, "{\n  \"tags\": [");
+	for (unsigned int t = 0; t < MemoryTag_Count; t++)
+	{
+		MemoryTotals totals = GetTotals((MemoryTag)t);
+		fprintf(file, "%s\n    { \"name\": \"%s\", \"assets\": %u, \"cpu_bytes\": %llu, \"gpu_bytes\": %llu, "
+			"\"peak_cpu_bytes\": %llu, \"peak_gpu_bytes\": %llu, \"cpu_budget\": %llu, \"gpu_budget\": %llu }",
+			t > 0 ? "," : "",
+			tagNames[t],
+			totals.assetCount,
+			(unsigned long long)totals.cpuBytes,
+			(unsigned long long)totals.gpuBytes,
+			(unsigned long long)totals.peakCpuBytes,
+			(unsigned long long)totals.peakGpuBytes,
+			(unsigned long long)totals.cpuBudget,
+			(unsigned long long)totals.gpuBudget);
+	}
+	fprintf(file, "\n  ],\n  \"assets\": [");
+
+	std::vector<MemoryAsset> list;
+	GetAssets(list);
+	for (unsigned int i = 0; i < list.size(); i++)
+	{
+		fprintf(file, "%s\n    { \"name\": \"%s\", \"tag\": \"%s\", \"cpu_bytes\": %llu, \"gpu_bytes\": %llu }",
+			i > 0 ? "," : "",
+			JsonEscape(list[i].name).c_str(),
+			tagNames[list[i].tag],
+			(unsigned long long)list[i].cpuBytes,
+			(unsigned long long)list[i].gpuBytes);
+	}
+	fprintf(file, "%s]\n}\n", list.empty() ? "" : "\n  ");
+
+	fclose(file);
+	return true;
+}
+
+const char* MemoryTracker::GetTagName(MemoryTag tag)
+{
+	return tagNames[tag];
+}
+
+size_t MemoryTracker::EstimateTextureBytes(unsigned int width, unsigned int height, unsigned int arraySize,
+	unsigned int mipLevels, unsigned int bitsPerPixel, bool blockCompressed)
+{
+	// 0 mip levels means a full chain, as in D3D
+	if (mipLevels == 0)
+	{
+		mipLevels = 1;
+		for (unsigned int size = std::max(width, height); size > 1; size /= 2)
+			mipLevels++;
+	}
+
+	size_t total = 0;
+	for (unsigned int mip = 0; mip < mipLevels; mip++)
+	{
+		size_t w = std::max(width >> mip, 1u);
+		size_t h = std::max(height >> mip, 1u);
+		if (blockCompressed)
+		{
+			w = (w + 3) & ~(size_t)3;
+			h = (h + 3) & ~(size_t)3;
+		}
+		total += w * h * bitsPerPixel / 8;
+	}
+	return total * (arraySize > 0 ? arraySize : 1);
+}
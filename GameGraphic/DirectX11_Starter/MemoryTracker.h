@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// --------------------------------------------------------
+// Who owns a tracked allocation
+// --------------------------------------------------------
+enum MemoryTag
+{
+	MemoryTag_Mesh,
+	MemoryTag_Texture,
+	MemoryTag_Shader,
+	MemoryTag_Audio,
+	MemoryTag_Other,
+
+	MemoryTag_Count
+};
+
+// Identifies one tracked asset.  0 is never a valid handle.
+typedef unsigned int MemoryHandle;
+
+// --------------------------------------------------------
+// One tracked asset
+// --------------------------------------------------------
+struct MemoryAsset
+{
+	MemoryHandle	handle;
+	MemoryTag		tag;
+	std::string		name;
+	size_t			cpuBytes;
+	size_t			gpuBytes;		// Estimated - the driver may pad or compress
+};
+
+// --------------------------------------------------------
+// Totals and budget for one tag
+// --------------------------------------------------------
+struct MemoryTotals
+{
+	size_t			cpuBytes;
+	size_t			gpuBytes;
+	size_t			peakCpuBytes;
+	size_t			peakGpuBytes;
+	unsigned int	assetCount;
+	size_t			cpuBudget;		// 0 = no budget
+	size_t			gpuBudget;
+};
+
+// --------------------------------------------------------
+// Tagged memory accounting.
+//
+// Assets register what they hold on the CPU and (estimated)
+// on the GPU under a tag, update it when it changes, and
+// unregister when they go away.  Each tag can have a CPU and
+// a GPU budget; going over one calls the warning handler once,
+// and again only after dropping back under it.
+//
+// Safe to call from any thread.  Pure bookkeeping - no Windows
+// or D3D dependencies.
+// --------------------------------------------------------
+class MemoryTracker
+{
+public:
+	typedef void (*WarningHandler)(const char* message);
+
+	static MemoryHandle Register(MemoryTag tag, const std::string& name, size_t cpuBytes, size_t gpuBytes);
+	static void Update(MemoryHandle handle, size_t cpuBytes, size_t gpuBytes);
+	static void Unregister(MemoryHandle handle);
+
+	// 0 removes a budget
+	static void SetBudget(MemoryTag tag, size_t cpuBytes, size_t gpuBytes);
+
+	// Defaults to printing to stderr
+	static void SetWarningHandler(WarningHandler handler);
+
+	// --- Reports ---
+	static MemoryTotals GetTotals(MemoryTag tag);
+	static void GetAssets(std::vector<MemoryAsset>& assets);
+
+	// Human readable: a line per tag, then the largest assets
+	static std::string FormatReport(unsigned int largestAssets = 10);
+
+	// Every tag and every asset
+	static bool WriteJsonReport(const char* path);
+
+	static const char* GetTagName(MemoryTag tag);
+
+	// Size of a texture with a full or partial mip chain.
+	// Block compressed formats pass bitsPerPixel for the whole
+	// block averaged per pixel (4 for BC1, 8 for BC2/3) and are
+	// rounded up to 4x4 blocks.
+	static size_t EstimateTextureBytes(unsigned int width, unsigned int height, unsigned int arraySize,
+		unsigned int mipLevels, unsigned int bitsPerPixel, bool blockCompressed);
+};
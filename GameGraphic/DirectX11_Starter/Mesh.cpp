@@ -1,20 +1,30 @@
 #include "Mesh.h"
+#include "Profiler.h"
+#include "RenderStats.h"
 #include<fstream>
 #include<vector>
 
 Mesh::Mesh()
 {
-	pVerticies		= NULL;
-	pIndices		= NULL;
 	device			= NULL;
 	deviceContext	= NULL;
 	vertexBuffer	= NULL;
 	indexBuffer		= NULL;
+	baseVertex		= 0;
+	startIndex		= 0;
+	geometryPool	= NULL;
+	geometry.page	= 0;
+	geometry.vertices.block = 0xFFFFFFFF;
+	geometry.indices.block = 0xFFFFFFFF;
 	VertexNumber	= 0;
 	IndicesNumber	= 0;
+	boundingRadius	= 0.0f;
+	keepCpuCopy		= true;
+	memoryHandle	= 0;
 }
 
 Mesh::Mesh(Vertex* _verticies, int vertexNumber, int* _indices, int indNumber)
+	: Mesh()
 {
 	setVerticies(_verticies, vertexNumber);
 	setIndices(_indices, indNumber);
@@ -22,25 +32,59 @@ Mesh::Mesh(Vertex* _verticies, int vertexNumber, int* _indices, int indNumber)
 }
 
 Mesh::Mesh(char* objFileName)
+	: Mesh()
 {
 	LoadObjFile(objFileName);
 }
 
+Mesh::Mesh(std::vector<Vertex>&& vertices, std::vector<UINT>&& indices, ID3D11Device* _device, ID3D11DeviceContext* _devContext)
+	: Mesh()
+{
+	device = _device;
+	deviceContext = _devContext;
+	SetVertices(std::move(vertices));
+	SetIndices(std::move(indices));
+	CreateBuffer();
+}
+
 void Mesh::LoadObjFile(char* objFileName)
 {
+	PROFILE_SCOPE("Mesh::LoadObjFile");
+	name = objFileName;
+
+	std::vector<Vertex> verts;
+	std::vector<UINT> indices;
+	if (!ParseObjFile(objFileName, verts, indices))
+		return;
+
+	//The mesh takes the vectors over, so nothing is copied.
+	SetVertices(std::move(verts));
+	SetIndices(std::move(indices));
+	CreateBuffer();
+}
+
+// --------------------------------------------------------
+// Reads an OBJ file into vertices (with tangents) and
+// indices.  Touches no D3D state, so it can run on any
+// thread.
+// --------------------------------------------------------
+bool Mesh::ParseObjFile(const char* objFileName, std::vector<Vertex>& verts, std::vector<UINT>& indices)
+{
+	PROFILE_SCOPE("Mesh::ParseObjFile");
+	verts.clear();
+	indices.clear();
+
 	// File input object
 	std::ifstream obj(objFileName); // <-- Replace filename with your parameter
 
 								 // Check for successful open
 	if (!obj.is_open())
-		return;
+		return false;
 
 	// Variables used while reading the file
 	std::vector<XMFLOAT3> positions;     // Positions from the file
 	std::vector<XMFLOAT3> normals;       // Normals from the file
 	std::vector<XMFLOAT2> uvs;           // UVs from the file
-	std::vector<Vertex> verts;           // Verts we're assembling
-	std::vector<UINT> indices;           // Indices of these verts
 	unsigned int vertCounter = 0;        // Count of vertices/indices
 	char chars[100];                     // String for line reading
 
@@ -136,13 +180,12 @@ void Mesh::LoadObjFile(char* objFileName)
 
 	// Close
 	obj.close();
+	if (verts.empty())
+		return false;
 
-	//calculate tangents for normal mapping and create buffer
+	//calculate tangents for normal mapping
 	CalculateTangents(&verts[0], vertCounter, &indices[0], vertCounter);
-	setVerticies(&verts[0], vertCounter);
-	setIndices((int*)&indices[0], vertCounter);
-	CreateBuffer();
-	
+
 	// - At this point, "verts" is a vector of Vertex structs, and can be used
 	//    directly to create a vertex buffer:  &verts[0] is the first vert
 	//
@@ -150,44 +193,94 @@ void Mesh::LoadObjFile(char* objFileName)
 	//    can be used directly for the index buffer: &indices[0] is the first int
 	//
 	// - "vertCounter" is BOTH the number of vertices and the number of indices
+	return true;
 }
 
 Mesh::~Mesh()
 {
-	//free the vertex and index array which were created by Mesh class
-	free(pVerticies);
-	free(pIndices);
 	//set device and deviceContext to NULL, dont release them here
 	device = NULL;
 	deviceContext = NULL;
 	//release the buffer created by Mesh class
 	ReleaseMacro(vertexBuffer);
 	ReleaseMacro(indexBuffer);
+	if (geometryPool)
+		geometryPool->Free(geometry);
+	MemoryTracker::Unregister(memoryHandle);
 }
 
 void Mesh::setVerticies(Vertex* _verticies, int number)
 {
-	//free old space first before store a new array
-	free(pVerticies);
-	//create new space and save the new vertex data
-	pVerticies = (Vertex*)malloc(sizeof(Vertex) * number);
-	memset(pVerticies, 0, sizeof(Vertex) * number);
-	memcpy(pVerticies, _verticies, sizeof(Vertex) * number);
+	//replace the old vertex data with a copy of the new
+	verticies.assign(_verticies, _verticies + number);
 	//save the number of Vertex
 	VertexNumber = number;
+	UpdateMemoryTracking();
 }
 
 void Mesh::setIndices(int* _indices, int number)
 {
-	free(pIndices);
-	pIndices = (int*)malloc(sizeof(int) * number);
-	memset(pIndices, 0, sizeof(int) * number);
-	memcpy(pIndices, _indices, sizeof(int) * number);
+	//same bits either way - the index buffer is R32_UINT
+	const UINT* first = reinterpret_cast<const UINT*>(_indices);
+	indices.assign(first, first + number);
 	IndicesNumber = number;
+	UpdateMemoryTracking();
+}
+
+void Mesh::SetVertices(std::vector<Vertex>&& vertices)
+{
+	verticies = std::move(vertices);
+	VertexNumber = (int)verticies.size();
+	UpdateMemoryTracking();
+}
+
+void Mesh::SetIndices(std::vector<UINT>&& _indices)
+{
+	indices = std::move(_indices);
+	IndicesNumber = (int)indices.size();
+	UpdateMemoryTracking();
+}
+
+void Mesh::SetName(const std::string& _name)
+{
+	name = _name;
+}
+
+void Mesh::SetGeometryPool(GeometryPool* pool)
+{
+	geometryPool = pool;
 }
 
 void Mesh::CreateBuffer()
 {
+	// Measured while the vertices are still on the CPU
+	float radiusSquared = 0.0f;
+	for (int i = 0; i < VertexNumber; i++)
+	{
+		const XMFLOAT3& p = verticies[i].Position;
+		float distanceSquared = p.x * p.x + p.y * p.y + p.z * p.z;
+		if (distanceSquared > radiusSquared)
+			radiusSquared = distanceSquared;
+	}
+	boundingRadius = sqrtf(radiusSquared);
+
+	// Pooled meshes hold a reference to their page's buffers,
+	// so they are released the same way as buffers of their own
+	if (geometryPool && geometryPool->Allocate(verticies.data(), VertexNumber, indices.data(), IndicesNumber, geometry))
+	{
+		vertexBuffer = geometryPool->GetVertexBuffer(geometry.page);
+		indexBuffer = geometryPool->GetIndexBuffer(geometry.page);
+		vertexBuffer->AddRef();
+		indexBuffer->AddRef();
+		baseVertex = geometry.GetBaseVertex();
+		startIndex = geometry.GetStartIndex();
+
+		if (!keepCpuCopy)
+			ReleaseCpuCopy();
+		UpdateMemoryTracking();
+		return;
+	}
+
 	// Create the VERTEX BUFFER description -----------------------------------
 	D3D11_BUFFER_DESC vbd;
 	vbd.Usage = D3D11_USAGE_IMMUTABLE;
@@ -200,7 +293,7 @@ void Mesh::CreateBuffer()
 	// Create the proper struct to hold the initial vertex data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialVertexData;
-	initialVertexData.pSysMem = pVerticies;
+	initialVertexData.pSysMem = verticies.data();
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
@@ -221,22 +314,82 @@ void Mesh::CreateBuffer()
 	// Create the proper struct to hold the initial index data
 	// - This is how we put the initial data into the buffer
 	D3D11_SUBRESOURCE_DATA initialIndexData;
-	initialIndexData.pSysMem = pIndices;
+	initialIndexData.pSysMem = indices.data();
 
 	// Actually create the buffer with the initial data
 	// - Once we do this, we'll NEVER CHANGE THE BUFFER AGAIN
 	HR(device->CreateBuffer(&ibd, &initialIndexData, &indexBuffer));
+
+	// The GPU has its own copy now
+	if (!keepCpuCopy)
+		ReleaseCpuCopy();
+	UpdateMemoryTracking();
+}
+
+void Mesh::SetKeepCpuCopy(bool keep)
+{
+	keepCpuCopy = keep;
+}
+
+void Mesh::ReleaseCpuCopy()
+{
+	//swapping with empty vectors actually frees the memory
+	std::vector<Vertex>().swap(verticies);
+	std::vector<UINT>().swap(indices);
+	UpdateMemoryTracking();
+}
+
+// --------------------------------------------------------
+// Reports the CPU arrays and GPU buffers this mesh holds
+// --------------------------------------------------------
+void Mesh::UpdateMemoryTracking()
+{
+	size_t cpuBytes = sizeof(Vertex) * verticies.capacity() + sizeof(UINT) * indices.capacity();
+
+	// Pooled geometry is counted by the pool
+	size_t gpuBytes = 0;
+	if (!geometry.IsValid())
+	{
+		if (vertexBuffer)	gpuBytes += sizeof(Vertex) * VertexNumber;
+		if (indexBuffer)	gpuBytes += sizeof(int) * IndicesNumber;
+	}
+
+	if (memoryHandle)
+		MemoryTracker::Update(memoryHandle, cpuBytes, gpuBytes);
+	else
+		memoryHandle = MemoryTracker::Register(MemoryTag_Mesh, name.empty() ? "Mesh" : name, cpuBytes, gpuBytes);
 }
 
 void Mesh::DrawMesh()
+{
+	DrawMesh(deviceContext);
+}
+
+void Mesh::DrawMesh(ID3D11DeviceContext* context)
+{
+	MeshBinding unknown = { NULL, NULL };
+	DrawMesh(context, unknown);
+}
+
+void Mesh::DrawMesh(ID3D11DeviceContext* context, MeshBinding& bound)
 {
 	// Set buffers in the input assembler
-	//  - Do this ONCE PER OBJECT you're drawing, since each object might
-	//    have different geometry.
+	//  - Only when they differ from the last draw's - meshes
+	//    sharing a geometry pool page share buffers
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
-	deviceContext->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	deviceContext->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	if (bound.vertexBuffer != vertexBuffer)
+	{
+		context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+		bound.vertexBuffer = vertexBuffer;
+		RenderStats::Add(RenderCounter_GeometryBinds);
+	}
+	if (bound.indexBuffer != indexBuffer)
+	{
+		context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+		bound.indexBuffer = indexBuffer;
+		RenderStats::Add(RenderCounter_GeometryBinds);
+	}
 
 	// Finally do the actual drawing
 	//  - Do this ONCE PER OBJECT you intend to draw
@@ -244,10 +397,13 @@ void Mesh::DrawMesh()
 	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
 	//     vertices in the currently set VERTEX BUFFER
 
-	deviceContext->DrawIndexed(
+	context->DrawIndexed(
 		IndicesNumber,     // The number of indices to use (we could draw a subset if we wanted)
-		0,     // Offset to the first index we want to use
-		0);    // Offset to add to each index when looking up vertices
+		startIndex,     // Offset to the first index we want to use
+		baseVertex);    // Offset to add to each index when looking up vertices
+
+	RenderStats::Add(RenderCounter_DrawCalls);
+	RenderStats::Add(RenderCounter_Triangles, IndicesNumber / 3);
 }
 
 void Mesh::SetD3DDevice(ID3D11Device* _device)
@@ -1,8 +1,22 @@
 #pragma once
 
 #include <d3d11.h>
+#include <string>
+#include <vector>
 #include "Vertex.h"
 #include "DirectXGameCore.h"
+#include "MemoryTracker.h"
+#include "GeometryPool.h"
+
+// --------------------------------------------------------
+// The geometry buffers last bound to a context, so draws
+// that share them (see GeometryPool) can skip rebinding
+// --------------------------------------------------------
+struct MeshBinding
+{
+	ID3D11Buffer*	vertexBuffer;
+	ID3D11Buffer*	indexBuffer;
+};
 
 class Mesh
 {
@@ -12,27 +26,77 @@ public:
 	Mesh(Vertex* _verticies, int vertexNumber, int* _indices, int indNumber);
 	Mesh(char* objFileName);
 	void LoadObjFile(char* objFileName);
+
+	// Just the file parsing part of LoadObjFile, for loading
+	// threads.  Returns false if there was nothing to load.
+	static bool ParseObjFile(const char* objFileName, std::vector<Vertex>& vertices, std::vector<UINT>& indices);
+	void SetName(const std::string& name);
+
+	// Copy the arrays (once)
 	void setVerticies(Vertex* _verticies, int number);
 	void setIndices(int* _indices, int number);
+
+	// Take over the vectors without copying.  The constructor
+	// also creates the buffers.
+	Mesh(std::vector<Vertex>&& vertices, std::vector<UINT>&& indices, ID3D11Device* _device, ID3D11DeviceContext* _devContext);
+	void SetVertices(std::vector<Vertex>&& vertices);
+	void SetIndices(std::vector<UINT>&& indices);
+
 	void CreateBuffer();
+
+	// Meshes given a pool before CreateBuffer() (or
+	// LoadObjFile) put their geometry in it instead of in
+	// buffers of their own
+	void SetGeometryPool(GeometryPool* pool);
+
+	// By default the vertex and index arrays are kept after
+	// CreateBuffer().  Turn this off first (e.g. before
+	// LoadObjFile) for meshes that are never read back.
+	void SetKeepCpuCopy(bool keep);
+	void ReleaseCpuCopy();
+
+	// True once the geometry is on the GPU
+	bool IsLoaded() { return vertexBuffer != NULL; }
+
+	// Distance from the model's origin to its farthest vertex,
+	// found by CreateBuffer()
+	float GetBoundingRadius() { return boundingRadius; }
+
 	void DrawMesh();
+	void DrawMesh(ID3D11DeviceContext* context);
+
+	// Only binds the buffers that differ from what the context
+	// last had bound, and updates the binding
+	void DrawMesh(ID3D11DeviceContext* context, MeshBinding& bound);
 	void SetD3DDevice(ID3D11Device* _device);
 	void SetD3DDevContext(ID3D11DeviceContext* _devContext);
 	ID3D11Device* GetD3DDevice();
 	ID3D11DeviceContext* GetD3DDeviceContext();
 
-	void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
+	static void CalculateTangents(Vertex* verts, int numVerts, unsigned int* indices, int numIndices);
 
 
 private:
-	Vertex*					pVerticies;
-	int*					pIndices;
+	// CPU copies of the geometry (empty once released)
+	std::vector<Vertex>		verticies;
+	std::vector<UINT>		indices;
 	ID3D11Device*           device;
 	ID3D11DeviceContext*    deviceContext;
 	ID3D11Buffer*			vertexBuffer;
 	ID3D11Buffer*			indexBuffer;
+	UINT					baseVertex;		// Where the geometry starts in the buffers
+	UINT					startIndex;
+	GeometryPool*			geometryPool;
+	GeometryAllocation		geometry;
 	int						VertexNumber;
 	int						IndicesNumber;
+	float					boundingRadius;
+
+	// Memory accounting
+	std::string				name;
+	bool					keepCpuCopy;
+	MemoryHandle			memoryHandle;
+	void UpdateMemoryTracking();
 
 	int temp = 0;
 
@@ -0,0 +1,434 @@
+#include "MipGenerator.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define MIP_GENERATOR_SSE
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	// Rows of a level handed to each job
+	const unsigned int RowsPerJob = 4;
+
+	// The Kaiser filter's taps per axis, its half width in
+	// texels of the smaller level, and its shape
+	const int KaiserTaps = 8;
+	const float KaiserWidth = 2.0f;
+	const float KaiserAlpha = 4.0f;
+
+	// Entries in the linear to sRGB table - enough that the
+	// steep part near black still rounds to the right byte
+	const int SrgbTableSize = 16384;
+
+	const float Pi = 3.14159265f;
+
+	// One RGBA texel in float
+#ifdef MIP_GENERATOR_SSE
+	struct Float4
+	{
+		__m128	v;
+	};
+
+	inline Float4 Load4(const float* p) { Float4 r = { _mm_loadu_ps(p) }; return r; }
+	inline void Store4(float* p, Float4 a) { _mm_storeu_ps(p, a.v); }
+	inline Float4 Splat4(float s) { Float4 r = { _mm_set1_ps(s) }; return r; }
+	inline Float4 operator+(Float4 a, Float4 b) { Float4 r = { _mm_add_ps(a.v, b.v) }; return r; }
+	inline Float4 operator*(Float4 a, Float4 b) { Float4 r = { _mm_mul_ps(a.v, b.v) }; return r; }
+#else
+	struct Float4
+	{
+		float	v[4];
+	};
+
+	inline Float4 Load4(const float* p) { Float4 r = { { p[0], p[1], p[2], p[3] } }; return r; }
+	inline void Store4(float* p, Float4 a) { p[0] = a.v[0]; p[1] = a.v[1]; p[2] = a.v[2]; p[3] = a.v[3]; }
+	inline Float4 Splat4(float s) { Float4 r = { { s, s, s, s } }; return r; }
+	inline Float4 operator+(Float4 a, Float4 b) { Float4 r = { { a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3] } }; return r; }
+	inline Float4 operator*(Float4 a, Float4 b) { Float4 r = { { a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3] } }; return r; }
+#endif
+
+	struct ColorTables
+	{
+		float			toLinear[256];
+		unsigned char	toSrgb[SrgbTableSize];
+
+		ColorTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i < SrgbTableSize; i++)
+			{
+				float linear = i / (float)(SrgbTableSize - 1);
+				float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * powf(linear, 1.0f / 2.4f) - 0.055f;
+				toSrgb[i] = (unsigned char)(c * 255.0f + 0.5f);
+			}
+		}
+	};
+
+	const ColorTables& GetColorTables()
+	{
+		static const ColorTables tables;
+		return tables;
+	}
+
+	float BesselI0(float x)
+	{
+		float sum = 1.0f;
+		float term = 1.0f;
+		for (int k = 1; k < 32 && term > sum * 1e-7f; k++)
+		{
+			float factor = x / (2.0f * k);
+			term *= factor * factor;
+			sum += term;
+		}
+		return sum;
+	}
+
+	// The Kaiser windowed sinc, x in texels of the smaller level
+	float Kaiser(float x)
+	{
+		float t = x / KaiserWidth;
+		if (t <= -1.0f || t >= 1.0f)
+			return 0.0f;
+		float window = BesselI0(KaiserAlpha * sqrtf(1.0f - t * t)) / BesselI0(KaiserAlpha);
+		float sinc = x == 0.0f ? 1.0f : sinf(Pi * x) / (Pi * x);
+		return sinc * window;
+	}
+
+	// Weights for halving: for texel x of the smaller level,
+	// tap k reads source texel 2x + k - 3
+	struct KaiserWeights
+	{
+		float	weights[KaiserTaps];
+
+		KaiserWeights()
+		{
+			float total = 0.0f;
+			for (int k = 0; k < KaiserTaps; k++)
+			{
+				weights[k] = Kaiser((k - (KaiserTaps - 1) * 0.5f) * 0.5f);
+				total += weights[k];
+			}
+			for (int k = 0; k < KaiserTaps; k++)
+				weights[k] /= total;
+		}
+	};
+
+	const KaiserWeights& GetKaiserWeights()
+	{
+		static const KaiserWeights weights;
+		return weights;
+	}
+
+	unsigned char ToByte(float value)
+	{
+		return (unsigned char)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	void ToFloat(const unsigned char* source, float* dest, size_t texels, MipContent content)
+	{
+		// Color goes through a table; the rest is scale and bias
+		const float* toLinear = GetColorTables().toLinear;
+		float scale = content == MipContent_NormalMap ? 2.0f / 255.0f : 1.0f / 255.0f;
+		float bias = content == MipContent_NormalMap ? -1.0f : 0.0f;
+		for (size_t i = 0; i < texels; i++, source += 4, dest += 4)
+		{
+			if (content == MipContent_Color)
+			{
+				dest[0] = toLinear[source[0]];
+				dest[1] = toLinear[source[1]];
+				dest[2] = toLinear[source[2]];
+			}
+			else
+			{
+				dest[0] = source[0] * scale + bias;
+				dest[1] = source[1] * scale + bias;
+				dest[2] = source[2] * scale + bias;
+			}
+			dest[3] = source[3] * (1.0f / 255.0f);
+		}
+	}
+
+	void ToBytes(const float* source, unsigned char* dest, size_t texels, MipContent content)
+	{
+		const unsigned char* toSrgb = GetColorTables().toSrgb;
+		for (size_t i = 0; i < texels; i++, source += 4, dest += 4)
+		{
+			switch (content)
+			{
+			case MipContent_Color:
+				for (int c = 0; c < 3; c++)
+					dest[c] = toSrgb[(int)(std::min(std::max(source[c], 0.0f), 1.0f) * (SrgbTableSize - 1) + 0.5f)];
+				break;
+
+			case MipContent_NormalMap:
+			{
+				float length = sqrtf(source[0] * source[0] + source[1] * source[1] + source[2] * source[2]);
+				float normal[3] = { 0.0f, 0.0f, 1.0f };
+				if (length > 1e-6f)
+				{
+					for (int c = 0; c < 3; c++)
+						normal[c] = source[c] / length;
+				}
+				for (int c = 0; c < 3; c++)
+					dest[c] = ToByte(normal[c] * 0.5f + 0.5f);
+				break;
+			}
+
+			default:
+				for (int c = 0; c < 3; c++)
+					dest[c] = ToByte(source[c]);
+				break;
+			}
+			dest[3] = ToByte(source[3]);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Source texels and weights for each texel of one axis
+	// resampled from one size to another.  The filter is
+	// stretched over the larger of the two texel sizes, so
+	// shrinking doesn't alias and growing stays smooth.
+	// --------------------------------------------------------
+	struct ResampleTaps
+	{
+		int					count;		// Per output texel
+		std::vector<int>	first;
+		std::vector<float>	weights;
+
+		ResampleTaps(uint32_t from, uint32_t to, MipFilter filter)
+		{
+			float scale = (float)from / to;
+			float stretch = std::max(scale, 1.0f);
+			float radius = (filter == MipFilter_Kaiser ? KaiserWidth : 1.0f) * stretch;
+			count = (int)ceilf(radius * 2.0f) + 1;
+			first.resize(to);
+			weights.resize((size_t)to * count);
+			for (uint32_t i = 0; i < to; i++)
+			{
+				float center = (i + 0.5f) * scale - 0.5f;
+				first[i] = (int)floorf(center - radius) + 1;
+				float total = 0.0f;
+				for (int k = 0; k < count; k++)
+				{
+					float x = (first[i] + k - center) / stretch;
+					float weight = filter == MipFilter_Kaiser ? Kaiser(x) : std::max(0.0f, 1.0f - fabsf(x));
+					weights[(size_t)i * count + k] = weight;
+					total += weight;
+				}
+				for (int k = 0; k < count; k++)
+					weights[(size_t)i * count + k] /= total;
+			}
+		}
+	};
+
+	template<typename F>
+	void ForEachRow(JobSystem* jobSystem, uint32_t rows, F f)
+	{
+		if (jobSystem)
+			jobSystem->ParallelFor(rows, RowsPerJob, f);
+		else
+			f(0u, rows);
+	}
+}
+
+size_t MipGenerator::GetChainSize(uint32_t width, uint32_t height)
+{
+	size_t size = 0;
+	for (;;)
+	{
+		size += (size_t)width * height * 4;
+		if (width == 1 && height == 1)
+			return size;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+}
+
+uint32_t MipGenerator::GetFilterReach(MipFilter filter)
+{
+	return filter == MipFilter_Kaiser ? KaiserTaps / 2 - 1 : 0;
+}
+
+// --------------------------------------------------------
+// The box filter averages each 2x2 square (repeating the last
+// row or column of odd sizes).  The Kaiser filter runs across
+// then down, clamping at the edges.
+// --------------------------------------------------------
+uint32_t MipGenerator::Generate(unsigned char* chain, uint32_t width, uint32_t height,
+	const MipSettings& settings, JobSystem* jobSystem)
+{
+	PROFILE_SCOPE("MipGenerator::Generate");
+
+	MipContent content = settings.content;
+	const float* kaiser = GetKaiserWeights().weights;
+
+	std::vector<float> current((size_t)width * height * 4);
+	std::vector<float> next;
+	std::vector<float> across;
+	ForEachRow(jobSystem, height, [&](unsigned int begin, unsigned int end)
+	{
+		size_t offset = (size_t)begin * width * 4;
+		ToFloat(chain + offset, &current[offset], (size_t)(end - begin) * width, content);
+	});
+
+	uint32_t levels = 1;
+	unsigned char* dest = chain + (size_t)width * height * 4;
+	while (width > 1 || height > 1)
+	{
+		uint32_t nextWidth = width > 1 ? width / 2 : 1;
+		uint32_t nextHeight = height > 1 ? height / 2 : 1;
+		next.resize((size_t)nextWidth * nextHeight * 4);
+
+		if (settings.filter == MipFilter_Box)
+		{
+			ForEachRow(jobSystem, nextHeight, [&](unsigned int begin, unsigned int end)
+			{
+				for (uint32_t y = begin; y < end; y++)
+				{
+					const float* row0 = &current[(size_t)std::min(y * 2, height - 1) * width * 4];
+					const float* row1 = &current[(size_t)std::min(y * 2 + 1, height - 1) * width * 4];
+					float* out = &next[(size_t)y * nextWidth * 4];
+					for (uint32_t x = 0; x < nextWidth; x++)
+					{
+						size_t left = (size_t)std::min(x * 2, width - 1) * 4;
+						size_t right = (size_t)std::min(x * 2 + 1, width - 1) * 4;
+						Float4 sum = Load4(row0 + left) + Load4(row0 + right) + Load4(row1 + left) + Load4(row1 + right);
+						Store4(out + x * 4, sum * Splat4(0.25f));
+					}
+					ToBytes(out, dest + (size_t)y * nextWidth * 4, nextWidth, content);
+				}
+			});
+		}
+		else
+		{
+			// Across every source row...
+			across.resize((size_t)nextWidth * height * 4);
+			ForEachRow(jobSystem, height, [&](unsigned int begin, unsigned int end)
+			{
+				for (uint32_t y = begin; y < end; y++)
+				{
+					const float* row = &current[(size_t)y * width * 4];
+					float* out = &across[(size_t)y * nextWidth * 4];
+					for (uint32_t x = 0; x < nextWidth; x++)
+					{
+						if (width == 1)
+						{
+							Store4(out + x * 4, Load4(row));
+							continue;
+						}
+						Float4 sum = Splat4(0.0f);
+						for (int k = 0; k < KaiserTaps; k++)
+						{
+							int source = std::min(std::max((int)(x * 2) + k - KaiserTaps / 2 + 1, 0), (int)width - 1);
+							sum = sum + Load4(row + source * 4) * Splat4(kaiser[k]);
+						}
+						Store4(out + x * 4, sum);
+					}
+				}
+			});
+
+			// ...then down
+			ForEachRow(jobSystem, nextHeight, [&](unsigned int begin, unsigned int end)
+			{
+				for (uint32_t y = begin; y < end; y++)
+				{
+					float* out = &next[(size_t)y * nextWidth * 4];
+					for (uint32_t x = 0; x < nextWidth; x++)
+					{
+						if (height == 1)
+						{
+							Store4(out + x * 4, Load4(&across[(size_t)x * 4]));
+							continue;
+						}
+						Float4 sum = Splat4(0.0f);
+						for (int k = 0; k < KaiserTaps; k++)
+						{
+							int source = std::min(std::max((int)(y * 2) + k - KaiserTaps / 2 + 1, 0), (int)height - 1);
+							sum = sum + Load4(&across[((size_t)source * nextWidth + x) * 4]) * Splat4(kaiser[k]);
+						}
+						Store4(out + x * 4, sum);
+					}
+					ToBytes(out, dest + (size_t)y * nextWidth * 4, nextWidth, content);
+				}
+			});
+		}
+
+		dest += (size_t)nextWidth * nextHeight * 4;
+		current.swap(next);
+		width = nextWidth;
+		height = nextHeight;
+		levels++;
+	}
+	return levels;
+}
+
+// --------------------------------------------------------
+// Across then down, like the Kaiser halving, clamping at the
+// edges
+// --------------------------------------------------------
+void MipGenerator::Resize(const unsigned char* source, uint32_t width, uint32_t height,
+	unsigned char* dest, uint32_t newWidth, uint32_t newHeight, const MipSettings& settings, JobSystem* jobSystem)
+{
+	PROFILE_SCOPE("MipGenerator::Resize");
+
+	MipContent content = settings.content;
+	ResampleTaps tapsX(width, newWidth, settings.filter);
+	ResampleTaps tapsY(height, newHeight, settings.filter);
+
+	std::vector<float> current((size_t)width * height * 4);
+	ForEachRow(jobSystem, height, [&](unsigned int begin, unsigned int end)
+	{
+		size_t offset = (size_t)begin * width * 4;
+		ToFloat(source + offset, &current[offset], (size_t)(end - begin) * width, content);
+	});
+
+	std::vector<float> across((size_t)newWidth * height * 4);
+	ForEachRow(jobSystem, height, [&](unsigned int begin, unsigned int end)
+	{
+		for (uint32_t y = begin; y < end; y++)
+		{
+			const float* row = &current[(size_t)y * width * 4];
+			float* out = &across[(size_t)y * newWidth * 4];
+			for (uint32_t x = 0; x < newWidth; x++)
+			{
+				const float* weights = &tapsX.weights[(size_t)x * tapsX.count];
+				Float4 sum = Splat4(0.0f);
+				for (int k = 0; k < tapsX.count; k++)
+				{
+					int sourceX = std::min(std::max(tapsX.first[x] + k, 0), (int)width - 1);
+					sum = sum + Load4(row + sourceX * 4) * Splat4(weights[k]);
+				}
+				Store4(out + x * 4, sum);
+			}
+		}
+	});
+
+	ForEachRow(jobSystem, newHeight, [&](unsigned int begin, unsigned int end)
+	{
+		std::vector<float> out((size_t)newWidth * 4);
+		for (uint32_t y = begin; y < end; y++)
+		{
+			const float* weights = &tapsY.weights[(size_t)y * tapsY.count];
+			for (uint32_t x = 0; x < newWidth; x++)
+			{
+				Float4 sum = Splat4(0.0f);
+				for (int k = 0; k < tapsY.count; k++)
+				{
+					int sourceY = std::min(std::max(tapsY.first[y] + k, 0), (int)height - 1);
+					sum = sum + Load4(&across[((size_t)sourceY * newWidth + x) * 4]) * Splat4(weights[k]);
+				}
+				Store4(&out[x * 4], sum);
+			}
+			ToBytes(out.data(), dest + (size_t)y * newWidth * 4, newWidth, content);
+		}
+	});
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class JobSystem;
+
+enum MipFilter
+{
+	MipFilter_Box,			// 2x2 average - fast, a little soft
+	MipFilter_Kaiser		// 8 tap windowed sinc - sharper, less aliasing
+};
+
+// What the texels mean, which decides how they are averaged
+enum MipContent
+{
+	MipContent_Color,		// sRGB encoded color, averaged as linear light
+	MipContent_Linear,		// Data such as specular masks, averaged as is
+	MipContent_NormalMap	// Tangent space normals, renormalized per level
+};
+
+struct MipSettings
+{
+	MipFilter	filter;
+	MipContent	content;
+
+	MipSettings() : filter(MipFilter_Kaiser), content(MipContent_Color) { }
+};
+
+// --------------------------------------------------------
+// Builds the mip chain of an RGBA8 image on the CPU.
+//
+// Levels are filtered in float: color is converted to linear
+// light first, so dark and bright texels average the way the
+// eye sees them, and normal maps are averaged as vectors and
+// renormalized, so their detail fades to flat instead of to
+// shorter (darker) normals.  Alpha is always linear.
+//
+// Each level is made from the one above.  Its rows are spread
+// over the job system when one is given, and the per-texel
+// math uses SSE where the compiler has it.
+//
+// This file only uses the standard library and the job
+// system, so it also builds on Linux for tools.
+// --------------------------------------------------------
+class MipGenerator
+{
+public:
+	// Bytes in a chain of tightly packed RGBA8 levels, from
+	// width x height down to 1x1
+	static size_t GetChainSize(uint32_t width, uint32_t height);
+
+	// chain starts with the top level and must hold
+	// GetChainSize() bytes; the levels below are written after
+	// it, largest first.  Returns the number of levels.
+	static uint32_t Generate(unsigned char* chain, uint32_t width, uint32_t height,
+		const MipSettings& settings, JobSystem* jobSystem = 0);
+
+	// Scales an RGBA8 image to newWidth x newHeight with the
+	// same filter (a tent for MipFilter_Box) and the same care
+	// for color and normals.  dest must not overlap source.
+	static void Resize(const unsigned char* source, uint32_t width, uint32_t height,
+		unsigned char* dest, uint32_t newWidth, uint32_t newHeight, const MipSettings& settings, JobSystem* jobSystem = 0);
+
+	// Texels the filter reads past the 2x2 square each texel of
+	// a level shrinks, on every side, from the level above
+	static uint32_t GetFilterReach(MipFilter filter);
+
+private:
+	MipGenerator();
+};
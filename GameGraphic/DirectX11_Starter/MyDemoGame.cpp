@@ -25,6 +25,9 @@
 #include "Vertex.h"
 #include "WICTextureLoader.h"
 #include "DDSTextureLoader.h"
+#include "Profiler.h"
+#include "StartupGraph.h"
+#include <sstream>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -45,6 +48,12 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance,
 	// Create the game object.
 
 	MyDemoGame game(hInstance);
+
+	// "-benchmark" runs a scripted, timed session instead
+	BenchmarkSettings benchmark;
+	if (!benchmark.Parse(cmdLine))
+		return 1;
+	game.SetBenchmark(benchmark);
 	
 	// This is where we'll create the window, initialize DirectX, 
 	// set up geometry and shaders, etc.
@@ -75,6 +84,37 @@ MyDemoGame::MyDemoGame(HINSTANCE hInstance)
 	// Custom window size - will be created by Init() later
 	windowWidth = 1280;
 	windowHeight = 720;
+
+	// Record draws on worker threads by default, and
+	// simulate the next frame while this one is drawn
+	parallelSubmission = true;
+	pipelinedRendering = true;
+
+	// Simulate at a steady 60Hz and interpolate when drawing
+	fixedTimestep = true;
+	fixedStepSeconds = 1.0f / 60.0f;
+
+	// Don't render faster than the display needs
+	frameLimiter.SetTargetFrameTime(1.0 / 60.0);
+
+	// Write frame time reports on exit
+	frameStatsFile = "framestats";
+
+	// Record CPU timings (P saves a trace, O prints a summary)
+	Profiler::SetEnabled(true);
+	traceKeyDown = false;
+	summaryKeyDown = false;
+	stressDrawCount = 0;
+
+	// Warn (in the debug output) when assets outgrow these.
+	// M prints where the memory went.
+	MemoryTracker::SetBudget(MemoryTag_Mesh, 64 * 1024 * 1024, 128 * 1024 * 1024);
+	MemoryTracker::SetBudget(MemoryTag_Texture, 16 * 1024 * 1024, 256 * 1024 * 1024);
+	MemoryTracker::SetBudget(MemoryTag_Shader, 4 * 1024 * 1024, 8 * 1024 * 1024);
+	memoryKeyDown = false;
+
+	// Streamed texture mips are evicted to stay under this
+	textureStreamer.SetBudget(TextureStreamer::DefaultBudget);
 }
 
 // --------------------------------------------------------
@@ -84,6 +124,10 @@ MyDemoGame::MyDemoGame(HINSTANCE hInstance)
 // --------------------------------------------------------
 MyDemoGame::~MyDemoGame()
 {
+	// Jobs can still be using the asset loader, streamer and
+	// material library, which go away before the base class
+	ShutdownJobs();
+
 	// Release any D3D stuff that's still hanging out
 	ReleaseMacro(vertexBuffer);
 	ReleaseMacro(indexBuffer);
@@ -108,23 +152,11 @@ bool MyDemoGame::Init()
 	if( !DirectXGameCore::Init() )
 		return false;
 
-	// Helper methods to create something to draw, load shaders to draw it 
-	// with and set up matrices so we can see how to pass data to the GPU.
-	//  - For your own projects, feel free to expand/replace these.
-	LoadShaders();
-	
-	CreateMaterial();
-
-	//load mesh
-	CreateGeometry();
-
-	// Tell the input assembler stage of the pipeline what kind of
-	// geometric primitives we'll be using and how to interpret them
-	deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
 	//Camera Initialize
 	FPScamera.SetAspectRatio(aspectRatio);
-	
+
+	stressDrawCount = GetBenchmarkSettings().stressDraws;
+
 	//Light Initialize
 	//dirlight1.AmbientColor = XMFLOAT4(0.2, 0.2, 0.2, 1.0);
 	//dirlight1.DiffuseColor = XMFLOAT4(0.3, 0.3, 0.3, 1.0);
@@ -133,6 +165,98 @@ bool MyDemoGame::Init()
 	pointlight1.Postion = XMFLOAT3(0, 5, -5);
 	pointlight1.Color	 = XMFLOAT4(1, 1, 1, 1);
 
+	// The rest of start-up is a graph of tasks, each started as
+	// soon as what it needs is done.  Anything that touches the
+	// immediate context runs on this thread.
+	//  - For your own projects, feel free to expand/replace these.
+	bool assetsReady = false;
+	bool pathReady = true;
+	StartupGraph startup;
+
+	// Files are read on worker threads and turned into GPU
+	// resources a few per frame, so the first frame doesn't
+	// wait for them.  Anything the asset cooker has cooked
+	// (AssetCooker/Makefile, "make cook") is loaded from the
+	// cooked copy; without its manifest the sources are used.
+	StartupGraph::TaskId loader = startup.Add("Asset loader", [&]()
+	{
+		assetsReady = assetLoader.Init(device, deviceContext, &jobSystem);
+		if (!assetLoader.OpenPak("assets.pak"))
+			assetLoader.LoadManifest("Cooked/assets.manifest");
+		textureStreamer.Init(device, deviceContext, &jobSystem, &assetLoader);
+		materialLibrary.Init(device, &assetLoader, &textureStreamer);
+	});
+
+	// Helper methods to create something to draw, load shaders to draw it 
+	// with and set up matrices so we can see how to pass data to the GPU.
+	StartupGraph::TaskId shaders = startup.Add("Shaders", [&]() { LoadShaders(); }, { loader });
+	StartupGraph::TaskId materials = startup.Add("Materials", [&]() { CreateMaterial(); }, { loader, shaders });
+	StartupGraph::TaskId geometry = startup.Add("Geometry", [&]() { CreateGeometry(); }, { loader });
+	startup.Add("Entities", [&]() { CreateEntities(); }, { materials, geometry });
+
+	// Benchmarks measure the finished scene, not the loading
+	if (IsBenchmarking())
+		startup.Add("Flush assets", [&]() { assetLoader.Flush(); }, { shaders, materials, geometry }, true);
+
+	// Benchmarks fly the camera along a path instead of
+	// following input - a file's, or a lap around the scene
+	if (IsBenchmarking())
+	{
+		startup.Add("Camera path", [&]()
+		{
+			const std::string& pathFile = GetBenchmarkSettings().cameraPathFile;
+			if (!pathFile.empty())
+			{
+				pathReady = benchmarkPath.Load(pathFile.c_str());
+			}
+			else
+			{
+				float center[3] = { 0.0f, 0.0f, 0.0f };
+				benchmarkPath.CreateOrbit(center, 10.0f, 2.0f, 20.0f);
+			}
+		});
+	}
+
+	StartupGraph::TaskId blend = startup.Add("Blend state", [&]() { CreateBlendState(); });
+
+	// Tell the input assembler stage of the pipeline what kind of
+	// geometric primitives we'll be using and how to interpret them,
+	// and turn on the newly created blend state
+	startup.Add("Context state", [&]()
+	{
+		deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+		float factors[4] = { 1,1,1,1 };
+		deviceContext->OMSetBlendState(
+			blendState,
+			factors,
+			0xFFFFFFFF);
+	}, { blend }, true);
+
+	// Set up the deferred contexts for multi-threaded draw recording
+	startup.Add("Parallel renderer", [&]()
+	{
+		if (!parallelRenderer.Init(device, deviceContext, &jobSystem))
+			parallelSubmission = false;
+		parallelRenderer.SetRenderTargets(renderTargetView, depthStencilView, viewport);
+		parallelRenderer.SetBlendState(blendState);
+	}, { blend });
+
+	startup.Run(jobSystem);
+	OutputDebugStringA(startup.FormatReport().c_str());
+
+	if (!assetsReady || !pathReady)
+		return false;
+
+	// Successfully initialized
+	return true;
+}
+
+// --------------------------------------------------------
+// Creates the alpha blending state used for everything
+// --------------------------------------------------------
+void MyDemoGame::CreateBlendState()
+{
 	// Create a description of the blend state I want
 	D3D11_BLEND_DESC blendDesc = {};
 
@@ -163,15 +287,6 @@ bool MyDemoGame::Init()
 
 	// Create the blend state object
 	device->CreateBlendState(&blendDesc, &blendState);
-
-	// Turn on the newly created blend state
-	float factors[4] = { 1,1,1,1 };
-	deviceContext->OMSetBlendState(
-		blendState,
-		factors,
-		0xFFFFFFFF);
-	// Successfully initialized
-	return true;
 }
 
 // --------------------------------------------------------
@@ -179,63 +294,50 @@ bool MyDemoGame::Init()
 // --------------------------------------------------------
 void MyDemoGame::CreateMaterial()
 {
+	PROFILE_SCOPE("MyDemoGame::CreateMaterial");
+
 	//Init Material
-	//load texture
-	CreateWICTextureFromFile(	device,
-								deviceContext,
-								L"ironman.bmp",
-								0,
-								&material1.texture);
-	//load normalmap
-	CreateWICTextureFromFile(	device, 
-								deviceContext, 
-								L"ironmannormal.bmp", 
-								0, 
-								&material1.normalMap);
-	//load specTexture
-	CreateWICTextureFromFile(	device, 
-								deviceContext, 
-								L"ironmanspec.bmp", 
-								0, 
-								&material1.specTexture);
-	//load skybox texture
-	CreateDDSTextureFromFile(	device,
-								deviceContext,
-								L"SunnyCubeMap.dds",
-								0,
-								&skyBoxMaterial.skyTexture);
-
-	material1.skyTexture = skyBoxMaterial.skyTexture;
-	
-	//creat sampler state
-	D3D11_SAMPLER_DESC samplerDesc = {};
-	samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_WRAP;
-	samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_WRAP;
-	samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_WRAP;
-	samplerDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-	samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
-
-	device->CreateSamplerState(&samplerDesc, &material1.samplerState);
-	device->CreateSamplerState(&samplerDesc, &skyBoxMaterial.samplerState);
-
-	//Create the rasterizer state for sky box
-	D3D11_RASTERIZER_DESC rsDesc = {};
-	rsDesc.FillMode = D3D11_FILL_SOLID;
-	rsDesc.CullMode = D3D11_CULL_FRONT;
-	rsDesc.DepthClipEnable = true;
-	device->CreateRasterizerState(&rsDesc, &skyBoxMaterial.rsState);
-
-	//Create the depth stencil for sky box
-	D3D11_DEPTH_STENCIL_DESC dsDesc = {};
-	dsDesc.DepthEnable = true;
-	dsDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
-	dsDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
-	device->CreateDepthStencilState(&dsDesc, &skyBoxMaterial.dsState);
-	
-	material1.SetVertexShader(vertexShader);
-	material1.SetPixelShader(pixelShader);
-	skyBoxMaterial.SetVertexShader(skyboxVertexShader);
-	skyBoxMaterial.SetPixelShader(skyboxPixelShader);
+	//Textures come from the material library, so each is
+	//loaded once however many materials use it.  Cooked ones
+	//start with their small mips and stream the rest;
+	//placeholders stand in for the others until they arrive.
+	MaterialDesc modelDesc;
+	modelDesc.vertexShader = vertexShader;
+	modelDesc.pixelShader = pixelShader;
+	modelDesc.texture = L"ironman.bmp";
+	modelDesc.normalMap = L"ironmannormal.bmp";
+	modelDesc.specTexture = L"ironmanspec.bmp";
+
+	//the model reflects the skybox texture
+	modelDesc.skyTexture = L"SunnyCubeMap.dds";
+	material1 = materialLibrary.GetMaterial(modelDesc);
+
+	//Same textures, lit with the spec map or reflecting the sky
+	MaterialDesc specDesc = modelDesc;
+	specDesc.pixelShader = pixelShaderST;
+	specMaterial = materialLibrary.GetMaterial(specDesc);
+
+	MaterialDesc reflectDesc = modelDesc;
+	reflectDesc.pixelShader = pixelShaderReflect;
+	reflectMaterial = materialLibrary.GetMaterial(reflectDesc);
+
+	MaterialDesc skyDesc;
+	skyDesc.vertexShader = skyboxVertexShader;
+	skyDesc.pixelShader = skyboxPixelShader;
+	skyDesc.skyTexture = L"SunnyCubeMap.dds";
+
+	//rasterizer state for sky box
+	skyDesc.hasRasterizerState = true;
+	skyDesc.rasterizer.FillMode = D3D11_FILL_SOLID;
+	skyDesc.rasterizer.CullMode = D3D11_CULL_FRONT;
+	skyDesc.rasterizer.DepthClipEnable = true;
+
+	//depth stencil for sky box
+	skyDesc.hasDepthStencilState = true;
+	skyDesc.depthStencil.DepthEnable = true;
+	skyDesc.depthStencil.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+	skyDesc.depthStencil.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+	skyBoxMaterial = materialLibrary.GetMaterial(skyDesc);
 }
 
 
@@ -248,24 +350,28 @@ void MyDemoGame::CreateMaterial()
 // --------------------------------------------------------
 void MyDemoGame::LoadShaders()
 {
+	PROFILE_SCOPE("MyDemoGame::LoadShaders");
+
+	//The shaders are filled in by the asset loader.  Draws
+	//using them are skipped until then.
 	vertexShader = new SimpleVertexShader(device, deviceContext);
-	vertexShader->LoadShaderFile(L"VertexShader.cso");
+	assetLoader.LoadShader(L"VertexShader.cso", vertexShader);
 
 	pixelShader = new SimplePixelShader(device, deviceContext);
-	pixelShader->LoadShaderFile(L"PixelShader.cso");
+	assetLoader.LoadShader(L"PixelShader.cso", pixelShader);
 
 	pixelShaderST = new SimplePixelShader(device, deviceContext);
-	pixelShaderST->LoadShaderFile(L"PixelShaderSpecTexture.cso");
+	assetLoader.LoadShader(L"PixelShaderSpecTexture.cso", pixelShaderST);
 
 	//sky box shader
 	skyboxVertexShader = new SimpleVertexShader(device, deviceContext);
-	skyboxVertexShader->LoadShaderFile(L"SkyBoxVertexShader.cso");
+	assetLoader.LoadShader(L"SkyBoxVertexShader.cso", skyboxVertexShader);
 
 	skyboxPixelShader = new SimplePixelShader(device, deviceContext);
-	skyboxPixelShader->LoadShaderFile(L"SkyBoxPixelShader.cso");
+	assetLoader.LoadShader(L"SkyBoxPixelShader.cso", skyboxPixelShader);
 
 	pixelShaderReflect = new SimplePixelShader(device, deviceContext);
-	pixelShaderReflect->LoadShaderFile(L"PixelShaderReflection.cso");
+	assetLoader.LoadShader(L"PixelShaderReflection.cso", pixelShaderReflect);
 
 }
 
@@ -275,22 +381,34 @@ void MyDemoGame::LoadShaders()
 // --------------------------------------------------------
 void MyDemoGame::CreateGeometry()
 {
-	//Load obj file
+	//Every mesh shares the pool's buffers
+	geometryPool.Init(GetDevice(), GetDevContext());
+
+	//Load obj file.  Nothing reads the vertices back, so
+	//only the GPU keeps a copy.
 	CubeMesh.SetD3DDevice(GetDevice());
 	CubeMesh.SetD3DDevContext(GetDevContext());
-	CubeMesh.LoadObjFile("ironman.obj");
+	CubeMesh.SetKeepCpuCopy(false);
+	CubeMesh.SetGeometryPool(&geometryPool);
+	assetLoader.LoadMesh("ironman.obj", &CubeMesh);
 
 	SkyBoxMesh.SetD3DDevice(GetDevice());
 	SkyBoxMesh.SetD3DDevContext(GetDevContext());
-	SkyBoxMesh.LoadObjFile("cube.obj");
-
+	SkyBoxMesh.SetKeepCpuCopy(false);
+	SkyBoxMesh.SetGeometryPool(&geometryPool);
+	assetLoader.LoadMesh("cube.obj", &SkyBoxMesh);
+}
 
+// --------------------------------------------------------
+// Puts the meshes and materials together
+// --------------------------------------------------------
+void MyDemoGame::CreateEntities()
+{
 	//Set entities
 	CubeEntity.setMesh(&CubeMesh);
-	CubeEntity.setMaterial(&material1);
+	CubeEntity.setMaterial(material1.get());
 	SkyBoxEntity.setMesh(&SkyBoxMesh);
-	SkyBoxEntity.setMaterial(&skyBoxMaterial);
-
+	SkyBoxEntity.setMaterial(skyBoxMaterial.get());
 }
 
 #pragma endregion
@@ -307,6 +425,8 @@ void MyDemoGame::OnResize()
 	DirectXGameCore::OnResize();
 	//Change camera aspect ratio
 	FPScamera.SetAspectRatio(aspectRatio);
+	//The render target views were recreated
+	parallelRenderer.SetRenderTargets(renderTargetView, depthStencilView, viewport);
 #if 0
 	// Update our projection matrix since the window size changed
 	XMMATRIX P = XMMatrixPerspectiveFovLH(
@@ -326,6 +446,16 @@ void MyDemoGame::OnResize()
 // --------------------------------------------------------
 void MyDemoGame::UpdateScene(float deltaTime, float totalTime)
 {
+	// Benchmarks ignore the keyboard entirely
+	if (IsBenchmarking())
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 direction;
+		benchmarkPath.Evaluate(totalTime, &position.x, &direction.x);
+		FPScamera.SetCameraPosition(position);
+		FPScamera.SetCameraDirection(direction);
+		return;
+	}
 
 		//CubeEntity.setRotationY(totalTime);
 
@@ -354,16 +484,162 @@ void MyDemoGame::UpdateScene(float deltaTime, float totalTime)
 		{
 			FPScamera.MoveDown(deltaTime * 5);
 		}
+	// Save a Chrome trace of the recent frames
+	bool traceKey = (GetAsyncKeyState('P') & 0x8000) != 0;
+	if (traceKey && !traceKeyDown)
+		Profiler::ExportChromeTrace("profile.json");
+	traceKeyDown = traceKey;
+
+	// Print where the time went over the last second or so
+	bool summaryKey = (GetAsyncKeyState('O') & 0x8000) != 0;
+	if (summaryKey && !summaryKeyDown)
+		PrintProfileSummary();
+	summaryKeyDown = summaryKey;
+
+	// Print memory use per subsystem and the largest assets
+	bool memoryKey = (GetAsyncKeyState('M') & 0x8000) != 0;
+	if (memoryKey && !memoryKeyDown)
+		OutputDebugStringA(MemoryTracker::FormatReport().c_str());
+	memoryKeyDown = memoryKey;
+
 	// Quit if the escape key is pressed
 	if (GetAsyncKeyState(VK_ESCAPE))
 		Quit();
 }
 
+// --------------------------------------------------------
+// Writes the per-scope profiler totals to the debug output
+// --------------------------------------------------------
+void MyDemoGame::PrintProfileSummary()
+{
+	std::vector<ProfileSummaryEntry> summary;
+	Profiler::GetSummary(60, summary);
+
+	std::ostringstream outs;
+	outs.precision(3);
+	outs << std::fixed << "Profile (last 60 frames)  ms/frame  calls  max ms\n";
+	for (unsigned int i = 0; i < summary.size(); i++)
+	{
+		outs << "  " << summary[i].name << "  "
+			<< summary[i].averageMsPerFrame << "  "
+			<< summary[i].calls << "  "
+			<< summary[i].maxMs << "\n";
+	}
+	OutputDebugStringA(outs.str().c_str());
+}
+
+// --------------------------------------------------------
+// Called before each fixed simulation step - keeps the state
+// that BuildFrame() interpolates from
+// --------------------------------------------------------
+void MyDemoGame::SaveSimulationState()
+{
+	FPScamera.SaveState();
+	SkyBoxEntity.SaveState();
+}
+
 // --------------------------------------------------------
 // Clear the screen, redraw everything, present to the user
 // --------------------------------------------------------
 void MyDemoGame::DrawScene(float deltaTime, float totalTime)
 {
+	// Same path as pipelined mode, just on one thread
+	sceneFrame.Clear();
+	sceneFrame.deltaTime = deltaTime;
+	sceneFrame.totalTime = totalTime;
+	BuildFrame(sceneFrame);
+	DrawFrame(sceneFrame);
+}
+
+// --------------------------------------------------------
+// Captures the camera, lights and draw list for this frame.
+// Runs on the update thread in pipelined mode, so nothing
+// here may touch the device context or the shaders.
+// --------------------------------------------------------
+void MyDemoGame::BuildFrame(FramePacket& frame)
+{
+	//Camera, part way between the last two simulation steps
+	float alpha = GetInterpolationAlpha();
+	FPScamera.UpdateVPMatrixes(alpha);
+	pointlight1.Postion = FPScamera.GetViewPosition();
+
+	frame.viewMatrix = FPScamera.GetViewMatrix();
+	frame.projectionMatrix = FPScamera.GetProjectionMatrix();
+	frame.cameraPosition = FPScamera.GetViewPosition();
+	frame.dirLight = dirlight1;
+	frame.pointLight = pointlight1;
+
+	//Queue this frame's draws, in the order they should appear
+	//Draw sky box
+	frame.draws.push_back(SkyBoxEntity.GetDrawCommand(alpha));
+
+	//Entity Draw
+	for (int i = 0; i < 1; i++)
+	for (int j = 0; j < 1; j++)
+	for (int k = 0; k < 3; k++)
+	{
+		CubeEntity.setPositionX((float)k*4);
+		CubeEntity.setPositionY((float)j*4);
+		CubeEntity.setPositionZ((float)i*4);
+		if (k == 0)
+		{
+			CubeEntity.setMaterial(specMaterial.get());
+			frame.draws.push_back(CubeEntity.GetDrawCommand());
+		}
+		else if (k == 2)
+		{
+			CubeEntity.setMaterial(reflectMaterial.get());
+			frame.draws.push_back(CubeEntity.GetDrawCommand());
+		}
+	}
+
+	//Stress test copies laid out on a grid behind the scene.
+	//Only the translation differs, so the jobs just patch it
+	//into a copy of the cube's command (matrix is transposed).
+	if (stressDrawCount > 0)
+	{
+		CubeEntity.setMaterial(specMaterial.get());
+		CubeEntity.setPositionX(0);
+		CubeEntity.setPositionY(0);
+		CubeEntity.setPositionZ(0);
+		DrawCommand stressCommand = CubeEntity.GetDrawCommand();
+
+		unsigned int stressFirst = frame.draws.size();
+		frame.draws.resize(stressFirst + stressDrawCount);
+		DrawCommand* stressDraws = &frame.draws[stressFirst];
+		jobSystem.ParallelFor(stressDrawCount, 256, [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int n = begin; n < end; n++)
+			{
+				stressDraws[n] = stressCommand;
+				stressDraws[n].worldMatrix._14 = (float)((int)(n % 100) - 50) * 4;
+				stressDraws[n].worldMatrix._24 = (float)(n / 100 % 100) * 4;
+				stressDraws[n].worldMatrix._34 = (float)(n / 10000 + 2) * 4;
+			}
+		});
+	}
+
+	//Draw blending objects last
+	CubeEntity.setPositionX((float)1 * 4);
+	CubeEntity.setPositionY(0);
+	CubeEntity.setPositionZ(0);
+	CubeEntity.setMaterial(material1.get());
+	frame.draws.push_back(CubeEntity.GetDrawCommand());
+}
+
+// --------------------------------------------------------
+// Draws a captured frame.  Runs on the render thread in
+// pipelined mode and only reads from the frame packet.
+// --------------------------------------------------------
+void MyDemoGame::DrawFrame(const FramePacket& frame)
+{
+	// Create the GPU side of any assets that finished loading.
+	// This is the thread that owns the immediate context.
+	assetLoader.ProcessUploads();
+
+	// Stream texture mips in and out for what this frame draws
+	textureStreamer.Update(frame, viewport.Height);
+
 	// Background color (Cornflower Blue in this case) for clearing
 	const float color[4] = {0.4f, 0.6f, 0.75f, 0.0f};
 	//const float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
@@ -395,49 +671,30 @@ void MyDemoGame::DrawScene(float deltaTime, float totalTime)
 	//vertexShader->SetShader(true);
 	//pixelShader->SetShader(true);
 
-	//Camera 
-	FPScamera.UpdateVPMatrixes();
-	pointlight1.Postion = FPScamera.GetCameraPosition();
 	//set light to shader
-	pixelShader->SetData("dirlight", &dirlight1, sizeof(DirectionalLight));
-	pixelShader->SetData("pointlight", &pointlight1, sizeof(PointLight));
-	pixelShader->SetFloat3("cameraPosition", FPScamera.GetCameraPosition());
+	pixelShader->SetData("dirlight", &frame.dirLight, sizeof(DirectionalLight));
+	pixelShader->SetData("pointlight", &frame.pointLight, sizeof(PointLight));
+	pixelShader->SetFloat3("cameraPosition", frame.cameraPosition);
 
-	pixelShaderST->SetData("dirlight", &dirlight1, sizeof(DirectionalLight));
-	pixelShaderST->SetData("pointlight", &pointlight1, sizeof(PointLight));
-	pixelShaderST->SetFloat3("cameraPosition", FPScamera.GetCameraPosition());
+	pixelShaderST->SetData("dirlight", &frame.dirLight, sizeof(DirectionalLight));
+	pixelShaderST->SetData("pointlight", &frame.pointLight, sizeof(PointLight));
+	pixelShaderST->SetFloat3("cameraPosition", frame.cameraPosition);
 
-	pixelShaderReflect->SetData("dirlight", &dirlight1, sizeof(DirectionalLight));
-	pixelShaderReflect->SetData("pointlight", &pointlight1, sizeof(PointLight));
-	pixelShaderReflect->SetFloat3("cameraPosition", FPScamera.GetCameraPosition());
+	pixelShaderReflect->SetData("dirlight", &frame.dirLight, sizeof(DirectionalLight));
+	pixelShaderReflect->SetData("pointlight", &frame.pointLight, sizeof(PointLight));
+	pixelShaderReflect->SetFloat3("cameraPosition", frame.cameraPosition);
 
-	//Draw sky box
-	SkyBoxEntity.DrawEntity(FPScamera.GetViewMatrix(), FPScamera.GetProjectionMatrix());
-
-	//Entity Draw
-	for (int i = 0; i < 1; i++)
-	for (int j = 0; j < 1; j++)
-	for (int k = 0; k < 3; k++)
+	//Record the draws, spread across worker threads if enabled
+	if (parallelSubmission)
 	{
-		CubeEntity.setPositionX((float)k*4);
-		CubeEntity.setPositionY((float)j*4);
-		CubeEntity.setPositionZ((float)i*4);
-		if (k == 0)
-		{
-			material1.SetPixelShader(pixelShaderST);
-			CubeEntity.DrawEntity(FPScamera.GetViewMatrix(), FPScamera.GetProjectionMatrix());
-		}
-		else if (k == 2)
-		{
-			material1.SetPixelShader(pixelShaderReflect);
-			CubeEntity.DrawEntity(FPScamera.GetViewMatrix(), FPScamera.GetProjectionMatrix());
-		}
+		parallelRenderer.Submit(frame.draws.data(), frame.draws.size(), frame.viewMatrix, frame.projectionMatrix);
+	}
+	else
+	{
+		MeshBinding bound = { 0, 0 };
+		for (unsigned int i = 0; i < frame.draws.size(); i++)
+			ParallelRenderer::RecordDraw(deviceContext, frame.draws[i], frame.viewMatrix, frame.projectionMatrix, bound);
 	}
-
-	//Draw blending objects last
-	CubeEntity.setPositionX((float)1 * 4);
-	material1.SetPixelShader(pixelShader);
-	CubeEntity.DrawEntity(FPScamera.GetViewMatrix(), FPScamera.GetProjectionMatrix());
 
 	/*********************************************************************
 	// Set buffers in the input assembler
@@ -463,7 +720,9 @@ void MyDemoGame::DrawScene(float deltaTime, float totalTime)
 	//  - Puts the image we're drawing into the window so the user can see it
 	//  - Do this exactly ONCE PER FRAME
 	//  - Always at the very end of the frame
-	HR(swapChain->Present(0, 0));
+	//  - Headless benchmarks have nothing to present to
+	if (swapChain)
+		HR(swapChain->Present(0, 0));
 }
 
 #pragma endregion
@@ -509,7 +768,7 @@ void MyDemoGame::OnMouseUp(WPARAM btnState, int x, int y)
 // --------------------------------------------------------
 void MyDemoGame::OnMouseMove(WPARAM btnState, int x, int y)
 {
-	if (btnState & 0x0001)
+	if ((btnState & 0x0001) && !IsBenchmarking())
 	{
 		//update Cameradirection
 		FPScamera.UpdateCameraDir((y - prevMousePos.y)*XM_PIDIV4/500, (x - prevMousePos.x)*XM_PIDIV4/500);
@@ -8,6 +8,13 @@
 #include "Camera.h"
 #include "Material.h"
 #include "Light.h"
+#include "ParallelRenderer.h"
+#include "FramePacket.h"
+#include "AssetLoader.h"
+#include "TextureStreamer.h"
+#include "MaterialLibrary.h"
+#include <memory>
+#include <vector>
 
 // Include run-time memory checking in debug builds, so 
 // we can be notified of memory leaks
@@ -29,7 +36,10 @@ public:
 	bool Init();
 	void OnResize();
 	void UpdateScene(float deltaTime, float totalTime);
+	void SaveSimulationState();
 	void DrawScene(float deltaTime, float totalTime);
+	void BuildFrame(FramePacket& frame);
+	void DrawFrame(const FramePacket& frame);
 
 	// For handing mouse input
 	void OnMouseDown(WPARAM btnState, int x, int y);
@@ -51,18 +61,36 @@ private:
 	void LoadShaders(); 
 	void CreateGeometry();
 	void CreateMaterial();
+	void CreateEntities();
+	void CreateBlendState();
+	void PrintProfileSummary();
 
 	// Buffers to hold actual geometry data
 	ID3D11Buffer* vertexBuffer;
 	ID3D11Buffer* indexBuffer;
 
-	//Mesh Object here
+	//Loads the shaders, textures and meshes below
+	AssetLoader assetLoader;
+
+	//Streams the model's texture mips by how big it is on screen
+	TextureStreamer textureStreamer;
+
+	//Mesh Object here.  The pool must be declared first so
+	//it outlives the meshes in it.
+	GeometryPool geometryPool;
 	Mesh CubeMesh;
 	Mesh SkyBoxMesh;
 
-	//Material here
-	Material material1;
-	Material skyBoxMaterial;
+	//Loads each texture and material once, however many
+	//models use them
+	MaterialLibrary materialLibrary;
+
+	//Material here - one per pixel shader the cubes use, since
+	//library materials are shared and never changed
+	std::shared_ptr<Material> material1;
+	std::shared_ptr<Material> specMaterial;
+	std::shared_ptr<Material> reflectMaterial;
+	std::shared_ptr<Material> skyBoxMaterial;
 
 	ID3D11BlendState* blendState;
 	
@@ -88,6 +116,25 @@ private:
 
 	
 
+	// Frame captured by DrawScene() when not pipelined.  Its
+	// draws are recorded on several threads by the parallel renderer
+	FramePacket sceneFrame;
+	ParallelRenderer parallelRenderer;
+	bool parallelSubmission;
+
+	// Extra copies of the model drawn in a grid, for
+	// measuring submission cost with large draw counts
+	// (-stress on the command line; benchmarks default to some)
+	unsigned int stressDrawCount;
+
+	// Camera flight used instead of input when benchmarking
+	CameraPath benchmarkPath;
+
+	// Profiler hotkeys, so a held key only fires once
+	bool traceKeyDown;
+	bool summaryKeyDown;
+	bool memoryKeyDown;
+
 	// Keeps track of the old mouse position.  Useful for 
 	// determining how far the mouse moved in a single frame.
 	POINT prevMousePos;
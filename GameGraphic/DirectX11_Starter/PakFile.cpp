@@ -0,0 +1,216 @@
+#include "PakFile.h"
+#include "JobSystem.h"
+#include "Lz4.h"
+#include "Profiler.h"
+#include <atomic>
+#include <cctype>
+#include <cstring>
+
+static_assert(sizeof(PakHeader) == 64, "Pak header layout");
+static_assert(sizeof(PakEntry) == 48, "Pak entry layout");
+
+namespace
+{
+	const uint32_t ChunkStoredFlag = 0x80000000u;
+}
+
+PakFile::PakFile()
+{
+	header = 0;
+	entries = 0;
+	names = 0;
+}
+
+bool PakFile::Open(const char* path)
+{
+	PROFILE_SCOPE("PakFile::Open");
+
+	Close();
+	if (!file.Open(path))
+		return false;
+
+	const unsigned char* data = file.GetData();
+	size_t size = file.GetSize();
+	const PakHeader* candidate = (const PakHeader*)data;
+	if (size < sizeof(PakHeader) || candidate->magic != Magic || candidate->version != Version ||
+		candidate->chunkSize == 0 || candidate->tocOffset % 8 != 0 ||
+		candidate->tocOffset > size || (size - candidate->tocOffset) / sizeof(PakEntry) < candidate->entryCount ||
+		candidate->namesOffset > size || size - candidate->namesOffset < candidate->namesSize)
+	{
+		Close();
+		return false;
+	}
+
+	// Check every entry now so reads don't have to
+	const PakEntry* table = (const PakEntry*)(data + candidate->tocOffset);
+	for (uint32_t i = 0; i < candidate->entryCount; i++)
+	{
+		const PakEntry& entry = table[i];
+		bool valid = entry.offset <= size && size - entry.offset >= entry.storedSize &&
+			(uint64_t)entry.nameOffset + entry.nameLength <= candidate->namesSize &&
+			(entry.compression == PakCompression_Lz4 ||
+				(entry.compression == PakCompression_None && entry.storedSize == entry.size));
+		if (!valid)
+		{
+			Close();
+			return false;
+		}
+	}
+
+	header = candidate;
+	entries = table;
+	names = (const char*)data + header->namesOffset;
+	return true;
+}
+
+void PakFile::Close()
+{
+	file.Close();
+	header = 0;
+	entries = 0;
+	names = 0;
+}
+
+std::string PakFile::GetName(const PakEntry& entry) const
+{
+	return std::string(names + entry.nameOffset, entry.nameLength);
+}
+
+// --------------------------------------------------------
+// Binary search on the name hash, then a string compare in
+// case two names share one
+// --------------------------------------------------------
+const PakEntry* PakFile::Find(const std::string& name) const
+{
+	if (!header)
+		return 0;
+
+	std::string normalized = NormalizeName(name);
+	uint64_t hash = HashName(normalized);
+
+	uint32_t low = 0;
+	uint32_t high = header->entryCount;
+	while (low < high)
+	{
+		uint32_t middle = low + (high - low) / 2;
+		if (entries[middle].nameHash < hash)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+
+	for (uint32_t i = low; i < header->entryCount && entries[i].nameHash == hash; i++)
+	{
+		const PakEntry& entry = entries[i];
+		if (entry.nameLength == normalized.size() && memcmp(names + entry.nameOffset, normalized.data(), entry.nameLength) == 0)
+			return &entry;
+	}
+	return 0;
+}
+
+const void* PakFile::GetStoredData(const PakEntry& entry) const
+{
+	if (!header || entry.compression != PakCompression_None)
+		return 0;
+	return file.GetData() + entry.offset;
+}
+
+bool PakFile::Read(const PakEntry& entry, void* dest, JobSystem* jobSystem) const
+{
+	PROFILE_SCOPE("PakFile::Read");
+
+	if (!header)
+		return false;
+
+	const unsigned char* stored = file.GetData() + entry.offset;
+	if (entry.compression == PakCompression_None)
+	{
+		memcpy(dest, stored, (size_t)entry.size);
+		return true;
+	}
+	if (entry.size == 0)
+		return true;
+
+	// Where each chunk starts, from the size table
+	uint32_t chunkCount = (uint32_t)((entry.size + header->chunkSize - 1) / header->chunkSize);
+	uint64_t tableSize = (uint64_t)chunkCount * sizeof(uint32_t);
+	if (tableSize > entry.storedSize)
+		return false;
+
+	std::vector<uint32_t> chunkSizes(chunkCount);
+	memcpy(chunkSizes.data(), stored, (size_t)tableSize);
+
+	std::vector<uint64_t> chunkOffsets(chunkCount);
+	uint64_t offset = tableSize;
+	for (uint32_t i = 0; i < chunkCount; i++)
+	{
+		chunkOffsets[i] = offset;
+		offset += chunkSizes[i] & ~ChunkStoredFlag;
+	}
+	if (offset > entry.storedSize)
+		return false;
+
+	unsigned char* output = (unsigned char*)dest;
+	if (!jobSystem || chunkCount == 1)
+	{
+		for (uint32_t i = 0; i < chunkCount; i++)
+		{
+			if (!DecompressChunk(entry, i, chunkSizes.data(), chunkOffsets, output))
+				return false;
+		}
+		return true;
+	}
+
+	std::atomic<bool> succeeded(true);
+	jobSystem->ParallelFor(chunkCount, 1, [&](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			if (!DecompressChunk(entry, i, chunkSizes.data(), chunkOffsets, output))
+				succeeded.store(false, std::memory_order_relaxed);
+		}
+	});
+	return succeeded.load();
+}
+
+bool PakFile::Read(const std::string& name, std::vector<unsigned char>& data, JobSystem* jobSystem) const
+{
+	const PakEntry* entry = Find(name);
+	if (!entry)
+		return false;
+
+	data.resize((size_t)entry->size);
+	return Read(*entry, data.data(), jobSystem);
+}
+
+std::string PakFile::NormalizeName(const std::string& name)
+{
+	std::string normalized = name;
+	for (size_t i = 0; i < normalized.size(); i++)
+		normalized[i] = normalized[i] == '\\' ? '/' : (char)tolower((unsigned char)normalized[i]);
+	return normalized;
+}
+
+uint64_t PakFile::HashName(const std::string& normalizedName)
+{
+	return HashBytes(normalizedName.data(), normalizedName.size());
+}
+
+bool PakFile::DecompressChunk(const PakEntry& entry, uint32_t chunk, const uint32_t* chunkSizes,
+	const std::vector<uint64_t>& chunkOffsets, unsigned char* dest) const
+{
+	uint64_t start = (uint64_t)chunk * header->chunkSize;
+	uint64_t remaining = entry.size - start;
+	size_t size = (size_t)(remaining < header->chunkSize ? remaining : header->chunkSize);
+
+	const unsigned char* source = file.GetData() + entry.offset + chunkOffsets[chunk];
+	size_t storedSize = chunkSizes[chunk] & ~ChunkStoredFlag;
+	if (chunkSizes[chunk] & ChunkStoredFlag)
+	{
+		if (storedSize != size)
+			return false;
+		memcpy(dest + start, source, size);
+		return true;
+	}
+	return Lz4::Decompress(source, storedSize, dest + start, size);
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "ContentHash.h"
+#include "MappedFile.h"
+
+class JobSystem;
+
+enum PakCompression
+{
+	PakCompression_None,
+	PakCompression_Lz4
+};
+
+// --------------------------------------------------------
+// Start of a pak file
+// --------------------------------------------------------
+struct PakHeader
+{
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	entryCount;
+	uint32_t	chunkSize;			// Compressed entries are split into chunks this big
+	uint64_t	tocOffset;			// PakEntry[entryCount], sorted by nameHash
+	uint64_t	namesOffset;
+	uint64_t	namesSize;
+	ContentHash	contentsHash;		// Of every name and content hash - same inputs, same pak
+	uint32_t	alignment;			// Of uncompressed entries
+	uint32_t	reserved[3];
+};
+
+// --------------------------------------------------------
+// One file in a pak.  Entries with the same contents share
+// their data (same offset).
+//
+// Compressed data starts with a table of each chunk's stored
+// size, then the chunks one after another.  Each chunk is an
+// LZ4 block on its own, so they can be decompressed on
+// different threads; the top bit of a size marks a chunk kept
+// uncompressed because it didn't shrink.
+// --------------------------------------------------------
+struct PakEntry
+{
+	uint64_t	nameHash;
+	ContentHash	contentHash;		// Of the uncompressed data
+	uint64_t	offset;
+	uint64_t	size;				// Uncompressed
+	uint64_t	storedSize;
+	uint32_t	nameOffset;
+	uint16_t	nameLength;
+	uint8_t		compression;		// PakCompression
+	uint8_t		reserved;
+};
+
+// --------------------------------------------------------
+// Reads a pak: many files packed into one, written by the
+// asset cooker (see PakWriter).
+//
+// The pak is memory mapped, so opening it only reads the
+// table of contents.  Entries stored uncompressed start on a
+// page boundary and can be used straight from the mapping
+// with GetStoredData(); compressed ones are decompressed by
+// Read(), spreading their chunks over the job system when
+// it's given one.
+//
+// Names ignore case and treat \ and / alike.  Every method
+// is const once the pak is open, so any number of threads
+// can read at once.
+//
+// This file only uses the standard library and the job
+// system, so it also builds on Linux for tools.
+// --------------------------------------------------------
+class PakFile
+{
+public:
+	static const uint32_t Magic = 0x4B415047;		// "GPAK"
+	static const uint32_t Version = 1;
+	static const uint32_t DefaultChunkSize = 256 * 1024;
+	static const uint32_t PageAlignment = 4096;
+
+	PakFile();
+
+	bool Open(const char* path);
+	void Close();
+	bool IsOpen() const { return header != 0; }
+
+	const PakHeader* GetHeader() const { return header; }
+	unsigned int GetEntryCount() const { return header ? header->entryCount : 0; }
+	const PakEntry& GetEntry(unsigned int index) const { return entries[index]; }
+	std::string GetName(const PakEntry& entry) const;
+
+	// Null if the pak doesn't have it
+	const PakEntry* Find(const std::string& name) const;
+
+	// The entry's bytes inside the mapping if it is stored
+	// uncompressed, otherwise null
+	const void* GetStoredData(const PakEntry& entry) const;
+
+	// Decompresses (or copies) an entry into dest, which must
+	// hold entry.size bytes
+	bool Read(const PakEntry& entry, void* dest, JobSystem* jobSystem = 0) const;
+	bool Read(const std::string& name, std::vector<unsigned char>& data, JobSystem* jobSystem = 0) const;
+
+	// Lower case with / separators, as names are stored
+	static std::string NormalizeName(const std::string& name);
+	static uint64_t HashName(const std::string& normalizedName);
+
+private:
+	PakFile(const PakFile&);
+	PakFile& operator=(const PakFile&);
+
+	bool DecompressChunk(const PakEntry& entry, uint32_t chunk, const uint32_t* chunkSizes,
+		const std::vector<uint64_t>& chunkOffsets, unsigned char* dest) const;
+
+	MappedFile			file;
+	const PakHeader*	header;
+	const PakEntry*		entries;
+	const char*			names;
+};
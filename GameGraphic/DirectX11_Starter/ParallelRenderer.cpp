@@ -0,0 +1,230 @@
+#include "ParallelRenderer.h"
+#include "DirectXGameCore.h"
+#include "Material.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// Constructor - Nothing is created until Init()
+// --------------------------------------------------------
+ParallelRenderer::ParallelRenderer()
+	: device(0),
+	immediateContext(0),
+	jobSystem(0),
+	renderTargetView(0),
+	depthStencilView(0),
+	blendState(0),
+	minDrawsPerChunk(64)
+{
+	ZeroMemory(&viewport, sizeof(D3D11_VIEWPORT));
+}
+
+// --------------------------------------------------------
+// Destructor - Releases the contexts
+// --------------------------------------------------------
+ParallelRenderer::~ParallelRenderer()
+{
+	Release();
+}
+
+// --------------------------------------------------------
+// Creates one deferred context per chunk - one for the
+// calling thread plus one per job system worker
+// --------------------------------------------------------
+bool ParallelRenderer::Init(ID3D11Device* device, ID3D11DeviceContext* immediateContext, JobSystem* jobSystem)
+{
+	Release();
+
+	this->device = device;
+	this->immediateContext = immediateContext;
+	this->jobSystem = jobSystem;
+
+	chunks.resize(jobSystem->GetWorkerCount() + 1);
+	for (unsigned int i = 0; i < chunks.size(); i++)
+	{
+		chunks[i].context = 0;
+		chunks[i].commandList = 0;
+		chunks[i].first = 0;
+		chunks[i].count = 0;
+
+		if (FAILED(device->CreateDeferredContext(0, &chunks[i].context)))
+		{
+			Release();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// --------------------------------------------------------
+// Releases every deferred context
+// --------------------------------------------------------
+void ParallelRenderer::Release()
+{
+	for (unsigned int i = 0; i < chunks.size(); i++)
+	{
+		ReleaseMacro(chunks[i].commandList);
+		ReleaseMacro(chunks[i].context);
+	}
+	chunks.clear();
+}
+
+void ParallelRenderer::SetRenderTargets(ID3D11RenderTargetView* rtv, ID3D11DepthStencilView* dsv, const D3D11_VIEWPORT& viewport)
+{
+	renderTargetView = rtv;
+	depthStencilView = dsv;
+	this->viewport = viewport;
+}
+
+void ParallelRenderer::SetBlendState(ID3D11BlendState* blendState)
+{
+	this->blendState = blendState;
+}
+
+void ParallelRenderer::SetMinDrawsPerChunk(unsigned int count)
+{
+	minDrawsPerChunk = count > 0 ? count : 1;
+}
+
+unsigned int ParallelRenderer::GetWorkerCount()
+{
+	return chunks.size() > 0 ? chunks.size() - 1 : 0;
+}
+
+// --------------------------------------------------------
+// Splits the draw list across the chunks, records them in
+// parallel and executes the command lists in order
+// --------------------------------------------------------
+void ParallelRenderer::Submit(const DrawCommand* commands, unsigned int count, const XMFLOAT4X4& viewMatrix, const XMFLOAT4X4& projectionMatrix)
+{
+	PROFILE_SCOPE("ParallelRenderer::Submit");
+
+	if (count == 0)
+		return;
+
+	// Small lists (or no workers) go straight to the immediate context
+	if (chunks.size() < 2 || count < minDrawsPerChunk * 2)
+	{
+		MeshBinding bound = { 0, 0 };
+		for (unsigned int i = 0; i < count; i++)
+			RecordDraw(immediateContext, commands[i], viewMatrix, projectionMatrix, bound);
+		return;
+	}
+
+	this->viewMatrix = viewMatrix;
+	this->projectionMatrix = projectionMatrix;
+
+	// Only use as many chunks as there is work for
+	unsigned int chunkCount = count / minDrawsPerChunk;
+	if (chunkCount > chunks.size()) chunkCount = chunks.size();
+	unsigned int perChunk = (count + chunkCount - 1) / chunkCount;
+
+	for (unsigned int i = 0; i < chunks.size(); i++)
+	{
+		unsigned int begin = i * perChunk;
+		unsigned int end = begin + perChunk;
+		if (begin > count) begin = count;
+		if (end > count) end = count;
+
+		chunks[i].first = commands + begin;
+		chunks[i].count = end - begin;
+	}
+
+	// Hand the other chunks to the job system, then record
+	// chunk 0 ourselves and help out until they're all done
+	JobCounter recorded;
+	for (unsigned int i = 1; i < chunks.size(); i++)
+	{
+		if (chunks[i].count == 0)
+		{
+			chunks[i].commandList = 0;
+			continue;
+		}
+
+		Chunk* chunk = &chunks[i];
+		jobSystem->Run([this, chunk]() { RecordChunk(*chunk); }, &recorded);
+	}
+
+	RecordChunk(chunks[0]);
+	jobSystem->Wait(&recorded);
+
+	// Play everything back in chunk order.  Restoring the context
+	// state keeps the immediate context exactly as it was.
+	for (unsigned int i = 0; i < chunks.size(); i++)
+	{
+		if (!chunks[i].commandList)
+			continue;
+
+		immediateContext->ExecuteCommandList(chunks[i].commandList, TRUE);
+		RenderStats::Add(RenderCounter_CommandLists);
+		ReleaseMacro(chunks[i].commandList);
+	}
+}
+
+// --------------------------------------------------------
+// Records one chunk into its deferred context and closes
+// it into a command list
+// --------------------------------------------------------
+void ParallelRenderer::RecordChunk(Chunk& chunk)
+{
+	PROFILE_SCOPE("ParallelRenderer::RecordChunk");
+
+	chunk.commandList = 0;
+	if (chunk.count == 0)
+		return;
+
+	// Deferred contexts start from default state
+	ID3D11DeviceContext* context = chunk.context;
+	float factors[4] = { 1,1,1,1 };
+	context->OMSetRenderTargets(1, &renderTargetView, depthStencilView);
+	context->OMSetBlendState(blendState, factors, 0xFFFFFFFF);
+	RenderStats::Add(RenderCounter_StateChanges);
+	context->RSSetViewports(1, &viewport);
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+
+	MeshBinding bound = { 0, 0 };
+	for (unsigned int i = 0; i < chunk.count; i++)
+		RecordDraw(context, chunk.first[i], viewMatrix, projectionMatrix, bound);
+
+	// A failed list is simply dropped for this frame
+	if (FAILED(context->FinishCommandList(FALSE, &chunk.commandList)))
+		chunk.commandList = 0;
+}
+
+// --------------------------------------------------------
+// Records everything GameEntity::DrawEntity() would, but into
+// the given context and without writing to shared shader data
+// --------------------------------------------------------
+void ParallelRenderer::RecordDraw(ID3D11DeviceContext* context, const DrawCommand& cmd, const XMFLOAT4X4& viewMatrix, const XMFLOAT4X4& projectionMatrix, MeshBinding& bound)
+{
+	// Skip anything still loading (see AssetLoader)
+	if (!cmd.vertexShader->IsShaderValid() || !cmd.pixelShader->IsShaderValid() || !cmd.mesh->IsLoaded())
+		return;
+
+	SimpleShaderPatch patches[3] =
+	{
+		{ SimpleShaderPatch_World,		&cmd.worldMatrix,	sizeof(XMFLOAT4X4) },
+		{ SimpleShaderPatch_View,		&viewMatrix,		sizeof(XMFLOAT4X4) },
+		{ SimpleShaderPatch_Projection,	&projectionMatrix,	sizeof(XMFLOAT4X4) },
+	};
+	cmd.vertexShader->RecordShader(context, patches, 3);
+
+	Material* material = cmd.material;
+	cmd.pixelShader->RecordShaderResourceView(context, "diffuseTexture", material->texture);
+	cmd.pixelShader->RecordShaderResourceView(context, "normalMap", material->normalMap);
+	cmd.pixelShader->RecordShaderResourceView(context, "specTexture", material->specTexture);
+	cmd.pixelShader->RecordShaderResourceView(context, "skyTexture", material->skyTexture);
+	cmd.pixelShader->RecordSamplerState(context, "trilinear", material->samplerState);
+	cmd.pixelShader->RecordShader(context);
+
+	context->RSSetState(material->rsState);
+	context->OMSetDepthStencilState(material->dsState, 0);
+	cmd.mesh->DrawMesh(context, bound);
+
+	// Reset my states
+	context->RSSetState(0);
+	context->OMSetDepthStencilState(0, 0);
+	RenderStats::Add(RenderCounter_StateChanges, 4);
+}
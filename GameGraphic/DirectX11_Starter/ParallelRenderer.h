@@ -0,0 +1,76 @@
+#pragma once
+
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <vector>
+#include "DrawCommand.h"
+#include "JobSystem.h"
+#include "Mesh.h"
+
+using namespace DirectX;
+
+// --------------------------------------------------------
+// Records a list of draw commands on several threads at once.
+//
+// The draw list is split into contiguous chunks.  Each chunk
+// is recorded into its own deferred context by a job (the main
+// thread records the first chunk itself), and the resulting command
+// lists are executed on the immediate context in chunk order,
+// so the final draw order matches the order of the list.
+// --------------------------------------------------------
+class ParallelRenderer
+{
+public:
+	ParallelRenderer();
+	~ParallelRenderer();
+
+	// Creates one deferred context per job system thread
+	bool Init(ID3D11Device* device, ID3D11DeviceContext* immediateContext, JobSystem* jobSystem);
+	void Release();
+
+	// Pipeline state that every deferred context starts from,
+	// since deferred contexts don't inherit immediate state
+	void SetRenderTargets(ID3D11RenderTargetView* rtv, ID3D11DepthStencilView* dsv, const D3D11_VIEWPORT& viewport);
+	void SetBlendState(ID3D11BlendState* blendState);
+
+	// Lists shorter than this are recorded directly on the
+	// immediate context - threading isn't worth it for them
+	void SetMinDrawsPerChunk(unsigned int count);
+
+	// Records and executes the draws.  Blocks until every
+	// command list has been handed to the immediate context.
+	void Submit(const DrawCommand* commands, unsigned int count, const XMFLOAT4X4& viewMatrix, const XMFLOAT4X4& projectionMatrix);
+
+	unsigned int GetWorkerCount();
+
+	// Records a single draw into any context.  bound tracks
+	// the context's geometry buffers across a run of draws.
+	static void RecordDraw(ID3D11DeviceContext* context, const DrawCommand& cmd, const XMFLOAT4X4& viewMatrix, const XMFLOAT4X4& projectionMatrix, MeshBinding& bound);
+
+private:
+	struct Chunk
+	{
+		ID3D11DeviceContext*	context;
+		ID3D11CommandList*		commandList;
+		const DrawCommand*		first;
+		unsigned int			count;
+	};
+
+	void RecordChunk(Chunk& chunk);
+
+	ID3D11Device*				device;
+	ID3D11DeviceContext*		immediateContext;
+	JobSystem*					jobSystem;
+
+	// Chunk 0 is recorded by the calling thread, the rest by jobs
+	std::vector<Chunk>			chunks;
+
+	// Per-frame state shared with the workers
+	ID3D11RenderTargetView*		renderTargetView;
+	ID3D11DepthStencilView*		depthStencilView;
+	ID3D11BlendState*			blendState;
+	D3D11_VIEWPORT				viewport;
+	XMFLOAT4X4					viewMatrix;
+	XMFLOAT4X4					projectionMatrix;
+	unsigned int				minDrawsPerChunk;
+};
@@ -42,10 +42,13 @@ float4 main(VertexToPixel input) : SV_TARGET
 	input.tangent = normalize(input.tangent);
 
 	//Sample the normal map
-	float3 normalFromMap = normalMap.Sample(trilinear, input.uv).rgb;
+	float3 normalFromMap;
+	normalFromMap.xy = normalMap.Sample(trilinear, input.uv).rg;
 
-	//Unpack the normal
-	normalFromMap = normalFromMap * 2 - 1;
+	//Unpack the normal.  z is rebuilt, so two channel (BC5)
+	//normal maps work as well as RGB ones
+	normalFromMap.xy = normalFromMap.xy * 2 - 1;
+	normalFromMap.z = sqrt(saturate(1 - dot(normalFromMap.xy, normalFromMap.xy)));
 
 	//Calculate the TBN matrix to go from tangent-space to world-space
 	float3 N = input.normal;
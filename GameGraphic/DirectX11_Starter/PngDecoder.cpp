@@ -0,0 +1,481 @@
+#include "PngDecoder.h"
+#include "Inflate.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Images bigger than this are assumed to be corrupt headers
+	const uint32_t MaxDimension = 32768;
+
+	// Output rows handed to each job
+	const unsigned int RowsPerJob = 32;
+
+	const uint8_t Signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	enum ColorType
+	{
+		ColorType_Grey = 0,
+		ColorType_Rgb = 2,
+		ColorType_Palette = 3,
+		ColorType_GreyAlpha = 4,
+		ColorType_Rgba = 6
+	};
+
+	enum Filter
+	{
+		Filter_None,
+		Filter_Sub,
+		Filter_Up,
+		Filter_Average,
+		Filter_Paeth
+	};
+
+	// Where each Adam7 pass starts and how far apart its pixels are
+	const int Adam7[7][4] =
+	{
+		// x, y, step across, step down
+		{ 0, 0, 8, 8 },
+		{ 4, 0, 8, 8 },
+		{ 0, 4, 4, 8 },
+		{ 2, 0, 4, 4 },
+		{ 0, 2, 2, 4 },
+		{ 1, 0, 2, 2 },
+		{ 0, 1, 1, 2 }
+	};
+
+	inline uint32_t ReadBig32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3]; }
+	inline uint16_t ReadBig16(const uint8_t* p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+	struct Header
+	{
+		uint32_t		width;
+		uint32_t		height;
+		int				bitDepth;
+		int				colorType;
+		bool			interlaced;
+
+		int				channels;
+		int				bitsPerPixel;
+		int				filterStride;		// Bytes back to the matching byte of the pixel before
+
+		uint8_t			palette[256][4];
+		bool			hasColorKey;		// tRNS on a grey or RGB image
+		uint16_t		colorKey[3];
+		bool			hasAlpha;
+
+		const uint8_t*	data;				// The IDAT chunks' contents
+		std::vector<uint8_t> joined;		// ...copied together if there are several
+		size_t			dataSize;
+	};
+
+	size_t GetRowBytes(const Header& header, uint32_t width)
+	{
+		return ((size_t)width * header.bitsPerPixel + 7) / 8;
+	}
+
+	// --------------------------------------------------------
+	// Walks the chunks.  With withData false, stops at the
+	// first IDAT.
+	// --------------------------------------------------------
+	bool ParseChunks(const uint8_t* file, size_t size, Header& header, bool withData)
+	{
+		if (size < 8 + 25 || memcmp(file, Signature, 8) != 0)
+			return false;
+
+		bool seenHeader = false;
+		bool seenData = false;
+		int paletteCount = 0;
+		header.hasColorKey = false;
+		header.hasAlpha = false;
+		header.data = 0;
+		header.dataSize = 0;
+		header.joined.clear();
+
+		// Indices past the end of the palette come out black
+		memset(header.palette, 0, sizeof(header.palette));
+		for (int i = 0; i < 256; i++)
+			header.palette[i][3] = 255;
+
+		std::vector<const uint8_t*> dataChunks;
+		std::vector<uint32_t> dataSizes;
+		size_t position = 8;
+		while (position + 12 <= size)
+		{
+			uint32_t length = ReadBig32(file + position);
+			const uint8_t* type = file + position + 4;
+			const uint8_t* chunk = file + position + 8;
+			if (length > size - position - 12)
+				return false;
+			position += 12 + (size_t)length;
+
+			if (memcmp(type, "IHDR", 4) == 0)
+			{
+				if (seenHeader || length < 13)
+					return false;
+				seenHeader = true;
+				header.width = ReadBig32(chunk);
+				header.height = ReadBig32(chunk + 4);
+				header.bitDepth = chunk[8];
+				header.colorType = chunk[9];
+				header.interlaced = chunk[12] == 1;
+				if (header.width == 0 || header.height == 0 || header.width > MaxDimension || header.height > MaxDimension ||
+					chunk[10] != 0 || chunk[11] != 0 || chunk[12] > 1)
+					return false;
+
+				int depth = header.bitDepth;
+				switch (header.colorType)
+				{
+				case ColorType_Grey:		header.channels = 1; break;
+				case ColorType_Rgb:			header.channels = 3; break;
+				case ColorType_Palette:		header.channels = 1; break;
+				case ColorType_GreyAlpha:	header.channels = 2; break;
+				case ColorType_Rgba:		header.channels = 4; break;
+				default:					return false;
+				}
+				bool validDepth = depth == 8 ||
+					(depth == 16 && header.colorType != ColorType_Palette) ||
+					(depth < 8 && (depth == 1 || depth == 2 || depth == 4) &&
+						(header.colorType == ColorType_Grey || header.colorType == ColorType_Palette));
+				if (!validDepth)
+					return false;
+
+				header.bitsPerPixel = header.channels * depth;
+				header.filterStride = header.bitsPerPixel >= 8 ? header.bitsPerPixel / 8 : 1;
+				header.hasAlpha = header.colorType == ColorType_GreyAlpha || header.colorType == ColorType_Rgba;
+			}
+			else if (!seenHeader)
+			{
+				return false;
+			}
+			else if (memcmp(type, "PLTE", 4) == 0)
+			{
+				paletteCount = (int)(length / 3);
+				if (paletteCount > 256 || length % 3 != 0)
+					return false;
+				for (int i = 0; i < paletteCount; i++)
+				{
+					header.palette[i][0] = chunk[i * 3];
+					header.palette[i][1] = chunk[i * 3 + 1];
+					header.palette[i][2] = chunk[i * 3 + 2];
+					header.palette[i][3] = 255;
+				}
+			}
+			else if (memcmp(type, "tRNS", 4) == 0)
+			{
+				if (header.colorType == ColorType_Palette)
+				{
+					if ((int)length > paletteCount)
+						return false;
+					for (uint32_t i = 0; i < length; i++)
+					{
+						header.palette[i][3] = chunk[i];
+						header.hasAlpha |= chunk[i] != 255;
+					}
+				}
+				else if (header.colorType == ColorType_Grey && length >= 2)
+				{
+					header.hasColorKey = true;
+					header.hasAlpha = true;
+					header.colorKey[0] = ReadBig16(chunk);
+				}
+				else if (header.colorType == ColorType_Rgb && length >= 6)
+				{
+					header.hasColorKey = true;
+					header.hasAlpha = true;
+					for (int c = 0; c < 3; c++)
+						header.colorKey[c] = ReadBig16(chunk + c * 2);
+				}
+			}
+			else if (memcmp(type, "IDAT", 4) == 0)
+			{
+				if (header.colorType == ColorType_Palette && paletteCount == 0)
+					return false;
+				if (!withData)
+					return true;
+				seenData = true;
+				dataChunks.push_back(chunk);
+				dataSizes.push_back(length);
+				header.dataSize += length;
+			}
+			else if (memcmp(type, "IEND", 4) == 0)
+			{
+				break;
+			}
+			else if (!(type[0] & 0x20))
+			{
+				return false;		// A critical chunk we don't know
+			}
+		}
+
+		if (!seenData)
+			return false;
+
+		// Usually there is one IDAT; several are joined to inflate
+		if (dataChunks.size() == 1)
+		{
+			header.data = dataChunks[0];
+		}
+		else
+		{
+			header.joined.resize(header.dataSize);
+			size_t offset = 0;
+			for (size_t i = 0; i < dataChunks.size(); i++)
+			{
+				memcpy(&header.joined[offset], dataChunks[i], dataSizes[i]);
+				offset += dataSizes[i];
+			}
+			header.data = header.joined.data();
+		}
+		return true;
+	}
+
+	inline uint8_t Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = abs(p - a);
+		int pb = abs(p - b);
+		int pc = abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return (uint8_t)a;
+		return (uint8_t)(pb <= pc ? b : c);
+	}
+
+	// --------------------------------------------------------
+	// Undoes one row's filter in place.  previous is the row
+	// above, already unfiltered, or null for the first row.
+	// --------------------------------------------------------
+	bool Unfilter(uint8_t filter, uint8_t* row, const uint8_t* previous, size_t rowBytes, int stride)
+	{
+		size_t i;
+		switch (filter)
+		{
+		case Filter_None:
+			break;
+
+		case Filter_Sub:
+			for (i = stride; i < rowBytes; i++)
+				row[i] = (uint8_t)(row[i] + row[i - stride]);
+			break;
+
+		case Filter_Up:
+			if (previous)
+			{
+				for (i = 0; i < rowBytes; i++)
+					row[i] = (uint8_t)(row[i] + previous[i]);
+			}
+			break;
+
+		case Filter_Average:
+			for (i = 0; i < rowBytes; i++)
+			{
+				int left = i >= (size_t)stride ? row[i - stride] : 0;
+				int up = previous ? previous[i] : 0;
+				row[i] = (uint8_t)(row[i] + ((left + up) >> 1));
+			}
+			break;
+
+		case Filter_Paeth:
+			for (i = 0; i < rowBytes; i++)
+			{
+				int left = i >= (size_t)stride ? row[i - stride] : 0;
+				int up = previous ? previous[i] : 0;
+				int upLeft = previous && i >= (size_t)stride ? previous[i - stride] : 0;
+				row[i] = (uint8_t)(row[i] + Paeth(left, up, upLeft));
+			}
+			break;
+
+		default:
+			return false;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Expands an unfiltered row to RGBA, writing a pixel every
+	// step bytes of out
+	// --------------------------------------------------------
+	void ExpandRow(const Header& header, const uint8_t* row, uint32_t count, uint8_t* out, size_t step)
+	{
+		int depth = header.bitDepth;
+		if (depth < 8)
+		{
+			// Palette indices as they are; grey scaled up to 0-255
+			int mask = (1 << depth) - 1;
+			int scale = header.colorType == ColorType_Grey ? 255 / mask : 1;
+			for (uint32_t x = 0; x < count; x++, out += step)
+			{
+				size_t bit = (size_t)x * depth;
+				int value = (row[bit / 8] >> (8 - depth - (int)(bit % 8))) & mask;
+				if (header.colorType == ColorType_Palette)
+				{
+					memcpy(out, header.palette[value], 4);
+					continue;
+				}
+				out[0] = out[1] = out[2] = (uint8_t)(value * scale);
+				out[3] = header.hasColorKey && value == header.colorKey[0] ? 0 : 255;
+			}
+			return;
+		}
+
+		// The high byte of each 16-bit sample, which comes first
+		int sampleBytes = depth / 8;
+		int pixelBytes = header.channels * sampleBytes;
+		for (uint32_t x = 0; x < count; x++, out += step, row += pixelBytes)
+		{
+			switch (header.colorType)
+			{
+			case ColorType_Grey:
+				out[0] = out[1] = out[2] = row[0];
+				out[3] = 255;
+				if (header.hasColorKey && (sampleBytes == 2 ? ReadBig16(row) : row[0]) == header.colorKey[0])
+					out[3] = 0;
+				break;
+
+			case ColorType_GreyAlpha:
+				out[0] = out[1] = out[2] = row[0];
+				out[3] = row[sampleBytes];
+				break;
+
+			case ColorType_Palette:
+				memcpy(out, header.palette[row[0]], 4);
+				break;
+
+			case ColorType_Rgb:
+				out[0] = row[0];
+				out[1] = row[sampleBytes];
+				out[2] = row[sampleBytes * 2];
+				out[3] = 255;
+				if (header.hasColorKey)
+				{
+					bool match = true;
+					for (int c = 0; c < 3; c++)
+						match &= (sampleBytes == 2 ? ReadBig16(row + c * 2) : row[c]) == header.colorKey[c];
+					if (match)
+						out[3] = 0;
+				}
+				break;
+
+			default:
+				out[0] = row[0];
+				out[1] = row[sampleBytes];
+				out[2] = row[sampleBytes * 2];
+				out[3] = row[sampleBytes * 3];
+				break;
+			}
+		}
+	}
+
+	template<typename F>
+	void ForEachRow(JobSystem* jobSystem, unsigned int rows, F f)
+	{
+		if (jobSystem)
+			jobSystem->ParallelFor(rows, RowsPerJob, f);
+		else
+			f(0u, rows);
+	}
+}
+
+bool PngDecoder::IsPng(const void* file, size_t size)
+{
+	return size >= 8 && memcmp(file, Signature, 8) == 0;
+}
+
+bool PngDecoder::GetInfo(const void* file, size_t size, uint32_t& width, uint32_t& height, bool& hasAlpha)
+{
+	Header header;
+	if (!ParseChunks((const uint8_t*)file, size, header, false))
+		return false;
+	width = header.width;
+	height = header.height;
+	hasAlpha = header.hasAlpha;
+	return true;
+}
+
+bool PngDecoder::Decode(const void* file, size_t size, void* pixels, size_t rowPitch, JobSystem* jobSystem)
+{
+	PROFILE_SCOPE("PngDecoder::Decode");
+
+	Header header;
+	if (!ParseChunks((const uint8_t*)file, size, header, true))
+		return false;
+
+	// Each pass is a small image of its own; without
+	// interlacing there is one pass, the whole image
+	uint32_t passWidths[7];
+	uint32_t passHeights[7];
+	size_t passOffsets[7];
+	int passCount = header.interlaced ? 7 : 1;
+	size_t filteredSize = 0;
+	for (int pass = 0; pass < passCount; pass++)
+	{
+		passWidths[pass] = header.width;
+		passHeights[pass] = header.height;
+		if (header.interlaced)
+		{
+			const int* adam7 = Adam7[pass];
+			passWidths[pass] = header.width > (uint32_t)adam7[0] ? (header.width - adam7[0] + adam7[2] - 1) / adam7[2] : 0;
+			passHeights[pass] = header.height > (uint32_t)adam7[1] ? (header.height - adam7[1] + adam7[3] - 1) / adam7[3] : 0;
+		}
+
+		passOffsets[pass] = filteredSize;
+		if (passWidths[pass] > 0)
+			filteredSize += (GetRowBytes(header, passWidths[pass]) + 1) * passHeights[pass];
+	}
+
+	std::vector<uint8_t> filtered(filteredSize);
+	{
+		PROFILE_SCOPE("PngDecoder::Inflate");
+		if (!Inflate::DecompressZlib(header.data, header.dataSize, filtered.data(), filteredSize))
+			return false;
+	}
+
+	PROFILE_SCOPE("PngDecoder::Unfilter");
+	for (int pass = 0; pass < passCount; pass++)
+	{
+		if (passWidths[pass] == 0)
+			continue;
+
+		size_t rowBytes = GetRowBytes(header, passWidths[pass]);
+		uint8_t* rows = &filtered[passOffsets[pass]];
+		const uint8_t* previous = 0;
+		for (uint32_t y = 0; y < passHeights[pass]; y++)
+		{
+			uint8_t* row = rows + y * (rowBytes + 1);
+			if (!Unfilter(row[0], row + 1, previous, rowBytes, header.filterStride))
+				return false;
+			previous = row + 1;
+		}
+	}
+
+	uint8_t* output = (uint8_t*)pixels;
+	for (int pass = 0; pass < passCount; pass++)
+	{
+		if (passWidths[pass] == 0)
+			continue;
+
+		int startX = 0, startY = 0, stepX = 1, stepY = 1;
+		if (header.interlaced)
+		{
+			startX = Adam7[pass][0];
+			startY = Adam7[pass][1];
+			stepX = Adam7[pass][2];
+			stepY = Adam7[pass][3];
+		}
+		size_t rowBytes = GetRowBytes(header, passWidths[pass]);
+		const uint8_t* rows = &filtered[passOffsets[pass]];
+		uint32_t width = passWidths[pass];
+		ForEachRow(jobSystem, passHeights[pass], [&](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int y = begin; y < end; y++)
+			{
+				uint8_t* out = output + (size_t)(startY + y * stepY) * rowPitch + (size_t)startX * 4;
+				ExpandRow(header, rows + y * (rowBytes + 1) + 1, width, out, (size_t)stepX * 4);
+			}
+		});
+	}
+	return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+class JobSystem;
+
+// --------------------------------------------------------
+// Decodes PNG files to RGBA8:
+//  - every color type: grey, grey + alpha, RGB, RGBA and
+//    palette, with tRNS transparency
+//  - every bit depth from 1 to 16 (16-bit channels keep
+//    their high byte)
+//  - Adam7 interlacing
+// Gamma and color profile chunks are ignored; the values are
+// taken as sRGB, as the rest of the pipeline does.
+//
+// Inflating and unfiltering are sequential, as each row
+// depends on the one before.  Expanding rows to RGBA is
+// spread over the job system when one is given.  Pixels are
+// written straight into the caller's memory.
+//
+// This file only uses the standard library and the job
+// system, so it also builds on Linux for tools.
+// --------------------------------------------------------
+class PngDecoder
+{
+public:
+	// True if the file starts with the PNG signature
+	static bool IsPng(const void* file, size_t size);
+
+	// Reads the header.  hasAlpha is true if any pixel can be
+	// other than opaque.
+	static bool GetInfo(const void* file, size_t size, uint32_t& width, uint32_t& height, bool& hasAlpha);
+
+	// pixels must hold rowPitch * height bytes
+	static bool Decode(const void* file, size_t size, void* pixels, size_t rowPitch, JobSystem* jobSystem = 0);
+
+private:
+	PngDecoder();
+};
@@ -0,0 +1,282 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+// --------------------------------------------------------
+// One finished scope
+// --------------------------------------------------------
+struct ProfileEvent
+{
+	const char*		name;
+	long long		start;
+	long long		end;
+	unsigned int	depth;
+};
+
+// --------------------------------------------------------
+// Single-writer ring of events owned by one thread.  Readers
+// copy a range and then check it wasn't overwritten meanwhile.
+// --------------------------------------------------------
+struct ProfileThreadBuffer
+{
+	ProfileEvent				events[Profiler::EventsPerThread];
+	std::atomic<unsigned int>	written;
+	unsigned int				depth;
+	unsigned int				threadId;
+	const char*					threadName;
+};
+
+std::atomic<bool> Profiler::enabled(false);
+
+namespace
+{
+	// Every thread that ever recorded an event.  Buffers are never
+	// freed, so a thread's events outlive it until exported.
+	std::mutex							buffersLock;
+	std::vector<ProfileThreadBuffer*>	buffers;
+
+	thread_local ProfileThreadBuffer*	threadBuffer = 0;
+
+	// Frame start timestamps, written by the main thread
+	long long							frameStarts[Profiler::FrameHistory];
+	std::atomic<unsigned int>			frameCount(0);
+
+	ProfileThreadBuffer* GetThreadBuffer()
+	{
+		if (!threadBuffer)
+		{
+			ProfileThreadBuffer* buffer = new ProfileThreadBuffer();
+			buffer->written.store(0);
+			buffer->depth = 0;
+			buffer->threadName = 0;
+
+			std::lock_guard<std::mutex> lock(buffersLock);
+			buffer->threadId = buffers.size() + 1;
+			buffers.push_back(buffer);
+			threadBuffer = buffer;
+		}
+		return threadBuffer;
+	}
+
+	// Copies the still-valid events out of a thread's ring
+	void CopyEvents(ProfileThreadBuffer* buffer, std::vector<ProfileEvent>& out)
+	{
+		unsigned int end = buffer->written.load(std::memory_order_acquire);
+		unsigned int begin = end > Profiler::EventsPerThread ? end - Profiler::EventsPerThread : 0;
+
+		size_t first = out.size();
+		for (unsigned int i = begin; i != end; i++)
+			out.push_back(buffer->events[i & (Profiler::EventsPerThread - 1)]);
+
+		// Anything the writer lapped while we were copying is garbage
+		unsigned int after = buffer->written.load(std::memory_order_acquire);
+		unsigned int lapped = after - end;
+		if (lapped > 0)
+		{
+			size_t drop = std::min((size_t)lapped, out.size() - first);
+			out.erase(out.begin() + first, out.begin() + first + drop);
+		}
+	}
+
+	// Escapes a name for a JSON string
+	std::string JsonEscape(const char* text)
+	{
+		std::string result;
+		for (const char* c = text; c && *c; c++)
+		{
+			if (*c == '"' || *c == '\\')
+				result += '\\';
+			if ((unsigned char)*c >= 0x20)
+				result += *c;
+		}
+		return result;
+	}
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	Profiler::enabled.store(enabled);
+}
+
+long long Profiler::Now()
+{
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+double Profiler::TicksToMilliseconds(long long ticks)
+{
+	return (double)ticks * 1000.0 *
+		std::chrono::steady_clock::period::num / std::chrono::steady_clock::period::den;
+}
+
+void Profiler::BeginFrame()
+{
+	unsigned int frame = frameCount.load(std::memory_order_relaxed);
+	frameStarts[frame % FrameHistory] = Now();
+	frameCount.store(frame + 1, std::memory_order_release);
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+	GetThreadBuffer()->threadName = name;
+}
+
+void Profiler::BeginScope(const char*, long long& start, unsigned int& depth)
+{
+	ProfileThreadBuffer* buffer = GetThreadBuffer();
+	depth = buffer->depth++;
+	start = Now();
+}
+
+// --------------------------------------------------------
+// Events are written when a scope closes, so children land
+// in the buffer before their parents
+// --------------------------------------------------------
+void Profiler::EndScope(const char* name, long long start, unsigned int depth)
+{
+	long long end = Now();
+	ProfileThreadBuffer* buffer = GetThreadBuffer();
+	buffer->depth = depth;
+
+	unsigned int index = buffer->written.load(std::memory_order_relaxed);
+	ProfileEvent& event = buffer->events[index & (EventsPerThread - 1)];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	event.depth = depth;
+	buffer->written.store(index + 1, std::memory_order_release);
+}
+
+// --------------------------------------------------------
+// Writes complete ("X") events, one track per thread
+// --------------------------------------------------------
+bool Profiler::ExportChromeTrace(const char* path)
+{
+	FILE* file = 0;
+#ifdef _MSC_VER
+	if (fopen_s(&file, path, "w") != 0)
+		file = 0;
+#else
+	file = fopen(path, "w");
+#endif
+	if (!file)
+		return false;
+
+	std::vector<ProfileThreadBuffer*> threads;
+	{
+		std::lock_guard<std::mutex> lock(buffersLock);
+		threads = buffers;
+	}
+
+	// Timestamps are relative to the oldest event
+	std::vector<std::vector<ProfileEvent> > events(threads.size());
+	long long origin = 0;
+	bool haveOrigin = false;
+	for (unsigned int t = 0; t < threads.size(); t++)
+	{
+		CopyEvents(threads[t], events[t]);
+		for (unsigned int i = 0; i < events[t].size(); i++)
+		{
+			if (!haveOrigin || events[t][i].start < origin)
+			{
+				origin = events[t][i].start;
+				haveOrigin = true;
+			}
+		}
+	}
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (unsigned int t = 0; t < threads.size(); t++)
+	{
+		if (threads[t]->threadName)
+		{
+			fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+				first ? "" : ",\n", threads[t]->threadId, JsonEscape(threads[t]->threadName).c_str());
+			first = false;
+		}
+
+		for (unsigned int i = 0; i < events[t].size(); i++)
+		{
+			const ProfileEvent& e = events[t][i];
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",\n",
+				JsonEscape(e.name).c_str(),
+				threads[t]->threadId,
+				TicksToMilliseconds(e.start - origin) * 1000.0,
+				TicksToMilliseconds(e.end - e.start) * 1000.0);
+			first = false;
+		}
+	}
+	fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+
+	fclose(file);
+	return true;
+}
+
+// --------------------------------------------------------
+// Adds up every event that started within the last
+// frameCount complete frames, across all threads
+// --------------------------------------------------------
+void Profiler::GetSummary(unsigned int frames, std::vector<ProfileSummaryEntry>& summary)
+{
+	summary.clear();
+
+	unsigned int framesSeen = frameCount.load(std::memory_order_acquire);
+	if (frames == 0 || framesSeen < 2)
+		return;
+
+	// The newest frame is still in progress, so stop at its start
+	if (frames > framesSeen - 1) frames = framesSeen - 1;
+	if (frames > FrameHistory - 1) frames = FrameHistory - 1;
+	long long windowEnd = frameStarts[(framesSeen - 1) % FrameHistory];
+	long long windowStart = frameStarts[(framesSeen - 1 - frames) % FrameHistory];
+
+	std::vector<ProfileThreadBuffer*> threads;
+	{
+		std::lock_guard<std::mutex> lock(buffersLock);
+		threads = buffers;
+	}
+
+	std::vector<ProfileEvent> events;
+	for (unsigned int t = 0; t < threads.size(); t++)
+		CopyEvents(threads[t], events);
+
+	for (unsigned int i = 0; i < events.size(); i++)
+	{
+		const ProfileEvent& e = events[i];
+		if (e.start < windowStart || e.start >= windowEnd)
+			continue;
+
+		// Few distinct scopes, so a linear search is fine
+		ProfileSummaryEntry* entry = 0;
+		for (unsigned int s = 0; s < summary.size() && !entry; s++)
+			if (strcmp(summary[s].name, e.name) == 0)
+				entry = &summary[s];
+
+		if (!entry)
+		{
+			ProfileSummaryEntry blank = { e.name, 0, 0.0, 0.0, 0.0 };
+			summary.push_back(blank);
+			entry = &summary.back();
+		}
+
+		double ms = TicksToMilliseconds(e.end - e.start);
+		entry->calls++;
+		entry->totalMs += ms;
+		if (ms > entry->maxMs)
+			entry->maxMs = ms;
+	}
+
+	for (unsigned int s = 0; s < summary.size(); s++)
+		summary[s].averageMsPerFrame = summary[s].totalMs / frames;
+
+	std::sort(summary.begin(), summary.end(), [](const ProfileSummaryEntry& a, const ProfileSummaryEntry& b)
+	{
+		return a.totalMs > b.totalMs;
+	});
+}
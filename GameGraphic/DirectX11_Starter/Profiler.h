@@ -0,0 +1,110 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+
+// --------------------------------------------------------
+// Hierarchical CPU profiler.
+//
+// Wrap a block in PROFILE_SCOPE("Name") to time it.  Scopes
+// nest, and each thread writes its own lock-free ring buffer,
+// so timing costs two clock reads and a few stores.  While the
+// profiler is disabled a scope is a single flag check, and
+// defining PROFILER_DISABLED compiles the macros out entirely.
+//
+// Names must be string literals (or otherwise outlive the
+// profiler) - only the pointer is stored.
+//
+// Recent events can be exported as Chrome trace JSON (load in
+// chrome://tracing or ui.perfetto.dev) or summarised per scope
+// over the last N frames.
+// --------------------------------------------------------
+
+// Per-scope totals from Profiler::GetSummary()
+struct ProfileSummaryEntry
+{
+	const char*		name;
+	unsigned int	calls;
+	double			totalMs;
+	double			averageMsPerFrame;
+	double			maxMs;			// Longest single call
+};
+
+class Profiler
+{
+public:
+	// Events kept per thread.  Older events are overwritten.
+	static const unsigned int EventsPerThread = 1 << 16;
+
+	// Frame start times kept for summaries
+	static const unsigned int FrameHistory = 256;
+
+	static void SetEnabled(bool enabled);
+	static bool IsEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+	// Marks the start of a new frame.  Call from the main thread.
+	static void BeginFrame();
+
+	// Names the calling thread in exported traces
+	static void SetThreadName(const char* name);
+
+	// Writes every buffered event to a Chrome trace JSON file
+	static bool ExportChromeTrace(const char* path);
+
+	// Totals for every scope over the last frameCount frames,
+	// sorted by total time
+	static void GetSummary(unsigned int frameCount, std::vector<ProfileSummaryEntry>& summary);
+
+	// High resolution timestamp in ticks
+	static long long Now();
+	static double TicksToMilliseconds(long long ticks);
+
+	// Used by ProfileScope
+	static void BeginScope(const char* name, long long& start, unsigned int& depth);
+	static void EndScope(const char* name, long long start, unsigned int depth);
+
+private:
+	static std::atomic<bool> enabled;
+};
+
+// --------------------------------------------------------
+// Times its own lifetime
+// --------------------------------------------------------
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: name(0)
+	{
+		if (Profiler::IsEnabled())
+		{
+			this->name = name;
+			Profiler::BeginScope(name, start, depth);
+		}
+	}
+
+	~ProfileScope()
+	{
+		if (name)
+			Profiler::EndScope(name, start, depth);
+	}
+
+private:
+	ProfileScope(const ProfileScope&);
+	ProfileScope& operator=(const ProfileScope&);
+
+	const char*		name;
+	long long		start;
+	unsigned int	depth;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef PROFILER_DISABLED
+	#define PROFILE_SCOPE(name)
+	#define PROFILE_FUNCTION()
+#else
+	#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+	#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#endif
@@ -0,0 +1,289 @@
+#include "RangeAllocator.h"
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace
+{
+	// Index of the highest set bit.  value must not be 0.
+	unsigned int HighestBit(unsigned int value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanReverse(&index, value);
+		return index;
+#else
+		return 31 - __builtin_clz(value);
+#endif
+	}
+
+	// Index of the lowest set bit.  value must not be 0.
+	unsigned int LowestBit(unsigned int value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, value);
+		return index;
+#else
+		return __builtin_ctz(value);
+#endif
+	}
+}
+
+RangeAllocator::RangeAllocator(unsigned int capacity)
+{
+	Reset(capacity);
+}
+
+void RangeAllocator::Reset(unsigned int _capacity)
+{
+	// Sizes of 2^31 and up would need more lists
+	capacity = std::min(_capacity, 0x7FFFFFFFu);
+	freeSpace = 0;
+	allocationCount = 0;
+
+	blocks.clear();
+	unusedBlocks.clear();
+	listBitmap = 0;
+	for (unsigned int i = 0; i < ListCount; i++)
+	{
+		subListBitmaps[i] = 0;
+		for (unsigned int j = 0; j < SubListCount; j++)
+			freeLists[i][j] = None;
+	}
+
+	if (capacity > 0)
+	{
+		unsigned int whole = NewBlock();
+		blocks[whole].offset = 0;
+		blocks[whole].size = capacity;
+		InsertFree(whole);
+		freeSpace = capacity;
+	}
+}
+
+// --------------------------------------------------------
+// Which list holds free ranges of a size.  Sizes under
+// SubListCount each get their own list; past that, list i
+// covers [2^(i+2), 2^(i+3)) in eight equal steps.
+// --------------------------------------------------------
+void RangeAllocator::MapSize(unsigned int size, unsigned int& list, unsigned int& subList)
+{
+	if (size < SubListCount)
+	{
+		list = 0;
+		subList = size;
+	}
+	else
+	{
+		unsigned int high = HighestBit(size);
+		subList = (size >> (high - SubListBits)) ^ SubListCount;
+		list = high - SubListBits + 1;
+	}
+}
+
+RangeAllocation RangeAllocator::Allocate(unsigned int size)
+{
+	RangeAllocation result = { 0, 0, None };
+	if (size == 0 || size > freeSpace)
+		return result;
+
+	// Round up to the next list boundary, so any range in the
+	// list found is big enough and the search never walks one
+	unsigned int search = size;
+	if (search >= SubListCount)
+		search += (1u << (HighestBit(search) - SubListBits)) - 1;
+
+	unsigned int block = None;
+	unsigned int list, subList;
+	MapSize(search, list, subList);
+	if (list < ListCount)
+	{
+		// First non-empty list at this size or bigger
+		unsigned int subMap = subListBitmaps[list] & (~0u << subList);
+		if (!subMap)
+		{
+			unsigned int map = list + 1 < ListCount ? listBitmap & (~0u << (list + 1)) : 0;
+			if (map)
+			{
+				list = LowestBit(map);
+				subMap = subListBitmaps[list];
+			}
+		}
+		if (subMap)
+			block = freeLists[list][LowestBit(subMap)];
+	}
+
+	// Nearly full: the only fit may share the size's own list
+	if (block == None)
+	{
+		MapSize(size, list, subList);
+		for (unsigned int b = freeLists[list][subList]; b != None && block == None; b = blocks[b].nextFree)
+			if (blocks[b].size >= size)
+				block = b;
+		if (block == None)
+			return result;
+	}
+	RemoveFree(block);
+
+	// Return what is left over to the free lists
+	if (blocks[block].size > size)
+	{
+		unsigned int rest = NewBlock();
+		Block& b = blocks[block];
+		Block& r = blocks[rest];
+		r.offset = b.offset + size;
+		r.size = b.size - size;
+		r.prevPhysical = block;
+		r.nextPhysical = b.nextPhysical;
+		if (b.nextPhysical != None)
+			blocks[b.nextPhysical].prevPhysical = rest;
+		b.nextPhysical = rest;
+		b.size = size;
+		InsertFree(rest);
+	}
+
+	freeSpace -= size;
+	allocationCount++;
+
+	result.offset = blocks[block].offset;
+	result.size = size;
+	result.block = block;
+	return result;
+}
+
+void RangeAllocator::Free(RangeAllocation& allocation)
+{
+	if (!allocation.IsValid())
+		return;
+
+	unsigned int block = allocation.block;
+	freeSpace += blocks[block].size;
+	allocationCount--;
+
+	unsigned int next = blocks[block].nextPhysical;
+	if (next != None && blocks[next].isFree)
+	{
+		RemoveFree(next);
+		Merge(block, next);
+	}
+
+	unsigned int prev = blocks[block].prevPhysical;
+	if (prev != None && blocks[prev].isFree)
+	{
+		RemoveFree(prev);
+		Merge(prev, block);
+		block = prev;
+	}
+
+	InsertFree(block);
+	allocation.block = None;
+}
+
+unsigned int RangeAllocator::GetLargestFreeRange() const
+{
+	if (!listBitmap)
+		return 0;
+
+	// Only the highest non-empty list needs to be searched
+	unsigned int list = HighestBit(listBitmap);
+	unsigned int subList = HighestBit(subListBitmaps[list]);
+
+	unsigned int largest = 0;
+	for (unsigned int b = freeLists[list][subList]; b != None; b = blocks[b].nextFree)
+		largest = std::max(largest, blocks[b].size);
+	return largest;
+}
+
+float RangeAllocator::GetFragmentation() const
+{
+	if (freeSpace == 0)
+		return 0.0f;
+	return 1.0f - (float)GetLargestFreeRange() / freeSpace;
+}
+
+unsigned int RangeAllocator::NewBlock()
+{
+	unsigned int index;
+	if (!unusedBlocks.empty())
+	{
+		index = unusedBlocks.back();
+		unusedBlocks.pop_back();
+	}
+	else
+	{
+		index = (unsigned int)blocks.size();
+		blocks.push_back(Block());
+	}
+
+	Block& b = blocks[index];
+	b.offset = 0;
+	b.size = 0;
+	b.prevPhysical = None;
+	b.nextPhysical = None;
+	b.prevFree = None;
+	b.nextFree = None;
+	b.isFree = false;
+	return index;
+}
+
+void RangeAllocator::InsertFree(unsigned int block)
+{
+	unsigned int list, subList;
+	MapSize(blocks[block].size, list, subList);
+
+	Block& b = blocks[block];
+	b.isFree = true;
+	b.prevFree = None;
+	b.nextFree = freeLists[list][subList];
+	if (b.nextFree != None)
+		blocks[b.nextFree].prevFree = block;
+	freeLists[list][subList] = block;
+
+	listBitmap |= 1u << list;
+	subListBitmaps[list] |= 1u << subList;
+}
+
+void RangeAllocator::RemoveFree(unsigned int block)
+{
+	Block& b = blocks[block];
+	if (b.prevFree != None)
+		blocks[b.prevFree].nextFree = b.nextFree;
+	if (b.nextFree != None)
+		blocks[b.nextFree].prevFree = b.prevFree;
+
+	unsigned int list, subList;
+	MapSize(b.size, list, subList);
+	if (freeLists[list][subList] == block)
+	{
+		freeLists[list][subList] = b.nextFree;
+		if (b.nextFree == None)
+		{
+			subListBitmaps[list] &= ~(1u << subList);
+			if (!subListBitmaps[list])
+				listBitmap &= ~(1u << list);
+		}
+	}
+
+	b.isFree = false;
+	b.prevFree = None;
+	b.nextFree = None;
+}
+
+// --------------------------------------------------------
+// Joins a block to the one physically before it.  Neither
+// may be in a free list.
+// --------------------------------------------------------
+void RangeAllocator::Merge(unsigned int into, unsigned int absorbed)
+{
+	Block& a = blocks[into];
+	Block& b = blocks[absorbed];
+	a.size += b.size;
+	a.nextPhysical = b.nextPhysical;
+	if (b.nextPhysical != None)
+		blocks[b.nextPhysical].prevPhysical = into;
+
+	unusedBlocks.push_back(absorbed);
+}
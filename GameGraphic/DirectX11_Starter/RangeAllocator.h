@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+
+// --------------------------------------------------------
+// One range handed out by a RangeAllocator
+// --------------------------------------------------------
+struct RangeAllocation
+{
+	unsigned int	offset;
+	unsigned int	size;
+	unsigned int	block;			// Internal - pass the whole struct back to Free()
+
+	bool IsValid() const { return block != 0xFFFFFFFF; }
+};
+
+// --------------------------------------------------------
+// Sub-allocates ranges of a fixed size space, like the
+// elements of a big vertex or index buffer.  It never
+// touches the space itself, only offsets into it.
+//
+// Free ranges are kept in segregated lists in the style of
+// TLSF: sizes are grouped by power of two, each group split
+// into eight, and a pair of bitmaps finds the first
+// non-empty list that is big enough.  Allocating and freeing
+// are O(1); freed ranges merge with free neighbours
+// straight away.
+//
+// Not thread safe.  Pure bookkeeping - no Windows or D3D
+// dependencies.
+// --------------------------------------------------------
+class RangeAllocator
+{
+public:
+	explicit RangeAllocator(unsigned int capacity = 0);
+
+	// Forgets every allocation
+	void Reset(unsigned int capacity);
+
+	// Sizes are in whatever units the space uses.  Check
+	// IsValid() on the result - it fails when no free range
+	// is big enough.  Ranges are exactly the size asked for
+	// and carved end to end, so there is no alignment
+	// parameter: if every size is a multiple of N, so is every
+	// offset.
+	RangeAllocation Allocate(unsigned int size);
+	void Free(RangeAllocation& allocation);
+
+	// --- Stats ---
+	unsigned int GetCapacity() const { return capacity; }
+	unsigned int GetFreeSpace() const { return freeSpace; }
+	unsigned int GetAllocationCount() const { return allocationCount; }
+	unsigned int GetLargestFreeRange() const;
+
+	// 0 when the free space is one range, approaching 1 as it
+	// breaks into many small ones
+	float GetFragmentation() const;
+
+private:
+	static const unsigned int SubListBits = 3;
+	static const unsigned int SubListCount = 1 << SubListBits;
+	static const unsigned int ListCount = 30;
+	static const unsigned int None = 0xFFFFFFFF;
+
+	struct Block
+	{
+		unsigned int	offset;
+		unsigned int	size;
+		unsigned int	prevPhysical;	// Neighbours in the space
+		unsigned int	nextPhysical;
+		unsigned int	prevFree;		// Neighbours in its free list
+		unsigned int	nextFree;
+		bool			isFree;
+	};
+
+	static void MapSize(unsigned int size, unsigned int& list, unsigned int& subList);
+
+	unsigned int NewBlock();
+	void InsertFree(unsigned int block);
+	void RemoveFree(unsigned int block);
+	void Merge(unsigned int into, unsigned int absorbed);
+
+	std::vector<Block>			blocks;
+	std::vector<unsigned int>	unusedBlocks;
+	unsigned int				freeLists[ListCount][SubListCount];
+	unsigned int				listBitmap;
+	unsigned int				subListBitmaps[ListCount];
+	unsigned int				capacity;
+	unsigned int				freeSpace;
+	unsigned int				allocationCount;
+};
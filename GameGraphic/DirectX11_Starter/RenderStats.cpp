@@ -0,0 +1,98 @@
+#include "RenderStats.h"
+#include <mutex>
+#include <vector>
+
+namespace
+{
+	// Running totals for one thread.  Only that thread writes,
+	// so relaxed load + store is enough (no read-modify-write).
+	struct ThreadCounters
+	{
+		std::atomic<unsigned long long> totals[RenderCounter_Count];
+	};
+
+	std::mutex						threadsLock;
+	std::vector<ThreadCounters*>	threads;		// Never freed, like the threads' totals
+	thread_local ThreadCounters*	threadCounters = 0;
+
+	// Sum of every thread's totals at the last EndFrame().
+	// lastFrame is guarded by threadsLock.
+	unsigned long long				previousTotals[RenderCounter_Count];
+	RenderCounters					lastFrame;
+
+	const char* counterNames[RenderCounter_Count] =
+	{
+		"Draws",
+		"Triangles",
+		"CB Updates",
+		"CB Bytes",
+		"Shader Binds",
+		"SRV Binds",
+		"Sampler Binds",
+		"IA Binds",
+		"State Changes",
+		"Command Lists",
+	};
+
+	ThreadCounters* GetThreadCounters()
+	{
+		if (!threadCounters)
+		{
+			ThreadCounters* counters = new ThreadCounters();
+			for (unsigned int i = 0; i < RenderCounter_Count; i++)
+				counters->totals[i].store(0, std::memory_order_relaxed);
+
+			std::lock_guard<std::mutex> lock(threadsLock);
+			threads.push_back(counters);
+			threadCounters = counters;
+		}
+		return threadCounters;
+	}
+}
+
+void RenderStats::Add(RenderCounter counter, unsigned long long amount)
+{
+	std::atomic<unsigned long long>& total = GetThreadCounters()->totals[counter];
+	total.store(total.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// --------------------------------------------------------
+// The frame's counts are the growth of the summed totals
+// since the previous call
+// --------------------------------------------------------
+void RenderStats::EndFrame()
+{
+	std::lock_guard<std::mutex> lock(threadsLock);
+
+	unsigned long long totals[RenderCounter_Count] = {};
+	for (unsigned int t = 0; t < threads.size(); t++)
+		for (unsigned int i = 0; i < RenderCounter_Count; i++)
+			totals[i] += threads[t]->totals[i].load(std::memory_order_relaxed);
+
+	for (unsigned int i = 0; i < RenderCounter_Count; i++)
+	{
+		lastFrame.values[i] = totals[i] - previousTotals[i];
+		previousTotals[i] = totals[i];
+	}
+}
+
+unsigned long long RenderStats::GetLastFrame(RenderCounter counter)
+{
+	std::lock_guard<std::mutex> lock(threadsLock);
+	return lastFrame.values[counter];
+}
+
+// --------------------------------------------------------
+// Safe to call from any thread (e.g. the main thread while
+// the render thread closes frames)
+// --------------------------------------------------------
+RenderCounters RenderStats::GetLastFrame()
+{
+	std::lock_guard<std::mutex> lock(threadsLock);
+	return lastFrame;
+}
+
+const char* RenderStats::GetName(RenderCounter counter)
+{
+	return counterNames[counter];
+}
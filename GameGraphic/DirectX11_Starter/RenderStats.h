@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+
+// --------------------------------------------------------
+// What the render statistics count
+// --------------------------------------------------------
+enum RenderCounter
+{
+	RenderCounter_DrawCalls,
+	RenderCounter_Triangles,
+	RenderCounter_ConstantBufferUpdates,
+	RenderCounter_ConstantBufferBytes,
+	RenderCounter_ShaderBinds,
+	RenderCounter_ShaderResourceBinds,
+	RenderCounter_SamplerBinds,
+	RenderCounter_GeometryBinds,	// Vertex and index buffers
+	RenderCounter_StateChanges,		// Rasterizer, depth-stencil and blend states
+	RenderCounter_CommandLists,
+
+	RenderCounter_Count
+};
+
+// --------------------------------------------------------
+// One frame's worth of every counter
+// --------------------------------------------------------
+struct RenderCounters
+{
+	unsigned long long values[RenderCounter_Count];
+};
+
+// --------------------------------------------------------
+// Per-frame render statistics.
+//
+// Any layer can call RenderStats::Add() from any thread.
+// Each thread adds into its own block of counters, so there
+// is no contention; the main thread sums the blocks once per
+// frame in EndFrame().  Counters recorded on worker threads
+// for a frame that is still in flight may land in the next
+// frame's totals.
+// --------------------------------------------------------
+class RenderStats
+{
+public:
+	static void Add(RenderCounter counter, unsigned long long amount = 1);
+
+	// Closes the current frame.  Call once per frame.
+	static void EndFrame();
+
+	// Totals for the last closed frame
+	static unsigned long long GetLastFrame(RenderCounter counter);
+	static RenderCounters GetLastFrame();
+
+	// Short display name, e.g. "Draws"
+	static const char* GetName(RenderCounter counter);
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "ContentHash.h"
+
+// --------------------------------------------------------
+// Shares resources by the hash of their content, so every
+// request for the same data gets the same object.
+//
+// Resources are reference counted with shared_ptr.  The
+// cache itself only keeps weak references, so a resource is
+// destroyed as soon as its last user lets go of it, and is
+// created afresh if it's asked for again.
+//
+// The keys are hashes already, so they index the tables
+// as they are.  The table is split into shards, each behind
+// its own lock, so threads inserting different resources
+// rarely wait on each other.  A resource is created while
+// its shard is locked, so however many threads ask for the
+// same content at once, it is only created once.
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+template<typename Resource>
+class ResourceCache
+{
+public:
+	typedef std::shared_ptr<Resource> Handle;
+
+	ResourceCache() : hits(0), misses(0) { }
+
+	// The resource with this hash.  If there isn't one yet,
+	// create() is called to make it, and may return null if
+	// that fails.  Keep create() short, as other requests for
+	// the same shard wait on it.
+	template<typename Create>
+	Handle Acquire(ContentHash hash, Create create)
+	{
+		Shard& shard = GetShard(hash);
+		std::lock_guard<std::mutex> lock(shard.lock);
+
+		std::weak_ptr<Resource>& entry = shard.entries[hash];
+		Handle resource = entry.lock();
+		if (resource)
+		{
+			hits++;
+			return resource;
+		}
+
+		misses++;
+		resource = create();
+		if (resource)
+			entry = resource;
+		else
+			shard.entries.erase(hash);
+		return resource;
+	}
+
+	// The resource with this hash if something still holds it
+	Handle Find(ContentHash hash) const
+	{
+		const Shard& shard = GetShard(hash);
+		std::lock_guard<std::mutex> lock(shard.lock);
+		typename Table::const_iterator found = shard.entries.find(hash);
+		return found != shard.entries.end() ? found->second.lock() : Handle();
+	}
+
+	// Resources still alive
+	size_t GetCount() const
+	{
+		size_t count = 0;
+		for (unsigned int i = 0; i < ShardCount; i++)
+		{
+			std::lock_guard<std::mutex> lock(shards[i].lock);
+			for (typename Table::const_iterator e = shards[i].entries.begin(); e != shards[i].entries.end(); ++e)
+			{
+				if (!e->second.expired())
+					count++;
+			}
+		}
+		return count;
+	}
+
+	// Requests that found a live resource, and those that had
+	// to create one
+	unsigned int GetHitCount() const { return hits; }
+	unsigned int GetMissCount() const { return misses; }
+
+	// Forgets entries whose resources have been destroyed
+	void Purge()
+	{
+		for (unsigned int i = 0; i < ShardCount; i++)
+		{
+			std::lock_guard<std::mutex> lock(shards[i].lock);
+			for (typename Table::iterator e = shards[i].entries.begin(); e != shards[i].entries.end();)
+			{
+				if (e->second.expired())
+					e = shards[i].entries.erase(e);
+				else
+					++e;
+			}
+		}
+	}
+
+	// Forgets every entry.  Resources still held stay alive,
+	// but are no longer shared with later requests.
+	void Clear()
+	{
+		for (unsigned int i = 0; i < ShardCount; i++)
+		{
+			std::lock_guard<std::mutex> lock(shards[i].lock);
+			shards[i].entries.clear();
+		}
+	}
+
+private:
+	ResourceCache(const ResourceCache&);
+	ResourceCache& operator=(const ResourceCache&);
+
+	static const unsigned int ShardCount = 16;
+
+	struct IdentityHash
+	{
+		size_t operator()(ContentHash hash) const { return (size_t)hash; }
+	};
+
+	typedef std::unordered_map<ContentHash, std::weak_ptr<Resource>, IdentityHash> Table;
+
+	struct Shard
+	{
+		mutable std::mutex	lock;
+		Table				entries;
+	};
+
+	// The top bits pick the shard, leaving the low bits, which
+	// pick the bucket, spread evenly within each one
+	Shard& GetShard(ContentHash hash) { return shards[hash >> 60]; }
+	const Shard& GetShard(ContentHash hash) const { return shards[hash >> 60]; }
+
+	Shard					shards[ShardCount];
+	std::atomic<unsigned int>	hits;
+	std::atomic<unsigned int>	misses;
+};
@@ -58,9 +58,12 @@ float4 main(VertexToPixel input) : SV_TARGET
 	//normal map normal calculate
 	input.normal = normalize(input.normal);
 	input.tangent = normalize(input.tangent);
-	float3 normalFromMap = normalMap.Sample(trilinear, input.uv).rgb;
-	//Unpack the normal
-	normalFromMap = normalFromMap * 2 - 1;
+	float3 normalFromMap;
+	normalFromMap.xy = normalMap.Sample(trilinear, input.uv).rg;
+	//Unpack the normal.  z is rebuilt, so two channel (BC5)
+	//normal maps work as well as RGB ones
+	normalFromMap.xy = normalFromMap.xy * 2 - 1;
+	normalFromMap.z = sqrt(saturate(1 - dot(normalFromMap.xy, normalFromMap.xy)));
 	//Calculate the TBN matrix to go from tangent-space to world-space
 	float3 N = input.normal;	
 	float3 T = input.tangent;//normalize(input.tangent - N * dot(input.tangent, N));
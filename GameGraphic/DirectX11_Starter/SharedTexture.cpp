@@ -0,0 +1,55 @@
+#include "SharedTexture.h"
+#include "DirectXGameCore.h"
+#include <algorithm>
+
+SharedTexture::SharedTexture()
+{
+	loaded = 0;
+	view = 0;
+}
+
+SharedTexture::~SharedTexture()
+{
+	ReleaseMacro(loaded);
+	ReleaseMacro(view);
+}
+
+void SharedTexture::Publish()
+{
+	std::lock_guard<std::mutex> lock(slotLock);
+	if (loaded == view)
+		return;
+
+	// The published view keeps its own reference, apart from
+	// the load target's, so the loader can replace that freely
+	if (loaded)
+		loaded->AddRef();
+	ReleaseMacro(view);
+	view = loaded;
+
+	for (unsigned int i = 0; i < slots.size(); i++)
+	{
+		ID3D11ShaderResourceView*& slot = *slots[i];
+		ReleaseMacro(slot);
+		slot = view;
+		if (view)
+			view->AddRef();
+	}
+}
+
+void SharedTexture::AddSlot(ID3D11ShaderResourceView** slot)
+{
+	std::lock_guard<std::mutex> lock(slotLock);
+	ID3D11ShaderResourceView*& current = *slot;
+	ReleaseMacro(current);
+	current = view;
+	if (view)
+		view->AddRef();
+	slots.push_back(slot);
+}
+
+void SharedTexture::RemoveSlot(ID3D11ShaderResourceView** slot)
+{
+	std::lock_guard<std::mutex> lock(slotLock);
+	slots.erase(std::remove(slots.begin(), slots.end(), slot), slots.end());
+}
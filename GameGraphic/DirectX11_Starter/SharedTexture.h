@@ -0,0 +1,51 @@
+#pragma once
+
+#include <d3d11.h>
+#include <mutex>
+#include <vector>
+
+// --------------------------------------------------------
+// One loaded texture whose view is shared by several
+// material slots.
+//
+// The asset loader and texture streamer write a single view
+// pointer, and replace it when a load finishes or mips
+// stream.  Here that pointer is GetLoadTarget(); Publish()
+// then copies the view into every slot added with
+// AddSlot(), so all of them follow the one load.
+//
+// Every slot owns a reference to the view it holds, the
+// same as a target the loader wrote itself, so materials
+// release their slots as usual.
+// --------------------------------------------------------
+class SharedTexture
+{
+public:
+	SharedTexture();
+	~SharedTexture();
+
+	// For AssetLoader::LoadTexture() or TextureStreamer::LoadTexture()
+	ID3D11ShaderResourceView** GetLoadTarget() { return &loaded; }
+
+	// Copies the load target's current view into every slot.
+	// Call after the loader or streamer has replaced it, on
+	// the same thread.
+	void Publish();
+
+	// Puts the current view in a slot (releasing what it held)
+	// and keeps it up to date until it's removed.  The slot
+	// keeps its reference after RemoveSlot().
+	void AddSlot(ID3D11ShaderResourceView** slot);
+	void RemoveSlot(ID3D11ShaderResourceView** slot);
+
+	ID3D11ShaderResourceView* GetView() const { return view; }
+
+private:
+	SharedTexture(const SharedTexture&);
+	SharedTexture& operator=(const SharedTexture&);
+
+	ID3D11ShaderResourceView*				loaded;		// Written by the loader or streamer
+	ID3D11ShaderResourceView*				view;		// Last published
+	std::vector<ID3D11ShaderResourceView**>	slots;
+	std::mutex								slotLock;
+};
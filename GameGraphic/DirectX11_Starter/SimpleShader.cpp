@@ -1,4 +1,12 @@
 #include "SimpleShader.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+
+namespace
+{
+	// Variable names for each SimpleShaderPatchSlot
+	const char* const PatchSlotNames[SimpleShaderPatch_Count] = { "world", "view", "projection" };
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ BASE SIMPLE SHADER --------------------------------------------------
@@ -15,7 +23,11 @@ ISimpleShader::ISimpleShader(ID3D11Device* device, ID3D11DeviceContext* context)
 	this->deviceContext = context;
 
 	// Set up fields
+	shaderValid = false;
 	constantBufferCount = 0;
+	constantBuffers = 0;
+	memoryHandle = 0;
+	ZeroMemory(patchVariables, sizeof(patchVariables));
 }
 
 // --------------------------------------------------------
@@ -42,6 +54,9 @@ void ISimpleShader::CleanUp()
 	delete[] constantBuffers;
 	constantBufferCount = 0;
 
+	MemoryTracker::Unregister(memoryHandle);
+	memoryHandle = 0;
+
 	for (unsigned int i = 0; i < shaderResourceViews.size(); i++)
 		delete shaderResourceViews[i];
 
@@ -53,6 +68,7 @@ void ISimpleShader::CleanUp()
 	cbTable.clear();
 	samplerTable.clear();
 	textureTable.clear();
+	ZeroMemory(patchVariables, sizeof(patchVariables));
 }
 
 // --------------------------------------------------------
@@ -66,6 +82,8 @@ void ISimpleShader::CleanUp()
 // --------------------------------------------------------
 bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 {
+	PROFILE_SCOPE("SimpleShader::LoadShaderFile");
+
 	// Load the shader to a blob and ensure it worked
 	ID3DBlob* shaderBlob = 0;
 	HRESULT hr = D3DReadFileToBlob(shaderFile, &shaderBlob);
@@ -74,14 +92,29 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		return false;
 	}
 
+	std::string name;
+	for (LPCWSTR c = shaderFile; *c; c++)
+		name += *c < 128 ? (char)*c : '?';
+
+	bool result = LoadShaderBlob(shaderBlob, name);
+	shaderBlob->Release();
+	return result;
+}
+
+// --------------------------------------------------------
+// Creates the shader from compiled bytecode that is already
+// in memory (e.g. read by a loading thread), and builds the
+// variable table.  The blob is not released.
+//
+// name - What the memory tracker calls this shader
+// --------------------------------------------------------
+bool ISimpleShader::LoadShaderBlob(ID3DBlob* shaderBlob, const std::string& name)
+{
 	// Create the shader - Calls an overloaded version of this abstract
 	// method in the appropriate child class
 	shaderValid = CreateShader(shaderBlob);
 	if (!shaderValid)
-	{
-		shaderBlob->Release();
 		return false;
-	}
 
 	// Set up shader reflection to get information about
 	// this shader and its variables,  buffers, etc.
@@ -198,9 +231,28 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 		}
 	}
 
+	// Resolve the patch slots now, rather than on every draw
+	for (unsigned int s = 0; s < SimpleShaderPatch_Count; s++)
+	{
+		SimpleShaderVariable* var = FindVariable(PatchSlotNames[s], -1);
+		if (var != 0)
+			patchVariables[s] = *var;
+	}
+
+	// Account for the bytecode (which the driver keeps its own
+	// copy of) and each constant buffer plus its local copy
+	size_t bufferBytes = 0;
+	for (unsigned int b = 0; b < constantBufferCount; b++)
+		bufferBytes += constantBuffers[b].Size;
+
+	memoryHandle = MemoryTracker::Register(
+		MemoryTag_Shader,
+		name,
+		bufferBytes,
+		shaderBlob->GetBufferSize() + bufferBytes);
+
 	// All set
 	refl->Release();
-	shaderBlob->Release();
 	return true;
 }
 
@@ -211,7 +263,7 @@ bool ISimpleShader::LoadShaderFile(LPCWSTR shaderFile)
 // name - the name of the variable to look for
 // size - the size of the variable (for verification), or -1 to bypass
 // --------------------------------------------------------
-SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
+SimpleShaderVariable* ISimpleShader::FindVariable(const std::string& name, int size)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleShaderVariable>::iterator result =
@@ -235,7 +287,7 @@ SimpleShaderVariable* ISimpleShader::FindVariable(std::string name, int size)
 // --------------------------------------------------------
 // Helper for looking up a constant buffer by name
 // --------------------------------------------------------
-SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(std::string name)
+SimpleConstantBuffer* ISimpleShader::FindConstantBuffer(const std::string& name)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleConstantBuffer*>::iterator result =
@@ -265,7 +317,7 @@ void ISimpleShader::SetShader(bool copyData)
 	if (copyData) CopyAllBufferData();
 
 	// Set the shader and any relevant constant buffers
-	SetShaderAndCB();
+	SetShaderAndCB(deviceContext);
 }
 
 // --------------------------------------------------------
@@ -275,7 +327,7 @@ void ISimpleShader::SetShader(bool copyData)
 //              Useful for updating more frequently-changing
 //              variables without having to re-copy all buffers.
 // --------------------------------------------------------
-void ISimpleShader::CopyBufferData(std::string bufferName)
+void ISimpleShader::CopyBufferData(const std::string& bufferName)
 {
 	// Ensure the shader is valid
 	if (!shaderValid) return;
@@ -288,6 +340,8 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 	deviceContext->UpdateSubresource(
 		cb->ConstantBuffer, 0, 0,
 		cb->LocalDataBuffer, 0, 0);
+	RenderStats::Add(RenderCounter_ConstantBufferUpdates);
+	RenderStats::Add(RenderCounter_ConstantBufferBytes, cb->Size);
 }
 
 // --------------------------------------------------------
@@ -297,6 +351,8 @@ void ISimpleShader::CopyBufferData(std::string bufferName)
 // --------------------------------------------------------
 void ISimpleShader::CopyAllBufferData()
 {
+	PROFILE_SCOPE("SimpleShader::CopyAllBufferData");
+
 	// Ensure the shader is valid
 	if (!shaderValid) return;
 
@@ -307,9 +363,98 @@ void ISimpleShader::CopyAllBufferData()
 		deviceContext->UpdateSubresource(
 			constantBuffers[i].ConstantBuffer, 0, 0,
 			constantBuffers[i].LocalDataBuffer, 0, 0);
+		RenderStats::Add(RenderCounter_ConstantBufferUpdates);
+		RenderStats::Add(RenderCounter_ConstantBufferBytes, constantBuffers[i].Size);
 	}
 }
 
+// --------------------------------------------------------
+// Records this shader, its constant buffers and their data
+// into the given context (usually a deferred context owned
+// by a worker thread)
+//
+// context    - The context to record into
+// patches    - OPTIONAL variables to override for this draw only,
+//              by slot (offsets were found when the shader loaded)
+// patchCount - Number of entries in patches
+//
+// The local data buffers are only read; buffers touched by a
+// patch are copied to a per-thread scratch buffer first
+// --------------------------------------------------------
+void ISimpleShader::RecordShader(ID3D11DeviceContext* context, const SimpleShaderPatch* patches, unsigned int patchCount)
+{
+	PROFILE_SCOPE("SimpleShader::RecordShader");
+
+	// Ensure the shader is valid
+	if (!shaderValid) return;
+
+	// Each recording thread gets its own scratch copy
+	thread_local std::vector<unsigned char> scratch;
+
+	for (unsigned int i = 0; i < constantBufferCount; i++)
+	{
+		const unsigned char* data = constantBuffers[i].LocalDataBuffer;
+
+		// Apply any patches that land in this buffer.  Slots
+		// this shader doesn't have never match (Size 0).
+		bool patched = false;
+		for (unsigned int p = 0; p < patchCount; p++)
+		{
+			const SimpleShaderVariable& var = patchVariables[patches[p].Slot];
+			if (var.Size != patches[p].Size || var.ConstantBufferIndex != i)
+				continue;
+
+			if (!patched)
+			{
+				scratch.assign(data, data + constantBuffers[i].Size);
+				patched = true;
+			}
+			memcpy(&scratch[0] + var.ByteOffset, patches[p].Data, patches[p].Size);
+		}
+
+		// UpdateSubresource copies the data immediately, even on a
+		// deferred context, so the scratch buffer can be reused
+		context->UpdateSubresource(
+			constantBuffers[i].ConstantBuffer, 0, 0,
+			patched ? &scratch[0] : data, 0, 0);
+		RenderStats::Add(RenderCounter_ConstantBufferUpdates);
+		RenderStats::Add(RenderCounter_ConstantBufferBytes, constantBuffers[i].Size);
+	}
+
+	// Set the shader and any relevant constant buffers
+	SetShaderAndCB(context);
+}
+
+// --------------------------------------------------------
+// Records a shader resource view into the given context
+//
+// Returns true if a texture of the given name was found, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::RecordShaderResourceView(ID3D11DeviceContext* context, const std::string& name, ID3D11ShaderResourceView* srv)
+{
+	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
+	if (srvInfo == 0)
+		return false;
+
+	BindShaderResourceView(context, srvInfo->BindIndex, srv);
+	return true;
+}
+
+// --------------------------------------------------------
+// Records a sampler state into the given context
+//
+// Returns true if a sampler of the given name was found, false otherwise
+// --------------------------------------------------------
+bool ISimpleShader::RecordSamplerState(ID3D11DeviceContext* context, const std::string& name, ID3D11SamplerState* samplerState)
+{
+	const SimpleSampler* sampInfo = GetSamplerInfo(name);
+	if (sampInfo == 0)
+		return false;
+
+	BindSamplerState(context, sampInfo->BindIndex, samplerState);
+	return true;
+}
+
 // --------------------------------------------------------
 // Sets a variable by name with arbitrary data of the specified size
 //
@@ -320,7 +465,7 @@ void ISimpleShader::CopyAllBufferData()
 // Returns true if data is copied, false if variable doesn't 
 // exist or sizes don't match
 // --------------------------------------------------------
-bool ISimpleShader::SetData(std::string name, const void* data, unsigned int size)
+bool ISimpleShader::SetData(const std::string& name, const void* data, unsigned int size)
 {
 	// Look for the variable and verify
 	SimpleShaderVariable* var = FindVariable(name, size);
@@ -340,7 +485,7 @@ bool ISimpleShader::SetData(std::string name, const void* data, unsigned int siz
 // --------------------------------------------------------
 // Sets INTEGER data
 // --------------------------------------------------------
-bool ISimpleShader::SetInt(std::string name, int data)
+bool ISimpleShader::SetInt(const std::string& name, int data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(int));
 }
@@ -348,7 +493,7 @@ bool ISimpleShader::SetInt(std::string name, int data)
 // --------------------------------------------------------
 // Sets a FLOAT variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat(std::string name, float data)
+bool ISimpleShader::SetFloat(const std::string& name, float data)
 {
 	return this->SetData(name, (void*)(&data), sizeof(float));
 }
@@ -356,7 +501,7 @@ bool ISimpleShader::SetFloat(std::string name, float data)
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const float data[2])
+bool ISimpleShader::SetFloat2(const std::string& name, const float data[2])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 2);
 }
@@ -364,7 +509,7 @@ bool ISimpleShader::SetFloat2(std::string name, const float data[2])
 // --------------------------------------------------------
 // Sets a FLOAT2 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
+bool ISimpleShader::SetFloat2(const std::string& name, const DirectX::XMFLOAT2 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 2);
 }
@@ -372,7 +517,7 @@ bool ISimpleShader::SetFloat2(std::string name, const DirectX::XMFLOAT2 data)
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const float data[3])
+bool ISimpleShader::SetFloat3(const std::string& name, const float data[3])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 3);
 }
@@ -380,7 +525,7 @@ bool ISimpleShader::SetFloat3(std::string name, const float data[3])
 // --------------------------------------------------------
 // Sets a FLOAT3 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
+bool ISimpleShader::SetFloat3(const std::string& name, const DirectX::XMFLOAT3 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 3);
 }
@@ -388,7 +533,7 @@ bool ISimpleShader::SetFloat3(std::string name, const DirectX::XMFLOAT3 data)
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const float data[4])
+bool ISimpleShader::SetFloat4(const std::string& name, const float data[4])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 4);
 }
@@ -396,7 +541,7 @@ bool ISimpleShader::SetFloat4(std::string name, const float data[4])
 // --------------------------------------------------------
 // Sets a FLOAT4 variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
+bool ISimpleShader::SetFloat4(const std::string& name, const DirectX::XMFLOAT4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 4);
 }
@@ -404,7 +549,7 @@ bool ISimpleShader::SetFloat4(std::string name, const DirectX::XMFLOAT4 data)
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
+bool ISimpleShader::SetMatrix4x4(const std::string& name, const float data[16])
 {
 	return this->SetData(name, (void*)data, sizeof(float) * 16);
 }
@@ -412,7 +557,7 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const float data[16])
 // --------------------------------------------------------
 // Sets a MATRIX (4x4) variable by name in the local data buffer
 // --------------------------------------------------------
-bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data)
+bool ISimpleShader::SetMatrix4x4(const std::string& name, const DirectX::XMFLOAT4X4 data)
 {
 	return this->SetData(name, &data, sizeof(float) * 16);
 }
@@ -420,7 +565,7 @@ bool ISimpleShader::SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 dat
 // --------------------------------------------------------
 // Gets info about a shader variable, if it exists
 // --------------------------------------------------------
-const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
+const SimpleShaderVariable* ISimpleShader::GetVariableInfo(const std::string& name)
 {
 	return FindVariable(name, -1);
 }
@@ -428,7 +573,7 @@ const SimpleShaderVariable* ISimpleShader::GetVariableInfo(std::string name)
 // --------------------------------------------------------
 // Gets the bind index of an SRV in the shader (or null)
 // --------------------------------------------------------
-const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(std::string name)
+const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(const std::string& name)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleSRV*>::iterator result =
@@ -457,7 +602,7 @@ const SimpleSRV* ISimpleShader::GetShaderResourceViewInfo(unsigned int index)
 // --------------------------------------------------------
 // Gets the bind index of a sampler in the shader (or null)
 // --------------------------------------------------------
-const SimpleSampler* ISimpleShader::GetSamplerInfo(std::string name)
+const SimpleSampler* ISimpleShader::GetSamplerInfo(const std::string& name)
 {
 	// Look for the key
 	std::unordered_map<std::string, SimpleSampler*>::iterator result =
@@ -506,7 +651,7 @@ unsigned int ISimpleShader::GetBufferSize(unsigned int index)
 // Gets info about a particular constant buffer 
 // by name, if it exists
 // --------------------------------------------------------
-const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(std::string name)
+const SimpleConstantBuffer * ISimpleShader::GetBufferInfo(const std::string& name)
 {
 	return FindConstantBuffer(name);
 }
@@ -683,19 +828,20 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 // Sets the vertex shader, input layout and constant buffers
 // for future DirectX drawing
 // --------------------------------------------------------
-void SimpleVertexShader::SetShaderAndCB()
+void SimpleVertexShader::SetShaderAndCB(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader and input layout
-	deviceContext->IASetInputLayout(inputLayout);
-	deviceContext->VSSetShader(shader, 0, 0);
+	context->IASetInputLayout(inputLayout);
+	context->VSSetShader(shader, 0, 0);
+	RenderStats::Add(RenderCounter_ShaderBinds);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->VSSetConstantBuffers(
+		context->VSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			&constantBuffers[i].ConstantBuffer);
@@ -710,7 +856,7 @@ void SimpleVertexShader::SetShaderAndCB()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleVertexShader::SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -719,6 +865,7 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderRes
 
 	// Set the shader resource view
 	deviceContext->VSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
 
 	// Success
 	return true;
@@ -732,7 +879,7 @@ bool SimpleVertexShader::SetShaderResourceView(std::string name, ID3D11ShaderRes
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleVertexShader::SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -741,11 +888,32 @@ bool SimpleVertexShader::SetSamplerState(std::string name, ID3D11SamplerState* s
 
 	// Set the shader resource view
 	deviceContext->VSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a shader resource view to the vertex shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleVertexShader::BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	context->VSSetShaderResources(bindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
+}
+
+// --------------------------------------------------------
+// Binds a sampler state to the vertex shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleVertexShader::BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	context->VSSetSamplers(bindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
+}
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // ------ SIMPLE PIXEL SHADER -------------------------------------------------
@@ -802,18 +970,19 @@ bool SimplePixelShader::CreateShader(ID3DBlob* shaderBlob)
 // Sets the pixel shader and constant buffers for
 // future DirectX drawing
 // --------------------------------------------------------
-void SimplePixelShader::SetShaderAndCB()
+void SimplePixelShader::SetShaderAndCB(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->PSSetShader(shader, 0, 0);
+	context->PSSetShader(shader, 0, 0);
+	RenderStats::Add(RenderCounter_ShaderBinds);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->PSSetConstantBuffers(
+		context->PSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			&constantBuffers[i].ConstantBuffer);
@@ -828,7 +997,7 @@ void SimplePixelShader::SetShaderAndCB()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimplePixelShader::SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -837,6 +1006,7 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderReso
 
 	// Set the shader resource view
 	deviceContext->PSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
 
 	// Success
 	return true;
@@ -850,7 +1020,7 @@ bool SimplePixelShader::SetShaderResourceView(std::string name, ID3D11ShaderReso
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimplePixelShader::SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -859,11 +1029,32 @@ bool SimplePixelShader::SetSamplerState(std::string name, ID3D11SamplerState* sa
 
 	// Set the shader resource view
 	deviceContext->PSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a shader resource view to the pixel shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimplePixelShader::BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	context->PSSetShaderResources(bindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
+}
+
+// --------------------------------------------------------
+// Binds a sampler state to the pixel shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimplePixelShader::BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	context->PSSetSamplers(bindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
+}
+
 
 
 
@@ -922,18 +1113,19 @@ bool SimpleDomainShader::CreateShader(ID3DBlob* shaderBlob)
 // Sets the domain shader and constant buffers for
 // future DirectX drawing
 // --------------------------------------------------------
-void SimpleDomainShader::SetShaderAndCB()
+void SimpleDomainShader::SetShaderAndCB(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->DSSetShader(shader, 0, 0);
+	context->DSSetShader(shader, 0, 0);
+	RenderStats::Add(RenderCounter_ShaderBinds);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->DSSetConstantBuffers(
+		context->DSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			&constantBuffers[i].ConstantBuffer);
@@ -948,7 +1140,7 @@ void SimpleDomainShader::SetShaderAndCB()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleDomainShader::SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -957,6 +1149,7 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderRes
 
 	// Set the shader resource view
 	deviceContext->DSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
 
 	// Success
 	return true;
@@ -970,7 +1163,7 @@ bool SimpleDomainShader::SetShaderResourceView(std::string name, ID3D11ShaderRes
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleDomainShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleDomainShader::SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -979,11 +1172,32 @@ bool SimpleDomainShader::SetSamplerState(std::string name, ID3D11SamplerState* s
 
 	// Set the shader resource view
 	deviceContext->DSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a shader resource view to the domain shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleDomainShader::BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	context->DSSetShaderResources(bindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
+}
+
+// --------------------------------------------------------
+// Binds a sampler state to the domain shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleDomainShader::BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	context->DSSetSamplers(bindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1041,18 +1255,19 @@ bool SimpleHullShader::CreateShader(ID3DBlob* shaderBlob)
 // Sets the hull shader and constant buffers for
 // future DirectX drawing
 // --------------------------------------------------------
-void SimpleHullShader::SetShaderAndCB()
+void SimpleHullShader::SetShaderAndCB(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->HSSetShader(shader, 0, 0);
+	context->HSSetShader(shader, 0, 0);
+	RenderStats::Add(RenderCounter_ShaderBinds);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->HSSetConstantBuffers(
+		context->HSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			&constantBuffers[i].ConstantBuffer);
@@ -1067,7 +1282,7 @@ void SimpleHullShader::SetShaderAndCB()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleHullShader::SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1076,6 +1291,7 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResou
 
 	// Set the shader resource view
 	deviceContext->HSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
 
 	// Success
 	return true;
@@ -1089,7 +1305,7 @@ bool SimpleHullShader::SetShaderResourceView(std::string name, ID3D11ShaderResou
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleHullShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleHullShader::SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1098,11 +1314,32 @@ bool SimpleHullShader::SetSamplerState(std::string name, ID3D11SamplerState* sam
 
 	// Set the shader resource view
 	deviceContext->HSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a shader resource view to the hull shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleHullShader::BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	context->HSSetShaderResources(bindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
+}
+
+// --------------------------------------------------------
+// Binds a sampler state to the hull shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleHullShader::BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	context->HSSetSamplers(bindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
+}
+
 
 
 
@@ -1284,18 +1521,19 @@ void SimpleGeometryShader::UnbindStreamOutStage(ID3D11DeviceContext* deviceConte
 // Sets the geometry shader and constant buffers for
 // future DirectX drawing
 // --------------------------------------------------------
-void SimpleGeometryShader::SetShaderAndCB()
+void SimpleGeometryShader::SetShaderAndCB(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->GSSetShader(shader, 0, 0);
+	context->GSSetShader(shader, 0, 0);
+	RenderStats::Add(RenderCounter_ShaderBinds);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->GSSetConstantBuffers(
+		context->GSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			&constantBuffers[i].ConstantBuffer);
@@ -1310,7 +1548,7 @@ void SimpleGeometryShader::SetShaderAndCB()
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleGeometryShader::SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1319,6 +1557,7 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderR
 
 	// Set the shader resource view
 	deviceContext->GSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
 
 	// Success
 	return true;
@@ -1332,7 +1571,7 @@ bool SimpleGeometryShader::SetShaderResourceView(std::string name, ID3D11ShaderR
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleGeometryShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleGeometryShader::SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1341,11 +1580,32 @@ bool SimpleGeometryShader::SetSamplerState(std::string name, ID3D11SamplerState*
 
 	// Set the shader resource view
 	deviceContext->GSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a shader resource view to the geometry shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleGeometryShader::BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	context->GSSetShaderResources(bindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
+}
+
+// --------------------------------------------------------
+// Binds a sampler state to the geometry shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleGeometryShader::BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	context->GSSetSamplers(bindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
+}
+
 // --------------------------------------------------------
 // Calculates the number of components specified by a parameter description mask
 //
@@ -1466,18 +1726,19 @@ bool SimpleComputeShader::CreateShader(ID3DBlob* shaderBlob)
 // Sets the Compute shader and constant buffers for
 // future DirectX drawing
 // --------------------------------------------------------
-void SimpleComputeShader::SetShaderAndCB()
+void SimpleComputeShader::SetShaderAndCB(ID3D11DeviceContext* context)
 {
 	// Is shader valid?
 	if (!shaderValid) return;
 
 	// Set the shader
-	deviceContext->CSSetShader(shader, 0, 0);
+	context->CSSetShader(shader, 0, 0);
+	RenderStats::Add(RenderCounter_ShaderBinds);
 
 	// Set the constant buffers
 	for (unsigned int i = 0; i < constantBufferCount; i++)
 	{
-		deviceContext->CSSetConstantBuffers(
+		context->CSSetConstantBuffers(
 			constantBuffers[i].BindIndex,
 			1,
 			&constantBuffers[i].ConstantBuffer);
@@ -1545,7 +1806,7 @@ void SimpleComputeShader::DispatchByThreads(unsigned int threadsX, unsigned int
 //
 // Returns true if a texture of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv)
+bool SimpleComputeShader::SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv)
 {
 	// Look for the variable and verify
 	const SimpleSRV* srvInfo = GetShaderResourceViewInfo(name);
@@ -1554,6 +1815,7 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderRe
 
 	// Set the shader resource view
 	deviceContext->CSSetShaderResources(srvInfo->BindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
 
 	// Success
 	return true;
@@ -1567,7 +1829,7 @@ bool SimpleComputeShader::SetShaderResourceView(std::string name, ID3D11ShaderRe
 //
 // Returns true if a sampler of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState* samplerState)
+bool SimpleComputeShader::SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState)
 {
 	// Look for the variable and verify
 	const SimpleSampler* sampInfo = GetSamplerInfo(name);
@@ -1576,11 +1838,32 @@ bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState*
 
 	// Set the shader resource view
 	deviceContext->CSSetSamplers(sampInfo->BindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
 
 	// Success
 	return true;
 }
 
+// --------------------------------------------------------
+// Binds a shader resource view to the compute shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleComputeShader::BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv)
+{
+	context->CSSetShaderResources(bindIndex, 1, &srv);
+	RenderStats::Add(RenderCounter_ShaderResourceBinds);
+}
+
+// --------------------------------------------------------
+// Binds a sampler state to the compute shader stage
+// of an arbitrary context (used when recording)
+// --------------------------------------------------------
+void SimpleComputeShader::BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState)
+{
+	context->CSSetSamplers(bindIndex, 1, &samplerState);
+	RenderStats::Add(RenderCounter_SamplerBinds);
+}
+
 // --------------------------------------------------------
 // Sets an unordered access view in the Compute shader stage
 //
@@ -1590,7 +1873,7 @@ bool SimpleComputeShader::SetSamplerState(std::string name, ID3D11SamplerState*
 //
 // Returns true if a UAV of the given name was found, false otherwise
 // --------------------------------------------------------
-bool SimpleComputeShader::SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView * uav, unsigned int appendConsumeOffset)
+bool SimpleComputeShader::SetUnorderedAccessView(const std::string& name, ID3D11UnorderedAccessView * uav, unsigned int appendConsumeOffset)
 {
 	// Look for the variable and verify
 	unsigned int bindIndex = GetUnorderedAccessViewIndex(name);
@@ -1607,7 +1890,7 @@ bool SimpleComputeShader::SetUnorderedAccessView(std::string name, ID3D11Unorder
 // --------------------------------------------------------
 // Gets the index of the specified UAV (or -1)
 // --------------------------------------------------------
-int SimpleComputeShader::GetUnorderedAccessViewIndex(std::string name)
+int SimpleComputeShader::GetUnorderedAccessViewIndex(const std::string& name)
 {
 	// Look for the key
 	std::unordered_map<std::string, unsigned int>::iterator result =
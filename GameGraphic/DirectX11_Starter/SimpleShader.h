@@ -9,6 +9,8 @@
 #include <vector>
 #include <string>
 
+#include "MemoryTracker.h"
+
 // --------------------------------------------------------
 // Used by simple shaders to store information about
 // specific variables in constant buffers
@@ -52,6 +54,31 @@ struct SimpleSampler
 	unsigned int BindIndex; // The register of the Sampler
 };
 
+// --------------------------------------------------------
+// Per-draw variables that can be overridden while recording.
+// Each shader finds these in its buffers when it loads, so
+// recording a draw doesn't look them up by name.
+// --------------------------------------------------------
+enum SimpleShaderPatchSlot
+{
+	SimpleShaderPatch_World,		// "world"
+	SimpleShaderPatch_View,			// "view"
+	SimpleShaderPatch_Projection,	// "projection"
+	SimpleShaderPatch_Count
+};
+
+// --------------------------------------------------------
+// A single variable override used while recording a shader
+// into another context - lets per-draw data (like a world
+// matrix) be sent without touching the shared local buffers
+// --------------------------------------------------------
+struct SimpleShaderPatch
+{
+	SimpleShaderPatchSlot Slot;
+	const void* Data;
+	unsigned int Size;
+};
+
 // --------------------------------------------------------
 // Base abstract class for simplifying shader handling
 // --------------------------------------------------------
@@ -64,6 +91,7 @@ public:
 	// Initialization method (since we can't invoke derived class
 	// overrides in the base class constructor)
 	bool LoadShaderFile(LPCWSTR shaderFile);
+	bool LoadShaderBlob(ID3DBlob* shaderBlob, const std::string& name);
 
 	// Simple helpers
 	bool IsShaderValid() { return shaderValid; }
@@ -71,41 +99,48 @@ public:
 	// Activating the shader and copying data
 	void SetShader(bool copyData = true);
 	void CopyAllBufferData();
-	void CopyBufferData(std::string bufferName);
+	void CopyBufferData(const std::string& bufferName);
+
+	// Recording into an explicit (usually deferred) context.  These
+	// only READ the local data buffers, so several threads may record
+	// the same shader at once as long as nobody calls SetData meanwhile
+	void RecordShader(ID3D11DeviceContext* context, const SimpleShaderPatch* patches = 0, unsigned int patchCount = 0);
+	bool RecordShaderResourceView(ID3D11DeviceContext* context, const std::string& name, ID3D11ShaderResourceView* srv);
+	bool RecordSamplerState(ID3D11DeviceContext* context, const std::string& name, ID3D11SamplerState* samplerState);
 
 	// Sets arbitrary shader data
-	bool SetData(std::string name, const void* data, unsigned int size);
-
-	bool SetInt(std::string name, int data);
-	bool SetFloat(std::string name, float data);
-	bool SetFloat2(std::string name, const float data[2]);
-	bool SetFloat2(std::string name, const DirectX::XMFLOAT2 data);
-	bool SetFloat3(std::string name, const float data[3]);
-	bool SetFloat3(std::string name, const DirectX::XMFLOAT3 data);
-	bool SetFloat4(std::string name, const float data[4]);
-	bool SetFloat4(std::string name, const DirectX::XMFLOAT4 data);
-	bool SetMatrix4x4(std::string name, const float data[16]);
-	bool SetMatrix4x4(std::string name, const DirectX::XMFLOAT4X4 data);
+	bool SetData(const std::string& name, const void* data, unsigned int size);
+
+	bool SetInt(const std::string& name, int data);
+	bool SetFloat(const std::string& name, float data);
+	bool SetFloat2(const std::string& name, const float data[2]);
+	bool SetFloat2(const std::string& name, const DirectX::XMFLOAT2 data);
+	bool SetFloat3(const std::string& name, const float data[3]);
+	bool SetFloat3(const std::string& name, const DirectX::XMFLOAT3 data);
+	bool SetFloat4(const std::string& name, const float data[4]);
+	bool SetFloat4(const std::string& name, const DirectX::XMFLOAT4 data);
+	bool SetMatrix4x4(const std::string& name, const float data[16]);
+	bool SetMatrix4x4(const std::string& name, const DirectX::XMFLOAT4X4 data);
 
 	// Setting shader resources
-	virtual bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv) = 0;
-	virtual bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState) = 0;
+	virtual bool SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv) = 0;
+	virtual bool SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState) = 0;
 
 	// Getting data about variables and resources
-	const SimpleShaderVariable* GetVariableInfo(std::string name);
+	const SimpleShaderVariable* GetVariableInfo(const std::string& name);
 
-	const SimpleSRV* GetShaderResourceViewInfo(std::string name);
+	const SimpleSRV* GetShaderResourceViewInfo(const std::string& name);
 	const SimpleSRV* GetShaderResourceViewInfo(unsigned int index);
 	unsigned int GetShaderResourceViewCount() { return textureTable.size(); }
 
-	const SimpleSampler* GetSamplerInfo(std::string name);
+	const SimpleSampler* GetSamplerInfo(const std::string& name);
 	const SimpleSampler* GetSamplerInfo(unsigned int index);
 	unsigned int GetSamplerCount() { return samplerTable.size(); }
 
 	// Get data about constant buffers
 	unsigned int GetBufferCount();
 	unsigned int GetBufferSize(unsigned int index);
-	const SimpleConstantBuffer* GetBufferInfo(std::string name);
+	const SimpleConstantBuffer* GetBufferInfo(const std::string& name);
 	const SimpleConstantBuffer* GetBufferInfo(unsigned int index);
 
 
@@ -118,6 +153,9 @@ protected:
 	// Resource counts
 	unsigned int constantBufferCount;
 
+	// Bytecode and constant buffers, for memory accounting
+	MemoryHandle memoryHandle;
+
 	// Maps for variables and buffers
 	SimpleConstantBuffer*		constantBuffers; // For index-based lookup
 	std::vector<SimpleSRV*>		shaderResourceViews;
@@ -127,15 +165,21 @@ protected:
 	std::unordered_map<std::string, SimpleSRV*> textureTable;
 	std::unordered_map<std::string, SimpleSampler*> samplerTable;
 
+	// Where each patch slot's variable is (Size 0 if this
+	// shader doesn't have it), found when the shader loads
+	SimpleShaderVariable patchVariables[SimpleShaderPatch_Count];
+
 	// Pure virtual functions for dealing with shader types
 	virtual bool CreateShader(ID3DBlob* shaderBlob) = 0;
-	virtual void SetShaderAndCB() = 0;
+	virtual void SetShaderAndCB(ID3D11DeviceContext* context) = 0;
+	virtual void BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv) = 0;
+	virtual void BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState) = 0;
 
 	virtual void CleanUp();
 
 	// Helpers for finding data by name
-	SimpleShaderVariable* FindVariable(std::string name, int size);
-	SimpleConstantBuffer* FindConstantBuffer(std::string name);
+	SimpleShaderVariable* FindVariable(const std::string& name, int size);
+	SimpleConstantBuffer* FindConstantBuffer(const std::string& name);
 };
 
 // --------------------------------------------------------
@@ -150,14 +194,16 @@ public:
 	ID3D11VertexShader* GetDirectXShader() { return shader; }
 	ID3D11InputLayout* GetInputLayout() { return inputLayout; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11InputLayout* inputLayout;
 	ID3D11VertexShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCB();
+	void SetShaderAndCB(ID3D11DeviceContext* context);
+	void BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -172,13 +218,15 @@ public:
 	~SimplePixelShader();
 	ID3D11PixelShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11PixelShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCB();
+	void SetShaderAndCB(ID3D11DeviceContext* context);
+	void BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -192,13 +240,15 @@ public:
 	~SimpleDomainShader();
 	ID3D11DomainShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11DomainShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCB();
+	void SetShaderAndCB(ID3D11DeviceContext* context);
+	void BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -212,13 +262,15 @@ public:
 	~SimpleHullShader();
 	ID3D11HullShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState);
 
 protected:
 	ID3D11HullShader* shader;
 	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCB();
+	void SetShaderAndCB(ID3D11DeviceContext* context);
+	void BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
 
@@ -232,8 +284,8 @@ public:
 	~SimpleGeometryShader();
 	ID3D11GeometryShader* GetDirectXShader() { return shader; }
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
+	bool SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState);
 
 	bool CreateCompatibleStreamOutBuffer(ID3D11Buffer** buffer, int vertexCount);
 
@@ -250,7 +302,9 @@ protected:
 
 	bool CreateShader(ID3DBlob* shaderBlob);
 	bool CreateShaderWithStreamOut(ID3DBlob* shaderBlob);
-	void SetShaderAndCB();
+	void SetShaderAndCB(ID3D11DeviceContext* context);
+	void BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 
 	// Helpers
@@ -271,11 +325,11 @@ public:
 	void DispatchByGroups(unsigned int groupsX, unsigned int groupsY, unsigned int groupsZ);
 	void DispatchByThreads(unsigned int threadsX, unsigned int threadsY, unsigned int threadsZ);
 
-	bool SetShaderResourceView(std::string name, ID3D11ShaderResourceView* srv);
-	bool SetSamplerState(std::string name, ID3D11SamplerState* samplerState);
-	bool SetUnorderedAccessView(std::string name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
+	bool SetShaderResourceView(const std::string& name, ID3D11ShaderResourceView* srv);
+	bool SetSamplerState(const std::string& name, ID3D11SamplerState* samplerState);
+	bool SetUnorderedAccessView(const std::string& name, ID3D11UnorderedAccessView* uav, unsigned int appendConsumeOffset = -1);
 
-	int GetUnorderedAccessViewIndex(std::string name);
+	int GetUnorderedAccessViewIndex(const std::string& name);
 
 protected:
 	ID3D11ComputeShader* shader;
@@ -287,6 +341,8 @@ protected:
 	unsigned int threadsTotal;
 
 	bool CreateShader(ID3DBlob* shaderBlob);
-	void SetShaderAndCB();
+	void SetShaderAndCB(ID3D11DeviceContext* context);
+	void BindShaderResourceView(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11ShaderResourceView* srv);
+	void BindSamplerState(ID3D11DeviceContext* context, unsigned int bindIndex, ID3D11SamplerState* samplerState);
 	void CleanUp();
 };
\ No newline at end of file
@@ -0,0 +1,170 @@
+#include "SpriteAtlas.h"
+#include "DirectXGameCore.h"
+#include "MipGenerator.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <cstring>
+
+SpriteAtlas::SpriteAtlas()
+{
+	device = 0;
+	context = 0;
+}
+
+SpriteAtlas::~SpriteAtlas()
+{
+	Release();
+}
+
+AtlasSettings SpriteAtlas::GetRuntimeSettings()
+{
+	AtlasSettings settings;
+	settings.method = AtlasPack_Skyline;
+	return settings;
+}
+
+bool SpriteAtlas::Init(ID3D11Device* _device, ID3D11DeviceContext* _context, const AtlasSettings& settings)
+{
+	device = _device;
+	context = _context;
+	atlas.SetSettings(settings);
+	return device && context;
+}
+
+void SpriteAtlas::Release()
+{
+	for (unsigned int i = 0; i < views.size(); i++)
+	{
+		ReleaseMacro(views[i]);
+		ReleaseMacro(textures[i]);
+		MemoryTracker::Unregister(memory[i]);
+	}
+	views.clear();
+	textures.clear();
+	memory.clear();
+	atlas.Clear();
+}
+
+// --------------------------------------------------------
+// Only into an empty atlas, since the layout replaces
+// whatever was there
+// --------------------------------------------------------
+bool SpriteAtlas::Load(const std::string& path, AssetLoader* assetLoader)
+{
+	PROFILE_SCOPE("SpriteAtlas::Load");
+
+	if (!views.empty() || !atlas.Load(path.c_str()))
+		return false;
+
+	const std::vector<AtlasPage>& pages = atlas.GetPages();
+	for (uint32_t i = 0; i < pages.size(); i++)
+	{
+		views.push_back(0);
+		textures.push_back(0);
+		memory.push_back(0);
+
+		std::string file = atlas.GetDirectory() + pages[i].file;
+		assetLoader->LoadTexture(std::wstring(file.begin(), file.end()), &views.back(), AssetPlaceholder_White);
+	}
+	return true;
+}
+
+const AtlasEntry* SpriteAtlas::Add(const std::string& name, const Image& image)
+{
+	return atlas.Insert(name, image);
+}
+
+bool SpriteAtlas::AddFile(const std::string& name, const char* path, JobSystem* jobSystem)
+{
+	Image image;
+	return ImageDecoder::Load(path, image, jobSystem) && Add(name, image) != 0;
+}
+
+bool SpriteAtlas::Upload(JobSystem* jobSystem)
+{
+	PROFILE_SCOPE("SpriteAtlas::Upload");
+
+	atlas.TakeDirtyPages(dirty);
+	bool succeeded = true;
+	for (unsigned int i = 0; i < dirty.size(); i++)
+		succeeded &= UploadPage(dirty[i], jobSystem);
+	return succeeded;
+}
+
+// --------------------------------------------------------
+// The page's texture is made the first time, and after that
+// every level is updated in place, so its view stays valid
+// --------------------------------------------------------
+bool SpriteAtlas::UploadPage(uint32_t page, JobSystem* jobSystem)
+{
+	const AtlasPage& source = atlas.GetPages()[page];
+	while (views.size() <= page)
+	{
+		views.push_back(0);
+		textures.push_back(0);
+		memory.push_back(0);
+	}
+
+	// Box filtered, as the wider filters reach past the gutters
+	// sooner.  Mips below the safe ones would blend neighbours
+	// together.
+	MipSettings settings;
+	settings.filter = MipFilter_Box;
+	chain.resize(MipGenerator::GetChainSize(source.width, source.height));
+	memcpy(chain.data(), source.pixels.data(), source.pixels.size());
+	uint32_t levels = MipGenerator::Generate(chain.data(), source.width, source.height, settings, jobSystem);
+	levels = std::min(levels, atlas.GetSafeMipCount(settings.filter));
+
+	std::vector<D3D11_SUBRESOURCE_DATA> data(levels);
+	size_t offset = 0;
+	uint32_t width = source.width;
+	uint32_t height = source.height;
+	for (uint32_t level = 0; level < levels; level++)
+	{
+		data[level].pSysMem = &chain[offset];
+		data[level].SysMemPitch = width * 4;
+		data[level].SysMemSlicePitch = 0;
+		offset += (size_t)width * height * 4;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+
+	if (textures[page])
+	{
+		for (uint32_t level = 0; level < levels; level++)
+			context->UpdateSubresource(textures[page], level, 0, data[level].pSysMem, data[level].SysMemPitch, 0);
+		return true;
+	}
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = source.width;
+	desc.Height = source.height;
+	desc.MipLevels = levels;
+	desc.ArraySize = 1;
+	desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	if (FAILED(device->CreateTexture2D(&desc, data.data(), &textures[page])))
+		return false;
+	if (FAILED(device->CreateShaderResourceView(textures[page], 0, &views[page])))
+	{
+		ReleaseMacro(textures[page]);
+		return false;
+	}
+
+	size_t bytes = MemoryTracker::EstimateTextureBytes(desc.Width, desc.Height, 1, levels, 32, false);
+	memory[page] = MemoryTracker::Register(MemoryTag_Texture, "Sprite atlas page " + std::to_string(page), 0, bytes);
+	return true;
+}
+
+RECT SpriteAtlas::GetSourceRect(const AtlasEntry& entry)
+{
+	RECT rect;
+	rect.left = (LONG)entry.x;
+	rect.top = (LONG)entry.y;
+	rect.right = (LONG)(entry.x + entry.width);
+	rect.bottom = (LONG)(entry.y + entry.height);
+	return rect;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <d3d11.h>
+#include <deque>
+#include <string>
+#include <vector>
+#include "AssetLoader.h"
+#include "MemoryTracker.h"
+#include "TextureAtlas.h"
+
+class JobSystem;
+
+// --------------------------------------------------------
+// A texture atlas on the GPU, so UI and 2D scenes made of
+// many small images draw in a few SpriteBatch batches: pass
+// GetTexture(entry->page) and GetSourceRect(*entry) to
+// SpriteBatch::Draw() in place of each image's own texture.
+//
+// Atlases cooked offline ("AssetCooker -a") are Load()ed: the
+// layout is read straight away and the page textures come
+// through the asset loader.  At run time, images are Add()ed
+// as they turn up, and Upload() puts the pages they changed
+// on the GPU with as many mips as the gutters keep clean.
+//
+// Page textures keep their views once created, so callers
+// can hold on to them.
+// --------------------------------------------------------
+class SpriteAtlas
+{
+public:
+	SpriteAtlas();
+	~SpriteAtlas();
+
+	// Skyline packing, as images come one at a time
+	static AtlasSettings GetRuntimeSettings();
+
+	bool Init(ID3D11Device* device, ID3D11DeviceContext* context, const AtlasSettings& settings = GetRuntimeSettings());
+	void Release();
+
+	// Reads a cooked atlas and queues its pages on the asset
+	// loader.  Its images can be drawn (from placeholders) at once.
+	bool Load(const std::string& path, AssetLoader* assetLoader);
+
+	// Packs an image onto a page.  Null if it's too big for one.
+	const AtlasEntry* Add(const std::string& name, const Image& image);
+
+	// Decodes an image file and adds it.  False if it can't.
+	bool AddFile(const std::string& name, const char* path, JobSystem* jobSystem = 0);
+
+	// Builds the mips of pages changed since the last call and
+	// uploads them.  Uses the immediate context, so call it on
+	// the render thread.
+	bool Upload(JobSystem* jobSystem = 0);
+
+	const AtlasEntry* Find(const std::string& name) const { return atlas.Find(name); }
+	ID3D11ShaderResourceView* GetTexture(uint32_t page) const { return page < views.size() ? views[page] : 0; }
+	uint32_t GetPageCount() const { return (uint32_t)views.size(); }
+
+	// An image's texels, for SpriteBatch's source rectangle
+	static RECT GetSourceRect(const AtlasEntry& entry);
+
+private:
+	SpriteAtlas(const SpriteAtlas&);
+	SpriteAtlas& operator=(const SpriteAtlas&);
+
+	bool UploadPage(uint32_t page, JobSystem* jobSystem);
+
+	ID3D11Device*							device;
+	ID3D11DeviceContext*					context;
+	TextureAtlas							atlas;
+
+	// One per page.  A deque, so the asset loader's pointers to
+	// the views of loaded pages stay put as pages are added.
+	std::deque<ID3D11ShaderResourceView*>	views;
+	std::vector<ID3D11Texture2D*>			textures;		// Null for loaded pages
+	std::vector<MemoryHandle>				memory;
+
+	std::vector<uint32_t>					dirty;			// Reused by Upload()
+	std::vector<unsigned char>				chain;			// Mips being uploaded
+};
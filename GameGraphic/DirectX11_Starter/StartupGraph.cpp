@@ -0,0 +1,181 @@
+#include "StartupGraph.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <sstream>
+
+StartupGraph::StartupGraph()
+	: jobSystem(0),
+	wallMs(0.0)
+{
+}
+
+StartupGraph::TaskId StartupGraph::Add(const char* name, std::function<void()> work,
+	std::initializer_list<TaskId> dependencies, bool mainThreadOnly)
+{
+	TaskId id = (TaskId)tasks.size();
+
+	std::unique_ptr<Task> task(new Task());
+	task->name = name;
+	task->work = std::move(work);
+	task->waitingOn = 0;
+	task->mainThreadOnly = mainThreadOnly;
+	task->startMs = 0.0;
+	task->endMs = 0.0;
+	task->thread = -1;
+
+	// Ids that don't exist yet are ignored, which rules out cycles
+	for (TaskId dependency : dependencies)
+	{
+		if (dependency >= id)
+			continue;
+		task->dependencies.push_back(dependency);
+		tasks[dependency]->dependents.push_back(id);
+		task->waitingOn++;
+	}
+
+	tasks.push_back(std::move(task));
+	return id;
+}
+
+void StartupGraph::Run(JobSystem& _jobSystem)
+{
+	PROFILE_SCOPE("StartupGraph::Run");
+
+	jobSystem = &_jobSystem;
+	start = std::chrono::steady_clock::now();
+
+	// Roots first; everything else is started by its last dependency
+	for (TaskId id = 0; id < tasks.size(); id++)
+	{
+		if (tasks[id]->dependencies.empty())
+			Launch(id);
+	}
+
+	jobSystem->Wait(&running);
+	wallMs = SinceStart();
+}
+
+double StartupGraph::GetTotalTaskMs() const
+{
+	double total = 0.0;
+	for (unsigned int i = 0; i < tasks.size(); i++)
+		total += tasks[i]->endMs - tasks[i]->startMs;
+	return total;
+}
+
+double StartupGraph::GetCriticalPathMs() const
+{
+	std::vector<TaskId> path;
+	double length;
+	FindCriticalPath(path, length);
+	return length;
+}
+
+std::string StartupGraph::FormatReport() const
+{
+	std::vector<TaskId> path;
+	double length;
+	FindCriticalPath(path, length);
+
+	std::ostringstream outs;
+	outs.precision(2);
+	outs << std::fixed << "Startup: " << wallMs << " ms wall, " << GetTotalTaskMs()
+		<< " ms of tasks, critical path " << length << " ms\n";
+
+	for (TaskId id = 0; id < tasks.size(); id++)
+	{
+		const Task& task = *tasks[id];
+		bool critical = std::find(path.begin(), path.end(), id) != path.end();
+		outs << (critical ? "  * " : "    ") << task.name << "  "
+			<< task.startMs << " - " << task.endMs << " ms ("
+			<< task.endMs - task.startMs << ")  thread " << task.thread << "\n";
+	}
+
+	outs << "Critical path: ";
+	for (unsigned int i = 0; i < path.size(); i++)
+		outs << (i > 0 ? " -> " : "") << tasks[path[i]]->name;
+	outs << "\n";
+	return outs.str();
+}
+
+void StartupGraph::Launch(TaskId id)
+{
+	if (tasks[id]->mainThreadOnly)
+		jobSystem->RunOnMainThread([this, id]() { Execute(id); }, &running);
+	else
+		jobSystem->Run([this, id]() { Execute(id); }, &running);
+}
+
+// --------------------------------------------------------
+// Runs one task, then starts whichever dependents it was
+// the last thing holding up.  They are queued before this
+// job finishes, so the counter can't reach zero early.
+// --------------------------------------------------------
+void StartupGraph::Execute(TaskId id)
+{
+	Task& task = *tasks[id];
+	task.thread = jobSystem->GetThreadIndex();
+	task.startMs = SinceStart();
+	{
+		ProfileScope scope(task.name);
+		if (task.work)
+			task.work();
+	}
+	task.endMs = SinceStart();
+
+	for (unsigned int i = 0; i < task.dependents.size(); i++)
+	{
+		TaskId dependent = task.dependents[i];
+		if (tasks[dependent]->waitingOn.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			Launch(dependent);
+	}
+}
+
+// --------------------------------------------------------
+// Tasks are stored in dependency order, so one pass finds
+// the longest chain ending at each task
+// --------------------------------------------------------
+void StartupGraph::FindCriticalPath(std::vector<TaskId>& path, double& length) const
+{
+	path.clear();
+	length = 0.0;
+	if (tasks.empty())
+		return;
+
+	std::vector<double> chain(tasks.size());
+	std::vector<TaskId> previous(tasks.size());
+	TaskId last = 0;
+	for (TaskId id = 0; id < tasks.size(); id++)
+	{
+		const Task& task = *tasks[id];
+		double before = 0.0;
+		previous[id] = id;
+		for (unsigned int d = 0; d < task.dependencies.size(); d++)
+		{
+			TaskId dependency = task.dependencies[d];
+			if (chain[dependency] > before)
+			{
+				before = chain[dependency];
+				previous[id] = dependency;
+			}
+		}
+
+		chain[id] = before + (task.endMs - task.startMs);
+		if (chain[id] > chain[last])
+			last = id;
+	}
+
+	length = chain[last];
+	for (TaskId id = last; ; id = previous[id])
+	{
+		path.push_back(id);
+		if (previous[id] == id)
+			break;
+	}
+	std::reverse(path.begin(), path.end());
+}
+
+double StartupGraph::SinceStart() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+#include "JobSystem.h"
+
+// --------------------------------------------------------
+// Start-up work declared as tasks with dependencies, e.g.
+//
+//   StartupGraph graph;
+//   StartupGraph::TaskId shaders = graph.Add("Shaders", [&]() { ... });
+//   graph.Add("Materials", [&]() { ... }, { shaders });
+//   graph.Run(jobSystem);
+//
+// Run() starts every task as soon as all of its dependencies
+// have finished, on any job system thread, so independent
+// tasks overlap and the total time approaches the longest
+// chain.  Tasks that need the immediate context can be marked
+// main thread only.
+//
+// A task can only depend on tasks added before it, so the
+// graph can never have a cycle.
+//
+// This file only uses the standard library and the job
+// system, so it also builds on Linux for tools.
+// --------------------------------------------------------
+class StartupGraph
+{
+public:
+	typedef unsigned int TaskId;
+
+	StartupGraph();
+
+	// name must outlive the graph (a string literal, usually)
+	TaskId Add(const char* name, std::function<void()> work,
+		std::initializer_list<TaskId> dependencies = {}, bool mainThreadOnly = false);
+
+	// Runs every task and blocks until they have all finished.
+	// Call from the job system's main thread, once.
+	void Run(JobSystem& jobSystem);
+
+	// --- Timing of the run ---
+	double GetWallMs() const { return wallMs; }
+	double GetTotalTaskMs() const;
+
+	// Longest chain of dependent tasks by duration - the least
+	// time the graph could possibly take
+	double GetCriticalPathMs() const;
+
+	// A line per task (start, end, thread), with the critical
+	// path marked
+	std::string FormatReport() const;
+
+private:
+	StartupGraph(const StartupGraph&);
+	StartupGraph& operator=(const StartupGraph&);
+
+	struct Task
+	{
+		const char*					name;
+		std::function<void()>		work;
+		std::vector<TaskId>			dependencies;
+		std::vector<TaskId>			dependents;
+		std::atomic<unsigned int>	waitingOn;		// Unfinished dependencies
+		bool						mainThreadOnly;
+		double						startMs;
+		double						endMs;
+		int							thread;
+	};
+
+	void Launch(TaskId id);
+	void Execute(TaskId id);
+	void FindCriticalPath(std::vector<TaskId>& path, double& length) const;
+	double SinceStart() const;
+
+	std::vector<std::unique_ptr<Task> >		tasks;
+	JobSystem*								jobSystem;
+	JobCounter								running;
+	std::chrono::steady_clock::time_point	start;
+	double									wallMs;
+};
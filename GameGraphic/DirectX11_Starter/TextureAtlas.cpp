@@ -0,0 +1,409 @@
+#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	FILE* OpenFile(const char* path, const char* mode)
+	{
+		FILE* file = 0;
+#ifdef _MSC_VER
+		if (fopen_s(&file, path, mode) != 0)
+			file = 0;
+#else
+		file = fopen(path, mode);
+#endif
+		return file;
+	}
+
+	// Splits a line at tabs
+	void SplitFields(const std::string& line, std::vector<std::string>& fields)
+	{
+		fields.clear();
+		size_t start = 0;
+		for (;;)
+		{
+			size_t tab = line.find('\t', start);
+			fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+			if (tab == std::string::npos)
+				break;
+			start = tab + 1;
+		}
+	}
+
+	uint32_t ParseNumber(const std::string& text)
+	{
+		return (uint32_t)strtoul(text.c_str(), 0, 10);
+	}
+
+	void SetTexCoords(AtlasEntry& entry, const AtlasPage& page)
+	{
+		entry.u0 = (float)entry.x / page.width;
+		entry.v0 = (float)entry.y / page.height;
+		entry.u1 = (float)(entry.x + entry.width) / page.width;
+		entry.v1 = (float)(entry.y + entry.height) / page.height;
+	}
+}
+
+TextureAtlas::TextureAtlas()
+{
+	SetSettings(AtlasSettings());
+}
+
+void TextureAtlas::SetSettings(const AtlasSettings& _settings)
+{
+	settings = _settings;
+	if (settings.alignment == 0)
+		settings.alignment = 1;
+	settings.gutter = (settings.gutter + settings.alignment - 1) / settings.alignment * settings.alignment;
+}
+
+void TextureAtlas::Add(const std::string& name, const Image& image)
+{
+	Pending added;
+	added.name = name;
+	added.image = image;
+	pending.push_back(added);
+}
+
+// --------------------------------------------------------
+// The packers work in cells of the alignment, so whatever
+// they place is aligned
+// --------------------------------------------------------
+void TextureAtlas::GetCellSize(const Image& image, uint32_t& width, uint32_t& height) const
+{
+	uint32_t a = settings.alignment;
+	width = (image.width + settings.gutter * 2 + a - 1) / a;
+	height = (image.height + settings.gutter * 2 + a - 1) / a;
+}
+
+// --------------------------------------------------------
+// Tries one page of each size from the smallest that could
+// hold everything, up to pageSize, and fills as many pages of
+// the first size that takes them all (or of pageSize) as needed
+// --------------------------------------------------------
+bool TextureAtlas::Build()
+{
+	if (pending.empty())
+		return true;
+
+	uint32_t a = settings.alignment;
+	uint32_t pageCells = settings.pageSize / a;
+	std::vector<AtlasRect> cells(pending.size());
+	uint64_t area = 0;
+	uint32_t largest = 0;
+	for (size_t i = 0; i < pending.size(); i++)
+	{
+		if (pending[i].image.width == 0 || pending[i].image.height == 0)
+			return false;
+		GetCellSize(pending[i].image, cells[i].width, cells[i].height);
+		if (cells[i].width > pageCells || cells[i].height > pageCells)
+			return false;
+		area += (uint64_t)cells[i].width * cells[i].height;
+		largest = std::max(largest, std::max(cells[i].width, cells[i].height));
+	}
+
+	// Longest side first, then largest area, packs tightest
+	std::vector<size_t> order(pending.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&cells](size_t x, size_t y)
+	{
+		uint32_t sideX = std::max(cells[x].width, cells[x].height);
+		uint32_t sideY = std::max(cells[y].width, cells[y].height);
+		if (sideX != sideY)
+			return sideX > sideY;
+		return (uint64_t)cells[x].width * cells[x].height > (uint64_t)cells[y].width * cells[y].height;
+	});
+
+	uint32_t size = a;
+	while (size < settings.pageSize && ((uint64_t)(size / a) * (size / a) < area || size / a < largest))
+		size *= 2;
+	for (; size < settings.pageSize; size *= 2)
+	{
+		AtlasPacker trial;
+		trial.Init(size / a, size / a, settings.method);
+		size_t placed = 0;
+		AtlasRect rect;
+		while (placed < order.size() && trial.Insert(cells[order[placed]].width, cells[order[placed]].height, rect))
+			placed++;
+		if (placed == order.size())
+			break;
+	}
+
+	uint32_t firstPage = (uint32_t)pages.size();
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const Pending& image = pending[order[i]];
+		AtlasRect rect;
+		uint32_t page = firstPage;
+		while (page < pages.size() && !packers[page].Insert(cells[order[i]].width, cells[order[i]].height, rect))
+			page++;
+		if (page == pages.size())
+		{
+			page = AddPage(size);
+			packers[page].Insert(cells[order[i]].width, cells[order[i]].height, rect);
+		}
+		Place(image.name, image.image, page, rect);
+	}
+
+	pending.clear();
+	return true;
+}
+
+const AtlasEntry* TextureAtlas::Insert(const std::string& name, const Image& image)
+{
+	AtlasRect cells;
+	GetCellSize(image, cells.width, cells.height);
+	uint32_t pageCells = settings.pageSize / settings.alignment;
+	if (image.width == 0 || image.height == 0 || cells.width > pageCells || cells.height > pageCells)
+		return 0;
+
+	uint32_t page = 0;
+	AtlasRect rect;
+	while (page < pages.size() && (pages[page].pixels.empty() || !packers[page].Insert(cells.width, cells.height, rect)))
+		page++;
+	if (page == pages.size())
+	{
+		page = AddPage(settings.pageSize);
+		packers[page].Insert(cells.width, cells.height, rect);
+	}
+	return Place(name, image, page, rect);
+}
+
+uint32_t TextureAtlas::AddPage(uint32_t size)
+{
+	AtlasPage page;
+	page.width = size;
+	page.height = size;
+	page.pixels.assign((size_t)size * size * 4, 0);
+	pages.push_back(page);
+
+	packers.push_back(AtlasPacker());
+	packers.back().Init(size / settings.alignment, size / settings.alignment, settings.method);
+	return (uint32_t)pages.size() - 1;
+}
+
+const AtlasEntry* TextureAtlas::Place(const std::string& name, const Image& image, uint32_t page, const AtlasRect& cells)
+{
+	AtlasEntry entry;
+	entry.name = name;
+	entry.page = page;
+	entry.x = cells.x * settings.alignment + settings.gutter;
+	entry.y = cells.y * settings.alignment + settings.gutter;
+	entry.width = image.width;
+	entry.height = image.height;
+	SetTexCoords(entry, pages[page]);
+
+	CopyWithGutter(image, pages[page], entry.x, entry.y);
+	if (std::find(dirtyPages.begin(), dirtyPages.end(), page) == dirtyPages.end())
+		dirtyPages.push_back(page);
+
+	AddEntry(entry);
+	return Find(name);
+}
+
+// --------------------------------------------------------
+// Each row is written with its first and last texels
+// repeated out into the gutter, and the first and last rows
+// repeated above and below
+// --------------------------------------------------------
+void TextureAtlas::CopyWithGutter(const Image& image, AtlasPage& page, uint32_t x, uint32_t y) const
+{
+	uint32_t g = settings.gutter;
+	size_t rowBytes = (size_t)image.width * 4;
+	for (uint32_t row = 0; row < image.height + g * 2; row++)
+	{
+		uint32_t sourceRow = row < g ? 0 : std::min(row - g, image.height - 1);
+		const unsigned char* source = &image.pixels[sourceRow * rowBytes];
+		unsigned char* dest = &page.pixels[(((size_t)(y - g + row)) * page.width + (x - g)) * 4];
+
+		for (uint32_t i = 0; i < g; i++)
+			memcpy(dest + i * 4, source, 4);
+		memcpy(dest + g * 4, source, rowBytes);
+		for (uint32_t i = 0; i < g; i++)
+			memcpy(dest + (g + image.width + i) * 4, source + rowBytes - 4, 4);
+	}
+}
+
+void TextureAtlas::AddEntry(const AtlasEntry& entry)
+{
+	std::unordered_map<std::string, size_t>::iterator it = lookup.find(entry.name);
+	if (it != lookup.end())
+	{
+		entries[it->second] = entry;
+		return;
+	}
+
+	lookup[entry.name] = entries.size();
+	entries.push_back(entry);
+}
+
+const AtlasEntry* TextureAtlas::Find(const std::string& name) const
+{
+	std::unordered_map<std::string, size_t>::const_iterator it = lookup.find(name);
+	return it != lookup.end() ? &entries[it->second] : 0;
+}
+
+// --------------------------------------------------------
+// A texel of a level covers a square of size x size top
+// level texels.  The squares around an image can start up to
+// size - alignment texels before it and end up to size - 1
+// after it, and on the way down each level's filter reads
+// further out again.  A level is safe while all of that stays
+// inside the gutter.
+// --------------------------------------------------------
+uint32_t TextureAtlas::GetSafeMipCount(MipFilter filter) const
+{
+	uint32_t reach = MipGenerator::GetFilterReach(filter);
+	uint32_t a = settings.alignment;
+	uint32_t g = settings.gutter;
+	uint32_t spread = 0;
+	uint32_t levels = 1;
+	for (uint32_t size = 2; size <= settings.pageSize; size *= 2)
+	{
+		spread += reach * size / 2;
+		uint32_t before = (size > a ? size - a : 0) + spread;
+		uint32_t after = size - 1 + spread;
+		if (before > g || after > g)
+			break;
+		levels++;
+	}
+	return levels;
+}
+
+void TextureAtlas::TakeDirtyPages(std::vector<uint32_t>& dirty)
+{
+	dirty.swap(dirtyPages);
+	dirtyPages.clear();
+}
+
+bool TextureAtlas::Save(const char* path) const
+{
+	FILE* file = OpenFile(path, "wb");
+	if (!file)
+		return false;
+
+	fprintf(file, "# Texture atlas - written by the asset cooker\n");
+	fprintf(file, "version\t%u\n", Version);
+	for (size_t i = 0; i < pages.size(); i++)
+		fprintf(file, "page\t%u\t%s\t%u\t%u\n", (unsigned int)i, pages[i].file.c_str(), pages[i].width, pages[i].height);
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		const AtlasEntry& entry = entries[i];
+		fprintf(file, "image\t%s\t%u\t%u\t%u\t%u\t%u\n", entry.name.c_str(), entry.page,
+			entry.x, entry.y, entry.width, entry.height);
+	}
+
+	bool failed = ferror(file) != 0;
+	return fclose(file) == 0 && !failed;
+}
+
+bool TextureAtlas::Load(const char* path)
+{
+	Clear();
+
+	FILE* file = OpenFile(path, "rb");
+	if (!file)
+		return false;
+
+	std::string text;
+	char chunk[4096];
+	size_t read;
+	while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		text.append(chunk, read);
+	fclose(file);
+
+	if (!Parse(text))
+		return false;
+
+	const char* slash = strrchr(path, '/');
+	const char* backslash = strrchr(path, '\\');
+	if (backslash > slash)
+		slash = backslash;
+	if (slash)
+		directory.assign(path, slash + 1);
+	return true;
+}
+
+// --------------------------------------------------------
+// Pages come before the images on them.  Lines that don't
+// make sense are skipped.
+// --------------------------------------------------------
+bool TextureAtlas::Parse(const std::string& text)
+{
+	Clear();
+
+	std::vector<std::string> fields;
+	bool versionOk = false;
+	size_t start = 0;
+	while (start < text.size())
+	{
+		size_t end = text.find('\n', start);
+		if (end == std::string::npos)
+			end = text.size();
+		std::string line = text.substr(start, end - start);
+		start = end + 1;
+
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.erase(line.size() - 1);
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		SplitFields(line, fields);
+		if (!versionOk)
+		{
+			versionOk = fields.size() == 2 && fields[0] == "version" && ParseNumber(fields[1]) == Version;
+			if (!versionOk)
+				break;
+			continue;
+		}
+
+		if (fields[0] == "page" && fields.size() == 5 && ParseNumber(fields[1]) == pages.size())
+		{
+			AtlasPage page;
+			page.file = fields[2];
+			page.width = ParseNumber(fields[3]);
+			page.height = ParseNumber(fields[4]);
+			if (page.width > 0 && page.height > 0)
+				pages.push_back(page);
+		}
+		else if (fields[0] == "image" && fields.size() == 7)
+		{
+			AtlasEntry entry;
+			entry.name = fields[1];
+			entry.page = ParseNumber(fields[2]);
+			entry.x = ParseNumber(fields[3]);
+			entry.y = ParseNumber(fields[4]);
+			entry.width = ParseNumber(fields[5]);
+			entry.height = ParseNumber(fields[6]);
+			if (entry.page >= pages.size())
+				continue;
+			SetTexCoords(entry, pages[entry.page]);
+			AddEntry(entry);
+		}
+	}
+
+	if (!versionOk)
+		Clear();
+	return versionOk;
+}
+
+void TextureAtlas::ReleasePixels()
+{
+	for (size_t i = 0; i < pages.size(); i++)
+		std::vector<unsigned char>().swap(pages[i].pixels);
+}
+
+void TextureAtlas::Clear()
+{
+	pending.clear();
+	entries.clear();
+	lookup.clear();
+	pages.clear();
+	packers.clear();
+	dirtyPages.clear();
+	directory.clear();
+}
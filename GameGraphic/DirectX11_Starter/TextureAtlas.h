@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AtlasPacker.h"
+#include "ImageDecoder.h"
+#include "MipGenerator.h"
+
+struct AtlasSettings
+{
+	uint32_t		pageSize;		// Largest page, a power of two
+	uint32_t		gutter;			// Edge texels repeated around each image
+	uint32_t		alignment;		// Images start on multiples of this, a power of two
+	AtlasPackMethod	method;
+
+	AtlasSettings() : pageSize(2048), gutter(4), alignment(4), method(AtlasPack_MaxRects) { }
+};
+
+// --------------------------------------------------------
+// Where one image ended up: its texels on a page, and the
+// same rectangle as texture coordinates
+// --------------------------------------------------------
+struct AtlasEntry
+{
+	std::string		name;
+	uint32_t		page;
+	uint32_t		x;
+	uint32_t		y;
+	uint32_t		width;
+	uint32_t		height;
+	float			u0;
+	float			v0;
+	float			u1;
+	float			v1;
+};
+
+// --------------------------------------------------------
+// One texture of an atlas.  pixels (RGBA8) is only filled
+// while building; loaded atlases have the file instead.
+// --------------------------------------------------------
+struct AtlasPage
+{
+	std::string					file;		// Relative to the atlas
+	uint32_t					width;
+	uint32_t					height;
+	std::vector<unsigned char>	pixels;
+};
+
+// --------------------------------------------------------
+// Packs many small images into a few large textures, so
+// sprites using any of them draw without switching textures
+// (and SpriteBatch doesn't break its batch between them).
+//
+// Offline, images are Add()ed and then Build() packs them
+// all at once, largest first, into the smallest square page
+// that fits them, spilling onto more pages at pageSize.  At
+// run time, Insert() places one image at a time on pages of
+// pageSize, opening a new page when none has room.
+//
+// Each image is surrounded by a gutter of its own edge
+// texels, and starts on a multiple of the alignment, so
+// filtering (and mips, down to GetSafeMipCount()) never
+// blends in a neighbour.  An alignment of 4 also keeps
+// images on whole blocks for block compression.
+//
+// The layout is stored as text, one tab separated line per
+// page and per image:
+//   page  index  file  width  height
+//   image  name  page  x  y  width  height
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+class TextureAtlas
+{
+public:
+	static const unsigned int Version = 1;
+
+	TextureAtlas();
+
+	// Call before adding anything.  The gutter is rounded up to
+	// a multiple of the alignment.
+	void SetSettings(const AtlasSettings& settings);
+	const AtlasSettings& GetSettings() const { return settings; }
+
+	// Queues a copy of an image for Build()
+	void Add(const std::string& name, const Image& image);
+
+	// Packs everything added since the last Build().  False if
+	// an image is too big for a page.
+	bool Build();
+
+	// Packs and copies in one image straight away.  Null if it
+	// is too big for a page.
+	const AtlasEntry* Insert(const std::string& name, const Image& image);
+
+	const AtlasEntry* Find(const std::string& name) const;
+
+	const std::vector<AtlasEntry>& GetEntries() const { return entries; }
+	const std::vector<AtlasPage>& GetPages() const { return pages; }
+
+	// Mip levels (counting the top one) the gutters and
+	// alignment keep images apart in, when the pages' mips are
+	// made with filter.  Box filtered mips get the most.
+	uint32_t GetSafeMipCount(MipFilter filter) const;
+
+	// Pages changed by Insert() since the last call, for
+	// uploading again
+	void TakeDirtyPages(std::vector<uint32_t>& dirty);
+
+	// Names each page's file (pages[i].file) before saving
+	void SetPageFile(uint32_t page, const std::string& file) { pages[page].file = file; }
+
+	bool Save(const char* path) const;
+	bool Load(const char* path);
+	bool Parse(const std::string& text);
+
+	// Folder the atlas was loaded from, with a trailing slash -
+	// page files are relative to it
+	const std::string& GetDirectory() const { return directory; }
+
+	// Frees the pages' pixels once they've been saved or uploaded
+	void ReleasePixels();
+	void Clear();
+
+private:
+	struct Pending
+	{
+		std::string		name;
+		Image			image;
+	};
+
+	void GetCellSize(const Image& image, uint32_t& width, uint32_t& height) const;
+	uint32_t AddPage(uint32_t size);
+	const AtlasEntry* Place(const std::string& name, const Image& image, uint32_t page, const AtlasRect& cells);
+	void CopyWithGutter(const Image& image, AtlasPage& page, uint32_t x, uint32_t y) const;
+	void AddEntry(const AtlasEntry& entry);
+
+	AtlasSettings								settings;
+	std::vector<Pending>						pending;
+	std::vector<AtlasEntry>						entries;
+	std::unordered_map<std::string, size_t>		lookup;
+	std::vector<AtlasPage>						pages;
+	std::vector<AtlasPacker>					packers;		// One per page, in cells
+	std::vector<uint32_t>						dirtyPages;
+	std::string									directory;
+};
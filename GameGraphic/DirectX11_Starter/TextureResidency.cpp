@@ -0,0 +1,213 @@
+#include "TextureResidency.h"
+#include <algorithm>
+#include <cmath>
+
+TextureResidency::TextureResidency()
+{
+	budget = 64 * 1024 * 1024;
+	residentBytes = 0;
+	frame = 0;
+}
+
+uint32_t TextureResidency::AddTexture(const size_t* mipBytes, uint32_t mipCount, uint32_t pinnedMip)
+{
+	if (mipCount == 0)
+		return InvalidTexture;
+
+	uint32_t index;
+	if (!freeSlots.empty())
+	{
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		index = (uint32_t)textures.size();
+		textures.push_back(Texture());
+	}
+
+	Texture& texture = textures[index];
+	texture.mipBytes.assign(mipBytes, mipBytes + mipCount);
+	texture.pinnedMip = std::min(pinnedMip, mipCount - 1);
+	texture.residentMip = texture.pinnedMip;
+	texture.wantedMip = texture.pinnedMip;
+	texture.requestedMip = InvalidTexture;
+	texture.lastUsed = frame;
+	texture.active = true;
+
+	residentBytes += GetTextureBytes(index);
+	return index;
+}
+
+void TextureResidency::RemoveTexture(uint32_t index)
+{
+	if (index >= textures.size() || !textures[index].active)
+		return;
+
+	residentBytes -= GetTextureBytes(index);
+	textures[index].active = false;
+	textures[index].mipBytes.clear();
+	freeSlots.push_back(index);
+}
+
+void TextureResidency::Request(uint32_t index, uint32_t mip)
+{
+	Texture& texture = textures[index];
+	if (texture.requestedMip == InvalidTexture || mip < texture.requestedMip)
+		texture.requestedMip = mip;
+}
+
+size_t TextureResidency::GetTextureBytes(uint32_t index) const
+{
+	const Texture& texture = textures[index];
+	size_t bytes = 0;
+	for (size_t i = texture.residentMip; i < texture.mipBytes.size(); i++)
+		bytes += texture.mipBytes[i];
+	return bytes;
+}
+
+uint32_t TextureResidency::SelectMip(uint32_t width, uint32_t height, uint32_t mipCount, float screenSize, float bias)
+{
+	if (mipCount == 0)
+		return 0;
+	if (screenSize <= 0.0f)
+		return mipCount - 1;
+
+	// Each level halves the texels across, so one more level
+	// is needed for every halving of the screen size
+	float texels = (float)std::max(width, height);
+	float level = std::floor(std::log2(texels / screenSize) + bias);
+	if (level <= 0.0f)
+		return 0;
+	return (uint32_t)std::min(level, (float)(mipCount - 1));
+}
+
+// --------------------------------------------------------
+// Mips of textures not used this frame can go, and so can
+// detail beyond what a used texture asked for.  The pinned
+// tail never goes.
+// --------------------------------------------------------
+bool TextureResidency::IsEvictable(const Texture& texture) const
+{
+	if (!texture.active || texture.residentMip >= texture.pinnedMip)
+		return false;
+	return texture.lastUsed < frame || texture.residentMip < texture.wantedMip;
+}
+
+// --------------------------------------------------------
+// The least recently used texture with a mip to spare.
+// Between textures last used in the same frame, the one
+// holding the most unneeded detail goes first.
+// --------------------------------------------------------
+uint32_t TextureResidency::FindVictim(uint32_t loading) const
+{
+	uint32_t victim = InvalidTexture;
+	for (uint32_t i = 0; i < textures.size(); i++)
+	{
+		const Texture& texture = textures[i];
+		if (i == loading || !IsEvictable(texture))
+			continue;
+		if (victim == InvalidTexture)
+		{
+			victim = i;
+			continue;
+		}
+
+		const Texture& best = textures[victim];
+		int excess = (int)texture.wantedMip - (int)texture.residentMip;
+		int bestExcess = (int)best.wantedMip - (int)best.residentMip;
+		if (texture.lastUsed < best.lastUsed || (texture.lastUsed == best.lastUsed && excess > bestExcess))
+			victim = i;
+	}
+	return victim;
+}
+
+// --------------------------------------------------------
+// Moves a texture's resident mip and merges the move into
+// this update's change for it
+// --------------------------------------------------------
+void TextureResidency::Move(uint32_t index, uint32_t mip, std::vector<ResidencyChange>& changes, size_t firstChange)
+{
+	Texture& texture = textures[index];
+	uint32_t oldMip = texture.residentMip;
+	residentBytes -= GetTextureBytes(index);
+	texture.residentMip = mip;
+	residentBytes += GetTextureBytes(index);
+
+	for (size_t i = firstChange; i < changes.size(); i++)
+	{
+		if (changes[i].texture != index)
+			continue;
+		changes[i].newMip = mip;
+		if (changes[i].newMip == changes[i].oldMip)
+			changes.erase(changes.begin() + i);
+		return;
+	}
+
+	ResidencyChange change = { index, oldMip, mip };
+	changes.push_back(change);
+}
+
+void TextureResidency::Update(std::vector<ResidencyChange>& changes, unsigned int maxLoads)
+{
+	frame++;
+	size_t firstChange = changes.size();
+
+	// Take this frame's requests, and list the textures that
+	// want more detail than they have
+	candidates.clear();
+	for (uint32_t i = 0; i < textures.size(); i++)
+	{
+		Texture& texture = textures[i];
+		if (!texture.active || texture.requestedMip == InvalidTexture)
+			continue;
+
+		texture.wantedMip = std::min(texture.requestedMip, texture.pinnedMip);
+		texture.requestedMip = InvalidTexture;
+		texture.lastUsed = frame;
+		if (texture.wantedMip < texture.residentMip)
+			candidates.push_back(i);
+	}
+
+	// The blurriest first
+	std::stable_sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b)
+	{
+		return textures[a].residentMip - textures[a].wantedMip > textures[b].residentMip - textures[b].wantedMip;
+	});
+
+	// One mip per texture per pass, so a single big texture
+	// doesn't take every load
+	unsigned int loads = 0;
+	while (loads < maxLoads && !candidates.empty())
+	{
+		for (size_t c = 0; c < candidates.size() && loads < maxLoads;)
+		{
+			uint32_t index = candidates[c];
+			Texture& texture = textures[index];
+			size_t needed = texture.mipBytes[texture.residentMip - 1];
+
+			bool fits = true;
+			while (residentBytes + needed > budget)
+			{
+				uint32_t victim = FindVictim(index);
+				if (victim == InvalidTexture)
+				{
+					fits = false;
+					break;
+				}
+				Move(victim, textures[victim].residentMip + 1, changes, firstChange);
+			}
+
+			if (fits)
+			{
+				Move(index, texture.residentMip - 1, changes, firstChange);
+				loads++;
+			}
+
+			if (!fits || texture.residentMip <= texture.wantedMip)
+				candidates.erase(candidates.begin() + c);
+			else
+				c++;
+		}
+	}
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// --------------------------------------------------------
+// A texture whose most detailed resident mip has moved.
+// Mips are numbered from the largest (0), so streaming in
+// lowers the number and evicting raises it.
+// --------------------------------------------------------
+struct ResidencyChange
+{
+	uint32_t	texture;
+	uint32_t	oldMip;
+	uint32_t	newMip;
+};
+
+// --------------------------------------------------------
+// Decides which mip levels of streamed textures should be
+// resident, without touching any of them.
+//
+// Each texture keeps a tail of small mips resident all the
+// time, so there is always something to sample.  Every frame
+// the textures in use ask for the most detailed mip their
+// screen size needs (Request()), and Update() moves each
+// towards it one mip per load, blurriest first - the ones
+// furthest from the mip they asked for.
+//
+// Everything resident counts against a byte budget.  When a
+// load doesn't fit, mips are evicted from the least recently
+// used textures first, then from textures holding more
+// detail than they asked for.  Mips a texture used this
+// frame needs are never evicted to make room for another, so
+// a full budget stops loading instead of thrashing.
+//
+// Update() changes the residency straight away: the caller
+// applies the changes it returns, and can treat loads still
+// in flight as resident.
+//
+// This file only uses the standard library, so it also
+// builds on Linux for tools.
+// --------------------------------------------------------
+class TextureResidency
+{
+public:
+	static const uint32_t InvalidTexture = 0xFFFFFFFF;
+
+	TextureResidency();
+
+	void SetBudget(size_t bytes) { budget = bytes; }
+	size_t GetBudget() const { return budget; }
+	size_t GetResidentBytes() const { return residentBytes; }
+
+	// mipBytes holds the size of each level, largest first.
+	// Mips from pinnedMip down are resident from the start and
+	// never evicted.
+	uint32_t AddTexture(const size_t* mipBytes, uint32_t mipCount, uint32_t pinnedMip);
+	void RemoveTexture(uint32_t texture);
+
+	// Records a use this frame.  The most detailed mip asked
+	// for in a frame wins.
+	void Request(uint32_t texture, uint32_t mip);
+
+	// Ends the frame.  Streams in at most maxLoads mips,
+	// evicting as needed, and appends one change for each
+	// texture whose resident mip moved.
+	void Update(std::vector<ResidencyChange>& changes, unsigned int maxLoads = 4);
+
+	uint32_t GetResidentMip(uint32_t texture) const { return textures[texture].residentMip; }
+	uint32_t GetWantedMip(uint32_t texture) const { return textures[texture].wantedMip; }
+	size_t GetTextureBytes(uint32_t texture) const;
+
+	// The most detailed mip worth having for a width x height
+	// texture that covers screenSize pixels across on screen,
+	// assuming its UVs span the surface once.  bias > 0 asks
+	// for less detail.
+	static uint32_t SelectMip(uint32_t width, uint32_t height, uint32_t mipCount, float screenSize, float bias = 0.0f);
+
+private:
+	struct Texture
+	{
+		std::vector<size_t>	mipBytes;
+		uint32_t			pinnedMip;
+		uint32_t			residentMip;
+		uint32_t			wantedMip;
+		uint32_t			requestedMip;		// This frame's, or InvalidTexture
+		uint64_t			lastUsed;			// Frame number
+		bool				active;
+	};
+
+	bool IsEvictable(const Texture& texture) const;
+	uint32_t FindVictim(uint32_t loading) const;
+	void Move(uint32_t texture, uint32_t mip, std::vector<ResidencyChange>& changes, size_t firstChange);
+
+	std::vector<Texture>	textures;
+	std::vector<uint32_t>	freeSlots;
+	std::vector<uint32_t>	candidates;			// Reused by Update()
+	size_t					budget;
+	size_t					residentBytes;
+	uint64_t				frame;
+};
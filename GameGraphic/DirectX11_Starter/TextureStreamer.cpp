@@ -0,0 +1,391 @@
+#include "TextureStreamer.h"
+#include "DirectXGameCore.h"
+#include "FramePacket.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "Profiler.h"
+#include <cmath>
+
+namespace
+{
+	uint32_t MipExtent(uint32_t size, uint32_t mip)
+	{
+		uint32_t extent = size >> mip;
+		return extent > 0 ? extent : 1;
+	}
+
+	std::string ToNarrow(const std::wstring& text)
+	{
+		std::string result;
+		for (unsigned int i = 0; i < text.size(); i++)
+			result += text[i] < 128 ? (char)text[i] : '?';
+		return result;
+	}
+}
+
+TextureStreamer::TextureStreamer()
+{
+	device = 0;
+	context = 0;
+	jobSystem = 0;
+	assetLoader = 0;
+	mipBias = 0.0f;
+	residency.SetBudget(DefaultBudget);
+}
+
+TextureStreamer::~TextureStreamer()
+{
+	Release();
+}
+
+bool TextureStreamer::Init(ID3D11Device* _device, ID3D11DeviceContext* _context, JobSystem* _jobSystem, AssetLoader* _assetLoader)
+{
+	device = _device;
+	context = _context;
+	jobSystem = _jobSystem;
+	assetLoader = _assetLoader;
+	return device && context && jobSystem && assetLoader;
+}
+
+// --------------------------------------------------------
+// Lets prefetches finish, then drops the textures.  The
+// views stay with the materials that hold them.
+// --------------------------------------------------------
+void TextureStreamer::Release()
+{
+	if (jobSystem)
+		jobSystem->Wait(&prefetchJobs);
+
+	for (unsigned int i = 0; i < textures.size(); i++)
+	{
+		if (!textures[i])
+			continue;
+		ReleaseMacro(textures[i]->texture);
+		MemoryTracker::Unregister(textures[i]->memory);
+		residency.RemoveTexture(textures[i]->residencyId);
+	}
+	textures.clear();
+	byView.clear();
+	unsettled.clear();
+}
+
+void TextureStreamer::LoadTexture(const std::wstring& path, ID3D11ShaderResourceView** target, AssetPlaceholder placeholder,
+	AssetCallback onChanged)
+{
+	PROFILE_SCOPE("TextureStreamer::LoadTexture");
+
+	std::unique_ptr<StreamedTexture> texture(new StreamedTexture());
+	texture->name = ToNarrow(path);
+	texture->target = target;
+	texture->texture = 0;
+	texture->unsettled = false;
+	texture->memory = 0;
+	texture->onChanged = onChanged;
+
+	// Anything that can't be streamed is loaded whole
+	size_t size = 0;
+	if (!assetLoader->MapFile(path, texture->file, texture->data, size) || !ReadLayout(texture.get(), size))
+	{
+		assetLoader->LoadTexture(path, target, placeholder, onChanged);
+		return;
+	}
+
+	std::vector<size_t> mipBytes(texture->desc.mipCount);
+	for (uint32_t i = 0; i < texture->desc.mipCount; i++)
+		mipBytes[i] = texture->mipOffsets[i + 1] - texture->mipOffsets[i];
+
+	uint32_t pinnedMip = GetPinnedMip(texture->desc);
+	texture->texture = CreateTexture(texture.get(), pinnedMip, true);
+	ID3D11ShaderResourceView* srv = 0;
+	if (!texture->texture || FAILED(device->CreateShaderResourceView(texture->texture, 0, &srv)))
+	{
+		ReleaseMacro(texture->texture);
+		texture->file.Close();
+		assetLoader->LoadTexture(path, target, placeholder, onChanged);
+		return;
+	}
+
+	*target = srv;
+	texture->appliedMip = pinnedMip;
+	texture->prefetchedMip = pinnedMip;
+	texture->prefetchTarget = pinnedMip;
+
+	std::lock_guard<std::mutex> lock(loadLock);
+	texture->residencyId = residency.AddTexture(mipBytes.data(), texture->desc.mipCount, pinnedMip);
+	texture->memory = MemoryTracker::Register(MemoryTag_Texture, texture->name, 0, residency.GetTextureBytes(texture->residencyId));
+
+	byView[srv] = texture->residencyId;
+	if (textures.size() <= texture->residencyId)
+		textures.resize(texture->residencyId + 1);
+	textures[texture->residencyId] = std::move(texture);
+}
+
+// --------------------------------------------------------
+// Finds where each level is in the file.  False unless it is
+// a DDS the streamer can use.
+// --------------------------------------------------------
+bool TextureStreamer::ReadLayout(StreamedTexture* texture, size_t size) const
+{
+	DdsTextureInfo info;
+	if (!DdsFile::ParseTextureInfo(texture->data, size, info) || info.arraySize != 1 || info.image.mipCount < 2)
+		return false;
+
+	DdsImageDesc& desc = texture->desc;
+	desc = info.image;
+	texture->mipOffsets.resize(desc.mipCount + 1);
+	for (uint32_t i = 0; i < desc.mipCount; i++)
+		texture->mipOffsets[i] = DdsFile::GetSurface(info, 0, i).offset;
+	texture->mipOffsets[desc.mipCount] = info.dataOffset + info.dataSize;
+	return true;
+}
+
+// --------------------------------------------------------
+// The first level no larger than PinnedSize.  Block
+// compressed textures can only start at levels that are
+// whole blocks across, so it stops short of any that aren't.
+// --------------------------------------------------------
+uint32_t TextureStreamer::GetPinnedMip(const DdsImageDesc& desc) const
+{
+	bool blocks = DdsFile::IsBlockCompressed(desc.format);
+	uint32_t pinned = 0;
+	for (uint32_t mip = 1; mip < desc.mipCount; mip++)
+	{
+		uint32_t width = MipExtent(desc.width, mip);
+		uint32_t height = MipExtent(desc.height, mip);
+		if (blocks && (width % 4 != 0 || height % 4 != 0))
+			break;
+		if (MipExtent(desc.width, pinned) <= PinnedSize && MipExtent(desc.height, pinned) <= PinnedSize)
+			break;
+		pinned = mip;
+	}
+	return pinned;
+}
+
+// --------------------------------------------------------
+// A texture holding levels topMip and down.  With data, they
+// are filled from the file; otherwise they are left for the
+// caller to copy in.
+// --------------------------------------------------------
+ID3D11Texture2D* TextureStreamer::CreateTexture(const StreamedTexture* texture, uint32_t topMip, bool withData) const
+{
+	const DdsImageDesc& image = texture->desc;
+	D3D11_TEXTURE2D_DESC desc = {};
+	desc.Width = MipExtent(image.width, topMip);
+	desc.Height = MipExtent(image.height, topMip);
+	desc.MipLevels = image.mipCount - topMip;
+	desc.ArraySize = 1;
+	desc.Format = (DXGI_FORMAT)image.format;
+	desc.SampleDesc.Count = 1;
+	desc.Usage = D3D11_USAGE_DEFAULT;
+	desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+	std::vector<D3D11_SUBRESOURCE_DATA> levels;
+	if (withData)
+	{
+		levels.resize(desc.MipLevels);
+		for (uint32_t i = 0; i < desc.MipLevels; i++)
+		{
+			uint32_t mip = topMip + i;
+			levels[i].pSysMem = texture->data + texture->mipOffsets[mip];
+			levels[i].SysMemPitch = (UINT)DdsFile::GetRowPitch(image.format, MipExtent(image.width, mip));
+			levels[i].SysMemSlicePitch = 0;
+		}
+	}
+
+	ID3D11Texture2D* created = 0;
+	if (FAILED(device->CreateTexture2D(&desc, withData ? levels.data() : 0, &created)))
+		return 0;
+	return created;
+}
+
+// --------------------------------------------------------
+// Replaces the texture with one starting at topMip.  Levels
+// both have are copied on the GPU; the rest come from the
+// file, which Prefetch() has already read in.
+// --------------------------------------------------------
+bool TextureStreamer::Rebuild(StreamedTexture* texture, uint32_t topMip)
+{
+	PROFILE_SCOPE("TextureStreamer::Rebuild");
+
+	ID3D11Texture2D* rebuilt = CreateTexture(texture, topMip, false);
+	if (!rebuilt)
+		return false;
+
+	const DdsImageDesc& image = texture->desc;
+	for (uint32_t mip = topMip; mip < image.mipCount; mip++)
+	{
+		UINT level = mip - topMip;
+		if (mip >= texture->appliedMip)
+		{
+			context->CopySubresourceRegion(rebuilt, level, 0, 0, 0, texture->texture, mip - texture->appliedMip, 0);
+		}
+		else
+		{
+			UINT rowPitch = (UINT)DdsFile::GetRowPitch(image.format, MipExtent(image.width, mip));
+			context->UpdateSubresource(rebuilt, level, 0, texture->data + texture->mipOffsets[mip], rowPitch, 0);
+		}
+	}
+
+	ID3D11ShaderResourceView* srv = 0;
+	if (FAILED(device->CreateShaderResourceView(rebuilt, 0, &srv)))
+	{
+		rebuilt->Release();
+		return false;
+	}
+
+	// The new reference replaces the old view's
+	ID3D11ShaderResourceView*& target = *texture->target;
+	byView.erase(target);
+	byView[srv] = texture->residencyId;
+	ReleaseMacro(target);
+	target = srv;
+	ReleaseMacro(texture->texture);
+	texture->texture = rebuilt;
+	texture->appliedMip = topMip;
+	MemoryTracker::Update(texture->memory, 0, residency.GetTextureBytes(texture->residencyId));
+
+	if (texture->onChanged)
+		texture->onChanged(AssetState_Ready);
+	return true;
+}
+
+// --------------------------------------------------------
+// Reads in the pages of levels topMip up to those already
+// read, on a worker
+// --------------------------------------------------------
+void TextureStreamer::Prefetch(StreamedTexture* texture, uint32_t topMip)
+{
+	uint32_t readMip = texture->prefetchedMip.load(std::memory_order_acquire);
+	texture->prefetchTarget = topMip;
+	const unsigned char* begin = texture->data + texture->mipOffsets[topMip];
+	size_t size = texture->mipOffsets[readMip] - texture->mipOffsets[topMip];
+	jobSystem->Run([texture, topMip, begin, size]()
+	{
+		MappedFile::Prefetch(begin, size);
+		texture->prefetchedMip.store(topMip, std::memory_order_release);
+	}, &prefetchJobs);
+}
+
+void TextureStreamer::Update(const FramePacket& frame, float viewportHeight)
+{
+	PROFILE_SCOPE("TextureStreamer::Update");
+
+	if (textures.empty())
+		return;
+
+	GatherUses(frame, viewportHeight);
+	for (unsigned int i = 0; i < uses.size(); i++)
+	{
+		const Material* material = uses[i].material;
+		RequestView(material->texture, uses[i].screenSize);
+		RequestView(material->normalMap, uses[i].screenSize);
+		RequestView(material->specTexture, uses[i].screenSize);
+	}
+
+	changes.clear();
+	residency.Update(changes, LoadsPerFrame);
+	for (unsigned int i = 0; i < changes.size(); i++)
+	{
+		StreamedTexture* texture = textures[changes[i].texture].get();
+		if (!texture->unsettled)
+		{
+			texture->unsettled = true;
+			unsettled.push_back(changes[i].texture);
+		}
+	}
+
+	// Evictions are applied straight away.  Loads wait until
+	// their pages have been read in.
+	for (unsigned int i = 0; i < unsettled.size();)
+	{
+		StreamedTexture* texture = textures[unsettled[i]].get();
+		uint32_t wanted = residency.GetResidentMip(texture->residencyId);
+		uint32_t readMip = texture->prefetchedMip.load(std::memory_order_acquire);
+		bool settled = wanted == texture->appliedMip;
+		if (!settled && (wanted > texture->appliedMip || readMip <= wanted))
+			settled = Rebuild(texture, wanted);
+		else if (!settled && texture->prefetchTarget >= readMip)
+			Prefetch(texture, wanted);
+
+		if (settled)
+		{
+			texture->unsettled = false;
+			unsettled[i] = unsettled.back();
+			unsettled.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+// --------------------------------------------------------
+// How many pixels across each material's nearest entity
+// covers.  The stress test's copies share one material, so
+// materials are merged as they go rather than looked up.
+// --------------------------------------------------------
+void TextureStreamer::GatherUses(const FramePacket& frame, float viewportHeight)
+{
+	uses.clear();
+
+	// Both matrices are transposed for HLSL; _22 is on the
+	// diagonal, so it is the same either way
+	float focal = frame.projectionMatrix._22 * viewportHeight * 0.5f;
+	const XMFLOAT3& eye = frame.cameraPosition;
+
+	MaterialUse* last = 0;
+	for (unsigned int i = 0; i < frame.draws.size(); i++)
+	{
+		const DrawCommand& draw = frame.draws[i];
+		if (!draw.material || !draw.mesh || !draw.mesh->IsLoaded())
+			continue;
+
+		// The world matrix is transposed, so the basis vectors
+		// are its columns and the translation its last column
+		const XMFLOAT4X4& m = draw.worldMatrix;
+		float scale = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float length = sqrtf(m.m[0][axis] * m.m[0][axis] + m.m[1][axis] * m.m[1][axis] + m.m[2][axis] * m.m[2][axis]);
+			if (length > scale)
+				scale = length;
+		}
+		float radius = draw.mesh->GetBoundingRadius() * scale;
+		float dx = m._14 - eye.x;
+		float dy = m._24 - eye.y;
+		float dz = m._34 - eye.z;
+		float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+		// Inside the bounds it could fill the screen
+		float screenSize = distance > radius ? 2.0f * radius * focal / distance : viewportHeight;
+
+		if (!last || last->material != draw.material)
+		{
+			last = 0;
+			for (unsigned int u = 0; u < uses.size(); u++)
+			{
+				if (uses[u].material == draw.material)
+					last = &uses[u];
+			}
+			if (!last)
+			{
+				MaterialUse use = { draw.material, 0.0f };
+				uses.push_back(use);
+				last = &uses.back();
+			}
+		}
+		if (screenSize > last->screenSize)
+			last->screenSize = screenSize;
+	}
+}
+
+void TextureStreamer::RequestView(const ID3D11ShaderResourceView* view, float screenSize)
+{
+	std::unordered_map<const ID3D11ShaderResourceView*, uint32_t>::const_iterator found = byView.find(view);
+	if (found == byView.end())
+		return;
+
+	const DdsImageDesc& desc = textures[found->second]->desc;
+	residency.Request(found->second, TextureResidency::SelectMip(desc.width, desc.height, desc.mipCount, screenSize, mipBias));
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <d3d11.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "AssetLoader.h"
+#include "DdsFile.h"
+#include "JobSystem.h"
+#include "MappedFile.h"
+#include "MemoryTracker.h"
+#include "TextureResidency.h"
+
+struct FramePacket;
+class Material;
+
+// --------------------------------------------------------
+// Streams the mip levels of cooked textures in and out as
+// the camera moves.
+//
+// Only the small mips (PinnedSize and below) are loaded up
+// front.  Every frame, Update() works out how big on screen
+// each material's entities are, asks TextureResidency which
+// mips that needs, and then rebuilds the textures whose
+// resident mips changed: levels the GPU already has are
+// copied across from the old texture, and only new levels
+// are read from the file.  The files stay mapped, and the
+// pages a load needs are read in by a job first, so the
+// render thread doesn't wait on the disk.
+//
+// Only 2D DDS files with a mip chain (what the asset cooker
+// writes) are streamed.  Anything else is handed to the
+// asset loader and loaded whole.
+//
+// Materials keep their usual view pointers; the streamer
+// swaps them when a texture is rebuilt, like the asset
+// loader does when a load finishes.  Textures are found
+// again by their current view, so slots the view has been
+// copied into (see SharedTexture) stream too.
+// --------------------------------------------------------
+class TextureStreamer
+{
+public:
+	static const size_t DefaultBudget = 64 * 1024 * 1024;
+
+	// Mips no larger than this across are always resident
+	static const uint32_t PinnedSize = 64;
+
+	// Most mips streamed in per frame
+	static const unsigned int LoadsPerFrame = 4;
+
+	TextureStreamer();
+	~TextureStreamer();
+
+	bool Init(ID3D11Device* device, ID3D11DeviceContext* context, JobSystem* jobSystem, AssetLoader* assetLoader);
+	void Release();
+
+	// Bytes of streamed textures allowed on the GPU, pinned
+	// mips included
+	void SetBudget(size_t bytes) { residency.SetBudget(bytes); }
+	size_t GetBudget() const { return residency.GetBudget(); }
+	size_t GetResidentBytes() const { return residency.GetResidentBytes(); }
+
+	// Added to every mip choice; above 0 trades detail for memory
+	void SetMipBias(float bias) { mipBias = bias; }
+
+	// Like AssetLoader::LoadTexture, but the texture starts with
+	// its pinned mips and streams the rest.  onChanged is called
+	// whenever *target is replaced later on, on the render
+	// thread, and is kept as long as the texture is.  Call at
+	// start-up, before the first Update(); any thread.
+	void LoadTexture(const std::wstring& path, ID3D11ShaderResourceView** target, AssetPlaceholder placeholder,
+		AssetCallback onChanged = AssetCallback());
+
+	// Requests mips for the frame's draws, then loads and
+	// evicts.  Uses the immediate context and writes the view
+	// pointers, so call it on the render thread.
+	void Update(const FramePacket& frame, float viewportHeight);
+
+private:
+	TextureStreamer(const TextureStreamer&);
+	TextureStreamer& operator=(const TextureStreamer&);
+
+	struct StreamedTexture
+	{
+		std::string					name;
+		ID3D11ShaderResourceView**	target;
+		MappedFile					file;			// Unless the data is in the pak
+		const unsigned char*		data;
+		DdsImageDesc				desc;
+		std::vector<size_t>			mipOffsets;		// From data
+		uint32_t					residencyId;
+		uint32_t					appliedMip;		// Top level of texture
+		ID3D11Texture2D*			texture;
+		std::atomic<uint32_t>		prefetchedMip;	// Levels from here down are read in
+		uint32_t					prefetchTarget;	// In flight while below prefetchedMip
+		bool						unsettled;		// appliedMip differs from the residency
+		MemoryHandle				memory;
+		AssetCallback				onChanged;
+	};
+
+	// The largest share of each material's entities on screen
+	struct MaterialUse
+	{
+		const Material*				material;
+		float						screenSize;
+	};
+
+	bool ReadLayout(StreamedTexture* texture, size_t size) const;
+	uint32_t GetPinnedMip(const DdsImageDesc& desc) const;
+	ID3D11Texture2D* CreateTexture(const StreamedTexture* texture, uint32_t topMip, bool withData) const;
+	bool Rebuild(StreamedTexture* texture, uint32_t topMip);
+	void Prefetch(StreamedTexture* texture, uint32_t topMip);
+	void GatherUses(const FramePacket& frame, float viewportHeight);
+	void RequestView(const ID3D11ShaderResourceView* view, float screenSize);
+
+	ID3D11Device*				device;
+	ID3D11DeviceContext*		context;
+	JobSystem*					jobSystem;
+	AssetLoader*				assetLoader;
+
+	TextureResidency			residency;
+	float						mipBias;
+
+	// Indexed by residency id, and found by current view
+	std::vector<std::unique_ptr<StreamedTexture> >	textures;
+	std::unordered_map<const ID3D11ShaderResourceView*, uint32_t>	byView;
+	std::mutex					loadLock;		// Taken while start-up adds textures
+
+	// Reused every frame
+	std::vector<MaterialUse>		uses;
+	std::vector<ResidencyChange>	changes;
+	std::vector<uint32_t>			unsettled;
+
+	JobCounter					prefetchJobs;
+};
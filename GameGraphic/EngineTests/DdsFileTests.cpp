@@ -0,0 +1,242 @@
+#include "Test.h"
+#include "DdsFile.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	// Header fields as 32-bit words after the magic number
+	enum HeaderWord
+	{
+		Word_Flags = 1,
+		Word_Height = 2,
+		Word_Width = 3,
+		Word_MipCount = 6,
+		Word_FormatFlags = 19,
+		Word_FourCC = 20,
+		Word_BitCount = 21,
+		Word_Masks = 22,
+		Word_Caps2 = 27,
+		Word_DxgiFormat = 31,
+		Word_Dimension = 32,
+		Word_MiscFlags = 33,
+		Word_ArraySize = 34
+	};
+
+	void SetWord(std::vector<unsigned char>& file, unsigned int word, uint32_t value)
+	{
+		memcpy(&file[4 + word * 4], &value, sizeof(value));
+	}
+
+	// A file written the way the tools do, with slices surfaces
+	// of zeroes after the header
+	std::vector<unsigned char> MakeFile(const DdsImageDesc& desc, uint32_t slices)
+	{
+		std::vector<unsigned char> file;
+		DdsFile::WriteHeader(desc, file);
+		file.resize(file.size() + DdsFile::GetImageSize(desc) * slices);
+		return file;
+	}
+
+	// The same without the DX10 extension, as older tools and
+	// texture editors write them
+	std::vector<unsigned char> MakeLegacyFile(const DdsImageDesc& desc, uint32_t slices)
+	{
+		std::vector<unsigned char> file = MakeFile(desc, slices);
+		file.erase(file.begin() + DdsFile::LegacyHeaderSize, file.begin() + DdsFile::HeaderSize);
+		return file;
+	}
+
+	bool Parse(const std::vector<unsigned char>& file, DdsTextureInfo& info)
+	{
+		return DdsFile::ParseTextureInfo(file.data(), file.size(), info);
+	}
+
+	// --------------------------------------------------------
+	// What the tools write reads back as it was, with every
+	// level where the loader expects it
+	// --------------------------------------------------------
+	void TestRoundTrip()
+	{
+		DdsImageDesc desc = { 256, 64, 9, DdsFormat_BC1 };
+		std::vector<unsigned char> file = MakeFile(desc, 1);
+
+		DdsTextureInfo info;
+		if (!CHECK(Parse(file, info)))
+			return;
+		CHECK(info.image.width == 256 && info.image.height == 64);
+		CHECK(info.image.mipCount == 9 && info.image.format == DdsFormat_BC1);
+		CHECK(info.arraySize == 1 && !info.isCubeMap);
+		CHECK(info.dataOffset == DdsFile::HeaderSize);
+		CHECK(info.dataOffset + info.dataSize == file.size());
+
+		size_t offset = DdsFile::HeaderSize;
+		const uint32_t widths[] = { 256, 128, 64, 32, 16, 8, 4, 2, 1 };
+		for (uint32_t mip = 0; mip < 9; mip++)
+		{
+			DdsSurface surface = DdsFile::GetSurface(info, 0, mip);
+			CHECK(surface.offset == offset);
+			CHECK(surface.width == widths[mip]);
+			CHECK(surface.height == (mip < 6 ? 64u >> mip : 1u));
+			CHECK(surface.rowPitch == (size_t)((widths[mip] + 3) / 4) * 8);
+			CHECK(surface.size == surface.rowPitch * ((surface.height + 3) / 4));
+			offset += surface.size;
+		}
+		CHECK(offset == file.size());
+
+		// No mip count means one level
+		SetWord(file, Word_MipCount, 0);
+		CHECK(Parse(file, info) && info.image.mipCount == 1);
+	}
+
+	// --------------------------------------------------------
+	// Headers without the DX10 extension, by FourCC and by
+	// channel masks
+	// --------------------------------------------------------
+	void TestLegacy()
+	{
+		// Sized for 16 byte blocks, so big enough for any of them
+		DdsImageDesc desc = { 64, 32, 7, DdsFormat_BC3 };
+		std::vector<unsigned char> file = MakeLegacyFile(desc, 1);
+
+		const uint32_t fourCCs[] = { 0x31545844, 0x33545844, 0x35545844, 0x32495441 };	// DXT1, DXT3, DXT5, ATI2
+		const DdsFormat formats[] = { DdsFormat_BC1, DdsFormat_BC2, DdsFormat_BC3, DdsFormat_BC5 };
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			SetWord(file, Word_FourCC, fourCCs[i]);
+			DdsTextureInfo info;
+			bool parsed = Parse(file, info);
+			CHECK(parsed && info.image.format == formats[i]);
+			CHECK(parsed && info.dataOffset == DdsFile::LegacyHeaderSize);
+		}
+
+		// 32-bit RGB, with and without alpha
+		desc.format = DdsFormat_RGBA8;
+		file = MakeLegacyFile(desc, 1);
+		SetWord(file, Word_FormatFlags, 0x40 | 0x1);
+		SetWord(file, Word_FourCC, 0);
+		SetWord(file, Word_BitCount, 32);
+		const uint32_t masks[][4] =
+		{
+			{ 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000 },
+			{ 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000 },
+			{ 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000 },
+		};
+		const DdsFormat maskFormats[] = { DdsFormat_RGBA8, DdsFormat_BGRA8, DdsFormat_BGRX8 };
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			for (unsigned int c = 0; c < 4; c++)
+				SetWord(file, Word_Masks + c, masks[i][c]);
+			DdsTextureInfo info;
+			CHECK(Parse(file, info) && info.image.format == maskFormats[i]);
+			CHECK(DdsFile::GetSurface(info, 0, 2).rowPitch == 16 * 4);
+		}
+
+		// Formats nothing here can upload
+		DdsTextureInfo info;
+		SetWord(file, Word_BitCount, 24);
+		CHECK(!Parse(file, info));
+		SetWord(file, Word_BitCount, 32);
+		SetWord(file, Word_Masks, 0x0000f800);
+		CHECK(!Parse(file, info));
+		SetWord(file, Word_FormatFlags, 0x4);
+		SetWord(file, Word_FourCC, 0x31545844 + 0x01000000 * 8);	// "DXT9"
+		CHECK(!Parse(file, info));
+	}
+
+	// --------------------------------------------------------
+	// Cube maps and arrays, which store every mip chain one
+	// after another, one slice at a time
+	// --------------------------------------------------------
+	void TestSlices()
+	{
+		// A legacy cube map, like the sky's
+		DdsImageDesc desc = { 128, 128, 8, DdsFormat_BC1 };
+		std::vector<unsigned char> file = MakeLegacyFile(desc, 6);
+		SetWord(file, Word_FourCC, 0x31545844);
+		SetWord(file, Word_Caps2, 0x200 | 0xFC00);
+
+		DdsTextureInfo info;
+		if (CHECK(Parse(file, info)))
+		{
+			size_t chain = DdsFile::GetImageSize(desc);
+			CHECK(info.isCubeMap && info.arraySize == 6);
+			CHECK(info.dataSize == chain * 6);
+			CHECK(DdsFile::GetSurface(info, 0, 0).offset == DdsFile::LegacyHeaderSize);
+			CHECK(DdsFile::GetSurface(info, 3, 0).offset == DdsFile::LegacyHeaderSize + chain * 3);
+			CHECK(DdsFile::GetSurface(info, 5, 1).offset == DdsFile::LegacyHeaderSize + chain * 5 + 128 / 4 * 128 / 4 * 8);
+			CHECK(DdsFile::GetSurface(info, 5, 7).offset + DdsFile::GetSurface(info, 5, 7).size == file.size());
+		}
+
+		// Short a face's worth of data, or a face
+		CHECK(!DdsFile::ParseTextureInfo(file.data(), file.size() - 1, info));
+		SetWord(file, Word_Caps2, 0x200 | 0x0400 | 0x0800);
+		CHECK(!Parse(file, info));
+
+		// DX10 cube maps count whole cubes, and arrays slices
+		desc.format = DdsFormat_BC7;
+		file = MakeFile(desc, 12);
+		SetWord(file, Word_MiscFlags, 0x4);
+		SetWord(file, Word_ArraySize, 2);
+		CHECK(Parse(file, info) && info.isCubeMap && info.arraySize == 12);
+		SetWord(file, Word_MiscFlags, 0);
+		CHECK(Parse(file, info) && !info.isCubeMap && info.arraySize == 2);
+		CHECK(info.dataSize == DdsFile::GetImageSize(desc) * 2);
+		SetWord(file, Word_ArraySize, 13);
+		CHECK(!Parse(file, info));
+		SetWord(file, Word_ArraySize, 0);
+		CHECK(!Parse(file, info));
+	}
+
+	// --------------------------------------------------------
+	// Headers that don't describe a texture this can read
+	// --------------------------------------------------------
+	void TestRejects()
+	{
+		DdsImageDesc desc = { 16, 16, 5, DdsFormat_RGBA8 };
+		std::vector<unsigned char> good = MakeFile(desc, 1);
+		DdsTextureInfo info;
+		CHECK(Parse(good, info));
+
+		CHECK(!DdsFile::ParseTextureInfo(good.data(), DdsFile::LegacyHeaderSize - 1, info));
+		CHECK(!DdsFile::ParseTextureInfo(good.data(), DdsFile::HeaderSize - 1, info));
+
+		std::vector<unsigned char> file = good;
+		file[0] = 'X';
+		CHECK(!Parse(file, info));
+
+		// Volumes, and 1D and 3D textures
+		file = good;
+		SetWord(file, Word_Flags, 0x1 | 0x2 | 0x4 | 0x1000 | 0x800000);
+		CHECK(!Parse(file, info));
+		const uint32_t dimensions[] = { 2, 4 };
+		for (unsigned int i = 0; i < 2; i++)
+		{
+			file = good;
+			SetWord(file, Word_Dimension, dimensions[i]);
+			CHECK(!Parse(file, info));
+		}
+
+		// Unknown formats, and sizes that could overflow
+		file = good;
+		SetWord(file, Word_DxgiFormat, 2);		// DXGI_FORMAT_R32G32B32A32_FLOAT
+		CHECK(!Parse(file, info));
+		file = good;
+		SetWord(file, Word_MipCount, 6);
+		CHECK(!Parse(file, info));
+		file = good;
+		SetWord(file, Word_Width, 0);
+		CHECK(!Parse(file, info));
+		SetWord(file, Word_Width, 0x40000000);
+		SetWord(file, Word_MipCount, 1);
+		CHECK(!Parse(file, info));
+	}
+}
+
+void RunDdsFileTests()
+{
+	TestRoundTrip();
+	TestLegacy();
+	TestSlices();
+	TestRejects();
+}
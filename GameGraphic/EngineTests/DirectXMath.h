@@ -0,0 +1,14 @@
+#pragma once
+
+// --------------------------------------------------------
+// Stands in for DirectXMath in the headless tests.  Only the
+// storage types that engine data structures (frame packets,
+// lights) hold are declared, with the same layout; nothing
+// here does any math.
+// --------------------------------------------------------
+namespace DirectX
+{
+	struct XMFLOAT3 { float x, y, z; };
+	struct XMFLOAT4 { float x, y, z, w; };
+	struct XMFLOAT4X4 { float m[4][4]; };
+}
@@ -0,0 +1,159 @@
+#include "Test.h"
+#include "FrameAllocator.h"
+#include "FramePacket.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+	struct alignas(64) CacheLine
+	{
+		char	bytes[64];
+	};
+
+	bool IsAligned(const void* pointer, size_t alignment)
+	{
+		return ((uintptr_t)pointer & (alignment - 1)) == 0;
+	}
+
+	// --------------------------------------------------------
+	// Alignment, big requests, and Reset() folding a frame's
+	// blocks into one so the next frame fits in it
+	// --------------------------------------------------------
+	void TestLinearAllocator()
+	{
+		LinearAllocator arena(1024);
+		CHECK(arena.GetCapacity() == 0);
+
+		void* a = arena.Allocate(3, 1);
+		void* b = arena.Allocate(8, 8);
+		void* c = arena.Allocate(16, 256);
+		CHECK(a && b && c);
+		CHECK(IsAligned(b, 8) && IsAligned(c, 256));
+		CHECK((char*)b >= (char*)a + 3);
+
+		// Not a power of two: the default is used instead
+		CHECK(IsAligned(arena.Allocate(4, 24), LinearAllocator::DefaultAlignment));
+
+		// Bigger than a block gets a block of its own
+		void* big = arena.Allocate(5000);
+		CHECK(big != 0);
+		CHECK(arena.GetCapacity() >= 1024 + 5000);
+		size_t used = arena.GetBytesUsed();
+		CHECK(used >= 3 + 8 + 16 + 4 + 5000);
+		CHECK(arena.GetHighWater() == used);
+
+		size_t capacity = arena.GetCapacity();
+		arena.Reset();
+		CHECK(arena.GetBytesUsed() == 0);
+		CHECK(arena.GetCapacity() == capacity);
+		CHECK(arena.GetHighWater() == used);
+
+		// The same frame again now fits in the one block
+		arena.Allocate(3, 1);
+		arena.Allocate(8, 8);
+		arena.Allocate(16, 256);
+		arena.Allocate(4, 24);
+		arena.Allocate(5000);
+		CHECK(arena.GetCapacity() == capacity);
+	}
+
+	void TestStlAdapter()
+	{
+		LinearAllocator arena(256);
+		FrameVector<int> numbers((FrameStlAllocator<int>(&arena)));
+		for (int i = 0; i < 1000; i++)
+			numbers.push_back(i);
+		CHECK(numbers.size() == 1000 && numbers[999] == 999);
+		CHECK(arena.GetBytesUsed() >= 1000 * sizeof(int));
+
+		FrameVector<CacheLine> lines((FrameStlAllocator<CacheLine>(&arena)));
+		lines.resize(5);
+		CHECK(IsAligned(lines.data(), alignof(CacheLine)));
+
+		// Same arena, same allocator
+		CHECK(numbers.get_allocator() == FrameStlAllocator<float>(&arena));
+		CHECK(numbers.get_allocator() != FrameStlAllocator<int>());
+
+		// The default is the thread's frame allocator
+		FrameVector<int> scratch;
+		scratch.push_back(1);
+		CHECK(FrameAllocator::GetThreadAllocator().GetBytesUsed() > 0);
+		FrameVector<int>().swap(scratch);
+		FrameAllocator::ResetThread();
+		CHECK(FrameAllocator::GetThreadAllocator().GetBytesUsed() == 0);
+	}
+
+	// --------------------------------------------------------
+	// What a frame does with transient memory: fill the
+	// packet's draw list, and sort keys and cull results in
+	// the thread's frame allocator.  The counts wobble from
+	// frame to frame like a real scene's.
+	// --------------------------------------------------------
+	void SimulateFrame(FramePacket& packet, unsigned int frame)
+	{
+		packet.Clear();
+		FrameAllocator::ResetThread();
+		packet.frameIndex = frame;
+
+		unsigned int drawCount = 400 + (frame * 37) % 200;
+		DrawCommand draw = {};
+		for (unsigned int i = 0; i < drawCount; i++)
+			packet.draws.push_back(draw);
+
+		FrameVector<unsigned long long> keys;
+		FrameVector<unsigned int> visible;
+		for (unsigned int i = 0; i < drawCount; i++)
+		{
+			keys.push_back(((unsigned long long)(i * 2654435761u) << 32) | i);
+			if (i % 3)
+				visible.push_back(i);
+		}
+		std::sort(keys.begin(), keys.end());
+
+		// Anything else the frame needs next to its draws
+		float* constants = (float*)packet.memory.Allocate(drawCount * 16 * sizeof(float), 16);
+		constants[0] = (float)frame;
+	}
+
+	// --------------------------------------------------------
+	// Once every allocator has seen the biggest frame, frames
+	// never call operator new and no allocator grows (which is
+	// when they malloc)
+	// --------------------------------------------------------
+	void TestSteadyFramesDontAllocate()
+	{
+		FramePacket packet;
+		const unsigned int warmupFrames = 250;
+		const unsigned int steadyFrames = 1000;
+
+		for (unsigned int frame = 0; frame < warmupFrames; frame++)
+			SimulateFrame(packet, frame);
+
+		unsigned long long allocations = Test::GetHeapAllocationCount();
+		size_t packetCapacity = packet.memory.GetCapacity();
+		size_t threadCapacity = FrameAllocator::GetThreadAllocator().GetCapacity();
+
+		for (unsigned int frame = warmupFrames; frame < warmupFrames + steadyFrames; frame++)
+			SimulateFrame(packet, frame);
+
+		CHECK(Test::GetHeapAllocationCount() == allocations);
+		CHECK(packet.memory.GetCapacity() == packetCapacity);
+		CHECK(FrameAllocator::GetThreadAllocator().GetCapacity() == threadCapacity);
+
+		// The counter does see heap use
+		std::vector<int>* onHeap = new std::vector<int>(10);
+		CHECK(Test::GetHeapAllocationCount() > allocations);
+		delete onHeap;
+
+		packet.Clear();
+		FrameAllocator::ResetThread();
+	}
+}
+
+void RunFrameAllocatorTests()
+{
+	TestLinearAllocator();
+	TestStlAdapter();
+	TestSteadyFramesDontAllocate();
+}
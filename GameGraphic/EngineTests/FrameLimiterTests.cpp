@@ -0,0 +1,146 @@
+#include "Test.h"
+#include "FrameLimiter.h"
+#include <cmath>
+
+namespace
+{
+	const double Target = 1.0 / 60.0;
+	const double SpinThreshold = 0.002;
+	const double SpinStep = 0.00001;
+
+	bool Near(double a, double b, double tolerance)
+	{
+		return std::fabs(a - b) <= tolerance;
+	}
+
+	// Simulates frameCount frames of the given work each
+	void RunFrames(FrameLimiter& limiter, ManualFrameClock& clock, unsigned int frameCount, double work)
+	{
+		for (unsigned int i = 0; i < frameCount; i++)
+		{
+			clock.Advance(work);
+			limiter.WaitForNextFrame();
+		}
+	}
+
+	// --------------------------------------------------------
+	// Oversleeps shorter than the spin threshold are spun out
+	// entirely.  Longer ones make that frame late, but the next
+	// deadline is still one target after the last, so the
+	// schedule doesn't drift.
+	// --------------------------------------------------------
+	void TestOversleepAbsorbed()
+	{
+		ManualFrameClock clock(0.001, SpinStep);
+		FrameLimiter limiter(&clock);
+		limiter.SetTargetFrameTime(Target);
+		limiter.SetSpinThreshold(SpinThreshold);
+
+		limiter.WaitForNextFrame();
+		double start = clock.Now();
+		RunFrames(limiter, clock, 100, 0.005);
+
+		FramePacingStats stats = limiter.GetStats();
+		CHECK(stats.frameCount == 100);
+		CHECK(stats.missedFrames == 0);
+		CHECK(stats.maxJitter <= SpinStep);
+		CHECK(Near(clock.Now() - start, 100 * Target, SpinStep));
+
+		// Oversleeping past the deadline
+		clock.SetOversleep(SpinThreshold + 0.001);
+		limiter.ResetStats();
+		start = clock.Now();
+		RunFrames(limiter, clock, 100, 0.005);
+
+		stats = limiter.GetStats();
+		CHECK(stats.missedFrames == 0);
+		CHECK(Near(stats.maxJitter, 0.001, SpinStep));
+		CHECK(Near(stats.averageFrameTime, Target, 0.001 / 100 + SpinStep));
+		CHECK(Near(clock.Now() - start, 100 * Target + 0.001, SpinStep));
+	}
+
+	// --------------------------------------------------------
+	// A frame past its deadline counts as missed, and the next
+	// frame gets a whole target again instead of being cut
+	// short to catch up
+	// --------------------------------------------------------
+	void TestMissedDeadlineResets()
+	{
+		ManualFrameClock clock(0.0, SpinStep);
+		FrameLimiter limiter(&clock);
+		limiter.SetTargetFrameTime(Target);
+		limiter.SetSpinThreshold(SpinThreshold);
+
+		limiter.WaitForNextFrame();
+		RunFrames(limiter, clock, 10, 0.005);
+
+		clock.Advance(Target * 2.5);
+		double missedAt = clock.Now();
+		limiter.WaitForNextFrame();
+		CHECK(limiter.GetStats().missedFrames == 1);
+		CHECK(clock.Now() == missedAt);
+
+		clock.Advance(0.005);
+		limiter.WaitForNextFrame();
+		CHECK(Near(clock.Now() - missedAt, Target, SpinStep));
+		CHECK(limiter.GetStats().missedFrames == 1);
+
+		// Reset() forgets the schedule: the next call only starts
+		// a new one, without waiting or counting a frame
+		unsigned int frames = limiter.GetStats().frameCount;
+		limiter.Reset();
+		clock.Advance(Target * 10.0);
+		double before = clock.Now();
+		limiter.WaitForNextFrame();
+		CHECK(clock.Now() == before);
+		CHECK(limiter.GetStats().frameCount == frames);
+		CHECK(limiter.GetStats().missedFrames == 1);
+	}
+
+	// --------------------------------------------------------
+	// Frames that all run long by 2ms and 4ms in turn: jitter
+	// averages 3ms with a 1ms standard deviation
+	// --------------------------------------------------------
+	void TestJitterStats()
+	{
+		ManualFrameClock clock(0.0, SpinStep);
+		FrameLimiter limiter(&clock);
+		limiter.SetTargetFrameTime(Target);
+
+		limiter.WaitForNextFrame();
+		for (unsigned int i = 0; i < 50; i++)
+		{
+			clock.Advance(Target + 0.002);
+			limiter.WaitForNextFrame();
+			clock.Advance(Target + 0.004);
+			limiter.WaitForNextFrame();
+		}
+
+		FramePacingStats stats = limiter.GetStats();
+		CHECK(stats.frameCount == 100);
+		CHECK(stats.missedFrames == 100);
+		CHECK(Near(stats.averageFrameTime, Target + 0.003, 1e-9));
+		CHECK(Near(stats.averageJitter, 0.003, 1e-9));
+		CHECK(Near(stats.jitterStdDev, 0.001, 1e-7));
+		CHECK(Near(stats.maxJitter, 0.004, 1e-9));
+
+		// Without a target there is no jitter to measure
+		limiter.SetTargetFrameTime(0.0);
+		limiter.ResetStats();
+		limiter.WaitForNextFrame();
+		CHECK(limiter.GetStats().frameCount == 0);
+		RunFrames(limiter, clock, 10, Target);
+		stats = limiter.GetStats();
+		CHECK(stats.frameCount == 10);
+		CHECK(stats.missedFrames == 0);
+		CHECK(stats.averageJitter == 0.0 && stats.jitterStdDev == 0.0 && stats.maxJitter == 0.0);
+		CHECK(Near(stats.averageFrameTime, Target, 1e-9));
+	}
+}
+
+void RunFrameLimiterTests()
+{
+	TestOversleepAbsorbed();
+	TestMissedDeadlineResets();
+	TestJitterStats();
+}
@@ -0,0 +1,213 @@
+#include "Test.h"
+#include "FrameStats.h"
+#include <cmath>
+
+namespace
+{
+	bool Near(double a, double b)
+	{
+		return std::fabs(a - b) < 1e-6;
+	}
+
+	// Percentiles are bucket midpoints
+	double Midpoint(double frameMs)
+	{
+		return (std::floor(frameMs / FrameStats::BucketMs) + 0.5) * FrameStats::BucketMs;
+	}
+
+	// --------------------------------------------------------
+	// 1ms to 100ms once each: the walk stops in the bucket of
+	// the 50th, 95th and 99th frame
+	// --------------------------------------------------------
+	void TestPercentiles()
+	{
+		FrameStats stats;
+		stats.SetHitchThresholds(0.0, 0.0);
+
+		FrameTimeSummary empty = stats.GetRollingSummary();
+		CHECK(empty.frameCount == 0 && empty.p50Ms == 0.0 && empty.maxMs == 0.0);
+
+		// Out of order, so nothing depends on arrival
+		for (unsigned int i = 0; i < 100; i++)
+			stats.AddFrame(((i * 37) % 100) + 1.03);
+
+		FrameTimeSummary summary = stats.GetRollingSummary();
+		CHECK(summary.frameCount == 100);
+		CHECK(Near(summary.averageMs, 50.53));
+		CHECK(Near(summary.p50Ms, Midpoint(50.03)));
+		CHECK(Near(summary.p95Ms, Midpoint(95.03)));
+		CHECK(Near(summary.p99Ms, Midpoint(99.03)));
+		CHECK(Near(summary.maxMs, 100.03));
+
+		FrameTimeSummary session = stats.GetSessionSummary();
+		CHECK(session.frameCount == 100 && Near(session.p95Ms, summary.p95Ms));
+
+		// One frame is every percentile
+		stats.Reset();
+		stats.AddFrame(16.7);
+		summary = stats.GetRollingSummary();
+		CHECK(Near(summary.p50Ms, Midpoint(16.7)) && Near(summary.p99Ms, Midpoint(16.7)));
+	}
+
+	// --------------------------------------------------------
+	// Frames past the last bucket report the true maximum
+	// rather than a bucket midpoint
+	// --------------------------------------------------------
+	void TestOverflowBucket()
+	{
+		FrameStats stats;
+		stats.SetHitchThresholds(0.0, 0.0);
+
+		for (unsigned int i = 0; i < 90; i++)
+			stats.AddFrame(10.0);
+		for (unsigned int i = 0; i < 9; i++)
+			stats.AddFrame(300.0);
+		stats.AddFrame(1234.5);
+
+		double limit = FrameStats::BucketCount * FrameStats::BucketMs;
+		FrameTimeSummary summary = stats.GetRollingSummary();
+		CHECK(Near(summary.p50Ms, Midpoint(10.0)));
+		CHECK(summary.p95Ms > limit && Near(summary.p95Ms, 1234.5));
+		CHECK(Near(summary.p99Ms, 1234.5));
+		CHECK(Near(summary.maxMs, 1234.5));
+		CHECK(Near(stats.GetSessionSummary().p99Ms, 1234.5));
+	}
+
+	// --------------------------------------------------------
+	// The rolling window holds exactly WindowSize frames; older
+	// ones leave its histogram, sum and max but stay in the
+	// session's
+	// --------------------------------------------------------
+	void TestRollingWindow()
+	{
+		FrameStats stats;
+		stats.SetHitchThresholds(0.0, 0.0);
+		const unsigned int window = FrameStats::WindowSize;
+
+		stats.AddFrame(200.0);
+		for (unsigned int i = 0; i < window - 1; i++)
+			stats.AddFrame(10.0);
+
+		FrameTimeSummary summary = stats.GetRollingSummary();
+		CHECK(summary.frameCount == window);
+		CHECK(Near(summary.maxMs, 200.0));
+		CHECK(Near(summary.averageMs, (200.0 + 10.0 * (window - 1)) / window));
+
+		// The 200ms frame is the oldest, so the next one evicts it
+		stats.AddFrame(20.0);
+		summary = stats.GetRollingSummary();
+		CHECK(summary.frameCount == window);
+		CHECK(Near(summary.maxMs, 20.0));
+		CHECK(Near(summary.averageMs, (10.0 * (window - 1) + 20.0) / window));
+
+		for (unsigned int i = 0; i < window; i++)
+			stats.AddFrame(20.0);
+		summary = stats.GetRollingSummary();
+		CHECK(summary.frameCount == window);
+		CHECK(Near(summary.averageMs, 20.0));
+		CHECK(Near(summary.p50Ms, Midpoint(20.0)) && Near(summary.p99Ms, Midpoint(20.0)));
+
+		FrameTimeSummary session = stats.GetSessionSummary();
+		CHECK(session.frameCount == window * 2 + 1);
+		CHECK(stats.GetFrameCount() == window * 2 + 1);
+		CHECK(Near(session.maxMs, 200.0));
+		CHECK(Near(session.p50Ms, Midpoint(20.0)));
+	}
+
+	void TestAbsoluteHitch()
+	{
+		FrameStats stats;
+		stats.SetHitchThresholds(50.0, 0.0);
+		stats.SetWarmupFrames(0);
+
+		CHECK(!stats.AddFrame(16.0));
+		CHECK(!stats.AddFrame(50.0));
+		CHECK(stats.AddFrame(50.5));
+		CHECK(!stats.AddFrame(16.0));
+		stats.SetLastHitchDetails("Update 40ms");
+
+		const std::vector<FrameHitch>& hitches = stats.GetHitches();
+		if (CHECK(hitches.size() == 1))
+		{
+			CHECK(hitches[0].frameIndex == 2);
+			CHECK(Near(hitches[0].frameMs, 50.5));
+			CHECK(hitches[0].details == "Update 40ms");
+		}
+	}
+
+	// --------------------------------------------------------
+	// Against the median of the frames before, so a hitch
+	// doesn't raise its own bar
+	// --------------------------------------------------------
+	void TestMedianHitch()
+	{
+		FrameStats stats;
+		stats.SetHitchThresholds(0.0, 2.0);
+		stats.SetWarmupFrames(10);
+
+		for (unsigned int i = 0; i < 100; i++)
+			CHECK(!stats.AddFrame(10.0));
+
+		double median = Midpoint(10.0);
+		CHECK(!stats.AddFrame(median * 2.0));
+		CHECK(stats.AddFrame(median * 2.0 + 0.01));
+
+		const std::vector<FrameHitch>& hitches = stats.GetHitches();
+		if (CHECK(hitches.size() == 1))
+		{
+			CHECK(hitches[0].frameIndex == 101);
+			CHECK(Near(hitches[0].medianMs, median));
+		}
+
+		// A slower scene moves the median up with it: its first
+		// frames are hitches, but once it is most of the window
+		// they aren't
+		unsigned int slowHitches = 0;
+		for (unsigned int i = 0; i < FrameStats::WindowSize; i++)
+			slowHitches += stats.AddFrame(30.0);
+		CHECK(slowHitches > 0 && slowHitches < FrameStats::WindowSize / 2 + 1);
+		CHECK(!stats.AddFrame(40.0));
+
+		// Both limits on: either one is enough
+		stats.SetHitchThresholds(35.0, 2.0);
+		CHECK(stats.AddFrame(36.0));
+	}
+
+	// --------------------------------------------------------
+	// No hitches until the window has the warm-up's frames,
+	// again after a Reset()
+	// --------------------------------------------------------
+	void TestWarmup()
+	{
+		FrameStats stats;
+		stats.SetHitchThresholds(50.0, 2.0);
+		stats.SetWarmupFrames(30);
+
+		for (unsigned int round = 0; round < 2; round++)
+		{
+			for (unsigned int i = 0; i < 30; i++)
+				CHECK(!stats.AddFrame(i % 2 ? 500.0 : 10.0));
+			CHECK(stats.GetHitches().empty());
+			CHECK(stats.AddFrame(500.0));
+			CHECK(stats.GetHitches().size() == 1);
+			stats.Reset();
+		}
+
+		// Hitches beyond MaxHitches push out the oldest
+		stats.SetWarmupFrames(0);
+		for (unsigned int i = 0; i < FrameStats::MaxHitches + 10; i++)
+			stats.AddFrame(100.0);
+		CHECK(stats.GetHitches().size() == FrameStats::MaxHitches);
+		CHECK(stats.GetHitches().front().frameIndex == 10);
+	}
+}
+
+void RunFrameStatsTests()
+{
+	TestPercentiles();
+	TestOverflowBucket();
+	TestRollingWindow();
+	TestAbsoluteHitch();
+	TestMedianHitch();
+	TestWarmup();
+}
@@ -0,0 +1,498 @@
+#include "Test.h"
+#include "JobSystem.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const unsigned int StressWorkers = 4;
+
+	// --------------------------------------------------------
+	// Jobs that queue more jobs, from every thread at once, all
+	// counted by one counter the main thread waits on
+	// --------------------------------------------------------
+	void TestMultiProducerStress()
+	{
+		JobSystem jobs;
+		jobs.Init(StressWorkers);
+
+		const unsigned int producers = 64;
+		const unsigned int childrenPerProducer = 200;
+		for (unsigned int round = 0; round < 20; round++)
+		{
+			std::atomic<unsigned int> ran(0);
+			JobCounter counter;
+			for (unsigned int p = 0; p < producers; p++)
+			{
+				jobs.Run([&jobs, &ran, &counter]()
+				{
+					for (unsigned int c = 0; c < childrenPerProducer; c++)
+						jobs.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+					ran.fetch_add(1, std::memory_order_relaxed);
+				}, &counter);
+			}
+
+			jobs.Wait(&counter);
+			CHECK(counter.IsDone());
+			CHECK(ran.load() == producers * (childrenPerProducer + 1));
+		}
+
+		jobs.Shutdown();
+	}
+
+	// --------------------------------------------------------
+	// Fills the main thread's deque with tiny jobs while every
+	// worker steals from it.  Each job must run exactly once.
+	// More jobs than the pool holds, so slots get recycled
+	// while thieves are still racing for them.
+	// --------------------------------------------------------
+	void TestStealContention()
+	{
+		JobSystem jobs;
+		jobs.Init(StressWorkers);
+
+		const unsigned int jobCount = 10000;
+		std::unique_ptr<std::atomic<int>[]> runs(new std::atomic<int>[jobCount]);
+		for (unsigned int round = 0; round < 10; round++)
+		{
+			for (unsigned int i = 0; i < jobCount; i++)
+				runs[i].store(0);
+
+			JobCounter counter;
+			std::atomic<int>* slots = runs.get();
+			for (unsigned int i = 0; i < jobCount; i++)
+				jobs.Run([slots, i]() { slots[i].fetch_add(1, std::memory_order_relaxed); }, &counter);
+			jobs.Wait(&counter);
+
+			unsigned int wrong = 0;
+			for (unsigned int i = 0; i < jobCount; i++)
+				wrong += runs[i].load() != 1;
+			CHECK(wrong == 0);
+		}
+
+		jobs.Shutdown();
+	}
+
+	// --------------------------------------------------------
+	// Three stages chained through counters.  A job may only
+	// start once every job of the stage before has finished,
+	// even when it is queued before they are.
+	// --------------------------------------------------------
+	void TestDependencyOrdering()
+	{
+		JobSystem jobs;
+		jobs.Init(StressWorkers);
+
+		const unsigned int perStage = 300;
+		for (unsigned int round = 0; round < 20; round++)
+		{
+			std::atomic<unsigned int> firstDone(0);
+			std::atomic<unsigned int> secondDone(0);
+			std::atomic<unsigned int> thirdDone(0);
+			std::atomic<unsigned int> tooEarly(0);
+			JobCounter first, second, third;
+
+			// Hold the first stage back behind a gate, so the later
+			// stages are definitely parked rather than released
+			JobCounter gate;
+			std::atomic<bool> open(false);
+			jobs.Run([&open]()
+			{
+				while (!open.load())
+					std::this_thread::yield();
+			}, &gate);
+
+			for (unsigned int i = 0; i < perStage; i++)
+				jobs.Run([&firstDone]() { firstDone.fetch_add(1); }, &first, &gate);
+			for (unsigned int i = 0; i < perStage; i++)
+			{
+				jobs.Run([&]()
+				{
+					if (firstDone.load() != perStage)
+						tooEarly.fetch_add(1);
+					secondDone.fetch_add(1);
+				}, &second, &first);
+			}
+			for (unsigned int i = 0; i < perStage; i++)
+			{
+				jobs.Run([&]()
+				{
+					if (secondDone.load() != perStage)
+						tooEarly.fetch_add(1);
+					thirdDone.fetch_add(1);
+				}, &third, &second);
+			}
+
+			CHECK(firstDone.load() == 0);
+			open.store(true);
+			jobs.Wait(&third);
+
+			CHECK(tooEarly.load() == 0);
+			CHECK(thirdDone.load() == perStage);
+			CHECK(first.IsDone() && second.IsDone() && gate.IsDone());
+		}
+
+		// A dependency that is already done holds nothing back
+		JobCounter done, after;
+		bool ran = false;
+		jobs.Run([&ran]() { ran = true; }, &after, &done);
+		jobs.Wait(&after);
+		CHECK(ran);
+
+		jobs.Shutdown();
+	}
+
+	// --------------------------------------------------------
+	// Main-thread jobs queued by workers only run when the main
+	// thread pumps them (or waits), in the order they came
+	// --------------------------------------------------------
+	void TestMainThreadQueue()
+	{
+		JobSystem jobs;
+		jobs.Init(StressWorkers);
+
+		// Called on the main thread it runs straight away
+		int index = -2;
+		jobs.RunOnMainThread([&jobs, &index]() { index = jobs.GetThreadIndex(); });
+		CHECK(index == 0);
+
+		// One worker queues them, so their order is known
+		const unsigned int count = 500;
+		std::vector<unsigned int> order;
+		std::atomic<unsigned int> offMain(0);
+		JobCounter queued, ran;
+		jobs.Run([&]()
+		{
+			for (unsigned int i = 0; i < count; i++)
+			{
+				jobs.RunOnMainThread([&, i]()
+				{
+					if (jobs.GetThreadIndex() != 0)
+						offMain.fetch_add(1);
+					order.push_back(i);
+				}, &ran);
+			}
+		}, &queued);
+
+		// Not Wait(), which would pump them on this thread
+		while (!queued.IsDone())
+			std::this_thread::yield();
+
+		// Nothing has run yet: only the main thread can run them
+		CHECK(order.empty());
+		CHECK(!ran.IsDone());
+
+		CHECK(jobs.PumpMainThreadJobs(10) == 10);
+		CHECK(order.size() == 10);
+		while (!ran.IsDone())
+			jobs.PumpMainThreadJobs();
+
+		CHECK(offMain.load() == 0);
+		bool inOrder = order.size() == count;
+		for (unsigned int i = 0; inOrder && i < count; i++)
+			inOrder = order[i] == i;
+		CHECK(inOrder);
+		CHECK(jobs.PumpMainThreadJobs() == 0);
+
+		// A worker waiting on main-thread work doesn't deadlock a
+		// main thread that is waiting on the worker
+		JobCounter outer;
+		bool innerRan = false;
+		jobs.Run([&]()
+		{
+			JobCounter inner;
+			jobs.RunOnMainThread([&innerRan]() { innerRan = true; }, &inner);
+			jobs.Wait(&inner);
+		}, &outer);
+		jobs.Wait(&outer);
+		CHECK(innerRan);
+
+		jobs.Shutdown();
+	}
+
+	// --------------------------------------------------------
+	// Threads the job system doesn't know about can queue jobs
+	// and wait for them too
+	// --------------------------------------------------------
+	void TestForeignThreads()
+	{
+		JobSystem jobs;
+		jobs.Init(StressWorkers);
+
+		const unsigned int threadCount = 4;
+		const unsigned int jobsPerThread = 5000;
+		std::atomic<unsigned int> ran(0);
+		std::atomic<unsigned int> badIndex(0);
+		std::atomic<unsigned int> unfinished(0);
+
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				if (jobs.GetThreadIndex() != -1)
+					badIndex.fetch_add(1);
+
+				JobCounter counter;
+				for (unsigned int i = 0; i < jobsPerThread; i++)
+					jobs.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+				jobs.Wait(&counter);
+				if (!counter.IsDone())
+					unfinished.fetch_add(1);
+			}));
+		}
+		for (unsigned int t = 0; t < threadCount; t++)
+			threads[t].join();
+
+		CHECK(badIndex.load() == 0);
+		CHECK(unfinished.load() == 0);
+		CHECK(ran.load() == threadCount * jobsPerThread);
+
+		jobs.Shutdown();
+	}
+
+	// --------------------------------------------------------
+	// An attached thread (like the render thread) queues jobs
+	// from a pool of its own: no heap allocation per job, where
+	// an unattached thread needs one each
+	// --------------------------------------------------------
+	void TestAttachedThreads()
+	{
+		JobSystem jobs;
+		jobs.Init(StressWorkers);
+
+		CHECK(!jobs.AttachThread());
+
+		const unsigned int frames = 50;
+		const unsigned int jobsPerFrame = 100;
+		std::atomic<unsigned int> ran(0);
+		unsigned long long attachedAllocations = 0;
+		unsigned long long foreignAllocations = 0;
+		int attachedIndex = -1;
+
+		std::thread render([&]()
+		{
+			// The first frame warms up the thread's own containers
+			CHECK(jobs.AttachThread());
+			attachedIndex = jobs.GetThreadIndex();
+			CHECK(!jobs.AttachThread());
+			for (unsigned int frame = 0; frame < frames; frame++)
+			{
+				unsigned long long before = Test::GetHeapAllocationCount();
+				JobCounter counter;
+				for (unsigned int i = 0; i < jobsPerFrame; i++)
+					jobs.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+				jobs.Wait(&counter);
+				if (frame > 0)
+					attachedAllocations += Test::GetHeapAllocationCount() - before;
+			}
+			jobs.DetachThread();
+			CHECK(jobs.GetThreadIndex() == -1);
+
+			unsigned long long before = Test::GetHeapAllocationCount();
+			JobCounter counter;
+			for (unsigned int i = 0; i < jobsPerFrame; i++)
+				jobs.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+			jobs.Wait(&counter);
+			foreignAllocations = Test::GetHeapAllocationCount() - before;
+		});
+		render.join();
+
+		CHECK(attachedIndex > (int)StressWorkers);
+		CHECK(ran.load() == (frames + 1) * jobsPerFrame);
+		CHECK(attachedAllocations == 0);
+		CHECK(foreignAllocations >= jobsPerFrame);
+
+		// Only so many slots.  Detaching runs what the thread left
+		// queued, and frees the slot for the next thread.
+		std::vector<std::thread> threads;
+		std::atomic<unsigned int> attached(0);
+		std::atomic<unsigned int> leftOver(0);
+		std::atomic<bool> release(false);
+		for (unsigned int t = 0; t < JobSystem::MaxAttachedThreads + 2; t++)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				if (!jobs.AttachThread())
+					return;
+				attached.fetch_add(1);
+				while (!release.load())
+					std::this_thread::yield();
+
+				JobCounter counter;
+				jobs.Run([&leftOver]() { leftOver.fetch_add(1); }, &counter);
+				jobs.DetachThread();
+				jobs.Wait(&counter);
+			}));
+		}
+		while (attached.load() < JobSystem::MaxAttachedThreads)
+			std::this_thread::yield();
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		CHECK(attached.load() == JobSystem::MaxAttachedThreads);
+		release.store(true);
+		for (unsigned int t = 0; t < threads.size(); t++)
+			threads[t].join();
+		CHECK(leftOver.load() == JobSystem::MaxAttachedThreads);
+
+		std::thread again([&jobs]()
+		{
+			CHECK(jobs.AttachThread());
+			jobs.DetachThread();
+		});
+		again.join();
+
+		jobs.Shutdown();
+	}
+
+	// --------------------------------------------------------
+	// Shutdown() runs whatever is left - queued, parked behind
+	// a dependency, or queued for the main thread by a worker
+	// while it drains - before the workers stop
+	// --------------------------------------------------------
+	void TestShutdownFinishesEverything()
+	{
+		const unsigned int count = 200;
+		std::atomic<unsigned int> ran(0);
+		JobCounter gate, first;
+		{
+			JobSystem jobs;
+			jobs.Init(StressWorkers);
+
+			// Make sure a worker has the gate, so what it releases is
+			// queued from there rather than run by Shutdown() itself
+			std::atomic<bool> started(false);
+			jobs.Run([&started]()
+			{
+				started.store(true);
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			}, &gate);
+			while (!started.load())
+				std::this_thread::yield();
+
+			for (unsigned int i = 0; i < count; i++)
+			{
+				jobs.Run([&jobs, &ran]()
+				{
+					jobs.RunOnMainThread([&ran]() { ran.fetch_add(1); });
+					ran.fetch_add(1);
+				}, &first, &gate);
+			}
+			for (unsigned int i = 0; i < count; i++)
+				jobs.Run([&ran]() { ran.fetch_add(1); }, 0, &first);
+
+			jobs.Shutdown();
+			CHECK(ran.load() == count * 3);
+			CHECK(!jobs.IsRunning());
+		}
+		CHECK(gate.IsDone() && first.IsDone());
+	}
+
+	void TestParallelFor()
+	{
+		JobSystem jobs;
+		jobs.Init(StressWorkers);
+
+		const unsigned int count = 100000;
+		std::unique_ptr<std::atomic<int>[]> hits(new std::atomic<int>[count]);
+		for (unsigned int i = 0; i < count; i++)
+			hits[i].store(0);
+
+		std::atomic<int>* slots = hits.get();
+		jobs.ParallelFor(count, 1000, [slots](unsigned int begin, unsigned int end)
+		{
+			for (unsigned int i = begin; i < end; i++)
+				slots[i].fetch_add(1, std::memory_order_relaxed);
+		});
+
+		unsigned int wrong = 0;
+		for (unsigned int i = 0; i < count; i++)
+			wrong += hits[i].load() != 1;
+		CHECK(wrong == 0);
+
+		jobs.Shutdown();
+	}
+
+	// Stands in for a bit of real work per element
+	float Work(unsigned int i)
+	{
+		float x = (float)i;
+		for (unsigned int k = 0; k < 64; k++)
+			x = std::sqrt(x * 1.0001f + 1.0f);
+		return x;
+	}
+}
+
+void RunJobSystemTests()
+{
+	TestMultiProducerStress();
+	TestStealContention();
+	TestDependencyOrdering();
+	TestMainThreadQueue();
+	TestForeignThreads();
+	TestAttachedThreads();
+	TestShutdownFinishesEverything();
+	TestParallelFor();
+}
+
+// --------------------------------------------------------
+// Times the same work with 1 to N threads: a ParallelFor
+// heavy enough to scale, and a fan-out of empty jobs that
+// measures the scheduler's own overhead.  0 workers runs
+// everything inline, as the job system does before Init().
+// --------------------------------------------------------
+void RunJobSystemBenchmark()
+{
+	const unsigned int elements = 1 << 20;
+	const unsigned int emptyJobs = 200000;
+	std::vector<float> results(elements);
+
+	unsigned int cores = std::thread::hardware_concurrency();
+	unsigned int maxWorkers = cores > 1 ? cores - 1 : 1;
+	if (maxWorkers < 3)
+		maxWorkers = 3;
+
+	printf("%8s %16s %9s %16s\n", "threads", "parallel for", "speedup", "empty jobs/s");
+	double serialMs = 0.0;
+	for (unsigned int workers = 0; workers <= maxWorkers; workers++)
+	{
+		JobSystem jobs;
+		if (workers > 0)
+			jobs.Init(workers);
+
+		float* out = results.data();
+		double best = 1e30;
+		for (unsigned int run = 0; run < 3; run++)
+		{
+			double start = Test::NowMs();
+			jobs.ParallelFor(elements, 4096, [out](unsigned int begin, unsigned int end)
+			{
+				for (unsigned int i = begin; i < end; i++)
+					out[i] = Work(i);
+			});
+			double ms = Test::NowMs() - start;
+			if (ms < best)
+				best = ms;
+		}
+		if (workers == 0)
+			serialMs = best;
+
+		std::atomic<unsigned int> ran(0);
+		JobCounter counter;
+		double start = Test::NowMs();
+		for (unsigned int i = 0; i < emptyJobs; i++)
+			jobs.Run([&ran]() { ran.fetch_add(1, std::memory_order_relaxed); }, &counter);
+		jobs.Wait(&counter);
+		double emptyMs = Test::NowMs() - start;
+
+		CHECK(ran.load() == emptyJobs);
+		printf("%8u %14.2fms %8.2fx %16.0f\n", workers + 1, best, serialMs / best, emptyJobs / (emptyMs / 1000.0));
+		jobs.Shutdown();
+	}
+	if (cores < 2)
+		printf("Only %u core here, so the threads can't run in parallel.\n", cores);
+}
@@ -0,0 +1,112 @@
+#include "Test.h"
+#include "Lz4.h"
+#include <random>
+#include <vector>
+
+namespace
+{
+	bool RoundTrip(const std::vector<unsigned char>& data)
+	{
+		std::vector<unsigned char> compressed(Lz4::GetMaxCompressedSize(data.size()));
+		size_t size = Lz4::Compress(data.data(), data.size(), compressed.data(), compressed.size());
+		if (!CHECK(size > 0 && size <= compressed.size()))
+			return false;
+
+		std::vector<unsigned char> output(data.size());
+		if (!CHECK(Lz4::Decompress(compressed.data(), size, output.data(), output.size())))
+			return false;
+		if (!CHECK(output == data))
+			return false;
+
+		// Any other output size is an error, not a short read
+		std::vector<unsigned char> bigger(data.size() + 1);
+		CHECK(!Lz4::Decompress(compressed.data(), size, bigger.data(), bigger.size()));
+		if (data.size() > 0)
+			CHECK(!Lz4::Decompress(compressed.data(), size, output.data(), output.size() - 1));
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Empty input, where the buffers may be null
+	// --------------------------------------------------------
+	void TestEmpty()
+	{
+		unsigned char block[16];
+		CHECK(Lz4::Compress(0, 0, block, sizeof(block)) == 1 && block[0] == 0);
+		CHECK(Lz4::Compress(0, 0, block, 0) == 0);
+		CHECK(Lz4::Decompress(block, 1, 0, 0));
+		CHECK(!Lz4::Decompress(0, 0, 0, 0));
+		CHECK(!Lz4::Decompress(0, 0, block, sizeof(block)));
+
+		block[0] = 0x10;
+		CHECK(!Lz4::Decompress(block, 1, 0, 0));
+		RoundTrip(std::vector<unsigned char>());
+	}
+
+	// --------------------------------------------------------
+	// Sizes around the format's edges, with data that's
+	// random, repetitive and in between
+	// --------------------------------------------------------
+	void TestRoundTrips()
+	{
+		std::mt19937 random(5);
+		const size_t sizes[] = { 1, 4, 5, 12, 13, 15, 16, 17, 64, 255, 270, 4096, 70000, 300000 };
+		for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+		{
+			std::vector<unsigned char> data(sizes[s]);
+			for (unsigned int kind = 0; kind < 3; kind++)
+			{
+				for (size_t i = 0; i < data.size(); i++)
+				{
+					if (kind == 0)
+						data[i] = (unsigned char)random();
+					else if (kind == 1)
+						data[i] = (unsigned char)(i % 3);
+					else
+						data[i] = (unsigned char)(random() % 4 == 0 ? random() : i / 7);
+				}
+				if (!RoundTrip(data))
+					return;
+			}
+		}
+	}
+
+	// --------------------------------------------------------
+	// Truncated or corrupted blocks fail without touching
+	// memory they shouldn't (run under ASan to be sure)
+	// --------------------------------------------------------
+	void TestBadData()
+	{
+		std::vector<unsigned char> data(5000);
+		for (size_t i = 0; i < data.size(); i++)
+			data[i] = (unsigned char)(i / 11 + i % 5);
+		std::vector<unsigned char> compressed(Lz4::GetMaxCompressedSize(data.size()));
+		size_t size = Lz4::Compress(data.data(), data.size(), compressed.data(), compressed.size());
+		CHECK(size > 0 && size < data.size());
+
+		std::vector<unsigned char> output(data.size());
+		for (size_t cut = 0; cut < size; cut += 7)
+		{
+			std::vector<unsigned char> truncated(compressed.begin(), compressed.begin() + cut);
+			CHECK(!Lz4::Decompress(truncated.data(), truncated.size(), output.data(), output.size()));
+		}
+
+		std::mt19937 random(11);
+		for (unsigned int i = 0; i < 2000; i++)
+		{
+			std::vector<unsigned char> corrupt(compressed.begin(), compressed.begin() + size);
+			corrupt[random() % size] ^= (unsigned char)(1 + random() % 255);
+			Lz4::Decompress(corrupt.data(), corrupt.size(), output.data(), output.size());
+		}
+
+		// Too small to hold the output
+		CHECK(Lz4::Compress(data.data(), data.size(), compressed.data(), size - 1) == 0);
+	}
+}
+
+void RunLz4Tests()
+{
+	TestEmpty();
+	TestRoundTrips();
+	TestBadData();
+}
@@ -0,0 +1,110 @@
+#include "Test.h"
+#include "MipGenerator.h"
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+	std::vector<unsigned char> Fill(uint32_t width, uint32_t height, const unsigned char* color)
+	{
+		std::vector<unsigned char> pixels((size_t)width * height * 4);
+		for (size_t i = 0; i < pixels.size(); i++)
+			pixels[i] = color[i % 4];
+		return pixels;
+	}
+
+	bool IsFilled(const unsigned char* pixels, size_t texels, const unsigned char* color)
+	{
+		for (size_t i = 0; i < texels * 4; i++)
+		{
+			if (abs((int)pixels[i] - (int)color[i % 4]) > 1)
+				return false;
+		}
+		return true;
+	}
+
+	// --------------------------------------------------------
+	// Flat images stay flat at any size, with either filter
+	// and any content - the weights always add up to one
+	// --------------------------------------------------------
+	void TestFlat()
+	{
+		const unsigned char color[4] = { 200, 30, 90, 128 };
+		const unsigned char normal[4] = { 128, 128, 255, 255 };
+		const uint32_t sizes[][4] = { { 160, 137, 160, 136 }, { 37, 21, 40, 24 }, { 5, 3, 64, 48 }, { 64, 64, 1, 1 } };
+		const MipFilter filters[] = { MipFilter_Box, MipFilter_Kaiser };
+		for (unsigned int f = 0; f < 2; f++)
+		{
+			for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+			{
+				MipSettings settings;
+				settings.filter = filters[f];
+				std::vector<unsigned char> source = Fill(sizes[s][0], sizes[s][1], color);
+				std::vector<unsigned char> dest((size_t)sizes[s][2] * sizes[s][3] * 4);
+				MipGenerator::Resize(source.data(), sizes[s][0], sizes[s][1], dest.data(), sizes[s][2], sizes[s][3], settings);
+				CHECK(IsFilled(dest.data(), (size_t)sizes[s][2] * sizes[s][3], color));
+
+				settings.content = MipContent_NormalMap;
+				source = Fill(sizes[s][0], sizes[s][1], normal);
+				MipGenerator::Resize(source.data(), sizes[s][0], sizes[s][1], dest.data(), sizes[s][2], sizes[s][3], settings);
+				CHECK(IsFilled(dest.data(), (size_t)sizes[s][2] * sizes[s][3], normal));
+			}
+
+			MipSettings settings;
+			settings.filter = filters[f];
+			std::vector<unsigned char> chain = Fill(24, 10, color);
+			chain.resize(MipGenerator::GetChainSize(24, 10));
+			CHECK(MipGenerator::Generate(chain.data(), 24, 10, settings) == 5);
+			CHECK(IsFilled(chain.data(), chain.size() / 4, color));
+		}
+	}
+
+	// --------------------------------------------------------
+	// Same size in and out is a copy, and a ramp stays a ramp
+	// (edges clamp rather than wrap)
+	// --------------------------------------------------------
+	void TestDetail()
+	{
+		const uint32_t width = 40;
+		const uint32_t height = 6;
+		std::vector<unsigned char> ramp((size_t)width * height * 4);
+		for (uint32_t y = 0; y < height; y++)
+		{
+			for (uint32_t x = 0; x < width; x++)
+			{
+				unsigned char* texel = &ramp[((size_t)y * width + x) * 4];
+				texel[0] = texel[1] = texel[2] = (unsigned char)(x * 6);
+				texel[3] = (unsigned char)(y * 40);
+			}
+		}
+
+		const MipFilter filters[] = { MipFilter_Box, MipFilter_Kaiser };
+		for (unsigned int f = 0; f < 2; f++)
+		{
+			MipSettings settings;
+			settings.filter = filters[f];
+			settings.content = MipContent_Linear;
+			std::vector<unsigned char> same(ramp.size());
+			MipGenerator::Resize(ramp.data(), width, height, same.data(), width, height, settings);
+			CHECK(same == ramp);
+
+			const uint32_t newWidth = 31;
+			std::vector<unsigned char> smaller((size_t)newWidth * height * 4);
+			MipGenerator::Resize(ramp.data(), width, height, smaller.data(), newWidth, height, settings);
+			for (uint32_t y = 0; y < height; y++)
+			{
+				const unsigned char* row = &smaller[(size_t)y * newWidth * 4];
+				CHECK(row[0] <= 6 && row[(newWidth - 1) * 4] >= 228);
+				for (uint32_t x = 1; x < newWidth; x++)
+					CHECK(row[x * 4] >= row[(x - 1) * 4]);
+				CHECK(abs((int)row[3] - (int)(y * 40)) <= 1);
+			}
+		}
+	}
+}
+
+void RunMipGeneratorTests()
+{
+	TestFlat();
+	TestDetail();
+}
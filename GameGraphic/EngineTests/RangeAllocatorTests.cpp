@@ -0,0 +1,257 @@
+#include "Test.h"
+#include "RangeAllocator.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// Random allocations and frees, checked against a map of
+	// which units are in use.  Returns false at the first
+	// broken invariant.
+	// --------------------------------------------------------
+	bool Churn(RangeAllocator& allocator, std::vector<RangeAllocation>& live, unsigned int steps,
+		unsigned int maxSize, unsigned int sizeMultiple, std::mt19937& random)
+	{
+		unsigned int capacity = allocator.GetCapacity();
+		std::vector<unsigned char> used(capacity, 0);
+		unsigned int usedUnits = 0;
+		for (unsigned int i = 0; i < live.size(); i++)
+		{
+			for (unsigned int u = live[i].offset; u < live[i].offset + live[i].size; u++)
+				used[u] = 1;
+			usedUnits += live[i].size;
+		}
+
+		for (unsigned int step = 0; step < steps; step++)
+		{
+			if (live.empty() || random() % 3 != 0)
+			{
+				unsigned int size = (1 + random() % maxSize) * sizeMultiple;
+				unsigned int freeBefore = allocator.GetFreeSpace();
+				RangeAllocation allocation = allocator.Allocate(size);
+				if (!allocation.IsValid())
+				{
+					// Failing changes nothing
+					if (!CHECK(allocator.GetFreeSpace() == freeBefore))
+						return false;
+					continue;
+				}
+
+				if (!CHECK(allocation.size == size) ||
+					!CHECK(allocation.offset + size <= capacity) ||
+					!CHECK(allocation.offset % sizeMultiple == 0))
+					return false;
+				for (unsigned int u = allocation.offset; u < allocation.offset + size; u++)
+				{
+					if (!CHECK(used[u] == 0))
+						return false;
+					used[u] = 1;
+				}
+				usedUnits += size;
+				live.push_back(allocation);
+			}
+			else
+			{
+				unsigned int index = random() % live.size();
+				for (unsigned int u = live[index].offset; u < live[index].offset + live[index].size; u++)
+					used[u] = 0;
+				usedUnits -= live[index].size;
+				allocator.Free(live[index]);
+				if (!CHECK(!live[index].IsValid()))
+					return false;
+				live[index] = live.back();
+				live.pop_back();
+			}
+
+			if (!CHECK(allocator.GetFreeSpace() == capacity - usedUnits) ||
+				!CHECK(allocator.GetAllocationCount() == live.size()) ||
+				!CHECK(allocator.GetLargestFreeRange() <= allocator.GetFreeSpace()))
+				return false;
+		}
+		return true;
+	}
+
+	void FreeAll(RangeAllocator& allocator, std::vector<RangeAllocation>& live, std::mt19937& random)
+	{
+		while (!live.empty())
+		{
+			unsigned int index = random() % live.size();
+			allocator.Free(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+	}
+
+	// --------------------------------------------------------
+	// No overlaps and exact free space through random churn,
+	// then freeing everything merges back into a single range
+	// --------------------------------------------------------
+	void TestChurnAndCoalescing()
+	{
+		std::mt19937 random(1234);
+		const unsigned int capacities[] = { 1 << 16, 100003, 777 };
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			RangeAllocator allocator(capacities[c]);
+			std::vector<RangeAllocation> live;
+			if (!Churn(allocator, live, 20000, capacities[c] / 64, 1, random))
+				return;
+			CHECK(allocator.GetAllocationCount() > 0);
+
+			FreeAll(allocator, live, random);
+			CHECK(allocator.GetAllocationCount() == 0);
+			CHECK(allocator.GetFreeSpace() == capacities[c]);
+			CHECK(allocator.GetLargestFreeRange() == capacities[c]);
+			CHECK(allocator.GetFragmentation() == 0.0f);
+
+			// The whole space is one range again
+			RangeAllocation all = allocator.Allocate(capacities[c]);
+			CHECK(all.IsValid() && all.offset == 0);
+			allocator.Free(all);
+		}
+	}
+
+	// --------------------------------------------------------
+	// Sizes that are all multiples of N give offsets that are
+	// multiples of N, even with a capacity that isn't
+	// --------------------------------------------------------
+	void TestAlignmentContract()
+	{
+		std::mt19937 random(99);
+		const unsigned int multiples[] = { 3, 4, 16, 256 };
+		for (unsigned int m = 0; m < 4; m++)
+		{
+			RangeAllocator allocator(multiples[m] * 5000 + 7);
+			std::vector<RangeAllocation> live;
+			if (!Churn(allocator, live, 10000, 40, multiples[m], random))
+				return;
+			FreeAll(allocator, live, random);
+			CHECK(allocator.GetLargestFreeRange() == allocator.GetCapacity());
+		}
+	}
+
+	// --------------------------------------------------------
+	// Requests fail cleanly when nothing is big enough - out
+	// of space, or enough space but only in pieces
+	// --------------------------------------------------------
+	void TestOutOfSpace()
+	{
+		RangeAllocator empty;
+		CHECK(!empty.Allocate(1).IsValid());
+
+		RangeAllocator allocator(100);
+		CHECK(!allocator.Allocate(0).IsValid());
+		CHECK(!allocator.Allocate(101).IsValid());
+
+		RangeAllocation all = allocator.Allocate(100);
+		CHECK(all.IsValid());
+		CHECK(allocator.GetFreeSpace() == 0);
+		CHECK(allocator.GetFragmentation() == 0.0f);
+		CHECK(!allocator.Allocate(1).IsValid());
+		allocator.Free(all);
+
+		// Ten ranges of 10, every other one freed: 50 free, none
+		// of it more than 10 in a row
+		RangeAllocation pieces[10];
+		for (unsigned int i = 0; i < 10; i++)
+			pieces[i] = allocator.Allocate(10);
+		for (unsigned int i = 0; i < 10; i += 2)
+			allocator.Free(pieces[i]);
+		CHECK(allocator.GetFreeSpace() == 50);
+		CHECK(allocator.GetLargestFreeRange() == 10);
+		CHECK(allocator.GetFragmentation() > 0.75f);
+		CHECK(!allocator.Allocate(11).IsValid());
+		CHECK(allocator.GetFreeSpace() == 50);
+
+		// Exact fits still work, and freeing one in the middle
+		// merges with both neighbours
+		RangeAllocation fit = allocator.Allocate(10);
+		CHECK(fit.IsValid() && fit.offset % 20 == 0);
+		allocator.Free(fit);
+		allocator.Free(pieces[5]);
+		CHECK(allocator.GetLargestFreeRange() == 30);
+		CHECK(allocator.Allocate(30).IsValid());
+
+		// Freeing twice, or something that never was, is harmless
+		RangeAllocation invalid = allocator.Allocate(1000);
+		allocator.Free(invalid);
+		allocator.Free(pieces[5]);
+		CHECK(allocator.GetAllocationCount() == 5);
+
+		// Reset() forgets everything
+		allocator.Reset(64);
+		CHECK(allocator.GetCapacity() == 64 && allocator.GetFreeSpace() == 64);
+		CHECK(allocator.GetAllocationCount() == 0);
+	}
+}
+
+void RunRangeAllocatorTests()
+{
+	TestChurnAndCoalescing();
+	TestAlignmentContract();
+	TestOutOfSpace();
+}
+
+// --------------------------------------------------------
+// Allocate+free pairs per second with mesh-like sizes, and
+// how fragmented a pool gets under steady churn at various
+// fill levels
+// --------------------------------------------------------
+void RunRangeAllocatorBenchmark()
+{
+	std::mt19937 random(7);
+	const unsigned int batch = 1000;
+	const unsigned int rounds = 2000;
+
+	RangeAllocator allocator(1u << 30);
+	std::vector<RangeAllocation> live(batch);
+	std::vector<unsigned int> sizes(batch * 16);
+	for (unsigned int i = 0; i < sizes.size(); i++)
+		sizes[i] = 1 + random() % 10000;
+
+	double start = Test::NowMs();
+	for (unsigned int round = 0; round < rounds; round++)
+	{
+		for (unsigned int i = 0; i < batch; i++)
+			live[i] = allocator.Allocate(sizes[(round * 7 + i) % sizes.size()]);
+		for (unsigned int i = 0; i < batch; i++)
+			allocator.Free(live[(i * 7919) % batch]);
+	}
+	double ms = Test::NowMs() - start;
+	CHECK(allocator.GetLargestFreeRange() == allocator.GetCapacity());
+	printf("%.1f ns per allocate+free pair\n", ms * 1e6 / ((double)batch * rounds));
+
+	printf("%8s %14s %14s\n", "filled", "fragmentation", "failed");
+	const unsigned int capacity = 1 << 20;
+	const unsigned int fills[] = { 50, 75, 90 };
+	for (unsigned int f = 0; f < 3; f++)
+	{
+		RangeAllocator pool(capacity);
+		std::vector<RangeAllocation> held;
+		unsigned int target = capacity / 100 * fills[f];
+		unsigned int failed = 0;
+		unsigned int attempts = 0;
+		for (unsigned int step = 0; step < 200000; step++)
+		{
+			if (capacity - pool.GetFreeSpace() < target)
+			{
+				attempts++;
+				RangeAllocation allocation = pool.Allocate(1 + random() % 4096);
+				if (allocation.IsValid())
+					held.push_back(allocation);
+				else
+					failed++;
+			}
+			else
+			{
+				unsigned int index = random() % held.size();
+				pool.Free(held[index]);
+				held[index] = held.back();
+				held.pop_back();
+			}
+		}
+		printf("%7u%% %14.3f %13.2f%%\n", fills[f], pool.GetFragmentation(), 100.0 * failed / attempts);
+	}
+}
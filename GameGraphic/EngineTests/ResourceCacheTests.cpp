@@ -0,0 +1,197 @@
+#include "Test.h"
+#include "ResourceCache.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	struct Resource
+	{
+		explicit Resource(unsigned int id) : id(id) { }
+		unsigned int id;
+	};
+
+	typedef ResourceCache<Resource> Cache;
+
+	// Hashes spread over every shard, as real ones are
+	ContentHash MakeHash(unsigned int i)
+	{
+		return (i + 1) * 0x9E3779B97F4A7C15ull;
+	}
+
+	// --------------------------------------------------------
+	// Threads asking for the same content at once, and for
+	// different content, each get one resource per hash
+	// --------------------------------------------------------
+	void TestConcurrent()
+	{
+		const unsigned int threadCount = 8;
+		const unsigned int hashCount = 64;
+		const unsigned int rounds = 4;
+
+		Cache cache;
+		std::atomic<unsigned int> creates[hashCount + 1];
+		for (unsigned int i = 0; i <= hashCount; i++)
+			creates[i] = 0;
+
+		// Every thread keeps what it got, so nothing expires and
+		// each hash should be made exactly once
+		std::vector<std::vector<Cache::Handle> > held(threadCount);
+		std::atomic<bool> go(false);
+		std::vector<std::thread> threads;
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			threads.push_back(std::thread([&, t]()
+			{
+				while (!go)
+					std::this_thread::yield();
+
+				for (unsigned int r = 0; r < rounds; r++)
+				{
+					// The shared one, then the rest in a different
+					// order per thread
+					held[t].push_back(cache.Acquire(MakeHash(hashCount), [&]()
+					{
+						creates[hashCount]++;
+						return std::make_shared<Resource>(hashCount);
+					}));
+					for (unsigned int i = 0; i < hashCount; i++)
+					{
+						unsigned int index = (i + t * 7) % hashCount;
+						held[t].push_back(cache.Acquire(MakeHash(index), [&, index]()
+						{
+							creates[index]++;
+							return std::make_shared<Resource>(index);
+						}));
+					}
+				}
+			}));
+		}
+		go = true;
+		for (size_t t = 0; t < threads.size(); t++)
+			threads[t].join();
+
+		for (unsigned int i = 0; i <= hashCount; i++)
+			CHECK(creates[i] == 1);
+
+		// Everyone got the same object for each hash
+		for (unsigned int t = 0; t < threadCount; t++)
+		{
+			for (size_t h = 0; h < held[t].size(); h++)
+			{
+				const Cache::Handle& handle = held[t][h];
+				if (!CHECK(handle))
+					return;
+				CHECK(cache.Find(MakeHash(handle->id)) == handle);
+			}
+		}
+
+		const unsigned int requests = threadCount * rounds * (hashCount + 1);
+		CHECK(cache.GetCount() == hashCount + 1);
+		CHECK(cache.GetMissCount() == hashCount + 1);
+		CHECK(cache.GetHitCount() == requests - (hashCount + 1));
+	}
+
+	// --------------------------------------------------------
+	// The cache doesn't keep anything alive: once the last
+	// handle goes, the next request makes a new one
+	// --------------------------------------------------------
+	void TestExpiry()
+	{
+		Cache cache;
+		unsigned int creates = 0;
+		auto create = [&]() { return std::make_shared<Resource>(creates++); };
+
+		Cache::Handle first = cache.Acquire(MakeHash(0), create);
+		std::weak_ptr<Resource> watch = first;
+		CHECK(cache.Acquire(MakeHash(0), create) == first);
+		CHECK(creates == 1 && cache.GetCount() == 1);
+
+		first.reset();
+		CHECK(watch.expired());
+		CHECK(!cache.Find(MakeHash(0)));
+		CHECK(cache.GetCount() == 0);
+
+		Cache::Handle second = cache.Acquire(MakeHash(0), create);
+		CHECK(second && second->id == 1 && creates == 2);
+		CHECK(cache.Find(MakeHash(0)) == second);
+		CHECK(cache.GetHitCount() == 1 && cache.GetMissCount() == 2);
+	}
+
+	// --------------------------------------------------------
+	// Purge only drops dead entries; Clear drops them all but
+	// leaves held resources alive
+	// --------------------------------------------------------
+	void TestPurgeAndClear()
+	{
+		Cache cache;
+		unsigned int creates = 0;
+		auto create = [&]() { return std::make_shared<Resource>(creates++); };
+
+		std::vector<Cache::Handle> handles;
+		for (unsigned int i = 0; i < 32; i++)
+			handles.push_back(cache.Acquire(MakeHash(i), create));
+
+		// Let every other one go
+		for (unsigned int i = 0; i < 32; i += 2)
+			handles[i].reset();
+		CHECK(cache.GetCount() == 16);
+
+		cache.Purge();
+		CHECK(cache.GetCount() == 16);
+		for (unsigned int i = 0; i < 32; i++)
+			CHECK(cache.Find(MakeHash(i)) == handles[i]);
+
+		// Live ones are still shared after a purge
+		CHECK(cache.Acquire(MakeHash(1), create) == handles[1]);
+		CHECK(creates == 32);
+
+		cache.Clear();
+		CHECK(cache.GetCount() == 0);
+		CHECK(!cache.Find(MakeHash(1)));
+		CHECK(handles[1] && handles[1]->id == 1);
+
+		// And new requests no longer find them
+		Cache::Handle again = cache.Acquire(MakeHash(1), create);
+		CHECK(again && again != handles[1]);
+		CHECK(creates == 33 && cache.GetCount() == 1);
+	}
+
+	// --------------------------------------------------------
+	// A failed create() leaves nothing behind, so the next
+	// request tries again
+	// --------------------------------------------------------
+	void TestCreateFails()
+	{
+		Cache cache;
+		unsigned int attempts = 0;
+		auto fail = [&]() { attempts++; return Cache::Handle(); };
+
+		CHECK(!cache.Acquire(MakeHash(5), fail));
+		CHECK(!cache.Acquire(MakeHash(5), fail));
+		CHECK(attempts == 2);
+		CHECK(cache.GetCount() == 0);
+		CHECK(!cache.Find(MakeHash(5)));
+		CHECK(cache.GetMissCount() == 2 && cache.GetHitCount() == 0);
+
+		Cache::Handle made = cache.Acquire(MakeHash(5), []() { return std::make_shared<Resource>(5); });
+		CHECK(made && made->id == 5);
+		CHECK(cache.Acquire(MakeHash(5), fail) == made);
+		CHECK(attempts == 2);
+
+		// Failing alongside live entries in the same shard
+		// leaves them alone
+		CHECK(!cache.Acquire(MakeHash(5) + 1, fail));
+		CHECK(cache.Find(MakeHash(5)) == made);
+		CHECK(cache.GetCount() == 1);
+	}
+}
+
+void RunResourceCacheTests()
+{
+	TestConcurrent();
+	TestExpiry();
+	TestPurgeAndClear();
+	TestCreateFails();
+}
@@ -0,0 +1,99 @@
+#include "Test.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	// Checks can fail on worker threads too
+	std::atomic<unsigned int> failures(0);
+
+	std::atomic<unsigned long long> heapAllocations(0);
+}
+
+// --------------------------------------------------------
+// Counting replacements for the global allocation functions.
+// The nothrow forms are replaced too: std::stable_sort and
+// friends use them, and sanitizers would otherwise supply
+// their own, which don't pair with the deletes here.
+// --------------------------------------------------------
+void* operator new(size_t size)
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* memory = malloc(size > 0 ? size : 1))
+		return memory;
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	heapAllocations.fetch_add(1, std::memory_order_relaxed);
+	return malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) noexcept
+{
+	return operator new(size, nothrow);
+}
+
+void operator delete(void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+	free(memory);
+}
+
+bool Test::Check(bool condition, const char* expression, const char* file, int line)
+{
+	if (!condition)
+	{
+		failures.fetch_add(1);
+		fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+	}
+	return condition;
+}
+
+unsigned int Test::GetFailureCount()
+{
+	return failures.load();
+}
+
+double Test::NowMs()
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+unsigned long long Test::GetHeapAllocationCount()
+{
+	return heapAllocations.load(std::memory_order_relaxed);
+}
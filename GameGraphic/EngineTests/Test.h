@@ -0,0 +1,48 @@
+#pragma once
+
+// --------------------------------------------------------
+// Bare bones checks for the headless engine tests.
+//
+// A failed CHECK() prints where it failed and marks the
+// run as failed, but carries on, so one run reports every
+// failure.  It evaluates to the condition, so a test can
+// stop early when going on would make no sense:
+//
+//   if (!CHECK(allocation.IsValid()))
+//       return;
+//
+// Every suite is a plain function listed in main.cpp.
+// --------------------------------------------------------
+namespace Test
+{
+	bool Check(bool condition, const char* expression, const char* file, int line);
+
+	// Failed checks since the program started
+	unsigned int GetFailureCount();
+
+	// Wall clock time in milliseconds, for benchmarks
+	double NowMs();
+
+	// Calls to operator new (any thread) since the program
+	// started - the tests replace the global one to count them
+	unsigned long long GetHeapAllocationCount();
+}
+
+#define CHECK(condition) Test::Check((condition) ? true : false, #condition, __FILE__, __LINE__)
+
+// --- Suites ---
+void RunJobSystemTests();
+void RunFrameLimiterTests();
+void RunFrameStatsTests();
+void RunFrameAllocatorTests();
+void RunRangeAllocatorTests();
+void RunDdsFileTests();
+void RunLz4Tests();
+void RunMipGeneratorTests();
+void RunResourceCacheTests();
+void RunTextureResidencyTests();
+void RunTextureAtlasTests();
+
+// --- Benchmarks ---
+void RunJobSystemBenchmark();
+void RunRangeAllocatorBenchmark();
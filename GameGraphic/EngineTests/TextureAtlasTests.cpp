@@ -0,0 +1,323 @@
+#include "Test.h"
+#include "TextureAtlas.h"
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	Image MakeImage(uint32_t width, uint32_t height, std::mt19937& random, bool solid)
+	{
+		Image image;
+		image.width = width;
+		image.height = height;
+		image.pixels.resize((size_t)width * height * 4);
+		unsigned char color[4] = { (unsigned char)random(), (unsigned char)random(), (unsigned char)random(), 255 };
+		for (size_t i = 0; i < image.pixels.size(); i += 4)
+		{
+			for (int c = 0; c < 4; c++)
+				image.pixels[i + c] = solid || c == 3 ? color[c] : (unsigned char)random();
+		}
+		return image;
+	}
+
+	// Its rectangle with the gutter around it
+	AtlasRect GetCell(const AtlasEntry& entry, uint32_t gutter)
+	{
+		AtlasRect cell = { entry.x - gutter, entry.y - gutter, entry.width + gutter * 2, entry.height + gutter * 2 };
+		return cell;
+	}
+
+	bool Overlap(const AtlasRect& a, const AtlasRect& b)
+	{
+		return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+	}
+
+	// --------------------------------------------------------
+	// Entries sit on their pages, aligned, with their gutters
+	// apart, and each page texel in and around an entry is
+	// the image's nearest texel
+	// --------------------------------------------------------
+	bool CheckLayout(const TextureAtlas& atlas, const std::vector<Image>& images, const std::vector<std::string>& names)
+	{
+		const AtlasSettings& settings = atlas.GetSettings();
+		const std::vector<AtlasEntry>& entries = atlas.GetEntries();
+		const std::vector<AtlasPage>& pages = atlas.GetPages();
+		uint32_t g = settings.gutter;
+		if (!CHECK(entries.size() == images.size()))
+			return false;
+
+		for (size_t i = 0; i < pages.size(); i++)
+		{
+			if (!CHECK(pages[i].width <= settings.pageSize && (pages[i].width & (pages[i].width - 1)) == 0))
+				return false;
+		}
+
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			const AtlasEntry* entry = atlas.Find(names[i]);
+			const Image& image = images[i];
+			if (!CHECK(entry != 0) ||
+				!CHECK(entry->width == image.width && entry->height == image.height) ||
+				!CHECK(entry->page < pages.size()))
+				return false;
+
+			const AtlasPage& page = pages[entry->page];
+			if (!CHECK(entry->x % settings.alignment == 0 && entry->y % settings.alignment == 0) ||
+				!CHECK(entry->x >= g && entry->x + entry->width + g <= page.width) ||
+				!CHECK(entry->y >= g && entry->y + entry->height + g <= page.height) ||
+				!CHECK(entry->u0 == (float)entry->x / page.width && entry->v1 == (float)(entry->y + entry->height) / page.height))
+				return false;
+
+			for (size_t j = 0; j < names.size(); j++)
+			{
+				const AtlasEntry* other = atlas.Find(names[j]);
+				if (j != i && other->page == entry->page && !CHECK(!Overlap(GetCell(*entry, g), GetCell(*other, g))))
+					return false;
+			}
+
+			for (uint32_t y = 0; y < image.height + g * 2; y++)
+			{
+				uint32_t sourceY = y < g ? 0 : std::min(y - g, image.height - 1);
+				for (uint32_t x = 0; x < image.width + g * 2; x++)
+				{
+					uint32_t sourceX = x < g ? 0 : std::min(x - g, image.width - 1);
+					const unsigned char* expected = &image.pixels[((size_t)sourceY * image.width + sourceX) * 4];
+					const unsigned char* actual = &page.pixels[((size_t)(entry->y - g + y) * page.width + entry->x - g + x) * 4];
+					if (!CHECK(memcmp(expected, actual, 4) == 0))
+						return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	void TestBuild()
+	{
+		std::mt19937 random(3);
+		const AtlasPackMethod methods[] = { AtlasPack_MaxRects, AtlasPack_Skyline };
+		for (unsigned int m = 0; m < 2; m++)
+		{
+			AtlasSettings settings;
+			settings.pageSize = 256;
+			settings.gutter = 3;
+			settings.alignment = 4;
+			settings.method = methods[m];
+			TextureAtlas atlas;
+			atlas.SetSettings(settings);
+			CHECK(atlas.GetSettings().gutter == 4);
+
+			std::vector<Image> images;
+			std::vector<std::string> names;
+			for (unsigned int i = 0; i < 60; i++)
+			{
+				images.push_back(MakeImage(1 + random() % 50, 1 + random() % 50, random, false));
+				names.push_back("image" + std::to_string(i));
+				atlas.Add(names.back(), images.back());
+			}
+			if (!CHECK(atlas.Build()))
+				return;
+			CHECK(atlas.GetPages().size() > 1);
+			CheckLayout(atlas, images, names);
+
+			// Too big for a page, with its gutter
+			atlas.Add("huge", MakeImage(250, 10, random, true));
+			CHECK(!atlas.Build());
+		}
+	}
+
+	void TestInsert()
+	{
+		std::mt19937 random(8);
+		AtlasSettings settings;
+		settings.pageSize = 128;
+		settings.method = AtlasPack_Skyline;
+		TextureAtlas atlas;
+		atlas.SetSettings(settings);
+
+		std::vector<Image> images;
+		std::vector<std::string> names;
+		std::vector<uint32_t> dirty;
+		for (unsigned int i = 0; i < 40; i++)
+		{
+			images.push_back(MakeImage(1 + random() % 40, 1 + random() % 40, random, false));
+			names.push_back("sprite" + std::to_string(i));
+			const AtlasEntry* entry = atlas.Insert(names.back(), images.back());
+			if (!CHECK(entry != 0))
+				return;
+			atlas.TakeDirtyPages(dirty);
+			CHECK(dirty.size() == 1 && dirty[0] == entry->page);
+		}
+		CheckLayout(atlas, images, names);
+		CHECK(atlas.Insert("huge", MakeImage(125, 1, random, true)) == 0);
+	}
+
+	// --------------------------------------------------------
+	// Mips made with the filter actually used keep every
+	// texel an image's texture coordinates cover down to the
+	// safe level pure - solid images stay their own color
+	// --------------------------------------------------------
+	unsigned int CountBlendedTexels(const TextureAtlas& atlas, const std::vector<Image>& images,
+		const std::vector<std::string>& names, const std::vector<unsigned char>& chain,
+		uint32_t pageIndex, uint32_t level)
+	{
+		const AtlasPage& page = atlas.GetPages()[pageIndex];
+		size_t offset = 0;
+		uint32_t width = page.width;
+		uint32_t height = page.height;
+		for (uint32_t l = 0; l < level; l++)
+		{
+			offset += (size_t)width * height * 4;
+			width /= 2;
+			height /= 2;
+		}
+
+		unsigned int blended = 0;
+		uint32_t size = 1u << level;
+		for (size_t i = 0; i < names.size(); i++)
+		{
+			const AtlasEntry* entry = atlas.Find(names[i]);
+			if (entry->page != pageIndex)
+				continue;
+			const unsigned char* color = images[i].pixels.data();
+			for (uint32_t y = entry->y / size; y <= (entry->y + entry->height - 1) / size; y++)
+			{
+				for (uint32_t x = entry->x / size; x <= (entry->x + entry->width - 1) / size; x++)
+				{
+					const unsigned char* texel = &chain[offset + ((size_t)y * width + x) * 4];
+					for (int c = 0; c < 4; c++)
+					{
+						if (abs((int)texel[c] - (int)color[c]) > 1)
+						{
+							blended++;
+							break;
+						}
+					}
+				}
+			}
+		}
+		return blended;
+	}
+
+	void TestSafeMips()
+	{
+		std::mt19937 random(21);
+		TextureAtlas atlas;
+		AtlasSettings settings;
+		settings.pageSize = 512;
+		atlas.SetSettings(settings);
+
+		CHECK(atlas.GetSafeMipCount(MipFilter_Box) == 3);
+		CHECK(atlas.GetSafeMipCount(MipFilter_Kaiser) == 2);
+
+		std::vector<Image> images;
+		std::vector<std::string> names;
+		for (unsigned int i = 0; i < 80; i++)
+		{
+			images.push_back(MakeImage(1 + random() % 30, 1 + random() % 30, random, true));
+			names.push_back("solid" + std::to_string(i));
+			atlas.Add(names.back(), images.back());
+		}
+		if (!CHECK(atlas.Build()))
+			return;
+
+		const MipFilter filters[] = { MipFilter_Box, MipFilter_Kaiser };
+		for (unsigned int f = 0; f < 2; f++)
+		{
+			MipSettings mipSettings;
+			mipSettings.filter = filters[f];
+			uint32_t safe = atlas.GetSafeMipCount(filters[f]);
+			unsigned int blendedBelow = 0;
+			for (uint32_t p = 0; p < atlas.GetPages().size(); p++)
+			{
+				const AtlasPage& page = atlas.GetPages()[p];
+				std::vector<unsigned char> chain(MipGenerator::GetChainSize(page.width, page.height));
+				std::copy(page.pixels.begin(), page.pixels.end(), chain.begin());
+				uint32_t levels = MipGenerator::Generate(chain.data(), page.width, page.height, mipSettings);
+				if (!CHECK(levels > safe))
+					return;
+
+				for (uint32_t level = 0; level < safe; level++)
+					CHECK(CountBlendedTexels(atlas, images, names, chain, p, level) == 0);
+				blendedBelow += CountBlendedTexels(atlas, images, names, chain, p, safe);
+			}
+
+			// The first level past the safe ones does blend, so the
+			// count isn't just cautious
+			CHECK(blendedBelow > 0);
+		}
+	}
+
+	// --------------------------------------------------------
+	// What Save() writes, Load() reads back; bad lines are
+	// skipped and a wrong version reads nothing
+	// --------------------------------------------------------
+	void TestSaveAndParse()
+	{
+		std::mt19937 random(5);
+		TextureAtlas atlas;
+		for (unsigned int i = 0; i < 20; i++)
+			atlas.Add("folder/name " + std::to_string(i), MakeImage(1 + random() % 70, 1 + random() % 70, random, true));
+		if (!CHECK(atlas.Build()))
+			return;
+		for (uint32_t i = 0; i < atlas.GetPages().size(); i++)
+			atlas.SetPageFile(i, "ui_" + std::to_string(i) + ".dds");
+
+		const char* path = "EngineTests.atlas.tmp";
+		if (!CHECK(atlas.Save(path)))
+			return;
+		TextureAtlas loaded;
+		bool read = loaded.Load(path);
+		remove(path);
+		if (!CHECK(read))
+			return;
+
+		CHECK(loaded.GetDirectory().empty());
+		CHECK(loaded.GetPages().size() == atlas.GetPages().size());
+		for (size_t i = 0; i < atlas.GetPages().size() && i < loaded.GetPages().size(); i++)
+		{
+			const AtlasPage& a = atlas.GetPages()[i];
+			const AtlasPage& b = loaded.GetPages()[i];
+			CHECK(a.file == b.file && a.width == b.width && a.height == b.height && b.pixels.empty());
+		}
+		CHECK(loaded.GetEntries().size() == atlas.GetEntries().size());
+		for (size_t i = 0; i < atlas.GetEntries().size(); i++)
+		{
+			const AtlasEntry& a = atlas.GetEntries()[i];
+			const AtlasEntry* b = loaded.Find(a.name);
+			if (!CHECK(b != 0))
+				continue;
+			CHECK(a.page == b->page && a.x == b->x && a.y == b->y && a.width == b->width && a.height == b->height);
+			CHECK(a.u0 == b->u0 && a.v0 == b->v0 && a.u1 == b->u1 && a.v1 == b->v1);
+		}
+
+		TextureAtlas parsed;
+		CHECK(parsed.Parse(
+			"# comment\r\n"
+			"version\t1\r\n"
+			"page\t0\ta.dds\t64\t32\n"
+			"page\t5\tskipped.dds\t64\t64\n"
+			"image\tone\t0\t4\t8\t10\t12\n"
+			"image\toff page\t1\t0\t0\t1\t1\n"
+			"image\ttoo few\t0\t0\n"));
+		CHECK(parsed.GetPages().size() == 1 && parsed.GetEntries().size() == 1);
+		const AtlasEntry* one = parsed.Find("one");
+		CHECK(one && one->u1 == 14.0f / 64 && one->v1 == 20.0f / 32);
+
+		CHECK(!parsed.Parse("version\t2\npage\t0\ta.dds\t64\t64\n"));
+		CHECK(parsed.GetPages().empty());
+		CHECK(!parsed.Parse("page\t0\ta.dds\t64\t64\n"));
+	}
+}
+
+void RunTextureAtlasTests()
+{
+	TestBuild();
+	TestInsert();
+	TestSafeMips();
+	TestSaveAndParse();
+}
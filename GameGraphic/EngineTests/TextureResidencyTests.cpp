@@ -0,0 +1,287 @@
+#include "Test.h"
+#include "TextureResidency.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+	// --------------------------------------------------------
+	// A square texture's mip sizes, 4 bytes a texel
+	// --------------------------------------------------------
+	std::vector<size_t> MipSizes(uint32_t size)
+	{
+		std::vector<size_t> bytes;
+		for (; size > 0; size /= 2)
+			bytes.push_back((size_t)size * size * 4);
+		return bytes;
+	}
+
+	size_t TailBytes(const std::vector<size_t>& mipBytes, uint32_t firstMip)
+	{
+		size_t bytes = 0;
+		for (size_t i = firstMip; i < mipBytes.size(); i++)
+			bytes += mipBytes[i];
+		return bytes;
+	}
+
+	uint32_t AddSquare(TextureResidency& residency, uint32_t size, uint32_t pinnedMip)
+	{
+		std::vector<size_t> bytes = MipSizes(size);
+		return residency.AddTexture(bytes.data(), (uint32_t)bytes.size(), pinnedMip);
+	}
+
+	// Requests mip for every texture listed, then ends the frame
+	void RunFrame(TextureResidency& residency, const uint32_t* textures, unsigned int count, uint32_t mip,
+		std::vector<ResidencyChange>& changes, unsigned int maxLoads = 4)
+	{
+		for (unsigned int i = 0; i < count; i++)
+			residency.Request(textures[i], mip);
+		changes.clear();
+		residency.Update(changes, maxLoads);
+	}
+
+	// --------------------------------------------------------
+	// Random requests, budgets and textures coming and going,
+	// checked against what the changes say happened
+	// --------------------------------------------------------
+	void TestInvariants()
+	{
+		struct Shadow
+		{
+			std::vector<size_t>	mipBytes;
+			uint32_t			pinnedMip;
+			uint32_t			mip;			// As the changes tell it
+			bool				active;
+		};
+
+		std::mt19937 random(42);
+		TextureResidency residency;
+		residency.SetBudget(2 * 1024 * 1024);
+		std::vector<Shadow> shadows;
+		std::vector<uint32_t> requested;
+		std::vector<ResidencyChange> changes;
+
+		for (unsigned int frame = 0; frame < 3000; frame++)
+		{
+			// Textures come and go
+			if (random() % 8 == 0 || shadows.empty())
+			{
+				Shadow shadow;
+				shadow.mipBytes = MipSizes(16u << (random() % 6));
+				shadow.pinnedMip = (uint32_t)shadow.mipBytes.size() - 1 - random() % 3;
+				uint32_t index = residency.AddTexture(shadow.mipBytes.data(), (uint32_t)shadow.mipBytes.size(), shadow.pinnedMip);
+				shadow.mip = shadow.pinnedMip;
+				shadow.active = true;
+				if (!CHECK(residency.GetResidentMip(index) == shadow.pinnedMip))
+					return;
+				if (index >= shadows.size())
+					shadows.resize(index + 1);
+				shadows[index] = shadow;
+			}
+			if (random() % 16 == 0)
+			{
+				uint32_t index = random() % shadows.size();
+				residency.RemoveTexture(index);
+				shadows[index].active = false;
+			}
+			if (random() % 200 == 0)
+				residency.SetBudget((1 + random() % 8) * 512 * 1024);
+
+			// Some of them are used, some more than once
+			requested.assign(shadows.size(), (uint32_t)TextureResidency::InvalidTexture);
+			for (uint32_t i = 0; i < shadows.size(); i++)
+			{
+				if (!shadows[i].active || random() % 3 == 0)
+					continue;
+				for (unsigned int uses = 1 + random() % 2; uses > 0; uses--)
+				{
+					uint32_t mip = random() % shadows[i].mipBytes.size();
+					residency.Request(i, mip);
+					requested[i] = std::min(requested[i], mip);
+				}
+			}
+
+			changes.clear();
+			residency.Update(changes, 1 + random() % 6);
+
+			// Every change starts where the last one left off, and
+			// no texture has two
+			std::vector<bool> changed(shadows.size(), false);
+			bool loaded = false;
+			for (size_t c = 0; c < changes.size(); c++)
+			{
+				const ResidencyChange& change = changes[c];
+				if (!CHECK(change.texture < shadows.size() && shadows[change.texture].active) ||
+					!CHECK(change.oldMip == shadows[change.texture].mip) ||
+					!CHECK(change.newMip != change.oldMip) ||
+					!CHECK(!changed[change.texture]))
+					return;
+				changed[change.texture] = true;
+				loaded |= change.newMip < change.oldMip;
+				shadows[change.texture].mip = change.newMip;
+			}
+
+			size_t bytes = 0;
+			for (uint32_t i = 0; i < shadows.size(); i++)
+			{
+				const Shadow& shadow = shadows[i];
+				if (!shadow.active)
+					continue;
+
+				// The changes are the whole story, and the pinned
+				// tail is always there
+				uint32_t mip = residency.GetResidentMip(i);
+				if (!CHECK(mip == shadow.mip) ||
+					!CHECK(mip <= shadow.pinnedMip) ||
+					!CHECK(residency.GetTextureBytes(i) == TailBytes(shadow.mipBytes, mip)))
+					return;
+				bytes += residency.GetTextureBytes(i);
+
+				// Used this frame: never evicted past what it asked for
+				if (requested[i] != TextureResidency::InvalidTexture)
+				{
+					uint32_t wanted = std::min(requested[i], shadow.pinnedMip);
+					uint32_t before = mip;
+					for (size_t c = 0; c < changes.size(); c++)
+					{
+						if (changes[c].texture == i)
+							before = changes[c].oldMip;
+					}
+					if (!CHECK(residency.GetWantedMip(i) == wanted) ||
+						!CHECK(mip <= std::max(before, wanted)))
+						return;
+				}
+			}
+			// A smaller budget or new pinned tails can leave it over
+			// budget, but loads only ever happen within it
+			if (!CHECK(residency.GetResidentBytes() == bytes) ||
+				!CHECK(!loaded || bytes <= residency.GetBudget()))
+				return;
+		}
+	}
+
+	// --------------------------------------------------------
+	// Room is made from the least recently used texture first,
+	// and between textures last used together, from the one
+	// with the most detail it didn't ask for
+	// --------------------------------------------------------
+	void TestEvictionOrder()
+	{
+		std::vector<size_t> bytes = MipSizes(64);
+		size_t full = TailBytes(bytes, 0);
+
+		TextureResidency residency;
+		residency.SetBudget(full * 3 + TailBytes(bytes, 4));
+		uint32_t textures[4];
+		for (unsigned int i = 0; i < 4; i++)
+			textures[i] = AddSquare(residency, 64, 4);
+
+		// Load the first three one after another, oldest first
+		std::vector<ResidencyChange> changes;
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			for (unsigned int frame = 0; frame < 4; frame++)
+				RunFrame(residency, &textures[i], 1, 0, changes);
+			CHECK(residency.GetResidentMip(textures[i]) == 0);
+		}
+
+		// The fourth's first load takes from the oldest only
+		RunFrame(residency, &textures[3], 1, 3, changes, 1);
+		CHECK(residency.GetResidentMip(textures[3]) == 3);
+		CHECK(residency.GetResidentMip(textures[0]) == 1);
+		CHECK(residency.GetResidentMip(textures[1]) == 0);
+		CHECK(residency.GetResidentMip(textures[2]) == 0);
+		CHECK(changes.size() == 2);
+
+		// Using it again makes it the newest; the next oldest goes
+		RunFrame(residency, &textures[0], 1, 1, changes);
+		RunFrame(residency, &textures[3], 1, 0, changes);
+		CHECK(residency.GetResidentMip(textures[3]) == 0);
+		CHECK(residency.GetResidentMip(textures[1]) > 0);
+		CHECK(residency.GetResidentMip(textures[0]) == 1);
+
+		// Two textures last used in the same frame: the one
+		// holding more detail than it asked for goes first
+		TextureResidency tied;
+		tied.SetBudget(full * 2 + TailBytes(bytes, 4));
+		uint32_t a = AddSquare(tied, 64, 4);
+		uint32_t b = AddSquare(tied, 64, 4);
+		uint32_t c = AddSquare(tied, 64, 4);
+		uint32_t both[2] = { a, b };
+		for (unsigned int frame = 0; frame < 8; frame++)
+			RunFrame(tied, both, 2, 0, changes);
+		CHECK(tied.GetResidentMip(a) == 0 && tied.GetResidentMip(b) == 0);
+
+		tied.Request(a, 1);
+		tied.Request(b, 2);
+		tied.Request(c, 3);
+		changes.clear();
+		tied.Update(changes, 1);
+		CHECK(tied.GetResidentMip(c) == 3);
+		CHECK(tied.GetResidentMip(a) == 0);
+		CHECK(tied.GetResidentMip(b) == 1);
+		CHECK(changes.size() == 2);
+	}
+
+	// --------------------------------------------------------
+	// With the budget full of what this frame uses, loading
+	// stops rather than evicting it
+	// --------------------------------------------------------
+	void TestNoThrashing()
+	{
+		std::vector<size_t> bytes = MipSizes(64);
+		TextureResidency residency;
+		residency.SetBudget(TailBytes(bytes, 0) + TailBytes(bytes, 1));
+		uint32_t textures[2] = { AddSquare(residency, 64, 4), AddSquare(residency, 64, 4) };
+
+		std::vector<ResidencyChange> changes;
+		for (unsigned int frame = 0; frame < 10; frame++)
+			RunFrame(residency, textures, 2, 0, changes);
+		uint32_t first = residency.GetResidentMip(textures[0]);
+		uint32_t second = residency.GetResidentMip(textures[1]);
+		CHECK(std::min(first, second) == 0 && std::max(first, second) == 1);
+		CHECK(residency.GetResidentBytes() <= residency.GetBudget());
+
+		// Settled: asking again changes nothing
+		for (unsigned int frame = 0; frame < 10; frame++)
+		{
+			RunFrame(residency, textures, 2, 0, changes);
+			CHECK(changes.empty());
+		}
+
+		// Once one is no longer used, the other gets its room
+		RunFrame(residency, &textures[first == 0 ? 1 : 0], 1, 0, changes);
+		CHECK(residency.GetResidentMip(textures[0]) == 0 || residency.GetResidentMip(textures[1]) == 0);
+		CHECK(changes.size() == 2);
+
+		// A budget smaller than the pinned tails loads nothing
+		// and evicts nothing pinned
+		TextureResidency tight;
+		tight.SetBudget(1);
+		uint32_t pinned = AddSquare(tight, 64, 3);
+		CHECK(tight.GetResidentBytes() == TailBytes(bytes, 3));
+		RunFrame(tight, &pinned, 1, 0, changes);
+		CHECK(changes.empty() && tight.GetResidentMip(pinned) == 3);
+	}
+
+	void TestSelectMip()
+	{
+		CHECK(TextureResidency::SelectMip(1024, 1024, 11, 1024.0f) == 0);
+		CHECK(TextureResidency::SelectMip(1024, 1024, 11, 2000.0f) == 0);
+		CHECK(TextureResidency::SelectMip(1024, 1024, 11, 512.0f) == 1);
+		CHECK(TextureResidency::SelectMip(1024, 512, 11, 300.0f) == 1);
+		CHECK(TextureResidency::SelectMip(1024, 1024, 11, 1.0f) == 10);
+		CHECK(TextureResidency::SelectMip(1024, 1024, 5, 1.0f) == 4);
+		CHECK(TextureResidency::SelectMip(1024, 1024, 11, 0.0f) == 10);
+		CHECK(TextureResidency::SelectMip(1024, 1024, 11, 1024.0f, 1.0f) == 1);
+	}
+}
+
+void RunTextureResidencyTests()
+{
+	TestInvariants();
+	TestEvictionOrder();
+	TestNoThrashing();
+	TestSelectMip();
+}
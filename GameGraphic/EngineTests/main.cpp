@@ -0,0 +1,108 @@
+#include "Test.h"
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	struct Suite
+	{
+		const char*		name;
+		void			(*run)();
+	};
+
+	const Suite tests[] =
+	{
+		{ "jobs", RunJobSystemTests },
+		{ "limiter", RunFrameLimiterTests },
+		{ "framestats", RunFrameStatsTests },
+		{ "frameallocator", RunFrameAllocatorTests },
+		{ "ranges", RunRangeAllocatorTests },
+		{ "dds", RunDdsFileTests },
+		{ "lz4", RunLz4Tests },
+		{ "mips", RunMipGeneratorTests },
+		{ "resourcecache", RunResourceCacheTests },
+		{ "residency", RunTextureResidencyTests },
+		{ "atlas", RunTextureAtlasTests },
+	};
+
+	const Suite benchmarks[] =
+	{
+		{ "jobs", RunJobSystemBenchmark },
+		{ "ranges", RunRangeAllocatorBenchmark },
+	};
+
+	void PrintUsage()
+	{
+		printf(
+			"Usage: EngineTests [suite]...\n"
+			"       EngineTests -b [benchmark]...\n"
+			"\n"
+			"Runs the engine's headless tests (or with -b, its benchmarks),\n"
+			"all of them unless some are named.  Exits with 1 if a check failed.\n"
+			"\n"
+			"Suites:");
+		for (unsigned int i = 0; i < sizeof(tests) / sizeof(tests[0]); i++)
+			printf(" %s", tests[i].name);
+		printf("\nBenchmarks:");
+		for (unsigned int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+			printf(" %s", benchmarks[i].name);
+		printf("\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const Suite* suites = tests;
+	unsigned int suiteCount = sizeof(tests) / sizeof(tests[0]);
+
+	int first = 1;
+	if (argc > 1 && strcmp(argv[1], "-b") == 0)
+	{
+		suites = benchmarks;
+		suiteCount = sizeof(benchmarks) / sizeof(benchmarks[0]);
+		first = 2;
+	}
+	else if (argc > 1 && (strcmp(argv[1], "-h") == 0 || strcmp(argv[1], "--help") == 0))
+	{
+		PrintUsage();
+		return 0;
+	}
+
+	for (int i = first; i < argc; i++)
+	{
+		bool known = false;
+		for (unsigned int s = 0; s < suiteCount; s++)
+			known |= strcmp(argv[i], suites[s].name) == 0;
+		if (!known)
+		{
+			fprintf(stderr, "Unknown suite: %s\n\n", argv[i]);
+			PrintUsage();
+			return 2;
+		}
+	}
+
+	for (unsigned int s = 0; s < suiteCount; s++)
+	{
+		bool selected = argc <= first;
+		for (int i = first; i < argc; i++)
+			selected |= strcmp(argv[i], suites[s].name) == 0;
+		if (!selected)
+			continue;
+
+		unsigned int failuresBefore = Test::GetFailureCount();
+		double start = Test::NowMs();
+		printf("[ %s ]\n", suites[s].name);
+		fflush(stdout);
+		suites[s].run();
+		printf("[ %s ] %s (%.0fms)\n", suites[s].name,
+			Test::GetFailureCount() == failuresBefore ? "passed" : "FAILED", Test::NowMs() - start);
+	}
+
+	unsigned int failures = Test::GetFailureCount();
+	if (failures > 0)
+	{
+		printf("%u check(s) failed\n", failures);
+		return 1;
+	}
+	return 0;
+}
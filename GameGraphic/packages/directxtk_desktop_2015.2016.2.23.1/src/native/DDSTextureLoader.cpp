@@ -28,11 +28,110 @@
 
 using namespace DirectX;
 
+namespace
+{
+    struct view_closer { void operator()(const void* p) { if (p) UnmapViewOfFile(p); } };
+
+    typedef std::unique_ptr<const void, view_closer> ScopedView;
+
+    // What the headers of a DDS file describe, without the surface data
+    struct DDS_TEXTURE_INFO
+    {
+        D3D11_RESOURCE_DIMENSION    resDim;
+        unsigned int                width;
+        unsigned int                height;
+        unsigned int                depth;
+        unsigned int                arraySize;  // Already multiplied by 6 for cubemaps
+        unsigned int                mipCount;
+        DXGI_FORMAT                 format;
+        bool                        isCubeMap;
+    };
+}
+
+
+//--------------------------------------------------------------------------------------
+static HANDLE OpenFileForRead( _In_z_ const wchar_t* fileName )
+{
+#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
+    return safe_handle( CreateFile2( fileName,
+                                     GENERIC_READ,
+                                     FILE_SHARE_READ,
+                                     OPEN_EXISTING,
+                                     nullptr ) );
+#else
+    return safe_handle( CreateFileW( fileName,
+                                     GENERIC_READ,
+                                     FILE_SHARE_READ,
+                                     nullptr,
+                                     OPEN_EXISTING,
+                                     FILE_ATTRIBUTE_NORMAL,
+                                     nullptr ) );
+#endif
+}
+
+
+//--------------------------------------------------------------------------------------
+// Checks the magic number and headers at the start of a DDS file, and finds where the
+// surface data starts
+//--------------------------------------------------------------------------------------
+static HRESULT ValidateHeader( _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+                               _In_ size_t ddsDataSize,
+                               _Outptr_ const DDS_HEADER** header,
+                               _Out_ size_t* offset )
+{
+    // Need at least enough data to fill the header and magic number to be a valid DDS
+    if (ddsDataSize < ( sizeof(DDS_HEADER) + sizeof(uint32_t) ) )
+    {
+        return E_FAIL;
+    }
+
+    // DDS files always start with the same magic number ("DDS ")
+    uint32_t dwMagicNumber = *( const uint32_t* )( ddsData );
+    if (dwMagicNumber != DDS_MAGIC)
+    {
+        return E_FAIL;
+    }
+
+    auto hdr = reinterpret_cast<const DDS_HEADER*>( ddsData + sizeof( uint32_t ) );
+
+    // Verify header to validate DDS file
+    if (hdr->size != sizeof(DDS_HEADER) ||
+        hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    {
+        return E_FAIL;
+    }
+
+    // Check for DX10 extension
+    bool bDXT10Header = false;
+    if ((hdr->ddspf.flags & DDS_FOURCC) &&
+        (MAKEFOURCC( 'D', 'X', '1', '0' ) == hdr->ddspf.fourCC))
+    {
+        // Must be long enough for both headers and magic value
+        if (ddsDataSize < ( sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10) ) )
+        {
+            return E_FAIL;
+        }
+
+        bDXT10Header = true;
+    }
+
+    *header = hdr;
+    *offset = sizeof( uint32_t ) + sizeof( DDS_HEADER )
+              + (bDXT10Header ? sizeof( DDS_HEADER_DXT10 ) : 0);
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Maps the file read-only instead of reading it into a heap copy, so the subresource
+// data given to D3D points straight at the file's pages.  The view is released when
+// ddsData goes out of scope, once the texture has been created.
 //--------------------------------------------------------------------------------------
 static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
-                                        std::unique_ptr<uint8_t[]>& ddsData,
-                                        DDS_HEADER** header,
-                                        uint8_t** bitData,
+                                        ScopedView& ddsData,
+                                        const DDS_HEADER** header,
+                                        const uint8_t** bitData,
                                         size_t* bitSize
                                       )
 {
@@ -42,21 +141,7 @@ static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
     }
 
     // open the file
-#if (_WIN32_WINNT >= _WIN32_WINNT_WIN8)
-    ScopedHandle hFile( safe_handle( CreateFile2( fileName,
-                                                  GENERIC_READ,
-                                                  FILE_SHARE_READ,
-                                                  OPEN_EXISTING,
-                                                  nullptr ) ) );
-#else
-    ScopedHandle hFile( safe_handle( CreateFileW( fileName,
-                                                  GENERIC_READ,
-                                                  FILE_SHARE_READ,
-                                                  nullptr,
-                                                  OPEN_EXISTING,
-                                                  FILE_ATTRIBUTE_NORMAL,
-                                                  nullptr ) ) );
-#endif
+    ScopedHandle hFile( OpenFileForRead( fileName ) );
 
     if ( !hFile )
     {
@@ -77,7 +162,7 @@ static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
     GetFileSizeEx( hFile.get(), &FileSize );
 #endif
 
-    // File is too big for 32-bit allocation, so reject read
+    // File is too big for a 32-bit view, so reject it
     if (FileSize.HighPart > 0)
     {
         return E_FAIL;
@@ -89,65 +174,35 @@ static HRESULT LoadTextureDataFromFile( _In_z_ const wchar_t* fileName,
         return E_FAIL;
     }
 
-    // create enough space for the file data
-    ddsData.reset( new (std::nothrow) uint8_t[ FileSize.LowPart ] );
-    if (!ddsData)
-    {
-        return E_OUTOFMEMORY;
-    }
-
-    // read the data in
-    DWORD BytesRead = 0;
-    if (!ReadFile( hFile.get(),
-                   ddsData.get(),
-                   FileSize.LowPart,
-                   &BytesRead,
-                   nullptr
-                 ))
+    // map the whole file; the view keeps the mapping alive, so neither handle is
+    // needed once it exists
+    ScopedHandle hMapping( CreateFileMappingW( hFile.get(),
+                                               nullptr,
+                                               PAGE_READONLY,
+                                               0,
+                                               0,
+                                               nullptr ) );
+    if ( !hMapping )
     {
         return HRESULT_FROM_WIN32( GetLastError() );
     }
 
-    if (BytesRead < FileSize.LowPart)
+    ddsData.reset( MapViewOfFile( hMapping.get(), FILE_MAP_READ, 0, 0, 0 ) );
+    if ( !ddsData )
     {
-        return E_FAIL;
-    }
-
-    // DDS files always start with the same magic number ("DDS ")
-    uint32_t dwMagicNumber = *( const uint32_t* )( ddsData.get() );
-    if (dwMagicNumber != DDS_MAGIC)
-    {
-        return E_FAIL;
-    }
-
-    auto hdr = reinterpret_cast<DDS_HEADER*>( ddsData.get() + sizeof( uint32_t ) );
-
-    // Verify header to validate DDS file
-    if (hdr->size != sizeof(DDS_HEADER) ||
-        hdr->ddspf.size != sizeof(DDS_PIXELFORMAT))
-    {
-        return E_FAIL;
+        return HRESULT_FROM_WIN32( GetLastError() );
     }
 
-    // Check for DX10 extension
-    bool bDXT10Header = false;
-    if ((hdr->ddspf.flags & DDS_FOURCC) &&
-        (MAKEFOURCC( 'D', 'X', '1', '0' ) == hdr->ddspf.fourCC))
+    auto bytes = static_cast<const uint8_t*>( ddsData.get() );
+    size_t offset = 0;
+    HRESULT hr = ValidateHeader( bytes, FileSize.LowPart, header, &offset );
+    if (FAILED(hr))
     {
-        // Must be long enough for both headers and magic value
-        if (FileSize.LowPart < ( sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10) ) )
-        {
-            return E_FAIL;
-        }
-
-        bDXT10Header = true;
+        return hr;
     }
 
     // setup the pointers in the process request
-    *header = hdr;
-    ptrdiff_t offset = sizeof( uint32_t ) + sizeof( DDS_HEADER )
-                       + (bDXT10Header ? sizeof( DDS_HEADER_DXT10 ) : 0);
-    *bitData = ddsData.get() + offset;
+    *bitData = bytes + offset;
     *bitSize = FileSize.LowPart - offset;
 
     return S_OK;
@@ -1070,26 +1125,39 @@ static HRESULT CreateD3DResources( _In_ ID3D11Device* d3dDevice,
 
 
 //--------------------------------------------------------------------------------------
-static HRESULT CreateTextureFromDDS( _In_ ID3D11Device* d3dDevice,
-                                     _In_opt_ ID3D11DeviceContext* d3dContext,
-#if defined(_XBOX_ONE) && defined(_TITLE)
-                                     _In_opt_ ID3D11DeviceX* d3dDeviceX,
-                                     _In_opt_ ID3D11DeviceContextX* d3dContextX,
-#endif
-                                     _In_ const DDS_HEADER* header,
-                                     _In_reads_bytes_(bitSize) const uint8_t* bitData,
-                                     _In_ size_t bitSize,
-                                     _In_ size_t maxsize,
-                                     _In_ D3D11_USAGE usage,
-                                     _In_ unsigned int bindFlags,
-                                     _In_ unsigned int cpuAccessFlags,
-                                     _In_ unsigned int miscFlags,
-                                     _In_ bool forceSRGB,
-                                     _Outptr_opt_ ID3D11Resource** texture,
-                                     _Outptr_opt_ ID3D11ShaderResourceView** textureView )
+static DDS_ALPHA_MODE GetAlphaMode( _In_ const DDS_HEADER* header )
 {
-    HRESULT hr = S_OK;
+    if ( header->ddspf.flags & DDS_FOURCC )
+    {
+        if ( MAKEFOURCC( 'D', 'X', '1', '0' ) == header->ddspf.fourCC )
+        {
+            auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>( (const char*)header + sizeof(DDS_HEADER) );
+            auto mode = static_cast<DDS_ALPHA_MODE>( d3d10ext->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK );
+            switch( mode )
+            {
+            case DDS_ALPHA_MODE_STRAIGHT:
+            case DDS_ALPHA_MODE_PREMULTIPLIED:
+            case DDS_ALPHA_MODE_OPAQUE:
+            case DDS_ALPHA_MODE_CUSTOM:
+                return mode;
+            }
+        }
+        else if ( ( MAKEFOURCC( 'D', 'X', 'T', '2' ) == header->ddspf.fourCC )
+                  || ( MAKEFOURCC( 'D', 'X', 'T', '4' ) == header->ddspf.fourCC ) )
+        {
+            return DDS_ALPHA_MODE_PREMULTIPLIED;
+        }
+    }
 
+    return DDS_ALPHA_MODE_UNKNOWN;
+}
+
+
+//--------------------------------------------------------------------------------------
+// Interprets the headers without touching the surface data
+//--------------------------------------------------------------------------------------
+static HRESULT GetTextureInfo( _In_ const DDS_HEADER* header, _Out_ DDS_TEXTURE_INFO& info )
+{
     UINT width = header->width;
     UINT height = header->height;
     UINT depth = header->depth;
@@ -1256,6 +1324,56 @@ static HRESULT CreateTextureFromDDS( _In_ ID3D11Device* d3dDevice,
         return HRESULT_FROM_WIN32( ERROR_NOT_SUPPORTED );
     }
 
+    info.resDim = static_cast<D3D11_RESOURCE_DIMENSION>( resDim );
+    info.width = width;
+    info.height = height;
+    info.depth = depth;
+    info.arraySize = arraySize;
+    info.mipCount = static_cast<UINT>( mipCount );
+    info.format = format;
+    info.isCubeMap = isCubeMap;
+
+    return S_OK;
+}
+
+
+//--------------------------------------------------------------------------------------
+static HRESULT CreateTextureFromDDS( _In_ ID3D11Device* d3dDevice,
+                                     _In_opt_ ID3D11DeviceContext* d3dContext,
+#if defined(_XBOX_ONE) && defined(_TITLE)
+                                     _In_opt_ ID3D11DeviceX* d3dDeviceX,
+                                     _In_opt_ ID3D11DeviceContextX* d3dContextX,
+#endif
+                                     _In_ const DDS_HEADER* header,
+                                     _In_reads_bytes_(bitSize) const uint8_t* bitData,
+                                     _In_ size_t bitSize,
+                                     _In_ size_t maxsize,
+                                     _In_ D3D11_USAGE usage,
+                                     _In_ unsigned int bindFlags,
+                                     _In_ unsigned int cpuAccessFlags,
+                                     _In_ unsigned int miscFlags,
+                                     _In_ bool forceSRGB,
+                                     _Outptr_opt_ ID3D11Resource** texture,
+                                     _Outptr_opt_ ID3D11ShaderResourceView** textureView )
+{
+    HRESULT hr = S_OK;
+
+    DDS_TEXTURE_INFO info;
+    hr = GetTextureInfo( header, info );
+    if ( FAILED(hr) )
+    {
+        return hr;
+    }
+
+    UINT width = info.width;
+    UINT height = info.height;
+    UINT depth = info.depth;
+    uint32_t resDim = info.resDim;
+    UINT arraySize = info.arraySize;
+    DXGI_FORMAT format = info.format;
+    bool isCubeMap = info.isCubeMap;
+    size_t mipCount = info.mipCount;
+
     bool autogen = false;
     if ( mipCount == 1 && d3dContext != 0 && textureView != 0 ) // Must have context and shader-view to auto generate mipmaps
     {
@@ -1502,35 +1620,6 @@ static HRESULT CreateTextureFromDDS( _In_ ID3D11Device* d3dDevice,
 }
 
 
-//--------------------------------------------------------------------------------------
-static DDS_ALPHA_MODE GetAlphaMode( _In_ const DDS_HEADER* header )
-{
-    if ( header->ddspf.flags & DDS_FOURCC )
-    {
-        if ( MAKEFOURCC( 'D', 'X', '1', '0' ) == header->ddspf.fourCC )
-        {
-            auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>( (const char*)header + sizeof(DDS_HEADER) );
-            auto mode = static_cast<DDS_ALPHA_MODE>( d3d10ext->miscFlags2 & DDS_MISC_FLAGS2_ALPHA_MODE_MASK );
-            switch( mode )
-            {
-            case DDS_ALPHA_MODE_STRAIGHT:
-            case DDS_ALPHA_MODE_PREMULTIPLIED:
-            case DDS_ALPHA_MODE_OPAQUE:
-            case DDS_ALPHA_MODE_CUSTOM:
-                return mode;
-            }
-        }
-        else if ( ( MAKEFOURCC( 'D', 'X', 'T', '2' ) == header->ddspf.fourCC )
-                  || ( MAKEFOURCC( 'D', 'X', 'T', '4' ) == header->ddspf.fourCC ) )
-        {
-            return DDS_ALPHA_MODE_PREMULTIPLIED;
-        }
-    }
-
-    return DDS_ALPHA_MODE_UNKNOWN;
-}
-
-
 //--------------------------------------------------------------------------------------
 _Use_decl_annotations_
 HRESULT DirectX::CreateDDSTextureFromMemory( ID3D11Device* d3dDevice,
@@ -1599,51 +1688,21 @@ HRESULT DirectX::CreateDDSTextureFromMemoryEx( ID3D11Device* d3dDevice,
     }
 
     // Validate DDS file in memory
-    if (ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
-    {
-        return E_FAIL;
-    }
-
-    uint32_t dwMagicNumber = *( const uint32_t* )( ddsData );
-    if (dwMagicNumber != DDS_MAGIC)
-    {
-        return E_FAIL;
-    }
-
-    auto header = reinterpret_cast<const DDS_HEADER*>( ddsData + sizeof( uint32_t ) );
-
-    // Verify header to validate DDS file
-    if (header->size != sizeof(DDS_HEADER) ||
-        header->ddspf.size != sizeof(DDS_PIXELFORMAT))
-    {
-        return E_FAIL;
-    }
-
-    // Check for DX10 extension
-    bool bDXT10Header = false;
-    if ((header->ddspf.flags & DDS_FOURCC) &&
-        (MAKEFOURCC( 'D', 'X', '1', '0' ) == header->ddspf.fourCC) )
+    const DDS_HEADER* header = nullptr;
+    size_t offset = 0;
+    HRESULT hr = ValidateHeader( ddsData, ddsDataSize, &header, &offset );
+    if (FAILED(hr))
     {
-        // Must be long enough for both headers and magic value
-        if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
-        {
-            return E_FAIL;
-        }
-
-        bDXT10Header = true;
+        return hr;
     }
 
-    ptrdiff_t offset = sizeof( uint32_t )
-                       + sizeof( DDS_HEADER )
-                       + (bDXT10Header ? sizeof( DDS_HEADER_DXT10 ) : 0);
-
-    HRESULT hr = CreateTextureFromDDS( d3dDevice, nullptr,
+    hr = CreateTextureFromDDS( d3dDevice, nullptr,
 #if defined(_XBOX_ONE) && defined(_TITLE)
-                                       nullptr, nullptr,
+                               nullptr, nullptr,
 #endif
-                                       header, ddsData + offset, ddsDataSize - offset, maxsize,
-                                       usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
-                                       texture, textureView );
+                               header, ddsData + offset, ddsDataSize - offset, maxsize,
+                               usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
+                               texture, textureView );
     if ( SUCCEEDED(hr) )
     {
         if (texture != 0 && *texture != 0)
@@ -1702,51 +1761,21 @@ HRESULT DirectX::CreateDDSTextureFromMemoryEx( ID3D11Device* d3dDevice,
     }
 
     // Validate DDS file in memory
-    if (ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
-    {
-        return E_FAIL;
-    }
-
-    uint32_t dwMagicNumber = *( const uint32_t* )( ddsData );
-    if (dwMagicNumber != DDS_MAGIC)
-    {
-        return E_FAIL;
-    }
-
-    auto header = reinterpret_cast<const DDS_HEADER*>( ddsData + sizeof( uint32_t ) );
-
-    // Verify header to validate DDS file
-    if (header->size != sizeof(DDS_HEADER) ||
-        header->ddspf.size != sizeof(DDS_PIXELFORMAT))
-    {
-        return E_FAIL;
-    }
-
-    // Check for DX10 extension
-    bool bDXT10Header = false;
-    if ((header->ddspf.flags & DDS_FOURCC) &&
-        (MAKEFOURCC( 'D', 'X', '1', '0' ) == header->ddspf.fourCC) )
+    const DDS_HEADER* header = nullptr;
+    size_t offset = 0;
+    HRESULT hr = ValidateHeader( ddsData, ddsDataSize, &header, &offset );
+    if (FAILED(hr))
     {
-        // Must be long enough for both headers and magic value
-        if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
-        {
-            return E_FAIL;
-        }
-
-        bDXT10Header = true;
+        return hr;
     }
 
-    ptrdiff_t offset = sizeof( uint32_t )
-                       + sizeof( DDS_HEADER )
-                       + (bDXT10Header ? sizeof( DDS_HEADER_DXT10 ) : 0);
-
-    HRESULT hr = CreateTextureFromDDS( d3dDevice, d3dContext,
+    hr = CreateTextureFromDDS( d3dDevice, d3dContext,
 #if defined(_XBOX_ONE) && defined(_TITLE)
-                                       d3dDevice, d3dContext,
+                               d3dDevice, d3dContext,
 #endif
-                                       header, ddsData + offset, ddsDataSize - offset, maxsize,
-                                       usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
-                                       texture, textureView );
+                               header, ddsData + offset, ddsDataSize - offset, maxsize,
+                               usage, bindFlags, cpuAccessFlags, miscFlags, forceSRGB,
+                               texture, textureView );
     if ( SUCCEEDED(hr) )
     {
         if (texture != 0 && *texture != 0)
@@ -1830,11 +1859,11 @@ HRESULT DirectX::CreateDDSTextureFromFileEx( ID3D11Device* d3dDevice,
         return E_INVALIDARG;
     }
 
-    DDS_HEADER* header = nullptr;
-    uint8_t* bitData = nullptr;
+    const DDS_HEADER* header = nullptr;
+    const uint8_t* bitData = nullptr;
     size_t bitSize = 0;
 
-    std::unique_ptr<uint8_t[]> ddsData;
+    ScopedView ddsData;
     HRESULT hr = LoadTextureDataFromFile( fileName,
                                           ddsData,
                                           &header,
@@ -1955,11 +1984,11 @@ HRESULT DirectX::CreateDDSTextureFromFileEx( ID3D11Device* d3dDevice,
         return E_INVALIDARG;
     }
 
-    DDS_HEADER* header = nullptr;
-    uint8_t* bitData = nullptr;
+    const DDS_HEADER* header = nullptr;
+    const uint8_t* bitData = nullptr;
     size_t bitSize = 0;
 
-    std::unique_ptr<uint8_t[]> ddsData;
+    ScopedView ddsData;
     HRESULT hr = LoadTextureDataFromFile( fileName,
                                           ddsData,
                                           &header,
@@ -27,6 +27,25 @@ using namespace DirectX;
 using Microsoft::WRL::ComPtr;
 
 
+namespace
+{
+    // Maps a float to an unsigned integer that sorts in the same order: positive values
+    // get their sign bit set, and negative ones have every bit flipped so larger
+    // magnitudes come first.
+    inline uint32_t FloatToSortableKey(float value)
+    {
+        // Treat -0 and +0 as equal, like the comparisons this replaces.
+        if (value == 0)
+            value = 0;
+
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        return (bits & 0x80000000) ? ~bits : (bits | 0x80000000);
+    }
+}
+
+
 // Internal SpriteBatch implementation class.
 __declspec(align(16)) class SpriteBatch::Impl : public AlignedNew<SpriteBatch::Impl>
 {
@@ -68,6 +87,7 @@ private:
     void PrepareForRendering();
     void FlushBatch();
     void SortSprites();
+    void SortEntriesByKey(size_t keyBytes);
     void GrowSortedSprites();
 
     void RenderBatch(_In_ ID3D11ShaderResourceView* texture, _In_reads_(count) SpriteInfo const* const* sprites, size_t count);
@@ -100,6 +120,18 @@ private:
     std::vector<SpriteInfo const*> mSortedSprites;
 
 
+    // Sorting compares integer keys pulled out of each sprite once, rather than chasing
+    // the pointers above for every comparison. Scratch space, reused between batches.
+    struct SortEntry
+    {
+        uint64_t key;
+        SpriteInfo const* sprite;
+    };
+
+    std::vector<SortEntry> mSortEntries;
+    std::vector<SortEntry> mSortScratch;
+
+
     // If each SpriteInfo instance held a refcount on its texture, could end up with
     // many redundant AddRef/Release calls on the same object, so instead we use
     // this separate list to hold just a single refcount each time we change texture.
@@ -651,31 +683,120 @@ void SpriteBatch::Impl::SortSprites()
         GrowSortedSprites();
     }
 
+    size_t keyBytes;
+
     switch (mSortMode)
     {
         case SpriteSortMode_Texture:
-            // Sort by texture.
-            std::sort(mSortedSprites.begin(), mSortedSprites.begin() + mSpriteQueueCount, [](SpriteInfo const* x, SpriteInfo const* y) -> bool
-            {
-                return x->texture < y->texture;
-            });
+            keyBytes = sizeof(uintptr_t);
             break;
 
         case SpriteSortMode_BackToFront:
-            // Sort back to front.
-            std::sort(mSortedSprites.begin(), mSortedSprites.begin() + mSpriteQueueCount, [](SpriteInfo const* x, SpriteInfo const* y) -> bool
-            {
-                return x->originRotationDepth.w > y->originRotationDepth.w;
-            });
-            break;
-
         case SpriteSortMode_FrontToBack:
-            // Sort front to back.
-            std::sort(mSortedSprites.begin(), mSortedSprites.begin() + mSpriteQueueCount, [](SpriteInfo const* x, SpriteInfo const* y) -> bool
-            {
-                return x->originRotationDepth.w < y->originRotationDepth.w;
-            });
+            keyBytes = sizeof(uint32_t);
             break;
+
+        default:
+            return;
+    }
+
+    // Extract one key per sprite, walking the queue in order. mSortedSprites still
+    // holds the queue order here, as it is never reused once sorted.
+    mSortEntries.resize(mSpriteQueueCount);
+
+    for (size_t i = 0; i < mSpriteQueueCount; i++)
+    {
+        SpriteInfo const* sprite = mSortedSprites[i];
+        uint64_t key;
+
+        switch (mSortMode)
+        {
+            case SpriteSortMode_Texture:
+                // Sort by texture.
+                key = reinterpret_cast<uintptr_t>(sprite->texture);
+                break;
+
+            case SpriteSortMode_BackToFront:
+                // Sort back to front.
+                key = static_cast<uint32_t>(~FloatToSortableKey(sprite->originRotationDepth.w));
+                break;
+
+            default:
+                // Sort front to back.
+                key = FloatToSortableKey(sprite->originRotationDepth.w);
+                break;
+        }
+
+        mSortEntries[i].key = key;
+        mSortEntries[i].sprite = sprite;
+    }
+
+    SortEntriesByKey(keyBytes);
+
+    for (size_t i = 0; i < mSpriteQueueCount; i++)
+    {
+        mSortedSprites[i] = mSortEntries[i].sprite;
+    }
+}
+
+
+// Least significant digit radix sort of mSortEntries, one byte per pass. Being stable,
+// sprites with equal keys stay in the order they were drawn. Passes where every key has
+// the same byte (such as the high bytes of texture pointers) are skipped.
+void SpriteBatch::Impl::SortEntriesByKey(size_t keyBytes)
+{
+    size_t count = mSortEntries.size();
+
+    if (count < 2)
+        return;
+
+    // Histogram every byte of every key in a single pass.
+    size_t histograms[sizeof(uint64_t)][256] = {};
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint64_t key = mSortEntries[i].key;
+
+        for (size_t byte = 0; byte < keyBytes; byte++)
+        {
+            histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+        }
+    }
+
+    mSortScratch.resize(count);
+
+    SortEntry* source = mSortEntries.data();
+    SortEntry* dest = mSortScratch.data();
+
+    for (size_t byte = 0; byte < keyBytes; byte++)
+    {
+        size_t* histogram = histograms[byte];
+        size_t shift = byte * 8;
+
+        if (histogram[(source[0].key >> shift) & 0xFF] == count)
+            continue;
+
+        // Turn the counts into where each byte value starts.
+        size_t offset = 0;
+
+        for (size_t value = 0; value < 256; value++)
+        {
+            size_t valueCount = histogram[value];
+            histogram[value] = offset;
+            offset += valueCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            dest[histogram[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+
+        std::swap(source, dest);
+    }
+
+    if (source != mSortEntries.data())
+    {
+        memcpy(mSortEntries.data(), source, count * sizeof(SortEntry));
     }
 }
 